@@ -0,0 +1,131 @@
+#include "bench-common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "error-handling.h"
+#include "metadata-util.h"
+
+/** Returns the current time of the monotonic clock in seconds. */
+double benchGetSeconds(void)
+{
+  struct timespec time;
+  if(clock_gettime(CLOCK_MONOTONIC, &time) != 0)
+  {
+    dieErrno("failed to read monotonic clock");
+  }
+  return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+/** Prints the throughput of a measured operation.
+
+  @param name The name of the measured operation.
+  @param operations The amount of operations performed in the given time.
+  @param unit The name of a single operation, e.g. "nodes".
+  @param seconds The time it took to perform all operations.
+*/
+void benchPrintRate(const char *name, const size_t operations, const char *unit, const double seconds)
+{
+  printf("%s: %zu %s in %.3fs, %.0f %s/s\n", name, operations, unit, seconds, (double)operations / seconds,
+         unit);
+}
+
+/** The amount of unmeasured runs before the measurement of a function
+  starts. They populate caches and let the CPU clock up. */
+#define BENCH_WARM_UP_RUNS 1
+
+/** The amount of measured runs of a function. */
+#define BENCH_RUNS 5
+
+static int compareDoubles(const void *a, const void *b)
+{
+  const double value_a = *(const double *)a;
+  const double value_b = *(const double *)b;
+  return (value_a > value_b) - (value_a < value_b);
+}
+
+/** Returns the median of the given sorted values. */
+static double getMedian(const double *values, const size_t count)
+{
+  return count % 2 == 1 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+/** Runs the given function repeatedly and prints the median rate of its
+  operations. The variation between runs is printed as median absolute
+  deviation, which is not skewed by single outliers.
+
+  @param name The name of the measured operation.
+  @param unit The name of a single operation, e.g. "nodes".
+  @param function The function to measure. It must perform the same
+  amount of work on each call.
+  @param user_data Will be passed to the given function.
+*/
+void benchRepeat(const char *name, const char *unit, BenchFunction *function, void *user_data)
+{
+  for(size_t run = 0; run < BENCH_WARM_UP_RUNS; run++)
+  {
+    (void)function(user_data);
+  }
+
+  size_t operations = 0;
+  double seconds[BENCH_RUNS];
+  for(size_t run = 0; run < BENCH_RUNS; run++)
+  {
+    const double start = benchGetSeconds();
+    operations = function(user_data);
+    seconds[run] = benchGetSeconds() - start;
+  }
+
+  qsort(seconds, BENCH_RUNS, sizeof(seconds[0]), compareDoubles);
+  const double median = getMedian(seconds, BENCH_RUNS);
+
+  double deviations[BENCH_RUNS];
+  for(size_t run = 0; run < BENCH_RUNS; run++)
+  {
+    deviations[run] = seconds[run] > median ? seconds[run] - median : median - seconds[run];
+  }
+  qsort(deviations, BENCH_RUNS, sizeof(deviations[0]), compareDoubles);
+  const double deviation = getMedian(deviations, BENCH_RUNS);
+
+  printf("%s: %zu %s in %.3fs, %.0f %s/s (median of %d runs, min %.3fs, max %.3fs, deviation %.1f%%)\n", name,
+         operations, unit, median, (double)operations / median, unit, BENCH_RUNS, seconds[0],
+         seconds[BENCH_RUNS - 1], median > 0 ? deviation / median * 100 : 0);
+}
+
+/** Generates metadata containing directories with the given amount of
+  files, which in turn have multiple history points. */
+Metadata *benchGenMetadata(CR_Region *r, const size_t directory_count, const size_t files_per_directory)
+{
+  Metadata *metadata = createEmptyMetadata(r, 3);
+  initHistPoint(metadata, 0, 0, 1000);
+  initHistPoint(metadata, 1, 1, 2000);
+  initHistPoint(metadata, 2, 2, 3000);
+
+  PathNode *root = createPathNode("data", BPOL_track, NULL, metadata);
+  appendHistDirectory(r, root, &metadata->backup_history[0], 0, 0, 1000, 0755);
+  metadata->paths = root;
+
+  uint8_t hash[FILE_HASH_SIZE] = { 0 };
+  for(size_t dir_index = 0; dir_index < directory_count; dir_index++)
+  {
+    char name[32];
+    sprintf(name, "directory-%zu", dir_index);
+
+    PathNode *dir = createPathNode(name, BPOL_track, root, metadata);
+    appendHistDirectory(r, dir, &metadata->backup_history[0], 0, 0, 1000, 0755);
+
+    for(size_t file_index = 0; file_index < files_per_directory; file_index++)
+    {
+      sprintf(name, "file-%zu.txt", file_index);
+      hash[0] = (uint8_t)dir_index;
+      hash[1] = (uint8_t)file_index;
+
+      PathNode *file = createPathNode(name, BPOL_track, dir, metadata);
+      appendHistRegular(r, file, &metadata->backup_history[0], 0, 0, 1000, 0644, 4096, hash, 0);
+      appendHistRegular(r, file, &metadata->backup_history[2], 0, 0, 3000, 0644, 4096, hash, 1);
+    }
+  }
+
+  return metadata;
+}
@@ -0,0 +1,19 @@
+#ifndef NANO_BACKUP_BENCH_BENCH_COMMON_H
+#define NANO_BACKUP_BENCH_BENCH_COMMON_H
+
+#include <stddef.h>
+
+#include "metadata.h"
+
+/** Performs the measured operations once.
+
+  @return The amount of operations performed.
+*/
+typedef size_t BenchFunction(void *user_data);
+
+extern double benchGetSeconds(void);
+extern void benchRepeat(const char *name, const char *unit, BenchFunction *function, void *user_data);
+extern void benchPrintRate(const char *name, size_t operations, const char *unit, double seconds);
+extern Metadata *benchGenMetadata(CR_Region *r, size_t directory_count, size_t files_per_directory);
+
+#endif
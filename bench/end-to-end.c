@@ -0,0 +1,182 @@
+/** @file
+  Runs the nb executable on a generated source tree and measures common
+  scenarios like the first backup, backups with few changes, restores, gc
+  and integrity checks. The results are written as JSON, including the
+  trace report of each run, so they can be compared between commits.
+*/
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "CRegion/region.h"
+
+#include "bench-common.h"
+#include "error-handling.h"
+#include "safe-wrappers.h"
+#include "tree-generator.h"
+
+typedef struct
+{
+  const char *nb_path;
+  StringView repo_path;
+  FILE *results;
+  size_t scenario_count;
+} Runner;
+
+/** Runs nb with the given arguments, answers all its questions with yes
+  and returns the elapsed time in seconds. Its output is discarded.
+
+  @param trace_path The path to which nb should write its trace report.
+  @param argument_list Arguments passed to nb after the repository path.
+  Must be terminated by NULL.
+*/
+static double runNb(const Runner *runner, const char *trace_path, const char **argument_list)
+{
+  const char *arguments[8] = { runner->nb_path, runner->repo_path.content };
+  for(size_t index = 0; argument_list[index] != NULL; index++)
+  {
+    if(index + 3 >= sizeof(arguments) / sizeof(arguments[0]))
+    {
+      die("too many arguments for nb");
+    }
+    arguments[index + 2] = argument_list[index];
+  }
+
+  int input[2];
+  if(pipe(input) != 0)
+  {
+    dieErrno("failed to create pipe");
+  }
+
+  /* Prevent the child from flushing buffered output a second time. */
+  fflush(stdout);
+
+  const double start = benchGetSeconds();
+  const pid_t pid = fork();
+  if(pid == -1)
+  {
+    dieErrno("failed to fork");
+  }
+  else if(pid == 0)
+  {
+    if(dup2(input[0], STDIN_FILENO) == -1 || close(input[0]) != 0 || close(input[1]) != 0 ||
+       freopen("/dev/null", "w", stdout) == NULL || setenv("NB_TRACE", trace_path, 1) != 0)
+    {
+      _exit(127);
+    }
+    execv(runner->nb_path, (char *const *)arguments);
+    _exit(127);
+  }
+
+  /* nb asks at most one question per run. Unused answers get discarded
+     when the pipe is closed. */
+  if(close(input[0]) != 0 || write(input[1], "yes\n", 4) != 4 || close(input[1]) != 0)
+  {
+    dieErrno("failed to pass answer to nb");
+  }
+
+  int status;
+  if(waitpid(pid, &status, 0) != pid)
+  {
+    dieErrno("failed to wait for nb");
+  }
+  const double seconds = benchGetSeconds() - start;
+
+  if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+  {
+    die("nb failed: \"%s\"", trace_path);
+  }
+  return seconds;
+}
+
+/** Runs a single scenario and appends its results to the results file. */
+static void runScenario(Runner *runner, const char *name, const char **argument_list)
+{
+  char trace_path[256];
+  sprintf(trace_path, "tmp/trace-%s.json", name);
+
+  const double seconds = runNb(runner, trace_path, argument_list);
+  printf("%s: %.3fs\n", name, seconds);
+
+  CR_Region *r = CR_RegionNew();
+  const FileContent trace = sGetFilesContent(r, str(trace_path));
+  fprintf(runner->results, "%s\n    {\"name\":\"%s\",\"wall_seconds\":%.6f,\"trace\":%.*s}",
+          runner->scenario_count == 0 ? "" : ",", name, seconds,
+          /* Strip the trailing newline. */
+          (int)(trace.size > 0 ? trace.size - 1 : 0), trace.content);
+  runner->scenario_count++;
+  CR_RegionRelease(r);
+}
+
+int main(const int arg_count, const char **arg_list)
+{
+  const size_t file_count = arg_count > 1 ? sStringToSize(str(arg_list[1])) : 4000;
+  const char *results_path = arg_count > 2 ? arg_list[2] : "end-to-end.json";
+  const TreeOptions options = treeDefaultOptions(file_count);
+
+  /* Benchmarks get started from the build directory of the bench
+     programs, which is next to nb. */
+  CR_Region *r = CR_RegionNew();
+  Allocator *a = allocatorWrapRegion(r);
+  StringView bench_dir = strSplitPath(str(arg_list[0])).head;
+  StringView cwd = strStripTrailingSlashes(sGetCurrentDir(a));
+  StringView tree_path = strAppendPath(cwd, str("tmp/source"), a);
+
+  Runner runner = {
+    .nb_path = strAppendPath(bench_dir.length > 0 ? bench_dir : str("."), str("../nb"), a).content,
+    .repo_path = str("tmp/repo"),
+    .scenario_count = 0,
+  };
+  signal(SIGPIPE, SIG_IGN);
+
+  double start = benchGetSeconds();
+  const TreeStatistics stats = treeGenerate(tree_path, &options);
+  printf("generated %zu files, %zu symlinks and %zu directories (%.1f MiB) in %.3fs\n", stats.regular_file_count,
+         stats.symlink_count, stats.directory_count, (double)stats.total_size / (1 << 20),
+         benchGetSeconds() - start);
+
+  sMkdir(runner.repo_path);
+  treeWriteConfig(str("tmp/repo/config"), tree_path);
+
+  runner.results = fopen(results_path, "w");
+  if(runner.results == NULL)
+  {
+    dieErrno("failed to open \"%s\"", results_path);
+  }
+  fprintf(runner.results,
+          "{\n  \"parameters\":{\"seed\":%llu,\"file_count\":%zu,\"files_per_directory\":%zu,\"depth\":%zu,"
+          "\"regular_files\":%zu,\"symlinks\":%zu,\"directories\":%zu,\"total_size\":%llu},\n"
+          "  \"scenarios\":[",
+          (unsigned long long)options.seed, options.file_count, options.files_per_directory, options.depth,
+          stats.regular_file_count, stats.symlink_count, stats.directory_count,
+          (unsigned long long)stats.total_size);
+
+  runScenario(&runner, "first_backup", (const char *[]){ NULL });
+  runScenario(&runner, "no_change_backup", (const char *[]){ NULL });
+
+  printf("changed %zu files\n", treeModify(tree_path, &options, 1, 1));
+  runScenario(&runner, "one_percent_change_backup", (const char *[]){ NULL });
+
+  StringView single_file = treeGetUniqueFilePath(tree_path, &options, a);
+  sRemove(single_file);
+  runScenario(&runner, "single_file_restore", (const char *[]){ "0", single_file.content, NULL });
+
+  sRemoveRecursively(tree_path);
+  runScenario(&runner, "full_restore", (const char *[]){ "0", tree_path.content, NULL });
+
+  runScenario(&runner, "gc", (const char *[]){ "gc", NULL });
+  runScenario(&runner, "integrity", (const char *[]){ "integrity", NULL });
+
+  fprintf(runner.results, "\n  ]\n}\n");
+  if(fclose(runner.results) != 0)
+  {
+    dieErrno("failed to write \"%s\"", results_path);
+  }
+  printf("results written to \"%s\"\n", results_path);
+
+  CR_RegionRelease(r);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,232 @@
+/** @file
+  Compares the binary FileSet used by the garbage collector against the
+  StringTable of hex paths it replaced, and measures a full garbage
+  collection run on a synthetic repository.
+*/
+
+#include "garbage-collector.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "CRegion/region.h"
+
+#include "bench-common.h"
+#include "error-handling.h"
+#include "file-set.h"
+#include "metadata-util.h"
+#include "safe-math.h"
+#include "safe-wrappers.h"
+#include "string-table.h"
+
+/** Generates infos of unique files stored inside a repository.
+
+  @param seed Infos generated with different seeds will not collide.
+*/
+static RegularFileInfo *genInfos(CR_Region *r, const size_t count, const uint64_t seed)
+{
+  RegularFileInfo *infos = CR_RegionAlloc(r, sSizeMul(sizeof(*infos), count));
+  uint64_t state = seed * UINT64_C(0x9e3779b97f4a7c15) + 1;
+
+  for(size_t index = 0; index < count; index++)
+  {
+    RegularFileInfo *info = &infos[index];
+    for(size_t byte = 0; byte < FILE_HASH_SIZE; byte++)
+    {
+      /* Xorshift64. */
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      info->hash[byte] = (uint8_t)state;
+    }
+    info->hash[FILE_HASH_SIZE - 1] = (uint8_t)seed;
+    info->size = 4096 + index % 1000;
+    info->slot = (uint8_t)(index % 3);
+  }
+
+  return infos;
+}
+
+/** Builds the repository paths of the given infos. */
+static StringView *buildPaths(CR_Region *r, const RegularFileInfo *infos, const size_t count)
+{
+  StringView *paths = CR_RegionAlloc(r, sSizeMul(sizeof(*paths), count));
+  for(size_t index = 0; index < count; index++)
+  {
+    static char *buffer = NULL;
+    repoBuildRegularFilePath(&buffer, &infos[index]);
+    strSet(&paths[index], strCopy(str(buffer), allocatorWrapRegion(r)));
+  }
+
+  return paths;
+}
+
+/** Checks that the expected amount of files was found. This also prevents
+  the compiler from optimizing the lookups away. */
+static void checkHits(const size_t hits, const size_t expected_hits)
+{
+  if(hits != expected_hits)
+  {
+    die("found %zu files, expected %zu", hits, expected_hits);
+  }
+}
+
+/** Compares building and querying the set of referenced files in memory. */
+static void benchLookups(CR_Region *r, const size_t count)
+{
+  const RegularFileInfo *infos = genInfos(r, count, 1);
+  const StringView *paths = buildPaths(r, infos, count);
+  const StringView *missing_paths = buildPaths(r, genInfos(r, count, 2), count);
+
+  {
+    CR_Region *table_region = CR_RegionNew();
+    Allocator *a = allocatorWrapRegion(table_region);
+    StringTable *table = strTableNew(table_region);
+
+    double start = benchGetSeconds();
+    for(size_t index = 0; index < count; index++)
+    {
+      static char *buffer = NULL;
+      repoBuildRegularFilePath(&buffer, &infos[index]);
+      StringView path = str(buffer);
+      if(strTableGet(table, path) == NULL)
+      {
+        strTableMap(table, strCopy(path, a), (void *)0x1);
+      }
+    }
+    benchPrintRate("hex paths in StringTable: populate", count, "files", benchGetSeconds() - start);
+
+    size_t hits = 0;
+    start = benchGetSeconds();
+    for(size_t index = 0; index < count; index++)
+    {
+      hits += strTableGet(table, paths[index]) != NULL;
+    }
+    benchPrintRate("hex paths in StringTable: lookup existing", count, "paths", benchGetSeconds() - start);
+    checkHits(hits, count);
+
+    start = benchGetSeconds();
+    for(size_t index = 0; index < count; index++)
+    {
+      hits += strTableGet(table, missing_paths[index]) != NULL;
+    }
+    benchPrintRate("hex paths in StringTable: lookup missing", count, "paths", benchGetSeconds() - start);
+    checkHits(hits, count);
+
+    CR_RegionRelease(table_region);
+  }
+
+  {
+    CR_Region *set_region = CR_RegionNew();
+    FileSet *set = fileSetNew(set_region, 0);
+
+    double start = benchGetSeconds();
+    for(size_t index = 0; index < count; index++)
+    {
+      fileSetInsert(set, &infos[index]);
+    }
+    benchPrintRate("FileSet: populate", count, "files", benchGetSeconds() - start);
+
+    size_t hits = 0;
+    start = benchGetSeconds();
+    for(size_t index = 0; index < count; index++)
+    {
+      RegularFileInfo info;
+      hits += repoParseRegularFilePath(paths[index], &info) && fileSetContains(set, &info);
+    }
+    benchPrintRate("FileSet: parse and lookup existing", count, "paths", benchGetSeconds() - start);
+    checkHits(hits, count);
+
+    start = benchGetSeconds();
+    for(size_t index = 0; index < count; index++)
+    {
+      RegularFileInfo info;
+      hits += repoParseRegularFilePath(missing_paths[index], &info) && fileSetContains(set, &info);
+    }
+    benchPrintRate("FileSet: parse and lookup missing", count, "paths", benchGetSeconds() - start);
+    checkHits(hits, count);
+
+    CR_RegionRelease(set_region);
+  }
+}
+
+/** Creates an empty file for each of the given infos inside the given
+  repository. */
+static void createRepoFiles(StringView repo_path, const RegularFileInfo *infos, const size_t count)
+{
+  CR_Region *r = CR_RegionNew();
+  Allocator *path_buffer = allocatorWrapOneSingleGrowableBuffer(r);
+
+  for(size_t index = 0; index < count; index++)
+  {
+    static char *buffer = NULL;
+    repoBuildRegularFilePath(&buffer, &infos[index]);
+    StringView path = strAppendPath(repo_path, str(buffer), path_buffer);
+
+    StringView parent = strSplitPath(path).head;
+    StringView grandparent = strSplitPath(parent).head;
+    if(!sPathExists(grandparent))
+    {
+      sMkdir(grandparent);
+    }
+    if(!sPathExists(parent))
+    {
+      sMkdir(parent);
+    }
+    sFclose(sFopenWrite(path));
+  }
+
+  CR_RegionRelease(r);
+}
+
+/** Runs the garbage collector on a repository in which half of the files
+  are unreferenced. */
+static void benchCollectGarbage(CR_Region *r, const size_t count)
+{
+  StringView repo_path = str("tmp/repo");
+  sMkdir(repo_path);
+
+  const RegularFileInfo *referenced = genInfos(r, count / 2, 3);
+  const RegularFileInfo *unreferenced = genInfos(r, count - count / 2, 4);
+  createRepoFiles(repo_path, referenced, count / 2);
+  createRepoFiles(repo_path, unreferenced, count - count / 2);
+
+  Metadata *metadata = createEmptyMetadata(r, 1);
+  initHistPoint(metadata, 0, 0, 1000);
+  PathNode *root = createPathNode("data", BPOL_track, NULL, metadata);
+  appendHistDirectory(r, root, &metadata->backup_history[0], 0, 0, 1000, 0755);
+  metadata->paths = root;
+
+  for(size_t index = 0; index < count / 2; index++)
+  {
+    char name[32];
+    sprintf(name, "file-%zu", index);
+
+    const RegularFileInfo *info = &referenced[index];
+    PathNode *file = createPathNode(name, BPOL_track, root, metadata);
+    appendHistRegular(r, file, &metadata->backup_history[0], 0, 0, 1000, 0644, info->size, info->hash,
+                      info->slot);
+  }
+
+  const double start = benchGetSeconds();
+  const GCStatistics statistics = collectGarbage(metadata, repo_path);
+  benchPrintRate("collectGarbage()", count, "files", benchGetSeconds() - start);
+
+  if(statistics.deleted_items_count < count - count / 2)
+  {
+    die("removed only %zu items, expected at least %zu", statistics.deleted_items_count, count - count / 2);
+  }
+}
+
+int main(const int arg_count, const char **arg_list)
+{
+  const size_t count = arg_count > 1 ? sStringToSize(str(arg_list[1])) : 1000000;
+  const size_t repo_file_count = arg_count > 2 ? sStringToSize(str(arg_list[2])) : 100000;
+
+  CR_Region *r = CR_RegionNew();
+  benchLookups(r, count);
+  benchCollectGarbage(r, repo_file_count);
+  CR_RegionRelease(r);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+/** @file
+  Measures how fast metadataLoad() reads large metadata trees and how fast
+  the loaded tree can be traversed.
+*/
+
+#include "metadata.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "CRegion/region.h"
+
+#include "bench-common.h"
+#include "safe-wrappers.h"
+
+/** Sums up the file sizes in the given tree, like most whole-tree passes
+  touching every node and every history point. */
+static uint64_t sumFileSizes(const PathNode *node_list, size_t *visited_points)
+{
+  uint64_t sum = 0;
+
+  for(const PathNode *node = node_list; node != NULL; node = node->next)
+  {
+    for(const PathHistory *point = node->history; point != NULL; point = point->next)
+    {
+      if(point->state.type == PST_regular_file)
+      {
+        sum += point->state.metadata.file_info.size;
+      }
+      (*visited_points)++;
+    }
+
+    sum += sumFileSizes(node->subnodes, visited_points);
+  }
+
+  return sum;
+}
+
+/** Traverses the given metadata repeatedly and prints the rate of visited
+  history points. */
+static void benchTraversal(const char *name, const Metadata *metadata)
+{
+  const size_t passes = 20;
+  size_t visited_points = 0;
+  uint64_t checksum = 0;
+
+  const double start = benchGetSeconds();
+  for(size_t pass = 0; pass < passes; pass++)
+  {
+    checksum += sumFileSizes(metadata->paths, &visited_points);
+  }
+  benchPrintRate(name, visited_points, "points", benchGetSeconds() - start);
+
+  if(checksum == 0)
+  {
+    printf("unexpected checksum\n");
+  }
+}
+
+int main(const int arg_count, const char **arg_list)
+{
+  const size_t directory_count = arg_count > 1 ? sStringToSize(str(arg_list[1])) : 1000;
+  const size_t files_per_directory = 500;
+
+  CR_Region *r = CR_RegionNew();
+  Metadata *generated = benchGenMetadata(r, directory_count, files_per_directory);
+  metadataWrite(generated, str("tmp"), str("tmp/tmp-file"), str("tmp/metadata"));
+  benchTraversal("traversal of generated tree", generated);
+
+  const double start = benchGetSeconds();
+  Metadata *loaded = metadataLoad(r, str("tmp/metadata"));
+  benchPrintRate("metadataLoad()", loaded->total_path_count, "nodes", benchGetSeconds() - start);
+  benchTraversal("traversal of loaded tree", loaded);
+
+  CR_RegionRelease(r);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,28 @@
+/** @file
+  Measures how fast metadataWrite() serializes large metadata trees.
+*/
+
+#include "metadata.h"
+
+#include <stdlib.h>
+
+#include "CRegion/region.h"
+
+#include "bench-common.h"
+#include "safe-wrappers.h"
+
+int main(const int arg_count, const char **arg_list)
+{
+  const size_t directory_count = arg_count > 1 ? sStringToSize(str(arg_list[1])) : 1000;
+  const size_t files_per_directory = 500;
+
+  CR_Region *r = CR_RegionNew();
+  Metadata *metadata = benchGenMetadata(r, directory_count, files_per_directory);
+
+  const double start = benchGetSeconds();
+  metadataWrite(metadata, str("tmp"), str("tmp/tmp-file"), str("tmp/metadata"));
+  benchPrintRate("metadataWrite()", metadata->total_path_count, "nodes", benchGetSeconds() - start);
+
+  CR_RegionRelease(r);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,463 @@
+/** @file
+  Measures the primitives used on hot paths in isolation: hash tables,
+  metadata serialization, file hashing, file handles, path manipulation,
+  region allocations and regex matching.
+
+  The amount of keys stored in the string table can be passed as the
+  first argument and defaults to 1000000. Run "primitives 10000000" to
+  measure at full scale, which requires roughly 3 GB of memory.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "CRegion/region.h"
+
+#include "bench-common.h"
+#include "error-handling.h"
+#include "file-hash.h"
+#include "metadata.h"
+#include "safe-math.h"
+#include "safe-wrappers.h"
+#include "string-table.h"
+
+typedef struct
+{
+  size_t count;
+  StringView *keys;
+  StringView *missing_keys;
+  StringTable *table;
+} StringTableContext;
+
+/** Generates keys which look like the full paths stored in metadata. All
+  keys share a single buffer to keep the memory overhead low. */
+static StringView *genKeys(CR_Region *r, const size_t count, const char *prefix)
+{
+  const size_t key_capacity = 64;
+  StringView *keys = CR_RegionAlloc(r, sSizeMul(sizeof(*keys), count));
+  char *buffer = CR_RegionAlloc(r, sSizeMul(key_capacity, count));
+
+  for(size_t index = 0; index < count; index++)
+  {
+    char *key = &buffer[index * key_capacity];
+    sprintf(key, "/home/user/%s/directory-%zu/file-%zu.txt", prefix, index / 100, index % 100);
+    strSet(&keys[index], str(key));
+  }
+
+  return keys;
+}
+
+static size_t mapKeys(void *user_data)
+{
+  StringTableContext *ctx = user_data;
+
+  CR_Region *r = CR_RegionNew();
+  StringTable *table = strTableNew(r);
+  for(size_t index = 0; index < ctx->count; index++)
+  {
+    strTableMap(table, ctx->keys[index], &ctx->keys[index]);
+  }
+  CR_RegionRelease(r);
+
+  return ctx->count;
+}
+
+/** Looks up the given keys and terminates the program if not exactly the
+  expected keys were found. This also prevents the compiler from
+  optimizing the lookups away. */
+static size_t lookupKeys(const StringTableContext *ctx, const StringView *keys, const size_t expected_hits)
+{
+  size_t hits = 0;
+  for(size_t index = 0; index < ctx->count; index++)
+  {
+    hits += strTableGet(ctx->table, keys[index]) != NULL;
+  }
+  if(hits != expected_hits)
+  {
+    die("found %zu mappings, expected %zu", hits, expected_hits);
+  }
+
+  return ctx->count;
+}
+
+static size_t getExistingKeys(void *user_data)
+{
+  StringTableContext *ctx = user_data;
+  return lookupKeys(ctx, ctx->keys, ctx->count);
+}
+
+static size_t getMissingKeys(void *user_data)
+{
+  StringTableContext *ctx = user_data;
+  return lookupKeys(ctx, ctx->missing_keys, 0);
+}
+
+static void benchStringTable(const size_t count)
+{
+  CR_Region *r = CR_RegionNew();
+  StringTableContext ctx = {
+    .count = count,
+    .keys = genKeys(r, count, "existing"),
+    .missing_keys = genKeys(r, count, "missing"),
+    .table = strTableNew(r),
+  };
+  for(size_t index = 0; index < count; index++)
+  {
+    strTableMap(ctx.table, ctx.keys[index], &ctx.keys[index]);
+  }
+
+  benchRepeat("strTableMap()", "keys", mapKeys, &ctx);
+  benchRepeat("strTableGet() existing", "keys", getExistingKeys, &ctx);
+  benchRepeat("strTableGet() missing", "keys", getMissingKeys, &ctx);
+
+  CR_RegionRelease(r);
+}
+
+static size_t writeMetadata(void *user_data)
+{
+  Metadata *metadata = user_data;
+  metadataWrite(metadata, str("tmp"), str("tmp/tmp-file"), str("tmp/metadata"));
+  return metadata->total_path_count;
+}
+
+static size_t loadMetadata(void *user_data)
+{
+  (void)user_data;
+
+  CR_Region *r = CR_RegionNew();
+  const size_t node_count = metadataLoad(r, str("tmp/metadata"))->total_path_count;
+  CR_RegionRelease(r);
+
+  return node_count;
+}
+
+static void benchMetadata(const size_t directory_count)
+{
+  CR_Region *r = CR_RegionNew();
+  Metadata *metadata = benchGenMetadata(r, directory_count, 500);
+
+  benchRepeat("metadataWrite()", "nodes", writeMetadata, metadata);
+  benchRepeat("metadataLoad()", "nodes", loadMetadata, NULL);
+
+  CR_RegionRelease(r);
+}
+
+typedef struct
+{
+  StringView path;
+  struct stat stats;
+} HashContext;
+
+static size_t hashFile(void *user_data)
+{
+  const HashContext *ctx = user_data;
+  uint8_t hash[FILE_HASH_SIZE];
+  fileHash(ctx->path, ctx->stats, hash, NULL, NULL);
+
+  return (size_t)(ctx->stats.st_size >> 20);
+}
+
+static void benchFileHash(const size_t mebibytes)
+{
+  HashContext ctx = { .path = str("tmp/hashed-file") };
+
+  static char buffer[1 << 20];
+  for(size_t index = 0; index < sizeof(buffer); index++)
+  {
+    buffer[index] = (char)(index * 31 + index / 4096);
+  }
+  FileStream *stream = sFopenWrite(ctx.path);
+  for(size_t mebibyte = 0; mebibyte < mebibytes; mebibyte++)
+  {
+    sFwrite(buffer, sizeof(buffer), stream);
+  }
+  sFclose(stream);
+  ctx.stats = sStat(ctx.path);
+
+  benchRepeat("fileHash() cached file", "MiB", hashFile, &ctx);
+  sRemove(ctx.path);
+}
+
+typedef struct
+{
+  size_t count;
+  StringView *paths;
+  StringView directory_path;
+} HandleContext;
+
+static size_t readSmallFiles(void *user_data)
+{
+  const HandleContext *ctx = user_data;
+  char content[16];
+
+  for(size_t index = 0; index < ctx->count; index++)
+  {
+    FileStream *stream = sFopenRead(ctx->paths[index]);
+    sFread(content, sizeof(content), stream);
+    sFclose(stream);
+  }
+
+  return ctx->count;
+}
+
+static size_t readSmallFilesAtOnce(void *user_data)
+{
+  const HandleContext *ctx = user_data;
+  char content[16];
+
+  for(size_t index = 0; index < ctx->count; index++)
+  {
+    if(!sReadFileExactly(ctx->paths[index], content, sizeof(content)))
+    {
+      die("file is larger than expected: \"" PRI_STR "\"", STR_FMT(ctx->paths[index]));
+    }
+  }
+
+  return ctx->count;
+}
+
+static size_t writeSmallFiles(void *user_data)
+{
+  const HandleContext *ctx = user_data;
+  const char content[16] = "small file data";
+
+  for(size_t index = 0; index < ctx->count; index++)
+  {
+    FileStream *stream = sFopenWrite(ctx->paths[index]);
+    sFwrite(content, sizeof(content), stream);
+    sFclose(stream);
+  }
+
+  return ctx->count;
+}
+
+static size_t readDirectories(void *user_data)
+{
+  const HandleContext *ctx = user_data;
+  size_t entries = 0;
+
+  for(size_t index = 0; index < ctx->count; index++)
+  {
+    DirIterator *dir = sDirOpen(ctx->directory_path);
+    entries += sDirGetNext(dir).length > 0;
+    sDirClose(dir);
+  }
+  if(entries != ctx->count)
+  {
+    die("found %zu entries, expected %zu", entries, ctx->count);
+  }
+
+  return ctx->count;
+}
+
+/** Measures the overhead of opening and closing handles, which dominates
+  when processing many small files. */
+static void benchFileHandles(const size_t count)
+{
+  CR_Region *r = CR_RegionNew();
+  HandleContext ctx = {
+    .count = count,
+    .paths = CR_RegionAlloc(r, sSizeMul(sizeof(*ctx.paths), count)),
+    .directory_path = str("tmp/directory"),
+  };
+
+  sMkdir(str("tmp/handles"));
+  for(size_t index = 0; index < count; index++)
+  {
+    char *path = CR_RegionAlloc(r, 64);
+    sprintf(path, "tmp/handles/file-%zu", index);
+    strSet(&ctx.paths[index], str(path));
+  }
+
+  writeSmallFiles(&ctx);
+  benchRepeat("sFopenWrite() + sFclose()", "files", writeSmallFiles, &ctx);
+  benchRepeat("sFopenRead() + sFclose()", "files", readSmallFiles, &ctx);
+  benchRepeat("sReadFileExactly()", "files", readSmallFilesAtOnce, &ctx);
+
+  /* Contains a single file, to keep the cost of reading it low. */
+  sMkdir(ctx.directory_path);
+  sSymlink(str("target"), str("tmp/directory/symlink"));
+  benchRepeat("sDirOpen() + sDirClose()", "directories", readDirectories, &ctx);
+  sRemove(str("tmp/directory/symlink"));
+  sRemove(ctx.directory_path);
+
+  for(size_t index = 0; index < count; index++)
+  {
+    sRemove(ctx.paths[index]);
+  }
+  sRemove(str("tmp/handles"));
+  CR_RegionRelease(r);
+}
+
+typedef struct
+{
+  size_t count;
+  StringView *paths;
+  Allocator *buffer;
+} PathContext;
+
+static size_t appendPaths(void *user_data)
+{
+  PathContext *ctx = user_data;
+  size_t total_length = 0;
+
+  for(size_t index = 0; index < ctx->count; index++)
+  {
+    total_length += strAppendPath(ctx->paths[index], str("file.txt"), ctx->buffer).length;
+  }
+  if(total_length == 0)
+  {
+    die("appended paths are empty");
+  }
+
+  return ctx->count;
+}
+
+static size_t splitPaths(void *user_data)
+{
+  PathContext *ctx = user_data;
+  size_t total_length = 0;
+
+  for(size_t index = 0; index < ctx->count; index++)
+  {
+    total_length += strSplitPath(ctx->paths[index]).tail.length;
+  }
+  if(total_length == 0)
+  {
+    die("split paths are empty");
+  }
+
+  return ctx->count;
+}
+
+static void benchPaths(const size_t count)
+{
+  CR_Region *r = CR_RegionNew();
+  PathContext ctx = {
+    .count = count,
+    .paths = genKeys(r, count, "paths"),
+    .buffer = allocatorWrapOneSingleGrowableBuffer(r),
+  };
+
+  benchRepeat("strAppendPath()", "paths", appendPaths, &ctx);
+  benchRepeat("strSplitPath()", "paths", splitPaths, &ctx);
+
+  CR_RegionRelease(r);
+}
+
+static size_t allocateFromRegion(void *user_data)
+{
+  const size_t count = *(const size_t *)user_data;
+
+  CR_Region *r = CR_RegionNew();
+  for(size_t index = 0; index < count; index++)
+  {
+    /* Sizes of typical nodes, history points and names. */
+    char *data = CR_RegionAlloc(r, 8 + index % 57);
+    data[0] = 'x';
+  }
+  CR_RegionRelease(r);
+
+  return count;
+}
+
+typedef struct
+{
+  size_t path_count;
+  StringView *paths;
+  size_t expression_count;
+  const regex_t **expressions;
+} RegexContext;
+
+static size_t matchPaths(void *user_data)
+{
+  const RegexContext *ctx = user_data;
+  size_t matches = 0;
+
+  for(size_t path = 0; path < ctx->path_count; path++)
+  {
+    for(size_t expression = 0; expression < ctx->expression_count; expression++)
+    {
+      if(sRegexIsMatching(ctx->expressions[expression], ctx->paths[path]))
+      {
+        matches++;
+        break;
+      }
+    }
+  }
+  if(matches == 0 || matches == ctx->path_count)
+  {
+    die("unexpected amount of matching paths: %zu", matches);
+  }
+
+  return ctx->path_count;
+}
+
+static void benchRegex(const size_t path_count)
+{
+  /* Expressions like the ones found in the ignore lists of real
+     configs. */
+  static const char *ignore_list[] = {
+    "\\.o$",
+    "\\.pyc$",
+    "\\.swp$",
+    "~$",
+    "/\\.cache$",
+    "/node_modules$",
+    "/__pycache__$",
+    "/\\.git$",
+    "/\\.thumbnails$",
+    "\\.(tmp|bak|log)$",
+    "/target/(debug|release)$",
+    "^/home/[^/]+/\\.local/share/Trash$",
+    "^/proc/",
+    "^/sys/",
+    "/build$",
+  };
+
+  CR_Region *r = CR_RegionNew();
+  RegexContext ctx = {
+    .path_count = path_count,
+    .paths = CR_RegionAlloc(r, sSizeMul(sizeof(*ctx.paths), path_count)),
+    .expression_count = sizeof(ignore_list) / sizeof(ignore_list[0]),
+    .expressions = CR_RegionAlloc(r, sizeof(ignore_list)),
+  };
+
+  for(size_t index = 0; index < ctx.expression_count; index++)
+  {
+    ctx.expressions[index] = sRegexCompile(r, str(ignore_list[index]), str(__FILE__), __LINE__);
+  }
+
+  static const char *extensions[] = { "c", "h", "txt", "o", "png", "log", "md", "json" };
+  for(size_t index = 0; index < path_count; index++)
+  {
+    char *path = CR_RegionAlloc(r, 96);
+    sprintf(path, "/home/user/projects/project-%zu/src/module-%zu/file-%zu.%s", index / 1000, index / 50 % 20,
+            index % 50, extensions[index % (sizeof(extensions) / sizeof(extensions[0]))]);
+    strSet(&ctx.paths[index], str(path));
+  }
+
+  char name[64];
+  sprintf(name, "sRegexIsMatching() with %zu expressions", ctx.expression_count);
+  benchRepeat(name, "paths", matchPaths, &ctx);
+
+  CR_RegionRelease(r);
+}
+
+int main(const int arg_count, const char **arg_list)
+{
+  const size_t key_count = arg_count > 1 ? sStringToSize(str(arg_list[1])) : 1000000;
+
+  benchStringTable(key_count);
+  benchMetadata(200);
+  benchFileHash(64);
+  benchFileHandles(20000);
+  benchPaths(1000000);
+
+  size_t allocation_count = 10000000;
+  benchRepeat("CR_RegionAlloc()", "allocations", allocateFromRegion, &allocation_count);
+
+  benchRegex(100000);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,18 @@
+#!/bin/sh -e
+
+export LANG=C
+
+# Names of benchmarks specified in the order to run.
+benchmarks="primitives metadata-write metadata-load string-table garbage-collector end-to-end"
+
+mkdir -p build/bench/data/
+cd build/bench/data/
+
+for benchmark in $benchmarks; do
+  rm -rf tmp/
+  mkdir tmp/
+
+  "../$benchmark"
+done
+
+rm -rf tmp/
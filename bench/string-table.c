@@ -0,0 +1,203 @@
+/** @file
+  Compares the StringTable against the chained hash table it replaced.
+*/
+
+#include "string-table.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SipHash/siphash.h"
+
+#include "bench-common.h"
+#include "error-handling.h"
+#include "safe-math.h"
+#include "safe-wrappers.h"
+
+/** Bucket of the chained table, which was used before StringTable
+  switched to open addressing. */
+typedef struct ChainedBucket ChainedBucket;
+struct ChainedBucket
+{
+  uint64_t hash;
+  StringView key;
+  void *data;
+  ChainedBucket *next;
+};
+
+typedef struct
+{
+  CR_Region *region;
+  ChainedBucket **buckets;
+  size_t capacity;
+  size_t associations;
+  uint8_t secret_key[16];
+} ChainedTable;
+
+static ChainedTable *chainedTableNew(CR_Region *r)
+{
+  ChainedTable *table = CR_RegionAlloc(r, sizeof(*table));
+  table->region = r;
+  table->associations = 0;
+  table->capacity = 32;
+  for(size_t index = 0; index < sizeof(table->secret_key); index++)
+  {
+    table->secret_key[index] = sRand() % UINT8_MAX;
+  }
+
+  const size_t array_size = sSizeMul(table->capacity, sizeof(*table->buckets));
+  table->buckets = CR_RegionAlloc(r, array_size);
+  memset(table->buckets, 0, array_size);
+
+  return table;
+}
+
+static void chainedTableMap(ChainedTable *table, StringView key, void *data)
+{
+  if(table->associations == table->capacity)
+  {
+    const size_t new_capacity = sSizeMul(table->capacity, 2);
+    const size_t new_array_size = sSizeMul(new_capacity, sizeof(*table->buckets));
+    ChainedBucket **new_buckets = CR_RegionAlloc(table->region, new_array_size);
+    memset(new_buckets, 0, new_array_size);
+
+    for(size_t index = 0; index < table->capacity; index++)
+    {
+      ChainedBucket *bucket = table->buckets[index];
+      while(bucket)
+      {
+        ChainedBucket *bucket_to_move = bucket;
+        bucket = bucket->next;
+
+        const size_t new_bucket_id = bucket_to_move->hash % new_capacity;
+        bucket_to_move->next = new_buckets[new_bucket_id];
+        new_buckets[new_bucket_id] = bucket_to_move;
+      }
+    }
+
+    table->buckets = new_buckets;
+    table->capacity = new_capacity;
+  }
+
+  ChainedBucket *bucket = CR_RegionAlloc(table->region, sizeof(*bucket));
+  bucket->hash = siphash((const uint8_t *)key.content, key.length, table->secret_key);
+  strSet(&bucket->key, key);
+  bucket->data = data;
+
+  const size_t bucket_id = bucket->hash % table->capacity;
+  bucket->next = table->buckets[bucket_id];
+  table->buckets[bucket_id] = bucket;
+  table->associations++;
+}
+
+static void *chainedTableGet(const ChainedTable *table, StringView key)
+{
+  const size_t hash = siphash((const uint8_t *)key.content, key.length, table->secret_key);
+  for(const ChainedBucket *bucket = table->buckets[hash % table->capacity]; bucket != NULL;
+      bucket = bucket->next)
+  {
+    if(strIsEqual(key, bucket->key))
+    {
+      return bucket->data;
+    }
+  }
+
+  return NULL;
+}
+
+/** Generates keys which look like the full paths stored in metadata. */
+static StringView *genKeys(CR_Region *r, const size_t count, const char *prefix)
+{
+  StringView *keys = CR_RegionAlloc(r, sSizeMul(sizeof(*keys), count));
+  for(size_t index = 0; index < count; index++)
+  {
+    char *buffer = CR_RegionAlloc(r, 64);
+    sprintf(buffer, "/home/user/%s/directory-%zu/file-%zu.txt", prefix, index / 100, index % 100);
+    strSet(&keys[index], str(buffer));
+  }
+
+  return keys;
+}
+
+/** Checks that looking up the given amount of keys found the expected
+  amount of mappings. This also prevents the compiler from optimizing the
+  lookups away. */
+static void checkHits(const size_t hits, const size_t expected_hits)
+{
+  if(hits != expected_hits)
+  {
+    die("found %zu mappings, expected %zu", hits, expected_hits);
+  }
+}
+
+int main(const int arg_count, const char **arg_list)
+{
+  const size_t count = arg_count > 1 ? sStringToSize(str(arg_list[1])) : 1000000;
+
+  CR_Region *r = CR_RegionNew();
+  StringView *keys = genKeys(r, count, "existing");
+  StringView *missing_keys = genKeys(r, count, "missing");
+
+  {
+    ChainedTable *table = chainedTableNew(r);
+
+    double start = benchGetSeconds();
+    for(size_t index = 0; index < count; index++)
+    {
+      chainedTableMap(table, keys[index], &keys[index]);
+    }
+    benchPrintRate("chained table: map", count, "keys", benchGetSeconds() - start);
+
+    size_t hits = 0;
+    start = benchGetSeconds();
+    for(size_t index = 0; index < count; index++)
+    {
+      hits += chainedTableGet(table, keys[index]) != NULL;
+    }
+    benchPrintRate("chained table: get existing", count, "keys", benchGetSeconds() - start);
+    checkHits(hits, count);
+
+    start = benchGetSeconds();
+    for(size_t index = 0; index < count; index++)
+    {
+      hits += chainedTableGet(table, missing_keys[index]) != NULL;
+    }
+    benchPrintRate("chained table: get missing", count, "keys", benchGetSeconds() - start);
+    checkHits(hits, count);
+  }
+
+  for(size_t hint = 0; hint <= count; hint += count)
+  {
+    StringTable *table = strTableNewWithCapacity(r, hint);
+    const char *map_name = hint == 0 ? "StringTable: map" : "StringTable: map with capacity hint";
+
+    double start = benchGetSeconds();
+    for(size_t index = 0; index < count; index++)
+    {
+      strTableMap(table, keys[index], &keys[index]);
+    }
+    benchPrintRate(map_name, count, "keys", benchGetSeconds() - start);
+
+    size_t hits = 0;
+    start = benchGetSeconds();
+    for(size_t index = 0; index < count; index++)
+    {
+      hits += strTableGet(table, keys[index]) != NULL;
+    }
+    benchPrintRate("StringTable: get existing", count, "keys", benchGetSeconds() - start);
+    checkHits(hits, count);
+
+    start = benchGetSeconds();
+    for(size_t index = 0; index < count; index++)
+    {
+      hits += strTableGet(table, missing_keys[index]) != NULL;
+    }
+    benchPrintRate("StringTable: get missing", count, "keys", benchGetSeconds() - start);
+    checkHits(hits, count);
+  }
+
+  CR_RegionRelease(r);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,326 @@
+/** @file
+  Generates deterministic source trees for end-to-end benchmarks.
+*/
+
+#include "tree-generator.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "error-handling.h"
+#include "safe-math.h"
+#include "safe-wrappers.h"
+
+/** The modification time of all generated files. Files changed by
+  treeModify() get a later timestamp, so nb will detect the changes even
+  if they happen in the same second as the previous backup. */
+#define TREE_BASE_TIME ((time_t)1000000000)
+
+/** The amount of subdirectories per directory. */
+#define TREE_FANOUT 8
+
+typedef enum
+{
+  FK_unique,
+  FK_symlink,
+  FK_sparse,
+  FK_duplicate,
+  FK_ignored,
+} FileKind;
+
+/** Returns a well distributed value for the given pair of inputs
+  (splitmix64). */
+static uint64_t mix(const uint64_t a, const uint64_t b)
+{
+  uint64_t value = a ^ (b * UINT64_C(0x9e3779b97f4a7c15));
+  value = (value ^ (value >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  value = (value ^ (value >> 27)) * UINT64_C(0x94d049bb133111eb);
+  return value ^ (value >> 31);
+}
+
+static FileKind getKind(const TreeOptions *options, const size_t index)
+{
+  size_t roll = mix(options->seed, index) % 100;
+  const size_t shares[] = {
+    options->symlink_percent,
+    options->sparse_percent,
+    options->duplicate_percent,
+    options->ignored_percent,
+  };
+  const FileKind kinds[] = { FK_symlink, FK_sparse, FK_duplicate, FK_ignored };
+
+  for(size_t share = 0; share < sizeof(shares) / sizeof(shares[0]); share++)
+  {
+    if(roll < shares[share])
+    {
+      return kinds[share];
+    }
+    roll -= shares[share];
+  }
+  return FK_unique;
+}
+
+/** Returns the size of the given file. Most files are small, with a long
+  tail of larger files. */
+static uint64_t getSize(const TreeOptions *options, const size_t index)
+{
+  const uint64_t roll = mix(options->seed ^ 1, index);
+  const uint64_t bucket = roll % 100;
+  const uint64_t value = roll / 100;
+
+  if(getKind(options, index) == FK_sparse)
+  {
+    return (1 << 20) + value % (7 << 20);
+  }
+  else if(bucket < 70)
+  {
+    return value % (4096 + 1);
+  }
+  else if(bucket < 95)
+  {
+    return 4096 + value % (60 << 10);
+  }
+  return (64 << 10) + value % (960 << 10);
+}
+
+/** Returns the index of the file from which the given file takes its
+  size and content. */
+static size_t getContentSource(const TreeOptions *options, const size_t index)
+{
+  if(getKind(options, index) != FK_duplicate || index == 0)
+  {
+    return index;
+  }
+
+  for(size_t candidate = mix(options->seed ^ 2, index) % index;; candidate--)
+  {
+    if(getKind(options, candidate) == FK_unique)
+    {
+      return candidate;
+    }
+    else if(candidate == 0)
+    {
+      return index;
+    }
+  }
+}
+
+/** Writes the full path of the given files parent directory into the
+  given buffer. */
+static void buildDirectoryPath(char *buffer, const size_t buffer_size, StringView path,
+                               const TreeOptions *options, const size_t index, const size_t depth)
+{
+  size_t directory = index / options->files_per_directory;
+  size_t used = snprintf(buffer, buffer_size, PRI_STR, STR_FMT(path));
+
+  for(size_t level = 0; level < depth && used < buffer_size; level++)
+  {
+    used += snprintf(&buffer[used], buffer_size - used, "/d%zu", directory % TREE_FANOUT);
+    directory /= TREE_FANOUT;
+  }
+  if(used >= buffer_size)
+  {
+    die("generated path is too long: \"" PRI_STR "\"", STR_FMT(path));
+  }
+}
+
+static void buildFilePath(char *buffer, const size_t buffer_size, StringView path, const TreeOptions *options,
+                          const size_t index)
+{
+  buildDirectoryPath(buffer, buffer_size, path, options, index, options->depth);
+
+  /* Suffixes matched by the ignore expressions in treeWriteConfig(). */
+  static const char *ignored_suffixes[] = { ".o", ".pyc", ".swp", "~" };
+  const char *suffix = getKind(options, index) == FK_ignored
+    ? ignored_suffixes[index % (sizeof(ignored_suffixes) / sizeof(ignored_suffixes[0]))]
+    : "";
+
+  const size_t used = strlen(buffer);
+  if((size_t)snprintf(&buffer[used], buffer_size - used, "/file-%zu%s", index, suffix) >= buffer_size - used)
+  {
+    die("generated path is too long: \"" PRI_STR "\"", STR_FMT(path));
+  }
+}
+
+/** Writes pseudo-random content derived from the given seed to the given
+  file. */
+static void writeContent(const char *path, const uint64_t size, const uint64_t content_seed,
+                         const time_t modification_time)
+{
+  static uint64_t buffer[8192];
+  uint64_t state = content_seed | 1;
+  FileStream *stream = sFopenWrite(str(path));
+
+  for(uint64_t bytes_left = size; bytes_left > 0;)
+  {
+    const size_t bytes_to_write = bytes_left < sizeof(buffer) ? bytes_left : sizeof(buffer);
+    for(size_t word = 0; word < sizeof(buffer) / sizeof(buffer[0]); word++)
+    {
+      /* Xorshift64. */
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      buffer[word] = state;
+    }
+
+    sFwrite(buffer, bytes_to_write, stream);
+    bytes_left -= bytes_to_write;
+  }
+
+  sFclose(stream);
+  sUtime(str(path), modification_time);
+}
+
+/** Creates a file of the given size which only has data in its last
+  block. */
+static void writeSparseFile(const char *path, const uint64_t size)
+{
+  static const char block[4096] = { 'x' };
+  const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd == -1)
+  {
+    dieErrno("failed to create \"%s\"", path);
+  }
+  if(ftruncate(fd, (off_t)size) != 0 ||
+     pwrite(fd, block, sizeof(block), (off_t)(size - sizeof(block))) != (ssize_t)sizeof(block))
+  {
+    dieErrno("failed to write \"%s\"", path);
+  }
+  if(close(fd) != 0)
+  {
+    dieErrno("failed to close \"%s\"", path);
+  }
+  sUtime(str(path), TREE_BASE_TIME);
+}
+
+/** Returns the options used by `make bench` for a tree with the given
+  amount of files. */
+TreeOptions treeDefaultOptions(const size_t file_count)
+{
+  return (TreeOptions){
+    .seed = 1,
+    .file_count = file_count,
+    .files_per_directory = 40,
+    .depth = 3,
+    .symlink_percent = 2,
+    .sparse_percent = 1,
+    .duplicate_percent = 5,
+    .ignored_percent = 2,
+  };
+}
+
+/** Creates a new tree at the given path, which must not exist. */
+TreeStatistics treeGenerate(StringView path, const TreeOptions *options)
+{
+  TreeStatistics stats = { 0 };
+  char buffer[4096];
+
+  sMkdir(path);
+  for(size_t index = 0; index < options->file_count; index++)
+  {
+    if(index % options->files_per_directory == 0)
+    {
+      for(size_t depth = 1; depth <= options->depth; depth++)
+      {
+        buildDirectoryPath(buffer, sizeof(buffer), path, options, index, depth);
+        if(!sPathExists(str(buffer)))
+        {
+          sMkdir(str(buffer));
+          stats.directory_count++;
+        }
+      }
+    }
+
+    buildFilePath(buffer, sizeof(buffer), path, options, index);
+    const FileKind kind = getKind(options, index);
+    if(kind == FK_symlink)
+    {
+      char target[64];
+      sprintf(target, "file-%zu", index > 0 ? index - 1 : index + 1);
+      sSymlink(str(target), str(buffer));
+      stats.symlink_count++;
+      continue;
+    }
+
+    const size_t source = getContentSource(options, index);
+    const uint64_t size = getSize(options, source);
+    if(kind == FK_sparse)
+    {
+      writeSparseFile(buffer, size);
+    }
+    else
+    {
+      writeContent(buffer, size, mix(options->seed ^ 3, source), TREE_BASE_TIME);
+    }
+    stats.regular_file_count++;
+    stats.total_size = sUint64Add(stats.total_size, size);
+  }
+
+  return stats;
+}
+
+/** Rewrites the content of some unique files in the given tree. Sizes
+  stay the same.
+
+  @param percent The share of unique files to change.
+  @param round Different rounds change different files. Must be greater
+  than 0.
+
+  @return The amount of changed files.
+*/
+size_t treeModify(StringView path, const TreeOptions *options, const size_t percent, const uint64_t round)
+{
+  size_t changed_files = 0;
+  char buffer[4096];
+
+  for(size_t index = 0; index < options->file_count; index++)
+  {
+    if(getKind(options, index) == FK_unique && mix(options->seed ^ (3 + round), index) % 100 < percent)
+    {
+      buildFilePath(buffer, sizeof(buffer), path, options, index);
+      writeContent(buffer, getSize(options, index), mix(options->seed ^ 3, index) + round,
+                   TREE_BASE_TIME + (time_t)round);
+      changed_files++;
+    }
+  }
+
+  return changed_files;
+}
+
+/** Returns the path of the first file with unique content in the given
+  tree. */
+StringView treeGetUniqueFilePath(StringView path, const TreeOptions *options, Allocator *a)
+{
+  for(size_t index = 0; index < options->file_count; index++)
+  {
+    if(getKind(options, index) == FK_unique)
+    {
+      char buffer[4096];
+      buildFilePath(buffer, sizeof(buffer), path, options, index);
+      return strCopy(str(buffer), a);
+    }
+  }
+
+  die("generated tree contains no unique files");
+}
+
+/** Writes a config which tracks the tree at the given path and ignores
+  temporary files, like editor backups or object files. */
+void treeWriteConfig(StringView config_path, StringView path)
+{
+  static const char ignore_expressions[] = "\n"
+                                           "[ignore]\n"
+                                           "\\.o$\n"
+                                           "\\.pyc$\n"
+                                           "\\.swp$\n"
+                                           "~$\n";
+
+  FileStream *stream = sFopenWrite(config_path);
+  sFwrite("[track]\n", 8, stream);
+  sFwrite(path.content, path.length, stream);
+  sFwrite(ignore_expressions, sizeof(ignore_expressions) - 1, stream);
+  sFclose(stream);
+}
@@ -0,0 +1,46 @@
+#ifndef NANO_BACKUP_BENCH_TREE_GENERATOR_H
+#define NANO_BACKUP_BENCH_TREE_GENERATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "allocator.h"
+#include "str.h"
+
+/** Describes the shape of a generated source tree. Trees generated with
+  the same options are identical. */
+typedef struct
+{
+  uint64_t seed;
+  size_t file_count;
+  size_t files_per_directory;
+
+  /** The amount of directories between the root of the tree and the
+    files. */
+  size_t depth;
+
+  /** The share of files which become symlinks, sparse files, copies of
+    other files or files matched by the ignore expressions of the config
+    written by treeWriteConfig(). All remaining files are regular files
+    with unique content. */
+  size_t symlink_percent;
+  size_t sparse_percent;
+  size_t duplicate_percent;
+  size_t ignored_percent;
+} TreeOptions;
+
+typedef struct
+{
+  size_t regular_file_count;
+  size_t symlink_count;
+  size_t directory_count;
+  uint64_t total_size;
+} TreeStatistics;
+
+extern TreeOptions treeDefaultOptions(size_t file_count);
+extern TreeStatistics treeGenerate(StringView path, const TreeOptions *options);
+extern size_t treeModify(StringView path, const TreeOptions *options, size_t percent, uint64_t round);
+extern StringView treeGetUniqueFilePath(StringView path, const TreeOptions *options, Allocator *a);
+extern void treeWriteConfig(StringView config_path, StringView path);
+
+#endif
@@ -5,6 +5,6 @@
 cd "$(dirname "$0")/.."
 
 mkdir -p build/
-c99 -O3 -D_XOPEN_SOURCE=600 -D_FILE_OFFSET_BITS=64 \
-  -I third-party/ src/*.c third-party/*/*.c -o ./build/nb
+c99 -O3 -D_XOPEN_SOURCE=700 -D_FILE_OFFSET_BITS=64 \
+  -I third-party/ src/*.c third-party/*/*.c -l pthread -o ./build/nb
 printf 'Successfully created ./build/nb\n'
@@ -9,9 +9,9 @@ CFLAGS=$(make -np | grep '^CFLAGS = ' | head -n1 | sed -r 's/^CFLAGS = //')
 
 {
   printf '['
-  find src/ test/ third-party/ -name '*.c' -print0 |
+  find src/ test/ bench/ third-party/ -name '*.c' -print0 |
     xargs -0 -I {} printf \
       '{"directory":"%s","command":"%s %s -c %s -o %s.o","file":"%s"},\n' \
-      "$PWD" "$CC" "$CFLAGS -Ithird-party/ -Isrc/" {} {} {} |
+      "$PWD" "$CC" "$CFLAGS -Ithird-party/ -Isrc/ -Itest/" {} {} {} |
     sed '$ s/,$/]/'
 } > compile_commands.json
@@ -6,4 +6,4 @@ cd "$(dirname "$0")/.."
 
 wrapper="./scripts/clang-tidy-wrapper.sh"
 
-exec run-clang-tidy -quiet -clang-tidy-binary "$wrapper" '/(src|test)/'
+exec run-clang-tidy -quiet -clang-tidy-binary "$wrapper" '/(src|test|bench)/'
@@ -5,7 +5,7 @@
 cd "$(dirname "$0")/.."
 
 cppcheck --quiet --std=c99 --enable=all --error-exitcode=1 \
-  --platform=unix64 -Isrc/ -Ithird-party/ -D_XOPEN_SOURCE=600 \
+  --platform=unix64 -Isrc/ -Ithird-party/ -Itest/ -D_XOPEN_SOURCE=700 \
   -D_FILE_OFFSET_BITS=64 -DCHAR_BIT=8 \
   --inline-suppr \
   --suppress="ctunullpointer:*" \
@@ -14,4 +14,4 @@ cppcheck --quiet --std=c99 --enable=all --error-exitcode=1 \
   --suppress="missingIncludeSystem:*" \
   --suppress="redundantAssignment:test/*.c" \
   --suppress="nullPointerRedundantCheck:test/*.c" \
-  src/ test/
+  src/ test/ bench/
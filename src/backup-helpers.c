@@ -15,10 +15,12 @@
   @param node A node representing a file with a size greater than 0 at its
   current history point. Its size should not have changed since the last
   backup. This function will update the node if the file has changed.
+  @param path The full path of the given node.
   @param state The path state to check and update.
   @param stats The stats of the file represented by the given node.
 */
-static void checkFileContentChanges(PathNode *node, PathState *state,
+static void checkFileContentChanges(PathNode *node, StringView path,
+                                    PathState *state,
                                     const struct stat stats)
 {
   uint8_t hash[FILE_HASH_SIZE];
@@ -26,21 +28,15 @@ static void checkFileContentChanges(PathNode *node, PathState *state,
 
   if(state->metadata.file_info.size > FILE_HASH_SIZE)
   {
-    fileHash(node->path, stats, hash, NULL, NULL);
+    fileHash(path, stats, hash, NULL, NULL);
   }
   else
   {
     bytes_used = state->metadata.file_info.size;
-
-    FileStream *stream = sFopenRead(node->path);
-    sFread(hash, bytes_used, stream);
-    bool stream_not_at_end = sFbytesLeft(stream);
-    sFclose(stream);
-
-    if(stream_not_at_end)
+    if(!sReadFileExactly(path, hash, bytes_used))
     {
       die("file has changed while checking for changes: \"" PRI_STR "\"",
-          STR_FMT(node->path));
+          STR_FMT(path));
     }
   }
 
@@ -57,11 +53,13 @@ static void checkFileContentChanges(PathNode *node, PathState *state,
   both its backup hint and the specified path state.
 
   @param node The node containing the hint to update.
+  @param path The full path of the given node.
   @param state The state to update.
   @param stats The stats of the file represented by the given node.
 */
 void applyNodeChanges(AllocatorPair *allocator_pair, PathNode *node,
-                      PathState *state, const struct stat stats)
+                      StringView path, PathState *state,
+                      const struct stat stats)
 {
   if(state->uid != stats.st_uid || state->gid != stats.st_gid)
   {
@@ -93,17 +91,17 @@ void applyNodeChanges(AllocatorPair *allocator_pair, PathNode *node,
     else if((node->hint & BH_timestamp_changed) &&
             state->metadata.file_info.size > 0)
     {
-      checkFileContentChanges(node, state, stats);
+      checkFileContentChanges(node, path, state, stats);
     }
   }
   else if(state->type == PST_symlink)
   {
     StringView target =
-      sSymlinkReadTarget(node->path, allocator_pair->reusable_buffer);
+      sSymlinkReadTarget(path, allocator_pair->reusable_buffer);
     if((off_t)target.length != stats.st_size)
     {
       die("symlink changed while reading: \"" PRI_STR "\"",
-          STR_FMT(node->path));
+          STR_FMT(path));
     }
 
     if(!strIsEqual(state->metadata.symlink_target, target))
@@ -13,6 +13,7 @@ typedef struct
 } AllocatorPair;
 
 extern void applyNodeChanges(AllocatorPair *allocator_pair, PathNode *node,
-                             PathState *state, struct stat stats);
+                             StringView path, PathState *state,
+                             struct stat stats);
 
 #endif
@@ -3,8 +3,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "CRegion/alloc-growable.h"
-
 #include "backup-helpers.h"
 #include "error-handling.h"
 #include "file-hash.h"
@@ -12,8 +10,8 @@
 #include "safe-math.h"
 #include "safe-wrappers.h"
 #include "search.h"
-
-static unsigned char *io_buffer = NULL;
+#include "thread-local.h"
+#include "trace.h"
 
 /** Sets all values inside the given state to the properties in the
   specified result. A regular files hash and slot will be left undefined.
@@ -113,24 +111,23 @@ static bool searchNodeMatches(SearchNode *node, StringView path_tail)
 }
 
 /** Checks if a subnode of the given result node matches the specified
-  path.
+  name.
 
-  @param path The path to match.
+  @param name The last element of the path to match.
   @param result The node containing the subnodes used for matching. Can be
   NULL.
 
   @return The results subnode that has matched the given string, or NULL.
 */
-static SearchNode *matchesSearchSubnodes(StringView path,
+static SearchNode *matchesSearchSubnodes(StringView name,
                                          const SearchNode *result)
 {
   if(result != NULL)
   {
-    StringView path_tail = strSplitPath(path).tail;
     for(SearchNode *node = result->subnodes; node != NULL;
         node = node->next)
     {
-      if(searchNodeMatches(node, path_tail))
+      if(searchNodeMatches(node, name))
       {
         return node;
       }
@@ -160,15 +157,39 @@ static bool matchesIgnoreList(StringView path,
   return false;
 }
 
-/** Decrements all reference counts in the given history list.
+/** Records the repository file referenced by the given state as a
+  candidate for garbage collection. Does nothing if the state doesn't
+  reference a file in the repository.
+
+  @param metadata The metadata of the current backup.
+  @param state The state which will be dropped or overwritten.
+*/
+static void recordDroppedFile(Metadata *metadata, const PathState *state)
+{
+  if(state->type != PST_regular_file ||
+     state->metadata.file_info.size <= FILE_HASH_SIZE)
+  {
+    return;
+  }
+
+  RepoFileList *element = CR_RegionAlloc(metadata->r, sizeof *element);
+  element->info = state->metadata.file_info;
+  element->next = metadata->dropped_files;
+  metadata->dropped_files = element;
+}
+
+/** Decrements all reference counts in the given history list and records
+  the files referenced by it as candidates for garbage collection.
 
+  @param metadata The metadata of the current backup.
   @param first_point The first history point in the list. Can be NULL.
 */
-static void decrementRefCounts(PathHistory *first_point)
+static void decrementRefCounts(Metadata *metadata, PathHistory *first_point)
 {
   for(PathHistory *point = first_point; point != NULL; point = point->next)
   {
     point->backup->ref_count--;
+    recordDroppedFile(metadata, &point->state);
   }
 }
 
@@ -188,7 +209,7 @@ static void prepareNodeForWiping(Metadata *metadata, PathNode *node)
   backupHintSet(node->hint, BH_not_part_of_repository);
   metadata->total_path_count--;
 
-  decrementRefCounts(node->history);
+  decrementRefCounts(metadata, node->history);
 }
 
 static void prepareNodeForWipingRecursively(Metadata *metadata,
@@ -234,6 +255,7 @@ static void markAsRemovedRecursively(Metadata *metadata, PathNode *node,
       point->state.type = PST_non_existing;
       point->next = node->history;
       node->history = point;
+      node->history_array_length = 0;
     }
   }
 
@@ -262,6 +284,7 @@ static void handlePolicyChanges(Metadata *metadata, PathNode *node,
   backupHintSet(node->hint, BH_policy_changed);
   if(node->policy == BPOL_track)
   {
+    node->history_array_length = 0;
     if(node->history->state.type == PST_non_existing)
     {
       node->history->backup->ref_count--;
@@ -270,7 +293,7 @@ static void handlePolicyChanges(Metadata *metadata, PathNode *node,
 
     if(node->history->next != NULL)
     {
-      decrementRefCounts(node->history->next);
+      decrementRefCounts(metadata, node->history->next);
       node->history->next = NULL;
 
       backupHintSet(node->hint, BH_loses_history);
@@ -374,7 +397,8 @@ static void handleNodeChanges(AllocatorPair *allocator_pair,
 
   if(backupHintNoPol(node->hint) == BH_none)
   {
-    applyNodeChanges(allocator_pair, node, state, result.stats);
+    applyNodeChanges(allocator_pair, node, result.path, state,
+                     result.stats);
   }
   else if(result.policy != BPOL_none)
   {
@@ -396,12 +420,19 @@ static void handleFoundNode(AllocatorPair *allocator_pair,
 
   if(result.policy != BPOL_track)
   {
+    /* Untracked nodes overwrite their only state in place. */
+    const PathState old_state = node->history->state;
     handleNodeChanges(allocator_pair, node, &node->history->state, result);
 
+    if(backupHintNoPol(node->hint) != BH_none)
+    {
+      recordDroppedFile(metadata, &old_state);
+    }
     if(backupHintNoPol(node->hint) != BH_none ||
        result.policy == BPOL_none)
     {
       reassignPointToCurrent(metadata, node->history);
+      node->history_array_length = 0;
     }
   }
   else if(node->history->state.type == PST_non_existing)
@@ -413,6 +444,7 @@ static void handleFoundNode(AllocatorPair *allocator_pair,
 
     point->next = node->history;
     node->history = point;
+    node->history_array_length = 0;
   }
   else
   {
@@ -429,6 +461,7 @@ static void handleFoundNode(AllocatorPair *allocator_pair,
 
       point->next = node->history;
       node->history = point;
+      node->history_array_length = 0;
     }
   }
 }
@@ -443,7 +476,8 @@ static void handleFoundNode(AllocatorPair *allocator_pair,
   @param ignore_list The ignore expression list of the current backups
   search tree. Can be NULL.
 */
-static void handleNotFoundSubnodes(Metadata *metadata,
+static void handleNotFoundSubnodes(AllocatorPair *allocator_pair,
+                                   Metadata *metadata,
                                    const SearchNode *node_match,
                                    const BackupPolicy node_policy,
                                    PathNode *subnode_list,
@@ -459,13 +493,15 @@ static void handleNotFoundSubnodes(Metadata *metadata,
 
     /* Find the node in the search tree matching the current subnode. */
     SearchNode *subnode_match =
-      matchesSearchSubnodes(subnode->path, node_match);
+      matchesSearchSubnodes(subnode->name, node_match);
     if(subnode_match != NULL)
     {
       handleRemovedPath(metadata, subnode, subnode_match->policy);
     }
     else if(node_policy == BPOL_none ||
-            matchesIgnoreList(subnode->path, ignore_list))
+            matchesIgnoreList(
+              pathNodeGetPath(subnode, allocator_pair->reusable_buffer),
+              ignore_list))
     {
       prepareNodeForWipingRecursively(metadata, subnode);
     }
@@ -476,9 +512,24 @@ static void handleNotFoundSubnodes(Metadata *metadata,
   }
 }
 
+/** Returns true if the given node represents a non-empty regular file,
+  which was added or changed during the current backup and must be stored
+  in the repository. */
+static bool mustBeStored(const PathNode *node)
+{
+  const BackupHint hint = backupHintNoPol(node->hint);
+
+  return node->history->state.type == PST_regular_file &&
+    node->history->state.metadata.file_info.size > 0 &&
+    (hint == BH_added || hint == BH_symlink_to_regular ||
+     hint == BH_directory_to_regular || (node->hint & BH_content_changed));
+}
+
 /** Queries and processes the next search result recursively and updates
   the given metadata as described in the documentation of initiateBackup().
 
+  @param parent The node representing the currently traversed directory.
+  NULL if the traversal is at the top of the tree.
   @param node_list A pointer to the node list corresponding to the
   currently traversed directory.
   @param context The context from which the search result should be
@@ -489,8 +540,9 @@ static void handleNotFoundSubnodes(Metadata *metadata,
   @return The type of the processed result.
 */
 static SearchResultType initiateMetadataRecursively(
-  AllocatorPair *allocator_pair, Metadata *metadata, PathNode **node_list,
-  SearchIterator *context, const RegexList *ignore_list)
+  AllocatorPair *allocator_pair, Metadata *metadata, PathNode *parent,
+  PathNode **node_list, SearchIterator *context,
+  const RegexList *ignore_list)
 {
   const SearchResult result = searchGetNext(context);
   if(result.type == SRT_end_of_directory ||
@@ -499,18 +551,21 @@ static SearchResultType initiateMetadataRecursively(
     return result.type;
   }
 
-  PathNode *node = strTableGet(metadata->path_table, result.path);
+  StringView name = strSplitPath(result.path).tail;
+  PathNode *node = pathTableGet(metadata->path_table, parent, name);
 
   if(node == NULL)
   {
     node = CR_RegionAlloc(metadata->r, sizeof *node);
 
-    strSet(&node->path, strCopy(result.path, allocator_pair->a));
+    node->parent = parent;
+    strSet(&node->name, strCopy(name, allocator_pair->a));
 
     node->hint = BH_added;
     node->policy = result.policy;
     node->history =
       buildPathHistoryPoint(allocator_pair->a, metadata, result);
+    node->history_array_length = 0;
     node->subnodes = NULL;
 
     /* Prepend the new node to the current node list. */
@@ -526,7 +581,7 @@ static SearchResultType initiateMetadataRecursively(
 
   if(result.type == SRT_directory)
   {
-    while(initiateMetadataRecursively(allocator_pair, metadata,
+    while(initiateMetadataRecursively(allocator_pair, metadata, node,
                                       &node->subnodes, context,
                                       ignore_list) != SRT_end_of_directory)
       ;
@@ -564,8 +619,8 @@ static SearchResultType initiateMetadataRecursively(
   }
   else
   {
-    handleNotFoundSubnodes(metadata, result.node, result.policy,
-                           node->subnodes, ignore_list);
+    handleNotFoundSubnodes(allocator_pair, metadata, result.node,
+                           result.policy, node->subnodes, ignore_list);
   }
 
   /* Mark nodes without a policy and needed subnodes for purging. */
@@ -592,6 +647,14 @@ static SearchResultType initiateMetadataRecursively(
   {
     backupHintSet(node->hint, BH_unchanged);
   }
+  else if(mustBeStored(node))
+  {
+    /* The nodes hint is final at this point. */
+    PathNodeList *element = CR_RegionAlloc(metadata->r, sizeof *element);
+    element->node = node;
+    element->next = metadata->files_to_store;
+    metadata->files_to_store = element;
+  }
 
   return result.type;
 }
@@ -600,12 +663,14 @@ static SearchResultType initiateMetadataRecursively(
 
   @param node A PathNode which represents a regular file at its current
   history point.
+  @param path The full path of the given node.
   @param repo_path The path to the backup repository.
   @param repo_tmp_file_path The path to the repositories temporary file.
   @param stats The stats of the file represented by the node. Required to
   determine the ideal block size.
 */
-static void copyFileIntoRepo(PathNode *node, StringView repo_path,
+static void copyFileIntoRepo(PathNode *node, StringView path,
+                             StringView repo_path,
                              StringView repo_tmp_file_path,
                              const struct stat stats)
 {
@@ -614,11 +679,11 @@ static void copyFileIntoRepo(PathNode *node, StringView repo_path,
   const size_t blocksize = stats.st_blksize;
   uint64_t bytes_left = file_info->size;
 
-  FileStream *reader = sFopenRead(node->path);
-  RepoWriter *writer = repoWriterOpenFile(repo_path, repo_tmp_file_path,
-                                          node->path, file_info);
+  FileStream *reader = sFopenRead(path);
+  RepoWriter *writer =
+    repoWriterOpenFile(repo_path, repo_tmp_file_path, path, file_info);
 
-  io_buffer = CR_EnsureCapacity(io_buffer, blocksize);
+  unsigned char *io_buffer = threadLocalBuffer(TB_io, blocksize);
 
   while(bytes_left > 0)
   {
@@ -627,6 +692,7 @@ static void copyFileIntoRepo(PathNode *node, StringView repo_path,
 
     sFread(io_buffer, bytes_to_read, reader);
     repoWriterWrite(io_buffer, bytes_to_read, writer);
+    traceCount(TR_bytes_copied, bytes_to_read);
 
     bytes_left -= bytes_to_read;
   }
@@ -637,7 +703,7 @@ static void copyFileIntoRepo(PathNode *node, StringView repo_path,
   if(stream_not_at_end)
   {
     die("file has changed during backup: \"" PRI_STR "\"",
-        STR_FMT(node->path));
+        STR_FMT(path));
   }
 
   repoWriterClose(writer);
@@ -649,6 +715,7 @@ static void copyFileIntoRepo(PathNode *node, StringView repo_path,
   @param node A PathNode which represents a regular file at its current
   history point. Its hash and slot number must be set to the stored file it
   should be compared to.
+  @param path The full path of the given node.
   @param repo_path The path to the backup repository.
   @param stats The stats of the file represented by the node. Required to
   determine the ideal block size.
@@ -656,19 +723,20 @@ static void copyFileIntoRepo(PathNode *node, StringView repo_path,
   @return True if the file represented by the node is equal to its stored
   counterpart.
 */
-static bool equalsToStoredFile(const PathNode *node, StringView repo_path,
+static bool equalsToStoredFile(const PathNode *node, StringView path,
+                               StringView repo_path,
                                const struct stat stats)
 {
   const RegularFileInfo *file_info =
     &node->history->state.metadata.file_info;
   const size_t blocksize = stats.st_blksize;
 
-  FileStream *stream = sFopenRead(node->path);
+  FileStream *stream = sFopenRead(path);
 
-  io_buffer = CR_EnsureCapacity(io_buffer, sSizeMul(blocksize, 2));
+  unsigned char *io_buffer =
+    threadLocalBuffer(TB_io, sSizeMul(blocksize, 2));
 
-  RepoReader *repo_stream =
-    repoReaderOpenFile(repo_path, node->path, file_info);
+  RepoReader *repo_stream = repoReaderOpenFile(repo_path, path, file_info);
   unsigned char *repo_buffer = &io_buffer[blocksize];
 
   uint64_t bytes_left = file_info->size;
@@ -694,7 +762,7 @@ static bool equalsToStoredFile(const PathNode *node, StringView repo_path,
   if(bytes_left == 0 && stream_not_at_end)
   {
     die("file has changed while comparing to backup: \"" PRI_STR "\"",
-        STR_FMT(node->path));
+        STR_FMT(path));
   }
 
   return files_equal;
@@ -706,6 +774,7 @@ static bool equalsToStoredFile(const PathNode *node, StringView repo_path,
   @param node A PathNode which represents a regular file at its current
   history point. Its hash must be set and its slot number will be modified
   by this function.
+  @param path The full path of the given node.
   @param repo_path The path to the backup repository.
   @param stats The stats of the file represented by the node. Required to
   determine the ideal block size.
@@ -714,7 +783,8 @@ static bool equalsToStoredFile(const PathNode *node, StringView repo_path,
   number will be set to the already existing files slot number. If false is
   returned, the nodes slot number will contain the next free slot number.
 */
-static bool searchFileDuplicates(PathNode *node, StringView repo_path,
+static bool searchFileDuplicates(PathNode *node, StringView path,
+                                 StringView repo_path,
                                  const struct stat stats)
 {
   RegularFileInfo *file_info = &node->history->state.metadata.file_info;
@@ -722,7 +792,7 @@ static bool searchFileDuplicates(PathNode *node, StringView repo_path,
 
   while(repoRegularFileExists(repo_path, file_info))
   {
-    if(equalsToStoredFile(node, repo_path, stats))
+    if(equalsToStoredFile(node, path, repo_path, stats))
     {
       return true;
     }
@@ -743,80 +813,44 @@ static bool searchFileDuplicates(PathNode *node, StringView repo_path,
   history point. Its hash and slot number will be set by this function. In
   some cases the entire file will be stored as the hash. See the
   documentation of RegularFileInfo for more informations.
+  @param path The full path of the given node.
   @param repo_path The path to the repository.
   @param repo_tmp_file_path The path to the repositories temporary file.
 */
-static void addFileToRepo(PathNode *node, StringView repo_path,
+static void addFileToRepo(PathNode *node, StringView path,
+                          StringView repo_path,
                           StringView repo_tmp_file_path)
 {
   RegularFileInfo *file_info = &node->history->state.metadata.file_info;
 
   /* Die if the file has changed since the metadata was initiated. */
-  const struct stat stats = sStat(node->path);
+  const struct stat stats = sStat(path);
   if(node->history->state.metadata.file_info.modification_time !=
      stats.st_mtime)
   {
     die("file has changed during backup: \"" PRI_STR "\"",
-        STR_FMT(node->path));
+        STR_FMT(path));
   }
   else if(file_info->size > FILE_HASH_SIZE)
   {
     if(!(node->hint & BH_fresh_hash))
     {
-      fileHash(node->path, stats, file_info->hash, NULL, NULL);
+      fileHash(path, stats, file_info->hash, NULL, NULL);
     }
 
-    if(!searchFileDuplicates(node, repo_path, stats))
+    if(!searchFileDuplicates(node, path, repo_path, stats))
     {
-      copyFileIntoRepo(node, repo_path, repo_tmp_file_path, stats);
+      copyFileIntoRepo(node, path, repo_path, repo_tmp_file_path, stats);
     }
   }
   else if(!(node->hint & BH_fresh_hash))
   {
     /* Store small files directly in its hash buffer. */
-    FileStream *stream = sFopenRead(node->path);
-    sFread(&file_info->hash, file_info->size, stream);
-    const bool stream_not_at_end = sFbytesLeft(stream);
-    sFclose(stream);
-
-    if(stream_not_at_end)
+    if(!sReadFileExactly(path, &file_info->hash, file_info->size))
     {
       die("file has changed during backup: \"" PRI_STR "\"",
-          STR_FMT(node->path));
-    }
-  }
-}
-
-/** Finishes a backup recursively, as described in the documentation of
-  finishBackup().
-
-  @param metadata A valid metadata struct as described in the documentation
-  of finishBackup().
-  @param node_list A list containing the subnodes of the currently
-  traversed node.
-  @param repo_path The path to the repository.
-  @param repo_tmp_file_path The path to the repositories temporary file.
-*/
-static void finishBackupRecursively(Metadata *metadata,
-                                    PathNode *node_list,
-                                    StringView repo_path,
-                                    StringView repo_tmp_file_path)
-{
-  for(PathNode *node = node_list; node != NULL; node = node->next)
-  {
-    /* Handle only new regular files. */
-    if(node->history->state.type == PST_regular_file &&
-       node->history->state.metadata.file_info.size > 0 &&
-       (backupHintNoPol(node->hint) == BH_added ||
-        backupHintNoPol(node->hint) == BH_symlink_to_regular ||
-        backupHintNoPol(node->hint) == BH_directory_to_regular ||
-        (node->hint & BH_content_changed)))
-    {
-      addFileToRepo(node, repo_path, repo_tmp_file_path);
+          STR_FMT(path));
     }
-
-    finishBackupRecursively(metadata, node->subnodes, repo_path,
-                            repo_tmp_file_path);
   }
 }
 
@@ -845,17 +879,29 @@ void initiateBackup(Metadata *metadata, SearchNode *root_node)
 
   SearchIterator *context = searchNew(root_node);
   while(initiateMetadataRecursively(
-          &allocator_pair, metadata, &metadata->paths, context,
+          &allocator_pair, metadata, NULL, &metadata->paths, context,
           *root_node->ignore_expressions) != SRT_end_of_search)
     ;
 
-  handleNotFoundSubnodes(metadata, root_node, root_node->policy,
-                         metadata->paths, *root_node->ignore_expressions);
+  handleNotFoundSubnodes(&allocator_pair, metadata, root_node,
+                         root_node->policy, metadata->paths,
+                         *root_node->ignore_expressions);
+
+  /* Restore the order in which the files were found. */
+  PathNodeList *files_to_store = NULL;
+  while(metadata->files_to_store != NULL)
+  {
+    PathNodeList *element = metadata->files_to_store;
+    metadata->files_to_store = element->next;
+    element->next = files_to_store;
+    files_to_store = element;
+  }
+  metadata->files_to_store = files_to_store;
 }
 
-/** Completes a backup initiated with initiateBackup(). It copies
-  new/changed files to the repository and calculates missing hashes and
-  slot numbers.
+/** Completes a backup initiated with initiateBackup(). It copies the
+  new/changed files found by initiateBackup() to the repository and
+  calculates missing hashes and slot numbers.
 
   @param metadata A valid metadata struct which was successfully initiated
   using initiateBackup(). This struct will be finalized and should never be
@@ -866,7 +912,16 @@ void initiateBackup(Metadata *metadata, SearchNode *root_node)
 void finishBackup(Metadata *metadata, StringView repo_path,
                   StringView repo_tmp_file_path)
 {
-  finishBackupRecursively(metadata, metadata->paths, repo_path,
-                          repo_tmp_file_path);
+  Allocator *path_buffer =
+    allocatorWrapOneSingleGrowableBuffer(metadata->r);
+  for(const PathNodeList *element = metadata->files_to_store;
+      element != NULL; element = element->next)
+  {
+    PathNode *node = element->node;
+    addFileToRepo(node, pathNodeGetPath(node, path_buffer), repo_path,
+                  repo_tmp_file_path);
+  }
+
+  metadata->files_to_store = NULL;
   metadata->current_backup.completion_time = sTime();
 }
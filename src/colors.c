@@ -16,6 +16,28 @@ static const char *color_codes[] = {
   "0;36", "1;36", /* Cyan, bold cyan. */
 };
 
+/** Returns true if the given stream belongs to a TTY. The results for
+  stdout and stderr get cached, because this gets checked for every
+  colored fragment of a change list. */
+static bool isTTY(FILE *stream)
+{
+  static int stdout_is_tty = -1;
+  static int stderr_is_tty = -1;
+  int *cached_result = stream == stdout ? &stdout_is_tty
+    : stream == stderr                  ? &stderr_is_tty
+                                        : NULL;
+
+  if(cached_result == NULL)
+  {
+    return sIsTTY(stream);
+  }
+  else if(*cached_result == -1)
+  {
+    *cached_result = sIsTTY(stream);
+  }
+  return *cached_result == 1;
+}
+
 /** A colorized wrapper around fprintf(). If the given stream is neither
   stdout nor stderr, or does not belong to a TTY, the text will be printed
   without colors.
@@ -30,7 +52,7 @@ void colorPrintf(FILE *stream, TextColor color, const char *format, ...)
 {
   va_list arguments;
   va_start(arguments, format);
-  const bool colorize = sIsTTY(stream);
+  const bool colorize = isTTY(stream);
 
   if(colorize) fprintf(stream, "\033[%sm", color_codes[color]);
   vfprintf(stream, format, arguments);
@@ -2,12 +2,67 @@
 
 #include <errno.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "worker-pool.h"
+
+#ifdef __GNUC__
+#define TERMINATE_FUNCTION_ATTRIBUTES __attribute__((noreturn, nonnull(1)))
+#else
+#define TERMINATE_FUNCTION_ATTRIBUTES
+#endif
+
+static void terminate(const char *format, va_list arguments,
+                      bool print_errno,
+                      int error_number) TERMINATE_FUNCTION_ATTRIBUTES;
+
+/** Prints the given error message and terminates the program. If called
+  from a job of a worker pool, all other jobs will be stopped first.
+
+  @param format A valid formatting string.
+  @param arguments The arguments for the given formatting string.
+  @param print_errno True if a description of the given errno value
+  should be appended to the message.
+  @param error_number The errno value at the time die() was called.
+*/
+static void terminate(const char *format, va_list arguments,
+                      const bool print_errno, const int error_number)
+{
+  va_list arguments_copy;
+  va_copy(arguments_copy, arguments);
+  const int length = vsnprintf(NULL, 0, format, arguments_copy);
+  va_end(arguments_copy);
+
+  char message[length > 0 ? length + 1 : 1];
+  message[0] = '\0';
+  if(length > 0)
+  {
+    vsnprintf(message, sizeof(message), format, arguments);
+  }
+
+  workerPoolStopOnDie(print_errno ? error_number : 0, message);
+
+  /* Print buffered output first, so the error message comes last. */
+  fflush(stdout);
+
+  if(print_errno)
+  {
+    fprintf(stderr, "nb: error: %s: %s\n", message,
+            strerror(error_number));
+  }
+  else
+  {
+    fprintf(stderr, "nb: error: %s\n", message);
+  }
+
+  exit(EXIT_FAILURE);
+}
+
 /** Prints an error message and terminates the program. It takes the same
-  arguments as printf().
+  arguments as printf(). Can be called from worker threads.
 
   @param format A valid formatting string. This string doesn't need to
   contain newlines.
@@ -17,14 +72,7 @@ void die(const char *format, ...)
 {
   va_list arguments;
   va_start(arguments, format);
-
-  fprintf(stderr, "nb: error: ");
-  vfprintf(stderr, format, arguments);
-  fprintf(stderr, "\n");
-
-  va_end(arguments);
-
-  exit(EXIT_FAILURE);
+  terminate(format, arguments, false, 0);
 }
 
 /** Almost identical to die(), but it also prints a description of the
@@ -34,14 +82,9 @@ void die(const char *format, ...)
 */
 void dieErrno(const char *format, ...)
 {
+  const int error_number = errno;
+
   va_list arguments;
   va_start(arguments, format);
-
-  fprintf(stderr, "nb: error: ");
-  vfprintf(stderr, format, arguments);
-  fprintf(stderr, ": %s\n", strerror(errno));
-
-  va_end(arguments);
-
-  exit(EXIT_FAILURE);
+  terminate(format, arguments, true, error_number);
 }
@@ -1,59 +1,132 @@
 #include "file-hash.h"
 
-#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
 
 #include "BLAKE2/blake2.h"
-#include "CRegion/alloc-growable.h"
 
 #include "error-handling.h"
 #include "safe-wrappers.h"
+#include "thread-local.h"
+#include "trace.h"
 
-/** Calculates the hash of a file.
+/** Hashes the given opened file, which is expected to have the given
+  size. This function does not terminate the program on errors, which
+  allows calling it from worker threads.
 
-  @param stats Informations about the specified file.
+  @param descriptor The file to hash. Will not be closed.
+  @param size The expected size of the file.
+  @param block_size The maximal amount of bytes to read at once. Must be
+  greater than 0.
   @param hash_out The location to which the hash will be written. Its size
-  must be at least FILE_HASH_SIZE.
+  must be at least FILE_HASH_SIZE. Undefined if this function fails.
   @param progress_callback Will be called for each processed block. Can be
-  NULL. Will never be called if the specified file is empty.
+  NULL. Will never be called if the file is empty.
   @param callback_user_data Will be passed to `progress_callback`.
+
+  @return FHR_success if the file had the expected size and was read
+  successfully.
 */
-void fileHash(StringView filepath, struct stat stats, uint8_t *hash_out,
-              HashProgressCallback progress_callback,
-              void *callback_user_data)
+FileHashResult fileHashDescriptor(const int descriptor, const uint64_t size,
+                                  const size_t block_size,
+                                  uint8_t *hash_out,
+                                  HashProgressCallback progress_callback,
+                                  void *callback_user_data)
 {
-  const size_t blocksize = stats.st_blksize;
-  uint64_t bytes_left = stats.st_size;
-  FileStream *stream = sFopenRead(filepath);
-
-  static unsigned char *buffer = NULL;
-  buffer = CR_EnsureCapacity(buffer, blocksize);
+  const size_t buffer_size = size < block_size ? size + 1 : block_size;
+  unsigned char *buffer = threadLocalBuffer(TB_hash, buffer_size);
 
   blake2b_state state;
   blake2b_init(&state, FILE_HASH_SIZE);
 
+  uint64_t bytes_left = size;
   while(bytes_left > 0)
   {
     const size_t bytes_to_read =
-      bytes_left > blocksize ? blocksize : bytes_left;
+      bytes_left > buffer_size ? buffer_size : bytes_left;
+    const ssize_t bytes_read = read(descriptor, buffer, bytes_to_read);
+    if(bytes_read == -1 && errno == EINTR)
+    {
+      continue;
+    }
+    else if(bytes_read == -1)
+    {
+      return FHR_read_error;
+    }
+    else if(bytes_read == 0)
+    {
+      return FHR_end_of_file;
+    }
 
-    sFread(buffer, bytes_to_read, stream);
-    blake2b_update(&state, buffer, bytes_to_read);
-    bytes_left -= bytes_to_read;
+    blake2b_update(&state, buffer, bytes_read);
+    traceCount(TR_bytes_hashed, bytes_read);
+    bytes_left -= bytes_read;
 
     if(progress_callback != NULL)
     {
-      progress_callback(bytes_to_read, callback_user_data);
+      progress_callback(bytes_read, callback_user_data);
     }
   }
 
-  const bool stream_not_at_end = sFbytesLeft(stream);
-  sFclose(stream);
+  /* The end of the file is reached if another read returns nothing. */
+  ssize_t bytes_read;
+  do
+  {
+    bytes_read = read(descriptor, buffer, 1);
+  } while(bytes_read == -1 && errno == EINTR);
 
-  if(stream_not_at_end)
+  if(bytes_read == -1)
+  {
+    return FHR_probe_error;
+  }
+  else if(bytes_read != 0)
   {
-    die("file changed while calculating hash: \"" PRI_STR "\"",
-        STR_FMT(filepath));
+    return FHR_file_changed;
   }
 
   blake2b_final(&state, hash_out, FILE_HASH_SIZE);
+  return FHR_success;
+}
+
+/** Calculates the hash of a file.
+
+  @param stats Informations about the specified file.
+  @param hash_out The location to which the hash will be written. Its size
+  must be at least FILE_HASH_SIZE.
+  @param progress_callback Will be called for each processed block. Can be
+  NULL. Will never be called if the specified file is empty.
+  @param callback_user_data Will be passed to `progress_callback`.
+*/
+void fileHash(StringView filepath, struct stat stats, uint8_t *hash_out,
+              HashProgressCallback progress_callback,
+              void *callback_user_data)
+{
+  const int descriptor = sOpenRead(filepath);
+  const FileHashResult result = fileHashDescriptor(
+    descriptor, stats.st_size, stats.st_blksize, hash_out,
+    progress_callback, callback_user_data);
+  const int error_number = errno;
+  if(close(descriptor) != 0 && result == FHR_success)
+  {
+    dieErrno("failed to close \"" PRI_STR "\"", STR_FMT(filepath));
+  }
+
+  errno = error_number;
+  switch(result)
+  {
+    case FHR_success:
+      break;
+    case FHR_read_error:
+      dieErrno("IO error while reading \"" PRI_STR "\"",
+               STR_FMT(filepath));
+    case FHR_end_of_file:
+      die("reading \"" PRI_STR "\": reached end of file unexpectedly",
+          STR_FMT(filepath));
+    case FHR_probe_error:
+      dieErrno("failed to check for remaining bytes in \"" PRI_STR "\"",
+               STR_FMT(filepath));
+    case FHR_file_changed:
+      die("file changed while calculating hash: \"" PRI_STR "\"",
+          STR_FMT(filepath));
+  }
 }
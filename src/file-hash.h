@@ -12,9 +12,31 @@
 typedef void HashProgressCallback(uint64_t processed_block_size,
                                   void *user_data);
 
+/** Results of fileHashDescriptor(). */
+typedef enum
+{
+  FHR_success,
+
+  /** Reading the file failed. errno will be set. */
+  FHR_read_error,
+
+  /** The file is smaller than expected. */
+  FHR_end_of_file,
+
+  /** Checking for bytes behind the expected end failed. errno will be
+    set. */
+  FHR_probe_error,
+
+  /** The file is bigger than expected. */
+  FHR_file_changed,
+} FileHashResult;
+
 extern void fileHash(StringView filepath, struct stat stats,
                      uint8_t *hash_out,
                      HashProgressCallback progress_callback,
                      void *callback_user_data);
+extern FileHashResult fileHashDescriptor(
+  int descriptor, uint64_t size, size_t block_size, uint8_t *hash_out,
+  HashProgressCallback progress_callback, void *callback_user_data);
 
 #endif
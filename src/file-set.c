@@ -0,0 +1,114 @@
+#include "file-set.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "error-handling.h"
+#include "hash-table.h"
+
+/** Slot in the flat array of a file set. */
+typedef struct
+{
+  /** Hash of the files hash, size and slot. */
+  uint64_t set_hash;
+
+  uint64_t size;
+  uint8_t hash[FILE_HASH_SIZE];
+  uint8_t slot;
+} Slot;
+
+struct FileSet
+{
+  HashTable table;
+};
+
+static uint64_t hashFile(const FileSet *set, const RegularFileInfo *info)
+{
+  uint8_t data[FILE_HASH_SIZE + 1];
+  memcpy(data, info->hash, FILE_HASH_SIZE);
+  data[FILE_HASH_SIZE] = info->slot;
+
+  return hashTableHash(&set->table, info->size, data, sizeof(data));
+}
+
+static bool slotMatches(const void *slot, const void *key)
+{
+  const Slot *file_slot = slot;
+  const RegularFileInfo *info = key;
+
+  return file_slot->size == info->size && file_slot->slot == info->slot &&
+    memcmp(file_slot->hash, info->hash, FILE_HASH_SIZE) == 0;
+}
+
+/** Creates a dynamically growing set of repository files.
+
+  @param region Region to use for allocations.
+  @param expected_files The amount of files which the set is expected to
+  contain. Can be 0.
+
+  @return Set which lifetime will be bound to the given region.
+*/
+FileSet *fileSetNew(CR_Region *region, const size_t expected_files)
+{
+  FileSet *set = CR_RegionAlloc(region, sizeof(*set));
+  hashTableInit(&set->table, region, sizeof(Slot), expected_files);
+
+  return set;
+}
+
+/** Adds the given file to the set.
+
+  @param set The set to which the file should be added.
+  @param info The file to add. Only its hash, size and slot will be
+  stored. Its size must be greater than FILE_HASH_SIZE, because smaller
+  files are not stored inside repositories.
+
+  @return True if the file was added. False if the set already contained
+  the file.
+*/
+bool fileSetInsert(FileSet *set, const RegularFileInfo *info)
+{
+  if(info->size <= FILE_HASH_SIZE)
+  {
+    die("unable to add file with size %" PRIu64 " to file set",
+        info->size);
+  }
+
+  const uint64_t set_hash = hashFile(set, info);
+  if(hashTableFind(&set->table, set_hash, slotMatches, info) != NULL)
+  {
+    return false;
+  }
+
+  Slot slot = { .set_hash = set_hash, .size = info->size,
+                .slot = info->slot };
+  memcpy(slot.hash, info->hash, FILE_HASH_SIZE);
+  hashTableInsert(&set->table, &slot);
+
+  return true;
+}
+
+/** Checks if the given file was added to the set.
+
+  @param set The set to search.
+  @param info The file to look up. Only its hash, size and slot will be
+  compared.
+
+  @return True if the set contains the file.
+*/
+bool fileSetContains(const FileSet *set, const RegularFileInfo *info)
+{
+  if(info->size <= FILE_HASH_SIZE)
+  {
+    return false;
+  }
+
+  return hashTableFind(&set->table, hashFile(set, info), slotMatches,
+                       info) != NULL;
+}
+
+/** @return Count of all files inside the given set. */
+size_t fileSetCount(const FileSet *set)
+{
+  return set->table.count;
+}
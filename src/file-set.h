@@ -0,0 +1,20 @@
+#ifndef NANO_BACKUP_SRC_FILE_SET_H
+#define NANO_BACKUP_SRC_FILE_SET_H
+
+#include <stdbool.h>
+
+#include "CRegion/region.h"
+
+#include "repository.h"
+
+/** A set of files stored inside a repository. Files are identified by
+  their hash, size and slot, which get stored in binary form. */
+typedef struct FileSet FileSet;
+
+extern FileSet *fileSetNew(CR_Region *region, size_t expected_files);
+extern bool fileSetInsert(FileSet *set, const RegularFileInfo *info);
+extern bool fileSetContains(const FileSet *set,
+                            const RegularFileInfo *info);
+extern size_t fileSetCount(const FileSet *set);
+
+#endif
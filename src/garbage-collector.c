@@ -1,21 +1,26 @@
 #include "garbage-collector.h"
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "CRegion/alloc-growable.h"
 #include "CRegion/region.h"
 #include "allocator.h"
+#include "file-set.h"
 #include "safe-math.h"
 #include "safe-wrappers.h"
-#include "string-table.h"
+#include "trace.h"
+#include "worker-pool.h"
 
-/** Populates the given StringTable with referenced unique filepaths
-  relative to their repository.
-
-  @param a Allocator to use for constructing table keys.
-*/
-static void populateTableRecursively(Allocator *a, StringTable *table,
-                                     const PathNode *nodes)
+/** Populates the given set with all files referenced by the given nodes
+  and their subnodes. */
+static void populateSetRecursively(FileSet *set, const PathNode *nodes)
 {
   for(const PathNode *node = nodes; node != NULL; node = node->next)
   {
@@ -27,76 +32,307 @@ static void populateTableRecursively(Allocator *a, StringTable *table,
     for(const PathHistory *point = node->history; point != NULL;
         point = point->next)
     {
-      if(point->state.type != PST_regular_file ||
-         point->state.metadata.file_info.size <= FILE_HASH_SIZE)
-      {
-        continue;
-      }
-
-      static char *buffer = NULL;
-      repoBuildRegularFilePath(&buffer, &point->state.metadata.file_info);
-      StringView path = str(buffer);
-
-      if(strTableGet(table, path) == NULL)
+      if(point->state.type == PST_regular_file &&
+         point->state.metadata.file_info.size > FILE_HASH_SIZE)
       {
-        strTableMap(table, strCopy(path, a), (void *)0x1);
+        fileSetInsert(set, &point->state.metadata.file_info);
       }
     }
 
-    populateTableRecursively(a, table, node->subnodes);
+    populateSetRecursively(set, node->subnodes);
   }
 }
 
-/** Used during a garbage collection run. */
+/** Returns true if the given path relative to the repository is one of
+  the repositories internal files. */
+static bool isInternalFile(StringView path)
+{
+  return strIsEqual(path, str("config")) ||
+    strIsEqual(path, str("metadata")) ||
+    strIsEqual(path, str("lockfile")) ||
+    strIsEqual(path, str("scrub-state"));
+}
+
+/** Used during a garbage collection run. Shared by all jobs sweeping the
+  repository. */
 typedef struct
 {
   StringView repo_path;
 
-  /** All file paths inside this table are relative to repo_path. */
-  StringTable *paths_to_preserve;
+  /** Files referenced by the metadata. */
+  const FileSet *files_to_preserve;
 
-  /** Populated with informations during garbage collection. */
-  GCStatistics statistics;
+  /** The value passed as `max_call_limit` to the progress callback. */
+  size_t max_call_limit;
+
+  /** Full paths to the items which get swept by their own job. */
+  StringView *job_paths;
+
+  /** Statistics of each job, merged after all jobs have finished. */
+  GCStatistics *job_statistics;
+
+  /** Volume of deleted files reported to the progress callback. Protected
+    by the worker pools lock. */
+  uint64_t deleted_size_progress;
 
   GCProgressCallback *progress_callback;
   void *callback_user_data;
 } GCContext;
 
-static bool shouldBeRemoved(StringView path, const struct stat *stats,
-                            void *user_data)
+/** State of a single job, which sweeps one item of the repository. Jobs
+  run in parallel and report errors to the worker pool instead of calling
+  die(), which allows them to close their directories before returning. */
+typedef struct
 {
-  GCContext *ctx = user_data;
+  GCContext *ctx;
+  WorkerPool *pool;
+
+  /** The full path of the current item. Only used for error messages and
+    for looking up the item in the metadata. */
+  char *path;
+  size_t path_capacity;
+
+  /** True if this job has reported an error. */
+  bool failed;
+
+  GCStatistics statistics;
+
+  /** Volume of deleted files which was not yet reported to the progress
+    callback. */
+  uint64_t unreported_size;
+} Sweep;
+
+static void sweepFail(Sweep *sweep, const char *message)
+{
+  workerPoolFail(sweep->pool, errno, "%s \"%s\"", message, sweep->path);
+  sweep->failed = true;
+}
+
+/** Appends the given filename to the path of the current item.
+
+  @return False if the path could not be extended.
+*/
+static bool sweepAppendName(Sweep *sweep, const size_t path_length,
+                            const char *name)
+{
+  const size_t name_length = strlen(name);
+  const size_t required_capacity = path_length + name_length + 2;
+  if(required_capacity > sweep->path_capacity)
+  {
+    char *path = realloc(sweep->path, required_capacity * 2);
+    if(path == NULL)
+    {
+      sweepFail(sweep, "failed to allocate memory for path inside");
+      return false;
+    }
+    sweep->path = path;
+    sweep->path_capacity = required_capacity * 2;
+  }
+
+  sweep->path[path_length] = '/';
+  memcpy(&sweep->path[path_length + 1], name, name_length + 1);
+  return true;
+}
+
+static bool shouldBeRemoved(Sweep *sweep, const size_t path_length,
+                            const struct stat *stats)
+{
+  GCContext *ctx = sweep->ctx;
 
   StringView path_relative_to_repo =
-    strUnterminated(&path.content[ctx->repo_path.length + 1],
-                    path.length - ctx->repo_path.length - 1);
-  if(strTableGet(ctx->paths_to_preserve, path_relative_to_repo) != NULL)
+    strUnterminated(&sweep->path[ctx->repo_path.length + 1],
+                    path_length - ctx->repo_path.length - 1);
+  RegularFileInfo info;
+  if(isInternalFile(path_relative_to_repo) ||
+     (repoParseRegularFilePath(path_relative_to_repo, &info) &&
+      fileSetContains(ctx->files_to_preserve, &info)))
   {
     if(ctx->progress_callback != NULL)
     {
-      ctx->progress_callback(ctx->statistics.deleted_items_total_size,
-                             strTableCountMappings(ctx->paths_to_preserve),
+      workerPoolLock(sweep->pool);
+      ctx->deleted_size_progress += sweep->unreported_size;
+      sweep->unreported_size = 0;
+      ctx->progress_callback(ctx->deleted_size_progress,
+                             ctx->max_call_limit,
                              ctx->callback_user_data);
+      workerPoolUnlock(sweep->pool);
     }
     return false;
   }
 
-  ctx->statistics.deleted_items_count =
-    sSizeAdd(ctx->statistics.deleted_items_count, 1);
+  sweep->statistics.deleted_items_count++;
   if(S_ISREG(stats->st_mode))
   {
-    ctx->statistics.deleted_items_total_size =
-      sSizeAdd(ctx->statistics.deleted_items_total_size, stats->st_size);
+    sweep->statistics.deleted_items_total_size += stats->st_size;
+    sweep->unreported_size += stats->st_size;
   }
   return true;
 }
 
+/** Removes the current item of the given sweep if it is not referenced
+  by the metadata. Directories will be swept recursively and only removed
+  if they became empty. Does not follow symlinks. Items are accessed
+  relative to the descriptor of their parent directory, which spares the
+  kernel from resolving their full path again on each call.
+
+  @param sweep The sweep containing the path of the current item.
+  @param path_length The length of the current items path.
+  @param dir_fd The directory containing the current item or AT_FDCWD.
+  @param name The path of the current item relative to `dir_fd`. Must
+  stay valid during the entire call.
+
+  @return True if the item was removed.
+*/
+static bool sweepRecursively(Sweep *sweep, const size_t path_length,
+                             const int dir_fd, const char *name)
+{
+  traceCount(TR_gc_objects_scanned, 1);
+  traceCount(TR_files_stated, 1);
+
+  struct stat stats;
+  if(fstatat(dir_fd, name, &stats, AT_SYMLINK_NOFOLLOW) != 0)
+  {
+    sweepFail(sweep, "failed to access");
+    return false;
+  }
+
+  bool current_path_is_needed = false;
+  if(S_ISDIR(stats.st_mode))
+  {
+    if(workerPoolHasFailed(sweep->pool))
+    {
+      return false;
+    }
+
+    traceCount(TR_directories_read, 1);
+    const int fd = openat(dir_fd, name,
+                          O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_NOCTTY);
+    if(fd == -1)
+    {
+      sweepFail(sweep, "failed to open directory");
+      return false;
+    }
+    DIR *dir = fdopendir(fd);
+    if(dir == NULL)
+    {
+      sweepFail(sweep, "failed to open directory");
+      (void)close(fd);
+      return false;
+    }
+
+    while(!sweep->failed)
+    {
+      errno = 0;
+      const struct dirent *entry = readdir(dir);
+      if(entry == NULL)
+      {
+        if(errno != 0)
+        {
+          sweepFail(sweep, "failed to read directory");
+        }
+        break;
+      }
+      else if(strcmp(entry->d_name, ".") == 0 ||
+              strcmp(entry->d_name, "..") == 0)
+      {
+        continue;
+      }
+      else if(!sweepAppendName(sweep, path_length, entry->d_name))
+      {
+        break;
+      }
+
+      if(!sweepRecursively(sweep,
+                           path_length + 1 + strlen(entry->d_name), fd,
+                           entry->d_name))
+      {
+        current_path_is_needed = true;
+      }
+      sweep->path[path_length] = '\0';
+    }
+
+    if(closedir(dir) != 0 && !sweep->failed)
+    {
+      sweepFail(sweep, "failed to close directory");
+    }
+  }
+
+  if(sweep->failed)
+  {
+    return false;
+  }
+  else if(!current_path_is_needed &&
+          shouldBeRemoved(sweep, path_length, &stats))
+  {
+    if(unlinkat(dir_fd, name,
+                S_ISDIR(stats.st_mode) ? AT_REMOVEDIR : 0) != 0)
+    {
+      sweepFail(sweep, "failed to remove");
+      return false;
+    }
+    return true;
+  }
+  return false;
+}
+
+static void sweepJobPath(const size_t index, WorkerPool *pool,
+                         void *user_data)
+{
+  GCContext *ctx = user_data;
+  StringView path = ctx->job_paths[index];
+
+  Sweep sweep = {
+    .ctx = ctx,
+    .pool = pool,
+    .path = malloc(path.length + 1),
+    .path_capacity = path.length + 1,
+    .failed = false,
+  };
+  if(sweep.path == NULL)
+  {
+    workerPoolFail(pool, errno, "failed to allocate memory for path");
+    return;
+  }
+  memcpy(sweep.path, path.content, path.length);
+  sweep.path[path.length] = '\0';
+
+  sweepRecursively(&sweep, path.length, AT_FDCWD, path.content);
+
+  ctx->job_statistics[index] = sweep.statistics;
+  free(sweep.path);
+}
+
+/** Appends a copy of the given path to the given array.
+
+  @param paths A growable array allocated inside the given region or NULL.
+  @param count The amount of paths in the array. Will be incremented.
+
+  @return The array, which may have been moved.
+*/
+static StringView *appendPath(CR_Region *r, StringView *paths,
+                              size_t *count, StringView path)
+{
+  if(paths == NULL)
+  {
+    paths = CR_RegionAllocGrowable(r, sizeof(*paths));
+  }
+  paths = CR_EnsureCapacity(
+    paths, sSizeMul(sSizeAdd(*count, 1), sizeof(*paths)));
+
+  strSet(&paths[*count], strCopy(path, allocatorWrapRegion(r)));
+  (*count)++;
+  return paths;
+}
+
 GCStatistics collectGarbage(const Metadata *metadata, StringView repo_path)
 {
   return collectGarbageProgress(metadata, repo_path, NULL, NULL);
 }
 
 /** Removes unreferenced files and directories from the given repository.
+  Files are stored in two levels of directories, like "a/bc/...". The
+  items inside the top-level directories get swept in parallel, which
+  spreads the work across up to 16 * 256 jobs of similar size.
 
   @param metadata The metadata to search for referenced files.
   @param repo_path The path to the repository which should be cleaned up.
@@ -111,27 +347,171 @@ GCStatistics collectGarbageProgress(const Metadata *metadata,
                                     void *callback_user_data)
 {
   CR_Region *r = CR_RegionNew();
+  CR_RegionSetTag(r, "garbage collector");
+  FileSet *files_to_preserve = fileSetNew(r, 0);
+  populateSetRecursively(files_to_preserve, metadata->paths);
 
   GCContext ctx = {
     .repo_path = repo_path,
-    .paths_to_preserve = strTableNew(r),
+    .files_to_preserve = files_to_preserve,
+    /* The +4 is for the repositories config, metadata, lockfile and
+       scrub state. */
+    .max_call_limit = sSizeAdd(fileSetCount(files_to_preserve), 4),
+    .job_paths = NULL,
+    .deleted_size_progress = 0,
     .progress_callback = progress_callback,
     .callback_user_data = callback_user_data,
   };
-  strTableMap(ctx.paths_to_preserve, str("config"), (void *)0x1);
-  strTableMap(ctx.paths_to_preserve, str("metadata"), (void *)0x1);
-  strTableMap(ctx.paths_to_preserve, str("lockfile"), (void *)0x1);
-  populateTableRecursively(allocatorWrapRegion(r), ctx.paths_to_preserve,
-                           metadata->paths);
 
+  size_t path_count = 0;
+  StringView *split_directories = NULL;
+  size_t split_directory_count = 0;
   DirIterator *dir = sDirOpen(repo_path);
   for(StringView subpath = sDirGetNext(dir); !strIsEmpty(subpath);
       strSet(&subpath, sDirGetNext(dir)))
   {
-    sRemoveRecursivelyIf(subpath, shouldBeRemoved, &ctx);
+    traceCount(TR_gc_objects_scanned, 1);
+    traceCount(TR_files_stated, 1);
+    if(!S_ISDIR(sLStat(subpath).st_mode) ||
+       isInternalFile(strSplitPath(subpath).tail))
+    {
+      ctx.job_paths = appendPath(r, ctx.job_paths, &path_count, subpath);
+      continue;
+    }
+
+    split_directories = appendPath(r, split_directories,
+                                   &split_directory_count, subpath);
+
+    traceCount(TR_directories_read, 1);
+    DirIterator *subdir = sDirOpen(subpath);
+    for(StringView item = sDirGetNext(subdir); !strIsEmpty(item);
+        strSet(&item, sDirGetNext(subdir)))
+    {
+      ctx.job_paths = appendPath(r, ctx.job_paths, &path_count, item);
+    }
+    sDirClose(subdir);
   }
   sDirClose(dir);
 
+  ctx.job_statistics = CR_RegionAlloc(
+    r, sSizeMul(sizeof(*ctx.job_statistics), sSizeAdd(path_count, 1)));
+  workerPoolRun(workerPoolDefaultSize(), path_count, sweepJobPath, &ctx);
+
+  GCStatistics statistics = { 0 };
+  for(size_t index = 0; index < path_count; index++)
+  {
+    statistics.deleted_items_count =
+      sSizeAdd(statistics.deleted_items_count,
+               ctx.job_statistics[index].deleted_items_count);
+    statistics.deleted_items_total_size =
+      sUint64Add(statistics.deleted_items_total_size,
+                 ctx.job_statistics[index].deleted_items_total_size);
+  }
+
+  /* Top-level directories are never referenced by the metadata and can
+     be removed once all their items are gone. */
+  for(size_t index = 0; index < split_directory_count; index++)
+  {
+    if(sRemoveIfEmpty(split_directories[index]))
+    {
+      statistics.deleted_items_count =
+        sSizeAdd(statistics.deleted_items_count, 1);
+    }
+  }
+
+  CR_RegionRelease(r);
+  return statistics;
+}
+
+/** Removes emptied parent directories of the given file inside the
+  repository.
+
+  @param path The path of the removed file, which must be inside the
+  given repository.
+  @param statistics Will be updated with the removed directories.
+*/
+static void removeEmptyParents(StringView repo_path, StringView path,
+                               GCStatistics *statistics)
+{
+  for(StringView parent = strSplitPath(path).head;
+      parent.length > repo_path.length && sRemoveIfEmpty(parent);
+      strSet(&parent, strSplitPath(parent).head))
+  {
+    statistics->deleted_items_count =
+      sSizeAdd(statistics->deleted_items_count, 1);
+  }
+}
+
+/** Removes the files which lost their last reference during the current
+  backup. Unlike collectGarbage() this function does not traverse the
+  repository. It only checks the files listed in the metadatas
+  `dropped_files`. Leftovers from interrupted backups can only be removed
+  by collectGarbage().
+
+  @param metadata The metadata of the current backup, on which
+  finishBackup() was already called. If metadataWrite() was called too,
+  the files it gathered will be reused instead of traversing the tree
+  again. In this case the metadata must not be modified in between.
+  @param repo_path The path to the repository which should be cleaned up.
+
+  @return Statistics about items removed from the repository.
+*/
+GCStatistics collectDroppedFiles(const Metadata *metadata,
+                                 StringView repo_path)
+{
+  GCStatistics statistics = { 0 };
+  if(metadata->dropped_files == NULL)
+  {
+    return statistics;
+  }
+
+  CR_Region *r = CR_RegionNew();
+  CR_RegionSetTag(r, "garbage collector");
+  Allocator *path_buffer = allocatorWrapOneSingleGrowableBuffer(r);
+
+  const FileSet *files_to_preserve = metadata->referenced_files;
+  if(files_to_preserve == NULL)
+  {
+    FileSet *referenced_files = fileSetNew(r, 0);
+    populateSetRecursively(referenced_files, metadata->paths);
+    files_to_preserve = referenced_files;
+  }
+
+  /* Files may be dropped multiple times. */
+  FileSet *checked_files = fileSetNew(r, 0);
+  for(const RepoFileList *file = metadata->dropped_files; file != NULL;
+      file = file->next)
+  {
+    if(fileSetContains(files_to_preserve, &file->info) ||
+       !fileSetInsert(checked_files, &file->info))
+    {
+      continue;
+    }
+
+    char buffer[REPO_FILE_PATH_CAPACITY];
+    repoFormatRegularFilePath(buffer, &file->info);
+    StringView relative_path = str(buffer);
+
+    StringView path = strAppendPath(repo_path, relative_path, path_buffer);
+    if(!sPathExists(path))
+    {
+      continue;
+    }
+
+    const struct stat stats = sLStat(path);
+    sRemove(path);
+
+    statistics.deleted_items_count =
+      sSizeAdd(statistics.deleted_items_count, 1);
+    if(S_ISREG(stats.st_mode))
+    {
+      statistics.deleted_items_total_size =
+        sSizeAdd(statistics.deleted_items_total_size, stats.st_size);
+    }
+
+    removeEmptyParents(repo_path, path, &statistics);
+  }
+
   CR_RegionRelease(r);
-  return ctx.statistics;
+  return statistics;
 }
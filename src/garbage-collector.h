@@ -11,10 +11,13 @@ typedef struct
 
 extern GCStatistics collectGarbage(const Metadata *metadata,
                                    StringView repo_path);
+extern GCStatistics collectDroppedFiles(const Metadata *metadata,
+                                        StringView repo_path);
 
 /** Callback for implementing progress animations. Will be called for each
   file spared from deletion. If there are no files to preserve, this
-  function will never be called.
+  function will never be called. Calls may happen from different threads,
+  but never concurrently.
 
   @param deleted_items_size Volume in bytes of already deleted files. This
   value is imprecise and depends on the traversal order of the current
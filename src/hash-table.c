@@ -0,0 +1,234 @@
+#include "hash-table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SipHash/siphash.h"
+
+#include "error-handling.h"
+#include "safe-math.h"
+#include "safe-wrappers.h"
+
+/** The smallest capacity of a table. A small value allows the test suite
+  to cover table resizing. */
+#define MIN_CAPACITY ((size_t)32)
+
+/** The biggest slot which can be stored in a table. */
+#define MAX_SLOT_SIZE ((size_t)64)
+
+static unsigned char *slotAt(const HashTable *table, const size_t index)
+{
+  return &table->slots[index * table->slot_size];
+}
+
+static uint64_t slotHash(const unsigned char *slot)
+{
+  uint64_t hash;
+  memcpy(&hash, slot, sizeof(hash));
+  return hash;
+}
+
+/** Returns the distance between the given index and the ideal position of
+  the given hash. */
+static size_t probeDistance(const HashTable *table, const size_t index,
+                            const uint64_t hash)
+{
+  const size_t mask = table->capacity - 1;
+  return (index - (hash & mask)) & mask;
+}
+
+/** Stores the given slot in the table without checking its capacity. Slots
+  which are closer to their ideal position than the slot to insert get
+  displaced. */
+static void insertSlot(HashTable *table, const unsigned char *slot)
+{
+  /* Holds the displaced slots. */
+  unsigned char buffers[2][MAX_SLOT_SIZE];
+  size_t next_buffer = 0;
+  const unsigned char *carried = slot;
+
+  const size_t mask = table->capacity - 1;
+  size_t index = slotHash(carried) & mask;
+  size_t distance = 0;
+
+  for(unsigned char *existing = slotAt(table, index);
+      slotHash(existing) != 0; existing = slotAt(table, index))
+  {
+    const size_t existing_distance =
+      probeDistance(table, index, slotHash(existing));
+    if(existing_distance < distance)
+    {
+      unsigned char *displaced = buffers[next_buffer];
+      memcpy(displaced, existing, table->slot_size);
+      memcpy(existing, carried, table->slot_size);
+      carried = displaced;
+      next_buffer ^= 1;
+      distance = existing_distance;
+    }
+
+    index = (index + 1) & mask;
+    distance++;
+  }
+
+  memcpy(slotAt(table, index), carried, table->slot_size);
+}
+
+/** Allocates a new zeroed slot array for the given table. */
+static unsigned char *allocSlots(const HashTable *table)
+{
+  const size_t array_size = sSizeMul(table->capacity, table->slot_size);
+  unsigned char *slots = sMalloc(array_size);
+  memset(slots, 0, array_size);
+
+  return slots;
+}
+
+/** Double the capacity of the given table and move all slots to their
+  new destination. */
+static void doubleTableCapacity(HashTable *table)
+{
+  unsigned char *old_slots = table->slots;
+  const size_t old_capacity = table->capacity;
+
+  table->capacity = sSizeMul(old_capacity, 2);
+  table->slots = allocSlots(table);
+
+  for(size_t index = 0; index < old_capacity; index++)
+  {
+    const unsigned char *slot = &old_slots[index * table->slot_size];
+    if(slotHash(slot) != 0)
+    {
+      insertSlot(table, slot);
+    }
+  }
+
+  free(old_slots);
+}
+
+static void releaseHashTable(void *data)
+{
+  HashTable *table = data;
+  free(table->slots);
+}
+
+/** Initializes the given table.
+
+  @param table The table to initialize.
+  @param region Region to which the lifetime of the tables slots will be
+  bound.
+  @param slot_size The size of the slots to store, including their hash.
+  @param expected_slots The amount of slots which the table is expected to
+  contain. Can be 0. The table will not have to grow until it contains
+  more slots.
+*/
+void hashTableInit(HashTable *table, CR_Region *region,
+                   const size_t slot_size, const size_t expected_slots)
+{
+  if(slot_size < sizeof(uint64_t) || slot_size > MAX_SLOT_SIZE)
+  {
+    die("unable to create hash table with slots of %zu bytes", slot_size);
+  }
+
+  table->slot_size = slot_size;
+  table->count = 0;
+  table->capacity = MIN_CAPACITY;
+
+  const size_t required_capacity =
+    sSizeAdd(expected_slots, expected_slots / 3);
+  while(table->capacity <= required_capacity)
+  {
+    table->capacity = sSizeMul(table->capacity, 2);
+  }
+
+  for(size_t index = 0; index < sizeof(table->secret_key); index++)
+  {
+    table->secret_key[index] = sRand() % UINT8_MAX;
+  }
+
+  table->slots = allocSlots(table);
+  CR_RegionAttach(region, releaseHashTable, table);
+}
+
+/** Hashes the given data with the secret key of the given table.
+
+  @param table The table in which the hash will be used.
+  @param seed Gets mixed into the secret key. Allows deriving hashes from
+  values which are not part of the hashed data, like the address of a
+  parent node.
+  @param data The data to hash.
+  @param length The length of the data in bytes.
+
+  @return A hash which is never 0.
+*/
+uint64_t hashTableHash(const HashTable *table, const uint64_t seed,
+                       const void *data, const size_t length)
+{
+  uint8_t key[sizeof(table->secret_key)];
+  memcpy(key, table->secret_key, sizeof(key));
+  for(size_t index = 0; index < sizeof(seed); index++)
+  {
+    key[index] ^= (uint8_t)(seed >> (index * 8));
+  }
+
+  const uint64_t hash = siphash(data, length, key);
+  return hash | ((uint64_t)1 << 63);
+}
+
+/** Stores a copy of the given slot in the table. This function does not
+  check whether a slot with the same key was already stored. Pointers
+  returned by hashTableFind() get invalidated.
+
+  @param table The table in which the slot should be stored.
+  @param slot The slot to store. Must start with a hash returned by
+  hashTableHash().
+*/
+void hashTableInsert(HashTable *table, const void *slot)
+{
+  /* Keep the load factor at or below 3/4. */
+  if(table->count >= table->capacity / 4 * 3)
+  {
+    doubleTableCapacity(table);
+  }
+
+  insertSlot(table, slot);
+  table->count++;
+}
+
+/** Finds the slot with the given key.
+
+  @param table The table to search.
+  @param hash The hash of the key.
+  @param matches Will be called to compare slots with the same hash
+  against the given key.
+  @param key The key to pass to the match function.
+
+  @return The found slot or NULL. The slot must not be modified in a way
+  which changes its hash.
+*/
+void *hashTableFind(const HashTable *table, const uint64_t hash,
+                    HashTableMatchFunction *matches, const void *key)
+{
+  const size_t mask = table->capacity - 1;
+  size_t index = hash & mask;
+
+  /* A key can't be stored behind a slot which is closer to its own ideal
+     position than the key would be. */
+  for(size_t distance = 0;; distance++)
+  {
+    unsigned char *slot = slotAt(table, index);
+    const uint64_t slot_hash = slotHash(slot);
+    if(slot_hash == 0 ||
+       probeDistance(table, index, slot_hash) < distance)
+    {
+      break;
+    }
+    else if(slot_hash == hash && matches(slot, key))
+    {
+      return slot;
+    }
+
+    index = (index + 1) & mask;
+  }
+
+  return NULL;
+}
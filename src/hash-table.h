@@ -0,0 +1,41 @@
+#ifndef NANO_BACKUP_SRC_HASH_TABLE_H
+#define NANO_BACKUP_SRC_HASH_TABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "CRegion/region.h"
+
+/** Open-addressing hash table using robin hood probing, which implements
+  the probing, resizing and hashing shared by the StringTable, PathTable
+  and FileSet. Slots are stored inline and every key sits as close as
+  possible to its ideal position, so most lookups touch only a single
+  cache line.
+
+  Slots are structs defined by the user of the table. Each of them must
+  start with a uint64_t hash returned by hashTableHash(). A hash of 0 marks
+  an empty slot.
+*/
+typedef struct
+{
+  unsigned char *slots;
+  size_t slot_size;
+  size_t capacity; /**< The amount of slots. Always a power of 2. */
+  size_t count;    /**< The amount of occupied slots. */
+  uint8_t secret_key[16]; /**< Secret key for SipHash. */
+} HashTable;
+
+/** Returns true if the given slot contains the given key. Gets only
+  called for slots with the same hash as the key. */
+typedef bool HashTableMatchFunction(const void *slot, const void *key);
+
+extern void hashTableInit(HashTable *table, CR_Region *region,
+                          size_t slot_size, size_t expected_slots);
+extern uint64_t hashTableHash(const HashTable *table, uint64_t seed,
+                              const void *data, size_t length);
+extern void hashTableInsert(HashTable *table, const void *slot);
+extern void *hashTableFind(const HashTable *table, uint64_t hash,
+                           HashTableMatchFunction *matches,
+                           const void *key);
+
+#endif
@@ -4,11 +4,14 @@
 #include <stdio.h>
 
 #include "colors.h"
+#include "output.h"
 #include "safe-math.h"
 #include "safe-wrappers.h"
 
 static void warnConfigLineNr(const size_t line_nr)
 {
+  /* Keep warnings in order with the buffered change list. */
+  outputFlush();
   colorPrintf(stderr, TC_yellow, "config");
   fprintf(stderr, ": ");
   colorPrintf(stderr, TC_blue, "line ");
@@ -295,70 +298,246 @@ static void printSummarizedDetail(const ChangeSummary *summary,
   }
 }
 
-static void printNodePath(const PathNode *node, const TextColor color)
+/** Returns true if the timestamp of the given node should be mentioned,
+  because it changed without its content or vice versa. */
+static bool hasNotableTimestamp(const PathNode *node,
+                                const ChangeSummary *summary)
+{
+  return node->history->state.type != PST_symlink &&
+    !(node->hint & BH_timestamp_changed) !=
+      !(node->hint & BH_content_changed) &&
+    !summary->affects_parent_timestamp;
+}
+
+static void printNodePath(const PathNode *node, const TextColor color,
+                          Allocator *path_buffer)
 {
   const PathState *state = getExistingState(node);
+  StringView path = pathNodeGetPath(node, path_buffer);
 
   colorPrintf(stdout, color, "%s" PRI_STR "%s",
-              state->type == PST_symlink ? "^" : "", STR_FMT(node->path),
+              state->type == PST_symlink ? "^" : "", STR_FMT(path),
               state->type == PST_directory ? "/" : "");
 }
 
+/** Contains the names of the file types involved in a type change, in
+  the same order as the BackupHint values from BH_regular_to_symlink to
+  BH_other_to_directory. */
+static const char *const type_change_names[][2] = {
+  { "regular", "symlink" },   { "regular", "directory" },
+  { "symlink", "regular" },   { "symlink", "directory" },
+  { "directory", "regular" }, { "directory", "symlink" },
+  { "other", "regular" },     { "other", "symlink" },
+  { "other", "directory" },
+};
+
+static const char *policy_names[] = {
+  [BPOL_none] = "none",
+  [BPOL_copy] = "copy",
+  [BPOL_mirror] = "mirror",
+  [BPOL_track] = "track",
+};
+
+static const char *fileTypeName(const PathStateType type)
+{
+  switch(type)
+  {
+    case PST_regular_file: return "regular";
+    case PST_symlink: return "symlink";
+    case PST_directory: return "directory";
+    default: return "non_existing";
+  }
+}
+
+/** Returns the name of the change printed by printNode() for the given
+  node. */
+static const char *changeTypeName(const PathNode *node,
+                                  const ChangeSummary *summary,
+                                  const bool summarize_subnode_changes)
+{
+  const BackupHint hint = backupHintNoPol(node->hint);
+
+  if(hint == BH_added)
+  {
+    return "added";
+  }
+  else if(hint == BH_removed)
+  {
+    return "removed";
+  }
+  else if(hint == BH_not_part_of_repository)
+  {
+    return "lost";
+  }
+  else if(hint >= BH_regular_to_symlink && hint <= BH_other_to_directory)
+  {
+    return "type_changed";
+  }
+  else if(hint & BH_content_changed)
+  {
+    return "content_changed";
+  }
+  else if(summarize_subnode_changes && containsContentChanges(summary))
+  {
+    return "subnodes_changed";
+  }
+  else if(hint != BH_none)
+  {
+    return "metadata_changed";
+  }
+  return "unchanged";
+}
+
+/** Appends the statistics in the given summary to the current JSON
+  object. */
+static void printChangeSummaryFields(const ChangeSummary *summary)
+{
+  outputJsonUint64("new_items", summary->new_items.affected_items_count);
+  outputJsonUint64("new_size",
+                   summary->new_items.affected_items_total_size);
+  outputJsonUint64("removed_items",
+                   summary->removed_items.affected_items_count);
+  outputJsonUint64("removed_size",
+                   summary->removed_items.affected_items_total_size);
+  outputJsonUint64("lost_items", summary->lost_items.affected_items_count);
+  outputJsonUint64("lost_size",
+                   summary->lost_items.affected_items_total_size);
+  outputJsonUint64("changed_items",
+                   summary->changed_items.affected_items_count);
+  outputJsonUint64("changed_size",
+                   summary->changed_items.affected_items_total_size);
+  outputJsonUint64("metadata_changes", summary->changed_attributes);
+}
+
+/** JSON counterpart of printNode(), which prints a single line with an
+  object of the type "change". Takes the same arguments. */
+static void printNodeAsJson(const PathNode *node,
+                            const ChangeSummary *summary,
+                            const bool summarize_subnode_changes,
+                            Allocator *path_buffer)
+{
+  const BackupHint hint = backupHintNoPol(node->hint);
+  const PathState *state = getExistingState(node);
+
+  outputJsonBegin("change");
+  outputJsonString(
+    "change",
+    str(changeTypeName(node, summary, summarize_subnode_changes)));
+  outputJsonString("path", pathNodeGetPath(node, path_buffer));
+  outputJsonString("file_type", str(fileTypeName(state->type)));
+  outputJsonString("policy", str(policy_names[node->policy]));
+
+  if(hint >= BH_regular_to_symlink && hint <= BH_other_to_directory)
+  {
+    outputJsonString(
+      "from", str(type_change_names[hint - BH_regular_to_symlink][0]));
+    outputJsonString(
+      "to", str(type_change_names[hint - BH_regular_to_symlink][1]));
+  }
+
+  if(node->hint & BH_owner_changed)
+  {
+    outputJsonBool("owner_changed", true);
+  }
+  if(node->hint & BH_permissions_changed)
+  {
+    outputJsonBool("permissions_changed", true);
+  }
+  if(hasNotableTimestamp(node, summary))
+  {
+    outputJsonBool("timestamp_changed",
+                   (node->hint & BH_timestamp_changed) != 0);
+  }
+  if(node->hint & BH_policy_changed)
+  {
+    outputJsonBool("policy_changed", true);
+  }
+  if(node->hint & BH_loses_history)
+  {
+    outputJsonBool("loses_history", true);
+  }
+
+  if(state->type == PST_regular_file)
+  {
+    outputJsonUint64("size", state->metadata.file_info.size);
+  }
+  else if(state->type == PST_symlink)
+  {
+    outputJsonString("target", state->metadata.symlink_target);
+  }
+
+  if(state->type == PST_directory || hint == BH_directory_to_regular ||
+     hint == BH_directory_to_symlink)
+  {
+    printChangeSummaryFields(summary);
+  }
+
+  outputJsonEnd();
+}
+
 /** Prints informations about the given node.
 
   @param node The node to consider.
   @param summary Statistics gathered from all the current nodes subnodes.
   @param summarize_subnode_changes True if the subnode changes should be
   printed in a concise way.
+  @param path_buffer Reusable buffer for building the nodes path.
 */
 static void printNode(const PathNode *node, const ChangeSummary *summary,
-                      const bool summarize_subnode_changes)
+                      const bool summarize_subnode_changes,
+                      Allocator *path_buffer)
 {
+  if(outputGetFormat() == OF_ndjson)
+  {
+    printNodeAsJson(node, summary, summarize_subnode_changes, path_buffer);
+    return;
+  }
+
   const BackupHint hint = backupHintNoPol(node->hint);
 
   if(hint == BH_added)
   {
     colorPrintf(stdout, TC_green_bold, "++ ");
-    printNodePath(node, TC_green);
+    printNodePath(node, TC_green, path_buffer);
   }
   else if(hint == BH_removed)
   {
     colorPrintf(stdout, TC_red_bold, "-- ");
-    printNodePath(node, TC_red);
+    printNodePath(node, TC_red, path_buffer);
   }
   else if(hint == BH_not_part_of_repository)
   {
     if(node->policy == BPOL_mirror)
     {
       colorPrintf(stdout, TC_red_bold, "xx ");
-      printNodePath(node, TC_red);
+      printNodePath(node, TC_red, path_buffer);
     }
     else
     {
       colorPrintf(stdout, TC_blue_bold, "?? ");
-      printNodePath(node, TC_blue);
+      printNodePath(node, TC_blue, path_buffer);
     }
   }
   else if(hint >= BH_regular_to_symlink && hint <= BH_other_to_directory)
   {
     colorPrintf(stdout, TC_cyan_bold, "<> ");
-    printNodePath(node, TC_cyan);
+    printNodePath(node, TC_cyan, path_buffer);
   }
   else if(hint & BH_content_changed)
   {
     colorPrintf(stdout, TC_yellow_bold, "!! ");
-    printNodePath(node, TC_yellow);
+    printNodePath(node, TC_yellow, path_buffer);
   }
   else if(summarize_subnode_changes && containsContentChanges(summary))
   {
     colorPrintf(stdout, TC_yellow_bold, "!! ");
-    printNodePath(node, TC_yellow);
+    printNodePath(node, TC_yellow, path_buffer);
     printf("...");
   }
   else if(hint != BH_none)
   {
     colorPrintf(stdout, TC_magenta_bold, "@@ ");
-    printNodePath(node, TC_magenta);
+    printNodePath(node, TC_magenta, path_buffer);
 
     if(summarize_subnode_changes && summary->changed_attributes > 0)
     {
@@ -368,7 +547,7 @@ static void printNode(const PathNode *node, const ChangeSummary *summary,
   else
   {
     colorPrintf(stdout, TC_blue_bold, ":: ");
-    printNodePath(node, TC_blue);
+    printNodePath(node, TC_blue, path_buffer);
   }
 
   bool has_printed_details = false;
@@ -403,10 +582,7 @@ static void printNode(const PathNode *node, const ChangeSummary *summary,
     printf("permissions");
   }
 
-  if(node->history->state.type != PST_symlink &&
-     !(node->hint & BH_timestamp_changed) !=
-       !(node->hint & BH_content_changed) &&
-     !summary->affects_parent_timestamp)
+  if(hasNotableTimestamp(node, summary))
   {
     printPrefix(&has_printed_details);
     printf("%stimestamp",
@@ -485,17 +661,25 @@ static void printNode(const PathNode *node, const ChangeSummary *summary,
   @param node Path to match.
   @param expression_list List of regular expressions. Can be NULL. The
   first expression to match will get its `has_matched` field updated.
+  @param path_buffer Reusable buffer for building the nodes path.
 
   @return True if the given path node got matched by one of the specified
   regex patterns.
 */
 static bool matchesRegexList(const PathNode *node,
-                             RegexList *expression_list)
+                             RegexList *expression_list,
+                             Allocator *path_buffer)
 {
+  if(expression_list == NULL)
+  {
+    return false;
+  }
+
+  StringView path = pathNodeGetPath(node, path_buffer);
   for(RegexList *expression = expression_list; expression != NULL;
       expression = expression->next)
   {
-    if(sRegexIsMatching(expression->regex, node->path))
+    if(sRegexIsMatching(expression->regex, path))
     {
       expression->has_matched = true;
       return true;
@@ -512,6 +696,7 @@ static bool matchesRegexList(const PathNode *node,
   whether this node should be printed recursively or not. Can be NULL. May
   update the `has_matched` field in the list.
   @param print True, if informations should be printed.
+  @param path_buffer Reusable buffer for building node paths.
 
   @return Statistics about all the nodes locatable trough the given path
   list.
@@ -519,7 +704,8 @@ static bool matchesRegexList(const PathNode *node,
 static ChangeSummary recursePrintOverTree(const Metadata *metadata,
                                           const PathNode *path_list,
                                           RegexList *summarize_expressions,
-                                          const bool print)
+                                          const bool print,
+                                          Allocator *path_buffer)
 {
   ChangeSummary changes = { 0 };
 
@@ -528,7 +714,7 @@ static ChangeSummary recursePrintOverTree(const Metadata *metadata,
     ChangeSummary summary;
     const bool summarize = node->policy != BPOL_none &&
       getExistingState(node)->type == PST_directory &&
-      matchesRegexList(node, summarize_expressions);
+      matchesRegexList(node, summarize_expressions, path_buffer);
     /* Once a summarize expression matched, its subnodes should not be
        tested anymore. */
     RegexList *expressions_to_pass_down =
@@ -537,10 +723,11 @@ static ChangeSummary recursePrintOverTree(const Metadata *metadata,
     if(print && summarize)
     {
       summary = recursePrintOverTree(metadata, node->subnodes,
-                                     expressions_to_pass_down, false);
+                                     expressions_to_pass_down, false,
+                                     path_buffer);
       if(node->hint > BH_unchanged || containsChanges(&summary))
       {
-        printNode(node, &summary, summarize);
+        printNode(node, &summary, summarize, path_buffer);
       }
     }
     else if(print && node->hint > BH_unchanged &&
@@ -554,18 +741,20 @@ static ChangeSummary recursePrintOverTree(const Metadata *metadata,
 
       summary =
         recursePrintOverTree(metadata, node->subnodes,
-                             expressions_to_pass_down, print_subnodes);
+                             expressions_to_pass_down, print_subnodes,
+                             path_buffer);
 
       if(!(node->hint == BH_timestamp_changed &&
            summary.affects_parent_timestamp))
       {
-        printNode(node, &summary, summarize);
+        printNode(node, &summary, summarize, path_buffer);
       }
     }
     else
     {
       summary = recursePrintOverTree(metadata, node->subnodes,
-                                     expressions_to_pass_down, print);
+                                     expressions_to_pass_down, print,
+                                     path_buffer);
     }
 
     addNode(node, &changes, summary.affects_parent_timestamp);
@@ -615,7 +804,8 @@ void printSearchTreeInfos(const SearchNode *root_node)
   warnUnmatchedExpressions(*root_node->summarize_expressions, "directory");
 }
 
-/** Prints the changes in the given metadata tree.
+/** Prints the changes in the given metadata tree in the format passed to
+  outputInit().
 
   @param metadata A metadata tree, which must have been initiated with
   initiateBackup().
@@ -628,8 +818,18 @@ void printSearchTreeInfos(const SearchNode *root_node)
 ChangeSummary printMetadataChanges(const Metadata *metadata,
                                    RegexList *summarize_expressions)
 {
-  return recursePrintOverTree(metadata, metadata->paths,
-                              summarize_expressions, true);
+  return recursePrintOverTree(
+    metadata, metadata->paths, summarize_expressions, true,
+    allocatorWrapOneSingleGrowableBuffer(metadata->r));
+}
+
+/** Prints the given summary as a single line with a JSON object of the
+  type "summary". */
+void printChangeSummaryAsJson(const ChangeSummary *changes)
+{
+  outputJsonBegin("summary");
+  printChangeSummaryFields(changes);
+  outputJsonEnd();
 }
 
 bool containsChanges(const ChangeSummary *changes)
@@ -36,6 +36,7 @@ extern void printSearchTreeInfos(const SearchNode *root_node);
 extern ChangeSummary
 printMetadataChanges(const Metadata *metadata,
                      RegexList *summarize_expressions);
+extern void printChangeSummaryAsJson(const ChangeSummary *changes);
 extern bool containsChanges(const ChangeSummary *changes);
 extern void warnNodeMatches(const SearchNode *node, StringView string);
 
@@ -1,234 +1,921 @@
+/* Exposes statx() on Linux. */
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 #include "integrity.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "CRegion/alloc-growable.h"
+
+#include "error-handling.h"
 #include "file-hash.h"
 #include "safe-math.h"
 #include "safe-wrappers.h"
-#include "string-table.h"
+#include "trace.h"
+#include "worker-pool.h"
+
+/** The maximal amount of bytes hashed per read() call. Small enough to be
+  allocated without mmap() by common malloc() implementations. */
+#define HASH_BUFFER_SIZE ((size_t)64 * 1024)
 
+/** The size of a single record in the scrub state file: the files hash,
+  its size as 64 bit little endian value, its slot and the time of its
+  last check as 64 bit little endian value. */
+#define SCRUB_RECORD_SIZE (FILE_HASH_SIZE + 8 + 1 + 8)
+
+/** A unique file inside the repository, which may be referenced by many
+  history points. */
 typedef struct
 {
-  /** Used for allocating broken path nodes. */
-  CR_Region *r;
+  const RegularFileInfo *info;
 
-  /** All broken path nodes found during the check will be stored here. The
-    lifetime of this list is bound to the region `r` in this struct. */
-  ListOfBrokenPathNodes *broken_nodes;
+  /** The last time this file was checked by a scrub. 0 if it was never
+    checked. */
+  time_t last_checked;
 
-  StringView repo_path;
+  /** The inode number of the file. Only defined if the file is located
+    and plausible. */
+  ino_t inode;
+
+  /** The physical location of the files data on its device. Only defined
+    if `has_physical_offset` is true. */
+  uint64_t physical_offset;
+
+  /** True if the physical location of the file is known. */
+  bool has_physical_offset;
+
+  /** True if the file was already looked up via locateObject(). */
+  bool is_located;
+
+  /** True if the file exists as a regular file with the expected size.
+    Only defined if the file is located. */
+  bool is_plausible;
 
-  /** Wraps a single reusable buffer for path building. */
-  Allocator *reusable_buffer_allocator;
+  /** True if this file was checked during the current run. */
+  bool was_checked;
 
-  /** Reusable buffer created with CR_RegionAllocGrowable(). */
-  char *unique_subpath_buffer;
+  bool is_healthy;
+} IntegrityObject;
 
-  /** Cache to store the result of checked files. */
-  StringTable *unique_subpath_cache;
-  Allocator *unique_subpath_cache_key_allocator;
+typedef struct
+{
+  StringView repo_path;
+
+  /** All unique files to check, sorted by repoCompareRegularFiles(). */
+  IntegrityObject *objects;
+  size_t object_count;
+
+  /** The objects in the order in which they should be checked. Can be
+    NULL to check them in the order of `objects`. */
+  IntegrityObject **queue;
 
-  /** Volume of all files inside the repository with a size larger than
-    FILE_HASH_SIZE. */
+  /** Volume of all unique files inside the repository with a size larger
+    than FILE_HASH_SIZE. */
   uint64_t files_to_check_total_size;
 
+  /** Limits the amount of objects to check. Can be NULL to check all
+    objects. */
+  const ScrubBudget *budget;
+
+  /** The time at which no more objects should be checked. Only used if
+    the budget specifies a maximal duration. */
+  time_t deadline;
+
+  /** The sum of the sizes of all objects checked so far. Can only be
+    accessed while holding the pools lock. */
+  uint64_t bytes_started;
+
+  /** The amount of upcoming objects for which the kernel gets asked to
+    prefetch data. */
+  size_t read_ahead;
+
+  /** True if objects should only be located without hashing them. */
+  bool quick;
+
   IntegrityProgressCallback *progress_callback;
   void *callback_user_data;
 } IntegrityCheckContext;
 
+static int compareFileInfoPointers(const void *a, const void *b)
+{
+  return repoCompareRegularFiles(*(const RegularFileInfo *const *)a,
+                                 *(const RegularFileInfo *const *)b);
+}
+
+static int compareObjectWithInfo(const void *info, const void *object)
+{
+  return repoCompareRegularFiles(info,
+                                 ((const IntegrityObject *)object)->info);
+}
+
+/** Returns the file stored in the repository for the given history point
+  or NULL if the point does not refer to any stored file. */
+static const RegularFileInfo *getStoredFile(const PathHistory *point)
+{
+  if(point->state.type != PST_regular_file ||
+     point->state.metadata.file_info.size <= FILE_HASH_SIZE)
+  {
+    return NULL;
+  }
+  return &point->state.metadata.file_info;
+}
+
+/** Collects all stored files referenced by the given nodes recursively.
+
+  @param infos Growable array created with CR_RegionAllocGrowable().
+  @param count The amount of elements in `infos`. Will be updated by this
+  function.
+
+  @return The new address of `infos`.
+*/
+static const RegularFileInfo **
+collectStoredFiles(const RegularFileInfo **infos, size_t *count,
+                   const PathNode *node_list)
+{
+  for(const PathNode *node = node_list; node != NULL; node = node->next)
+  {
+    for(const PathHistory *point = node->history; point != NULL;
+        point = point->next)
+    {
+      const RegularFileInfo *info = getStoredFile(point);
+      if(info != NULL)
+      {
+        infos = CR_EnsureCapacity(
+          infos, sSizeMul(sSizeAdd(*count, 1), sizeof(*infos)));
+        infos[*count] = info;
+        (*count)++;
+      }
+    }
+    infos = collectStoredFiles(infos, count, node->subnodes);
+  }
+
+  return infos;
+}
+
+/** Populates the contexts object list with all unique files referenced by
+  the given metadata.
+
+  @param r Region used for allocating the object list.
+*/
+static void planObjects(CR_Region *r, IntegrityCheckContext *ctx,
+                        const Metadata *metadata)
+{
+  CR_Region *disposable_r = CR_RegionNew();
+  CR_RegionSetTag(disposable_r, "integrity check");
+  size_t info_count = 0;
+  const RegularFileInfo **infos = collectStoredFiles(
+    CR_RegionAllocGrowable(disposable_r, sizeof(*infos)), &info_count,
+    metadata->paths);
+  qsort(infos, info_count, sizeof(*infos), compareFileInfoPointers);
+
+  ctx->objects = CR_RegionAlloc(
+    r, sSizeMul(sSizeAdd(info_count, 1), sizeof(*ctx->objects)));
+  ctx->object_count = 0;
+  ctx->files_to_check_total_size = 0;
+
+  for(size_t index = 0; index < info_count; index++)
+  {
+    if(index > 0 &&
+       repoCompareRegularFiles(infos[index - 1], infos[index]) == 0)
+    {
+      continue;
+    }
+
+    ctx->objects[ctx->object_count].info = infos[index];
+    ctx->objects[ctx->object_count].last_checked = 0;
+    ctx->objects[ctx->object_count].is_located = false;
+    ctx->objects[ctx->object_count].was_checked = false;
+    ctx->objects[ctx->object_count].is_healthy = false;
+    ctx->object_count++;
+    ctx->files_to_check_total_size =
+      sUint64Add(ctx->files_to_check_total_size, infos[index]->size);
+  }
+
+  CR_RegionRelease(disposable_r);
+}
+
+/** Calls the progress callback of the given context. Calls from different
+  jobs are serialized trough the lock of the given pool. */
 static void callProgressCallback(const IntegrityCheckContext *ctx,
+                                 WorkerPool *pool,
                                  const uint64_t processed_block_size)
 {
   if(ctx->progress_callback != NULL)
   {
+    workerPoolLock(pool);
     ctx->progress_callback(processed_block_size,
                            ctx->files_to_check_total_size,
                            ctx->callback_user_data);
+    workerPoolUnlock(pool);
   }
 }
 
-static void fileHashCallback(const uint64_t processed_block_size,
-                             void *user_data)
+/** Writes the full path of the given stored file into the given buffer,
+  which must have a capacity of at least `repo_path.length + 1 +
+  REPO_FILE_PATH_CAPACITY`. */
+static void buildObjectPath(char *buffer, StringView repo_path,
+                            const RegularFileInfo *info)
 {
-  callProgressCallback(user_data, processed_block_size);
+  memcpy(buffer, repo_path.content, repo_path.length);
+  buffer[repo_path.length] = '/';
+  repoFormatRegularFilePath(&buffer[repo_path.length + 1], info);
 }
 
-/**
-  @param file_info Metadata of the file to check. The files size must be
-  larger than FILE_HASH_SIZE.
-  @param unique_subpath Path to the stored file relative to the repository.
+/** Asks the kernel to read the given stored file into its cache. All
+  errors will be ignored, since the file will be checked properly later. */
+static void prefetchObject(const IntegrityCheckContext *ctx,
+                           const RegularFileInfo *info)
+{
+  char path[ctx->repo_path.length + 1 + REPO_FILE_PATH_CAPACITY];
+  buildObjectPath(path, ctx->repo_path, info);
 
-  @return True if the specified file is healthy.
+  const int fd = open(path, O_RDONLY | O_NONBLOCK | O_NOCTTY);
+  if(fd != -1)
+  {
+    (void)posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    (void)close(fd);
+  }
+}
+
+/** The context passed to reportHashProgress(). */
+typedef struct
+{
+  const IntegrityCheckContext *ctx;
+  WorkerPool *pool;
+} HashProgress;
+
+static void reportHashProgress(const uint64_t processed_block_size,
+                               void *user_data)
+{
+  const HashProgress *progress = user_data;
+  callProgressCallback(progress->ctx, progress->pool,
+                       processed_block_size);
+}
+
+/** Hashes the given opened file and compares it with the given info.
+
+  @param fd The file to hash, which will not be closed by this function.
+  @param path The path of the file, used for error messages.
+
+  @return True if the files content matches the given info. False on
+  mismatches or if an error was reported to the given pool.
 */
-typedef bool CheckFileCallback(IntegrityCheckContext *ctx,
-                               const RegularFileInfo *file_info,
-                               StringView unique_subpath);
+static bool contentMatches(const IntegrityCheckContext *ctx,
+                           WorkerPool *pool, const int fd, const char *path,
+                           const RegularFileInfo *info)
+{
+  (void)posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  HashProgress progress = { .ctx = ctx, .pool = pool };
+  uint8_t hash[FILE_HASH_SIZE];
+  switch(fileHashDescriptor(fd, info->size, HASH_BUFFER_SIZE, hash,
+                            reportHashProgress, &progress))
+  {
+    case FHR_success:
+      return memcmp(info->hash, hash, FILE_HASH_SIZE) == 0;
+    case FHR_read_error:
+      workerPoolFail(pool, errno, "IO error while reading \"%s\"", path);
+      break;
+    case FHR_end_of_file:
+      workerPoolFail(pool, 0,
+                     "reading \"%s\": reached end of file unexpectedly",
+                     path);
+      break;
+    case FHR_probe_error:
+      workerPoolFail(pool, errno,
+                     "failed to check for remaining bytes in \"%s\"",
+                     path);
+      break;
+    case FHR_file_changed:
+      workerPoolFail(pool, 0,
+                     "file changed while calculating hash: \"%s\"", path);
+      break;
+  }
 
-/** Updates `ctx->files_to_hash_total_size`. */
-static bool addToTotalFileSize(IntegrityCheckContext *ctx,
-                               const RegularFileInfo *file_info,
-                               StringView ignored)
+  return false;
+}
+
+/** The properties of a stored file which get checked without reading it. */
+typedef struct
 {
-  (void)ignored;
+  bool is_regular_file;
+  uint64_t size;
+  ino_t inode;
+} ObjectStats;
 
-  ctx->files_to_check_total_size =
-    sUint64Add(ctx->files_to_check_total_size, file_info->size);
+/** Looks up the given file without following symlinks. On Linux statx()
+  is used to request only the properties needed by the integrity check,
+  without forcing network filesystems to revalidate them.
+
+  @return False on failure, with errno set.
+*/
+static bool statObject(const char *path, ObjectStats *stats_out)
+{
+#ifdef STATX_TYPE
+  const unsigned int mask = STATX_TYPE | STATX_SIZE | STATX_INO;
+  struct statx extended_stats;
+  if(statx(AT_FDCWD, path, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, mask,
+           &extended_stats) != 0)
+  {
+    return false;
+  }
+  else if((extended_stats.stx_mask & mask) == mask)
+  {
+    stats_out->is_regular_file = S_ISREG(extended_stats.stx_mode);
+    stats_out->size = extended_stats.stx_size;
+    stats_out->inode = extended_stats.stx_ino;
+    return true;
+  }
+#endif
+
+  struct stat stats;
+  if(lstat(path, &stats) != 0)
+  {
+    return false;
+  }
+
+  stats_out->is_regular_file = S_ISREG(stats.st_mode);
+  stats_out->size = stats.st_size;
+  stats_out->inode = stats.st_ino;
   return true;
 }
 
-/**
-  @param file_info Metadata of the file to check. The files size must be
-  larger than FILE_HASH_SIZE.
-  @param unique_subpath Path to the stored file relative to the
-  repositories directory.
-*/
-static bool storedFileIsHealthy(IntegrityCheckContext *ctx,
-                                const RegularFileInfo *file_info,
-                                StringView unique_subpath)
+/** Looks up the given stored file and checks whether it exists as a
+  regular file with the expected size. Errors will be reported to the
+  given pool. */
+static void locateObject(const IntegrityCheckContext *ctx,
+                         WorkerPool *pool, IntegrityObject *object)
 {
-  StringView path_to_stored_file = strAppendPath(
-    ctx->repo_path, unique_subpath, ctx->reusable_buffer_allocator);
+  char path[ctx->repo_path.length + 1 + REPO_FILE_PATH_CAPACITY];
+  buildObjectPath(path, ctx->repo_path, object->info);
 
-  if(!sPathExists(path_to_stored_file))
+  object->is_located = true;
+  object->is_plausible = false;
+  traceCount(TR_files_stated, 1);
+
+  ObjectStats stats;
+  if(!statObject(path, &stats))
+  {
+    if(errno != ENOENT)
+    {
+      workerPoolFail(pool, errno, "failed to check existence of \"%s\"",
+                     path);
+    }
+    return;
+  }
+
+  object->inode = stats.inode;
+  object->has_physical_offset = false;
+  object->is_plausible =
+    stats.is_regular_file && stats.size == object->info->size;
+
+  /* Failures will be reported when the file gets checked. */
+  const int fd = object->is_plausible && !ctx->quick
+    ? open(path, O_RDONLY | O_NONBLOCK | O_NOCTTY)
+    : -1;
+  if(fd != -1)
   {
-    callProgressCallback(ctx, file_info->size);
+    object->has_physical_offset =
+      fPhysicalOffset(fd, &object->physical_offset);
+    (void)close(fd);
+  }
+}
+
+static void locateObjectAt(const size_t index, WorkerPool *pool,
+                           void *user_data)
+{
+  const IntegrityCheckContext *ctx = user_data;
+  IntegrityObject *object = &ctx->objects[index];
+  locateObject(ctx, pool, object);
+
+  if(ctx->quick)
+  {
+    object->is_healthy = object->is_plausible;
+    object->was_checked = true;
+    callProgressCallback(ctx, pool, object->info->size);
+  }
+}
+
+/** Orders located objects by the physical location of their data. Objects
+  with an unknown location are ordered by their inode number, which
+  approximates the physical order on most filesystems. */
+static int compareLocations(const void *a, const void *b)
+{
+  const IntegrityObject *object_a = *(const IntegrityObject *const *)a;
+  const IntegrityObject *object_b = *(const IntegrityObject *const *)b;
+
+  /* Implausible files will not be read and come first. */
+  if(object_a->is_plausible != object_b->is_plausible)
+  {
+    return object_a->is_plausible ? 1 : -1;
+  }
+  else if(!object_a->is_plausible)
+  {
+    return repoCompareRegularFiles(object_a->info, object_b->info);
+  }
+  else if(object_a->has_physical_offset != object_b->has_physical_offset)
+  {
+    return object_a->has_physical_offset ? 1 : -1;
+  }
+  else if(object_a->has_physical_offset &&
+          object_a->physical_offset != object_b->physical_offset)
+  {
+    return object_a->physical_offset < object_b->physical_offset ? -1 : 1;
+  }
+  else if(object_a->inode != object_b->inode)
+  {
+    return object_a->inode < object_b->inode ? -1 : 1;
+  }
+  return repoCompareRegularFiles(object_a->info, object_b->info);
+}
+
+/** Queues all located objects of the given context by their location, to
+  allow reading repositories on rotational disks sequentially. */
+static void queueByLocation(CR_Region *r, IntegrityCheckContext *ctx)
+{
+  ctx->queue = CR_RegionAlloc(
+    r, sSizeMul(sSizeAdd(ctx->object_count, 1), sizeof(*ctx->queue)));
+  for(size_t index = 0; index < ctx->object_count; index++)
+  {
+    ctx->queue[index] = &ctx->objects[index];
+  }
+  qsort(ctx->queue, ctx->object_count, sizeof(*ctx->queue),
+        compareLocations);
+}
+
+/** Checks whether the given stored file exists and matches its hash.
+
+  @param object The file to check. Will be located first, if this didn't
+  happen already.
+
+  @return True if the specified file is healthy.
+*/
+static bool storedFileIsHealthy(const IntegrityCheckContext *ctx,
+                                WorkerPool *pool, IntegrityObject *object)
+{
+  const RegularFileInfo *info = object->info;
+  if(!object->is_located)
+  {
+    locateObject(ctx, pool, object);
+  }
+  if(!object->is_plausible)
+  {
+    callProgressCallback(ctx, pool, info->size);
     return false;
   }
 
-  const struct stat stats = sLStat(path_to_stored_file);
-  if(!S_ISREG(stats.st_mode))
+  char path[ctx->repo_path.length + 1 + REPO_FILE_PATH_CAPACITY];
+  buildObjectPath(path, ctx->repo_path, info);
+
+  const int fd = open(path, O_RDONLY | O_NOCTTY);
+  if(fd == -1)
   {
-    callProgressCallback(ctx, file_info->size);
+    workerPoolFail(pool, errno, "failed to open \"%s\" for reading", path);
     return false;
   }
-  if((uint64_t)stats.st_size != file_info->size)
+
+  const bool is_healthy = contentMatches(ctx, pool, fd, path, info);
+  if(close(fd) != 0)
   {
-    callProgressCallback(ctx, file_info->size);
+    workerPoolFail(pool, errno, "failed to close \"%s\"", path);
     return false;
   }
+  return is_healthy;
+}
 
-  uint8_t hash[FILE_HASH_SIZE];
-  fileHash(path_to_stored_file, stats, hash, fileHashCallback, ctx);
-  return memcmp(file_info->hash, hash, FILE_HASH_SIZE) == 0;
+/** Used if no options were passed to checkIntegrity() or
+  scrubRepository(). */
+static const IntegrityOptions default_options = {
+  .thread_count = 0,
+  .read_ahead = INTEGRITY_DEFAULT_READ_AHEAD,
+  .quick = false,
+};
+
+/** Returns the object at the given position in the contexts queue. */
+static IntegrityObject *getQueuedObject(const IntegrityCheckContext *ctx,
+                                        const size_t index)
+{
+  return ctx->queue == NULL ? &ctx->objects[index] : ctx->queue[index];
 }
 
-/** Check the integrity of the stored file associated with the given
-  history point.
+/** Returns true if the budget of the given context was used up. */
+static bool budgetExhausted(const IntegrityCheckContext *ctx)
+{
+  if(ctx->budget->max_bytes > 0 &&
+     ctx->bytes_started >= ctx->budget->max_bytes)
+  {
+    return true;
+  }
+  return ctx->budget->max_seconds > 0 && time(NULL) >= ctx->deadline;
+}
 
-  @param ctx Informations related to the current integrity check.
-  @param point History point to check.
+/** Reserves the given object from the contexts budget.
 
-  @return True if the given history point is healthy.
+  @return False if the budget was already used up and the object should
+  not be checked.
 */
-static bool historyPointIsHealthy(IntegrityCheckContext *ctx,
-                                  const PathHistory *point,
-                                  CheckFileCallback check_file_callback)
+static bool reserveBudget(IntegrityCheckContext *ctx, WorkerPool *pool,
+                          const IntegrityObject *object)
 {
-  if(point->state.type != PST_regular_file)
+  if(ctx->budget == NULL)
   {
     return true;
   }
 
-  const RegularFileInfo *file_info = &point->state.metadata.file_info;
-  if(file_info->size <= FILE_HASH_SIZE)
+  workerPoolLock(pool);
+  const bool exhausted = budgetExhausted(ctx);
+  if(!exhausted)
   {
-    return true;
+    ctx->bytes_started =
+      sUint64Add(ctx->bytes_started, object->info->size);
   }
+  workerPoolUnlock(pool);
 
-  repoBuildRegularFilePath(&ctx->unique_subpath_buffer, file_info);
-  StringView unique_subpath = str(ctx->unique_subpath_buffer);
+  return !exhausted;
+}
 
-  const void *cached_result =
-    strTableGet(ctx->unique_subpath_cache, unique_subpath);
-  void *subpath_is_healthy = (void *)0x1;
-  void *subpath_is_broken = (void *)0x2;
+static void checkObject(const size_t index, WorkerPool *pool,
+                        void *user_data)
+{
+  IntegrityCheckContext *ctx = user_data;
 
-  if(cached_result == NULL)
+  IntegrityObject *object = getQueuedObject(ctx, index);
+  if(!reserveBudget(ctx, pool, object))
   {
-    const bool is_healthy =
-      check_file_callback(ctx, file_info, unique_subpath);
-    StringView key_copy =
-      strCopy(unique_subpath, ctx->unique_subpath_cache_key_allocator);
-    strTableMap(ctx->unique_subpath_cache, key_copy,
-                is_healthy ? subpath_is_healthy : subpath_is_broken);
-    return is_healthy;
+    return;
   }
-  return cached_result == subpath_is_healthy;
+
+  if(ctx->read_ahead > 0 && index == 0)
+  {
+    for(size_t ahead = 1;
+        ahead < ctx->read_ahead && ahead < ctx->object_count; ahead++)
+    {
+      prefetchObject(ctx, getQueuedObject(ctx, ahead)->info);
+    }
+  }
+  if(ctx->read_ahead > 0 && ctx->object_count - index > ctx->read_ahead)
+  {
+    prefetchObject(ctx,
+                   getQueuedObject(ctx, index + ctx->read_ahead)->info);
+  }
+
+  object->is_healthy = storedFileIsHealthy(ctx, pool, object);
+  object->was_checked = true;
 }
 
-/** Validate the integrity of all files in the given subtree recursively.
+/** Check the integrity of the stored file associated with the given
+  history point.
+
+  @param ctx Informations related to the current integrity check, on which
+  all objects were already checked.
+  @param point History point to check.
+
+  @return True if the given history point is healthy or if its file was
+  not checked during the current run.
+*/
+static bool historyPointIsHealthy(const IntegrityCheckContext *ctx,
+                                  const PathHistory *point)
+{
+  const RegularFileInfo *info = getStoredFile(point);
+  if(info == NULL)
+  {
+    return true;
+  }
 
+  const IntegrityObject *object =
+    bsearch(info, ctx->objects, ctx->object_count, sizeof(*ctx->objects),
+            compareObjectWithInfo);
+  return !object->was_checked || object->is_healthy;
+}
+
+/** Collects all nodes with broken history points in the given subtree
+  recursively.
+
+  @param r Region used for allocating the broken nodes.
+  @param broken_nodes The list to which found nodes will be prepended.
   @param node_list List of path nodes to traverse recursively.
 */
-static void
-checkIntegrityRecursively(IntegrityCheckContext *ctx,
-                          const PathNode *node_list,
-                          CheckFileCallback check_file_callback)
+static void collectBrokenNodes(CR_Region *r,
+                               const IntegrityCheckContext *ctx,
+                               ListOfBrokenPathNodes **broken_nodes,
+                               const PathNode *node_list)
 {
   for(const PathNode *node = node_list; node != NULL; node = node->next)
   {
     for(const PathHistory *point = node->history; point != NULL;
         point = point->next)
     {
-      if(!historyPointIsHealthy(ctx, point, check_file_callback))
+      if(!historyPointIsHealthy(ctx, point))
       {
         ListOfBrokenPathNodes *broken_node =
-          CR_RegionAlloc(ctx->r, sizeof(*broken_node));
+          CR_RegionAlloc(r, sizeof(*broken_node));
         broken_node->node = node;
-        broken_node->next = ctx->broken_nodes;
-        ctx->broken_nodes = broken_node;
+        broken_node->next = *broken_nodes;
+        *broken_nodes = broken_node;
         break;
       }
     }
-    checkIntegrityRecursively(ctx, node->subnodes, check_file_callback);
+    collectBrokenNodes(r, ctx, broken_nodes, node->subnodes);
   }
 }
 
-static CR_Region *attachDisposableRegion(IntegrityCheckContext *ctx)
-{
-  CR_Region *disposable_r = CR_RegionNew();
-  ctx->reusable_buffer_allocator =
-    allocatorWrapOneSingleGrowableBuffer(disposable_r);
-  ctx->unique_subpath_buffer = CR_RegionAllocGrowable(disposable_r, 1);
-  ctx->unique_subpath_cache = strTableNew(disposable_r);
-  ctx->unique_subpath_cache_key_allocator =
-    allocatorWrapRegion(disposable_r);
-  return disposable_r;
-}
-
 /** Check if all the files in the specified repository match up with their
-  stored hash.
+  stored hash. Each stored file will only be checked once, even if it is
+  referenced by many history points. All files get looked up before
+  hashing them in parallel, ordered by their physical location on disk or
+  their inode number. Quick checks skip hashing.
 
   @param r Region used for allocating the returned result.
   @param metadata Repository to validate.
   @param repo_path Absolute or relative path to the repository to check.
+  @param options Controls how the check is performed. Can be NULL to use
+  the defaults.
+  @param progress_callback Can be NULL. Calls may happen from different
+  threads, but never concurrently.
+  @param callback_user_data Will be passed to `progress_callback`.
 
   @return NULL if the given repository is healthy. Otherwise a list of all
   nodes associated with corrupted files. The lifetime of the returned list
-  will be bound to the given region.
+  will be bound to the given region. The order of the list does not depend
+  on the order in which files were checked.
 */
 ListOfBrokenPathNodes *checkIntegrity(
   CR_Region *r, const Metadata *metadata, StringView repo_path,
+  const IntegrityOptions *options,
   IntegrityProgressCallback progress_callback, void *callback_user_data)
 {
+  if(options == NULL)
+  {
+    options = &default_options;
+  }
+
   IntegrityCheckContext ctx = {
-    .r = r,
-    .broken_nodes = NULL,
     .repo_path = repo_path,
+    .read_ahead = options->read_ahead,
+    .quick = options->quick,
     .progress_callback = progress_callback,
     .callback_user_data = callback_user_data,
   };
 
-  /* Dry run to populate `ctx->files_to_hash_total_size`. */
-  CR_Region *disposable_r = attachDisposableRegion(&ctx);
-  checkIntegrityRecursively(&ctx, metadata->paths, addToTotalFileSize);
+  CR_Region *disposable_r = CR_RegionNew();
+  CR_RegionSetTag(disposable_r, "integrity check");
+  planObjects(disposable_r, &ctx, metadata);
+
+  const size_t thread_count = options->thread_count > 0
+    ? options->thread_count
+    : workerPoolDefaultSize();
+  workerPoolRunUnordered(thread_count, ctx.object_count, locateObjectAt,
+                         &ctx);
+  if(!ctx.quick)
+  {
+    queueByLocation(disposable_r, &ctx);
+    workerPoolRun(thread_count, ctx.object_count, checkObject, &ctx);
+  }
+
+  ListOfBrokenPathNodes *broken_nodes = NULL;
+  collectBrokenNodes(r, &ctx, &broken_nodes, metadata->paths);
   CR_RegionRelease(disposable_r);
-  disposable_r = attachDisposableRegion(&ctx);
 
-  /* Do a real check. */
-  checkIntegrityRecursively(&ctx, metadata->paths, storedFileIsHealthy);
+  return broken_nodes;
+}
+
+/** Orders objects by the time of their last check, starting with the
+  oldest one. Objects which were never checked come first. */
+static int compareCheckAge(const void *a, const void *b)
+{
+  const IntegrityObject *object_a = *(const IntegrityObject *const *)a;
+  const IntegrityObject *object_b = *(const IntegrityObject *const *)b;
+
+  if(object_a->last_checked != object_b->last_checked)
+  {
+    return object_a->last_checked < object_b->last_checked ? -1 : 1;
+  }
+  return repoCompareRegularFiles(object_a->info, object_b->info);
+}
+
+static uint64_t decode64(const char *bytes)
+{
+  uint64_t value = 0;
+  for(size_t index = 8; index > 0; index--)
+  {
+    value = (value << 8) | (uint8_t)bytes[index - 1];
+  }
+  return value;
+}
+
+static void encode64(uint8_t *bytes, uint64_t value)
+{
+  for(size_t index = 0; index < 8; index++)
+  {
+    bytes[index] = (uint8_t)(value & 0xFF);
+    value >>= 8;
+  }
+}
+
+/** Loads the check times stored in the given scrub state file into
+  the objects of the given context. Records of files which are not
+  referenced anymore will be ignored.
+
+  @param state_path The path to the scrub state file. If it doesn't
+  exist, all objects are assumed to have never been checked.
+*/
+static void loadScrubState(const IntegrityCheckContext *ctx,
+                           StringView state_path)
+{
+  if(!sPathExists(state_path))
+  {
+    return;
+  }
+
+  CR_Region *disposable_r = CR_RegionNew();
+  CR_RegionSetTag(disposable_r, "integrity check");
+  const FileContent content = sGetFilesContent(disposable_r, state_path);
+  if(content.size % SCRUB_RECORD_SIZE != 0)
+  {
+    die("corrupted scrub state: \"" PRI_STR "\"", STR_FMT(state_path));
+  }
+
+  for(size_t offset = 0; offset < content.size;
+      offset += SCRUB_RECORD_SIZE)
+  {
+    const char *record = &content.content[offset];
+
+    RegularFileInfo info;
+    memcpy(info.hash, record, FILE_HASH_SIZE);
+    info.size = decode64(&record[FILE_HASH_SIZE]);
+    info.slot = (uint8_t)record[FILE_HASH_SIZE + 8];
+
+    IntegrityObject *object =
+      bsearch(&info, ctx->objects, ctx->object_count,
+              sizeof(*ctx->objects), compareObjectWithInfo);
+    if(object != NULL)
+    {
+      object->last_checked =
+        (time_t)decode64(&record[FILE_HASH_SIZE + 8 + 1]);
+    }
+  }
+
+  CR_RegionRelease(disposable_r);
+}
+
+/** Writes the check times of all objects which were checked at least
+  once to the repositories scrub state file. */
+static void writeScrubState(const IntegrityCheckContext *ctx,
+                            StringView repo_tmp_file_path,
+                            StringView state_path)
+{
+  RepoWriter *writer = repoWriterOpenRaw(
+    ctx->repo_path, repo_tmp_file_path, str("scrub-state"), state_path);
+
+  for(size_t index = 0; index < ctx->object_count; index++)
+  {
+    const IntegrityObject *object = &ctx->objects[index];
+    if(object->last_checked == 0)
+    {
+      continue;
+    }
+
+    uint8_t record[SCRUB_RECORD_SIZE];
+    memcpy(record, object->info->hash, FILE_HASH_SIZE);
+    encode64(&record[FILE_HASH_SIZE], object->info->size);
+    record[FILE_HASH_SIZE + 8] = object->info->slot;
+    encode64(&record[FILE_HASH_SIZE + 8 + 1],
+             (uint64_t)object->last_checked);
+    repoWriterWrite(record, sizeof(record), writer);
+  }
+
+  repoWriterClose(writer);
+}
+
+/** Queues all objects of the given context by the age of their last
+  check and sums up the size of the files which fit into the byte budget.
+*/
+static void queueByCheckAge(CR_Region *r, IntegrityCheckContext *ctx)
+{
+  ctx->queue = CR_RegionAlloc(
+    r, sSizeMul(sSizeAdd(ctx->object_count, 1), sizeof(*ctx->queue)));
+  for(size_t index = 0; index < ctx->object_count; index++)
+  {
+    ctx->queue[index] = &ctx->objects[index];
+  }
+  qsort(ctx->queue, ctx->object_count, sizeof(*ctx->queue),
+        compareCheckAge);
+
+  if(ctx->budget->max_bytes == 0)
+  {
+    return;
+  }
+
+  ctx->files_to_check_total_size = 0;
+  for(size_t index = 0; index < ctx->object_count &&
+      ctx->files_to_check_total_size < ctx->budget->max_bytes;
+      index++)
+  {
+    ctx->files_to_check_total_size = sUint64Add(
+      ctx->files_to_check_total_size, ctx->queue[index]->info->size);
+  }
+}
+
+/** Checks the least recently checked files in the given repository until
+  the given budget is used up. The time of each check gets stored inside
+  the repository, which allows subsequent runs to continue where this one
+  stopped. Repeated runs will cycle through the entire repository, with
+  the files checked longest ago coming first. Corrupted files will only be
+  reported by the run which checked them.
+
+  @param r Region used for allocating the returned result.
+  @param metadata Repository to scrub.
+  @param repo_path Path to the repository, which must be locked for
+  writing.
+  @param budget Limits how much work will be done.
+  @param options Controls how files are checked. Can be NULL to use the
+  defaults. Quick checks are not supported and will be ignored.
+  @param progress_callback Can be NULL. Calls may happen from different
+  threads, but never concurrently.
+  @param callback_user_data Will be passed to `progress_callback`.
+
+  @return Statistics about this run. Its broken nodes will only contain
+  nodes associated with files which were found to be corrupted during
+  this run.
+*/
+ScrubResult scrubRepository(CR_Region *r, const Metadata *metadata,
+                            StringView repo_path,
+                            const ScrubBudget *budget,
+                            const IntegrityOptions *options,
+                            IntegrityProgressCallback progress_callback,
+                            void *callback_user_data)
+{
+  if(options == NULL)
+  {
+    options = &default_options;
+  }
+
+  const time_t start_time = sTime();
+  IntegrityCheckContext ctx = {
+    .repo_path = repo_path,
+    .budget = budget,
+    .deadline = start_time + budget->max_seconds,
+    .bytes_started = 0,
+    .read_ahead = options->read_ahead,
+    .progress_callback = progress_callback,
+    .callback_user_data = callback_user_data,
+  };
+
+  CR_Region *disposable_r = CR_RegionNew();
+  CR_RegionSetTag(disposable_r, "integrity check");
+  Allocator *disposable_a = allocatorWrapRegion(disposable_r);
+  StringView state_path =
+    strAppendPath(repo_path, str("scrub-state"), disposable_a);
+  StringView tmp_file_path =
+    strAppendPath(repo_path, str("tmp-file"), disposable_a);
+
+  planObjects(disposable_r, &ctx, metadata);
+  loadScrubState(&ctx, state_path);
+  queueByCheckAge(disposable_r, &ctx);
+
+  const size_t thread_count = options->thread_count > 0
+    ? options->thread_count
+    : workerPoolDefaultSize();
+  workerPoolRun(thread_count, ctx.object_count, checkObject, &ctx);
+
+  ScrubResult result = {
+    .broken_nodes = NULL,
+    .total_count = ctx.object_count,
+    .oldest_check = start_time,
+  };
+  for(size_t index = 0; index < ctx.object_count; index++)
+  {
+    IntegrityObject *object = &ctx.objects[index];
+    result.total_size = sUint64Add(result.total_size, object->info->size);
+
+    if(object->was_checked)
+    {
+      result.checked_count++;
+      result.checked_size =
+        sUint64Add(result.checked_size, object->info->size);
+      object->last_checked = start_time;
+    }
+
+    if(object->last_checked != 0)
+    {
+      result.covered_count++;
+    }
+    if(object->last_checked < result.oldest_check)
+    {
+      result.oldest_check = object->last_checked;
+    }
+  }
+
+  writeScrubState(&ctx, tmp_file_path, state_path);
+  collectBrokenNodes(r, &ctx, &result.broken_nodes, metadata->paths);
   CR_RegionRelease(disposable_r);
 
-  return ctx.broken_nodes;
+  return result;
 }
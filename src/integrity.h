@@ -11,14 +11,72 @@ struct ListOfBrokenPathNodes
   ListOfBrokenPathNodes *next;
 };
 
+/** The amount of upcoming files prefetched by default. */
+#define INTEGRITY_DEFAULT_READ_AHEAD ((size_t)4)
+
+typedef struct
+{
+  /** The amount of threads used for hashing files. If 0, one thread per
+    online CPU will be used. */
+  size_t thread_count;
+
+  /** The amount of upcoming files for which the kernel gets asked to
+    prefetch data. 0 disables prefetching. */
+  size_t read_ahead;
+
+  /** If true, files will only be checked for existence, type and size
+    without hashing their content. */
+  bool quick;
+} IntegrityOptions;
+
 /** Will be called for each processed block read from the repository. Only
   files larger than FILE_HASH_SIZE will be processed. */
 typedef void IntegrityProgressCallback(uint64_t processed_block_size,
                                        uint64_t total_bytes_to_process,
                                        void *user_data);
 
+/** Limits the amount of work done by scrubRepository(). Checking stops
+  once one of the limits is reached. */
+typedef struct
+{
+  /** The maximal duration of the scrub in seconds. 0 means unlimited. */
+  time_t max_seconds;
+
+  /** The maximal amount of bytes to check. The last file may exceed this
+    limit. 0 means unlimited. */
+  uint64_t max_bytes;
+} ScrubBudget;
+
+typedef struct
+{
+  /** Nodes associated with files which were found to be corrupted. */
+  ListOfBrokenPathNodes *broken_nodes;
+
+  /** The amount and volume of files checked during this scrub. */
+  size_t checked_count;
+  uint64_t checked_size;
+
+  /** The amount and volume of all unique files inside the repository
+    with a size larger than FILE_HASH_SIZE. */
+  size_t total_count;
+  uint64_t total_size;
+
+  /** The amount of files which were checked at least once, including
+    this scrub. */
+  size_t covered_count;
+
+  /** The time of the least recent check of any file. Will be 0 if at
+    least one file was never checked. */
+  time_t oldest_check;
+} ScrubResult;
+
 extern ListOfBrokenPathNodes *checkIntegrity(
   CR_Region *r, const Metadata *metadata, StringView repo_path,
+  const IntegrityOptions *options,
+  IntegrityProgressCallback progress_callback, void *callback_user_data);
+extern ScrubResult scrubRepository(
+  CR_Region *r, const Metadata *metadata, StringView repo_path,
+  const ScrubBudget *budget, const IntegrityOptions *options,
   IntegrityProgressCallback progress_callback, void *callback_user_data);
 
 #endif
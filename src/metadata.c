@@ -11,6 +11,7 @@
 #include "file-hash.h"
 #include "safe-math.h"
 #include "safe-wrappers.h"
+#include "trace.h"
 
 #if CHAR_BIT != 8
 #error CHAR_BIT must be 8
@@ -84,9 +85,17 @@ static uint8_t read8(const FileContent content, size_t *reader_position,
   return byte;
 }
 
+/** Like repoWriterWrite(), but also records the written amount. */
+static void writeBytes(const void *data, const size_t size,
+                       RepoWriter *writer)
+{
+  traceCount(TR_metadata_bytes_written, size);
+  repoWriterWrite(data, size, writer);
+}
+
 static void write8(const uint8_t value, RepoWriter *writer)
 {
-  repoWriterWrite(&value, sizeof(value), writer);
+  writeBytes(&value, sizeof(value), writer);
 }
 
 static uint32_t read32(const FileContent content, size_t *reader_position,
@@ -105,7 +114,7 @@ static uint32_t read32(const FileContent content, size_t *reader_position,
 static void write32(const uint32_t value, RepoWriter *writer)
 {
   const uint32_t converted_value = convertEndian32(value);
-  repoWriterWrite(&converted_value, sizeof(converted_value), writer);
+  writeBytes(&converted_value, sizeof(converted_value), writer);
 }
 
 static uint64_t read64(const FileContent content, size_t *reader_position,
@@ -124,7 +133,7 @@ static uint64_t read64(const FileContent content, size_t *reader_position,
 static void write64(const uint64_t value, RepoWriter *writer)
 {
   const uint64_t converted_value = convertEndian64(value);
-  repoWriterWrite(&converted_value, sizeof(converted_value), writer);
+  writeBytes(&converted_value, sizeof(converted_value), writer);
 }
 
 static size_t readSize(const FileContent content, size_t *reader_position,
@@ -180,23 +189,80 @@ static void readBytes(const FileContent content, size_t *reader_position,
   *reader_position += size;
 }
 
+/** Returns an upper bound for the amount of items which can be read from
+  the remaining content. Used for preventing corrupted item counts from
+  causing huge allocations.
+
+  @param content The content from which the items will be read.
+  @param reader_position The position of the first item.
+  @param min_item_size The minimal amount of bytes each item occupies.
+
+  @return A value which will never be reached, unless reading the
+  remaining content fails.
+*/
+static size_t maxItemsLeft(const FileContent content,
+                           const size_t reader_position,
+                           const size_t min_item_size)
+{
+  return (content.size - reader_position) / min_item_size + 1;
+}
+
+/** Allocates the given amount of items as one contiguous array.
+
+  @param r The region which should own the array.
+  @param content The content from which the items will be read.
+  @param reader_position The position of the first item.
+  @param count The amount of items. Will be clamped to maxItemsLeft().
+  @param min_item_size The minimal amount of bytes an item occupies in the
+  metadata file.
+  @param item_size The size of the items in memory.
+*/
+static void *allocItemArray(CR_Region *r, const FileContent content,
+                            const size_t reader_position,
+                            const size_t count,
+                            const size_t min_item_size,
+                            const size_t item_size)
+{
+  const size_t max_items =
+    maxItemsLeft(content, reader_position, min_item_size);
+
+  return CR_RegionAlloc(
+    r, sSizeMul(count < max_items ? count : max_items, item_size));
+}
+
+/** Copies the given string into the unaligned memory of the given region.
+  This keeps strings out of the chunks containing node and history
+  arrays.
+
+  @return A null-terminated copy of the given string.
+*/
+static StringView copyUnaligned(CR_Region *r, StringView string)
+{
+  char *buffer = CR_RegionAllocUnaligned(r, sSizeAdd(string.length, 1));
+  memcpy(buffer, string.content, string.length);
+  buffer[string.length] = '\0';
+
+  return (StringView){
+    .content = buffer,
+    .length = string.length,
+    .is_terminated = true,
+  };
+}
+
 /** Reads a PathHistory struct from the content of the given file.
 
+  @param point The PathHistory struct to populate.
   @param content The content containing the PathHistory.
   @param reader_position The position of the path history. It will be moved
   to the next unread byte.
   @param metadata_path The path to the file to which the given content
   belongs to.
-  @param metadata The metadata to which the returned PathHistory belongs.
+  @param metadata The metadata to which the given PathHistory belongs.
 */
-static PathHistory *readPathHistory(Allocator *region_wrapper,
-                                    const FileContent content,
-                                    size_t *reader_position,
-                                    StringView metadata_path,
-                                    Metadata *metadata)
+static void readPathHistory(PathHistory *point, const FileContent content,
+                            size_t *reader_position,
+                            StringView metadata_path, Metadata *metadata)
 {
-  PathHistory *point = allocate(region_wrapper, sizeof *point);
-
   const size_t id = readSize(content, reader_position, metadata_path);
   if(id >= metadata->backup_history_length)
   {
@@ -246,14 +312,15 @@ static PathHistory *readPathHistory(Allocator *region_wrapper,
     const size_t target_length =
       readSize(content, reader_position, metadata_path);
 
-    char *buffer = allocate(region_wrapper, sSizeAdd(target_length, 1));
+    assertBytesLeft(*reader_position, target_length, content,
+                    metadata_path);
 
-    readBytes(content, reader_position, (uint8_t *)buffer, target_length,
-              metadata_path);
+    StringView target = strUnterminated(
+      &content.content[*reader_position], target_length);
+    *reader_position += target_length;
 
-    buffer[target_length] = '\0';
-
-    strSet(&point->state.metadata.symlink_target, str(buffer));
+    strSet(&point->state.metadata.symlink_target,
+           copyUnaligned(metadata->r, target));
   }
   else if(point->state.type == PST_directory)
   {
@@ -269,43 +336,60 @@ static PathHistory *readPathHistory(Allocator *region_wrapper,
   }
 
   point->next = NULL;
-  return point;
 }
 
-/** Reads a full path history from the given files content.
+/** Reads a full path history from the given files content. All points
+  will be stored in a single array to allow linear traversals.
 
   @param content The content containing the path history.
   @param reader_position The position from which should be read. It will be
   moved to the next unread byte.
   @param metadata_path The path to the metadata file.
   @param metadata The metadata to which the returned PathHistory belongs.
+  @param sorted_length Will be set to the length of the returned array if
+  its points are sorted by backup id in ascending order. Otherwise it will
+  be set to 0.
 */
-static PathHistory *readFullPathHistory(Allocator *region_wrapper,
-                                        const FileContent content,
+static PathHistory *readFullPathHistory(const FileContent content,
                                         size_t *reader_position,
                                         StringView metadata_path,
-                                        Metadata *metadata)
+                                        Metadata *metadata,
+                                        size_t *sorted_length)
 {
   const size_t history_length =
     readSize(content, reader_position, metadata_path);
+  *sorted_length = 0;
 
   if(history_length == 0)
   {
     return NULL;
   }
 
-  PathHistory *first_point = readPathHistory(
-    region_wrapper, content, reader_position, metadata_path, metadata);
-  PathHistory *current_point = first_point;
+  /* Each point consists of at least a backup id and a state type. */
+  PathHistory *points =
+    allocItemArray(metadata->r, content, *reader_position,
+                   history_length, 9, sizeof *points);
+  bool is_sorted = true;
 
-  for(size_t counter = 1; counter < history_length; counter++)
+  for(size_t index = 0; index < history_length; index++)
   {
-    current_point->next = readPathHistory(
-      region_wrapper, content, reader_position, metadata_path, metadata);
-    current_point = current_point->next;
+    readPathHistory(&points[index], content, reader_position,
+                    metadata_path, metadata);
+
+    if(index > 0)
+    {
+      points[index - 1].next = &points[index];
+      is_sorted &=
+        points[index - 1].backup->id < points[index].backup->id;
+    }
   }
 
-  return first_point;
+  if(is_sorted)
+  {
+    *sorted_length = history_length;
+  }
+
+  return points;
 }
 
 /** Writes the given history list via the specified RepoWriter.
@@ -313,9 +397,12 @@ static PathHistory *readFullPathHistory(Allocator *region_wrapper,
 
   @param starting_point The first element in the list.
   @param writer The writer which should be used for writing.
+  @param referenced_files Will be updated with all repository files
+  referenced by the written history. Can be NULL.
 */
 static void writePathHistoryList(const PathHistory *starting_point,
-                                 RepoWriter *writer)
+                                 RepoWriter *writer,
+                                 FileSet *referenced_files)
 {
   size_t history_length = 0;
   for(const PathHistory *point = starting_point; point != NULL;
@@ -345,21 +432,27 @@ static void writePathHistoryList(const PathHistory *starting_point,
 
       if(point->state.metadata.file_info.size > FILE_HASH_SIZE)
       {
-        repoWriterWrite(point->state.metadata.file_info.hash,
-                        FILE_HASH_SIZE, writer);
+        writeBytes(point->state.metadata.file_info.hash, FILE_HASH_SIZE,
+                   writer);
         write8(point->state.metadata.file_info.slot, writer);
+
+        if(referenced_files != NULL)
+        {
+          fileSetInsert(referenced_files,
+                        &point->state.metadata.file_info);
+        }
       }
       else if(point->state.metadata.file_info.size > 0)
       {
-        repoWriterWrite(point->state.metadata.file_info.hash,
-                        point->state.metadata.file_info.size, writer);
+        writeBytes(point->state.metadata.file_info.hash,
+                   point->state.metadata.file_info.size, writer);
       }
     }
     else if(point->state.type == PST_symlink)
     {
       StringView target_path = point->state.metadata.symlink_target;
       write64(target_path.length, writer);
-      repoWriterWrite(target_path.content, target_path.length, writer);
+      writeBytes(target_path.content, target_path.length, writer);
     }
     else if(point->state.type == PST_directory)
     {
@@ -371,7 +464,8 @@ static void writePathHistoryList(const PathHistory *starting_point,
   }
 }
 
-/** Reads the subnodes of the given parent node recursively.
+/** Reads the subnodes of the given parent node recursively. All subnodes
+  of a node will be stored in a single array to allow linear traversals.
 
   @param content The content of the file from which the subnodes should be
   read.
@@ -381,31 +475,43 @@ static void writePathHistoryList(const PathHistory *starting_point,
   @param metadata_path The path to the metadata file. Only needed to print
   error messages.
   @param parent_node The parent node to which the read subnodes belong to.
-  It will not be modified. If the parent node does not exist, NULL can be
-  passed instead.
+  The read subnodes will keep a reference to it, but it will not be
+  modified. If the parent node does not exist, NULL can be passed instead.
   @param metadata The metadata of the repository to which the nodes belong
-  to. Its path table will be used for mapping full paths to nodes.
+  to. All read nodes will be added to its path table.
 
   @return Will be NULL if the given parent node has no subnodes.
 */
-static PathNode *
-readPathSubnodes(Allocator *region_wrapper, const FileContent content,
-                 size_t *reader_position, StringView metadata_path,
-                 PathNode *parent_node, Metadata *metadata)
+static PathNode *readPathSubnodes(const FileContent content,
+                                  size_t *reader_position,
+                                  StringView metadata_path,
+                                  PathNode *parent_node,
+                                  Metadata *metadata)
 {
   const size_t node_count =
     readSize(content, reader_position, metadata_path);
-  PathNode *node_tree = NULL;
 
-  for(size_t counter = 0; counter < node_count; counter++)
+  if(node_count == 0)
   {
-    PathNode *node = allocate(region_wrapper, sizeof *node);
+    return NULL;
+  }
+
+  /* Each node consists of at least a name length, a one byte long name, a
+     policy, a history length and a subnode count. */
+  PathNode *nodes = allocItemArray(metadata->r, content, *reader_position,
+                                   node_count, 26, sizeof *nodes);
+
+  for(size_t index = 0; index < node_count; index++)
+  {
+    PathNode *node = &nodes[index];
+    node->next = NULL;
 
-    /* Prepend current node to node tree. */
-    node->next = node_tree;
-    node_tree = node;
+    if(index > 0)
+    {
+      nodes[index - 1].next = node;
+    }
 
-    /* Read the name and append it to the parent nodes path. */
+    /* Read the name of the node. */
     const size_t name_length =
       readSize(content, reader_position, metadata_path);
     if(name_length == 0)
@@ -432,28 +538,29 @@ readPathSubnodes(Allocator *region_wrapper, const FileContent content,
           STR_FMT(name), STR_FMT(metadata_path));
     }
 
-    StringView parent_path =
-      parent_node == NULL ? str("") : parent_node->path;
-    strSet(&node->path, strAppendPath(parent_path, name, region_wrapper));
-
-    /* Read other node variables. */
-    strTableMap(metadata->path_table, node->path, node);
+    node->parent = parent_node;
+    strSet(&node->name, copyUnaligned(metadata->r, name));
+    pathTableInsert(metadata->path_table, node);
 
     node->hint = BH_none;
     node->policy = read8(content, reader_position, metadata_path);
-    node->history = readFullPathHistory(
-      region_wrapper, content, reader_position, metadata_path, metadata);
+    node->history =
+      readFullPathHistory(content, reader_position, metadata_path,
+                          metadata, &node->history_array_length);
 
-    node->subnodes =
-      readPathSubnodes(region_wrapper, content, reader_position,
-                       metadata_path, node, metadata);
+    node->subnodes = readPathSubnodes(content, reader_position,
+                                      metadata_path, node, metadata);
   }
 
-  return node_tree;
+  return nodes;
 }
 
-/** Writes the given list of path nodes recursively. */
-static void writePathList(const PathNode *node_list, RepoWriter *writer)
+/** Writes the given list of path nodes recursively.
+
+  @param referenced_files See writePathHistoryList().
+*/
+static void writePathList(const PathNode *node_list, RepoWriter *writer,
+                          FileSet *referenced_files)
 {
   size_t list_length = 0;
   for(const PathNode *node = node_list; node != NULL; node = node->next)
@@ -470,13 +577,12 @@ static void writePathList(const PathNode *node_list, RepoWriter *writer)
   {
     if(backupHintNoPol(node->hint) != BH_not_part_of_repository)
     {
-      StringView name = strSplitPath(node->path).tail;
-      write64(name.length, writer);
-      repoWriterWrite(name.content, name.length, writer);
+      write64(node->name.length, writer);
+      writeBytes(node->name.content, node->name.length, writer);
 
       write8(node->policy, writer);
-      writePathHistoryList(node->history, writer);
-      writePathList(node->subnodes, writer);
+      writePathHistoryList(node->history, writer, referenced_files);
+      writePathList(node->subnodes, writer, referenced_files);
     }
   }
 }
@@ -496,7 +602,10 @@ Metadata *metadataNew(CR_Region *r)
   metadata->config_history = NULL;
 
   metadata->total_path_count = 0;
-  metadata->path_table = strTableNew(metadata->r);
+  metadata->path_table = pathTableNew(metadata->r, 0);
+  metadata->dropped_files = NULL;
+  metadata->files_to_store = NULL;
+  metadata->referenced_files = NULL;
   metadata->paths = NULL;
 
   return metadata;
@@ -506,6 +615,7 @@ Metadata *metadataNew(CR_Region *r)
 Metadata *metadataLoad(CR_Region *r, StringView path)
 {
   CR_Region *disposable_r = CR_RegionNew();
+  CR_RegionSetTag(disposable_r, "metadata file");
   const FileContent content = sGetFilesContent(disposable_r, path);
 
   /* Allocate and initialize metadata. */
@@ -544,28 +654,39 @@ Metadata *metadataLoad(CR_Region *r, StringView path)
     metadata->backup_history[id].ref_count = 0;
   }
 
-  Allocator *region_wrapper = allocatorWrapRegion(metadata->r);
+  size_t config_history_length;
   metadata->config_history = readFullPathHistory(
-    region_wrapper, content, &reader_position, path, metadata);
+    content, &reader_position, path, metadata, &config_history_length);
 
   metadata->total_path_count = readSize(content, &reader_position, path);
-  metadata->path_table = strTableNew(metadata->r);
 
-  metadata->paths = readPathSubnodes(
-    region_wrapper, content, &reader_position, path, NULL, metadata);
+  /* Every path takes up at least one byte in the metadata file. This
+     prevents corrupted path counts from causing huge allocations. */
+  metadata->path_table = pathTableNew(
+    metadata->r, metadata->total_path_count < content.size
+      ? metadata->total_path_count
+      : content.size);
+  metadata->dropped_files = NULL;
+  metadata->files_to_store = NULL;
+  metadata->referenced_files = NULL;
+
+  metadata->paths =
+    readPathSubnodes(content, &reader_position, path, NULL, metadata);
   CR_RegionRelease(disposable_r);
 
   if(reader_position != content.size)
   {
     die("unneeded trailing bytes in \"" PRI_STR "\"", STR_FMT(path));
   }
+  traceCount(TR_metadata_paths_loaded, metadata->total_path_count);
 
   return metadata;
 }
 
 /** Writes the given metadata into the specified repositories metadata
   file. Counterpart to loadMetadata(). This function writes only referenced
-  history points and will modify their backup IDs.
+  history points and will modify their backup IDs. If the metadata has
+  dropped files, its `referenced_files` will be updated.
 
   @param metadata The metadata that should be written.
   @param repo_path The full or relative path to the repository, which
@@ -609,12 +730,76 @@ void metadataWrite(Metadata *metadata, StringView repo_path,
   }
 
   /* Write the config files history. */
-  writePathHistoryList(metadata->config_history, writer);
+  writePathHistoryList(metadata->config_history, writer, NULL);
 
-  /* Write the path tree. */
+  /* Write the path tree and gather the files it references for
+     collectDroppedFiles(). */
+  metadata->referenced_files = metadata->dropped_files == NULL
+    ? NULL
+    : fileSetNew(metadata->r, 0);
   write64(metadata->total_path_count, writer);
-  writePathList(metadata->paths, writer);
+  writePathList(metadata->paths, writer, metadata->referenced_files);
 
   /* Finish writing. */
   repoWriterClose(writer);
 }
+
+/** @return The length of the full, absolute path of the given node. */
+size_t pathNodeGetPathLength(const PathNode *node)
+{
+  size_t length = 0;
+  for(const PathNode *current = node; current != NULL;
+      current = current->parent)
+  {
+    length = sSizeAdd(length, sSizeAdd(current->name.length, 1));
+  }
+
+  return length;
+}
+
+/** Writes the full, absolute path of the given node into the given
+  buffer. Unlike pathNodeGetPath() this function does not allocate.
+
+  @param node The node which path should be written.
+  @param length The value returned by pathNodeGetPathLength().
+  @param buffer The buffer to which the null-terminated path will be
+  written. Must have a capacity of at least `length + 1`.
+*/
+void pathNodeFormatPath(const PathNode *node, const size_t length,
+                        char *buffer)
+{
+  buffer[length] = '\0';
+
+  size_t position = length;
+  for(const PathNode *current = node; current != NULL;
+      current = current->parent)
+  {
+    position -= current->name.length;
+    memcpy(&buffer[position], current->name.content, current->name.length);
+
+    position--;
+    buffer[position] = '/';
+  }
+}
+
+/** Builds the full, absolute path of the given node.
+
+  @param node The node which path should be built.
+  @param a The allocator which will be used for allocating the returned
+  string. Can be a reusable buffer, see
+  allocatorWrapOneSingleGrowableBuffer().
+
+  @return A null-terminated path, e.g. "/etc/conf.d/foo".
+*/
+StringView pathNodeGetPath(const PathNode *node, Allocator *a)
+{
+  const size_t length = pathNodeGetPathLength(node);
+  char *buffer = allocate(a, sSizeAdd(length, 1));
+  pathNodeFormatPath(node, length, buffer);
+
+  return (StringView){
+    .content = buffer,
+    .length = length,
+    .is_terminated = true,
+  };
+}
@@ -5,10 +5,12 @@
 #include <sys/types.h>
 
 #include "CRegion/region.h"
+#include "allocator.h"
 #include "backup-policies.h"
+#include "file-set.h"
+#include "path-table.h"
 #include "repository.h"
 #include "str.h"
-#include "string-table.h"
 
 /** The different states a filepath can represent at a specific backup. */
 typedef enum
@@ -148,8 +150,13 @@ typedef enum
 typedef struct PathNode PathNode;
 struct PathNode
 {
-  /** The full, absolute path inside the filesystem. */
-  StringView path;
+  /** The directory containing this path. Will be NULL if this node is at
+    the top of the tree. */
+  PathNode *parent;
+
+  /** The last element of the nodes path, e.g. "foo.txt". The full path
+    can be built with pathNodeGetPath(). */
+  StringView name;
 
   /** Contains temporary informations about this node. They will not be
     written to disk and are only used during a single backup. */
@@ -162,6 +169,12 @@ struct PathNode
     not NULL. */
   PathHistory *history;
 
+  /** If greater than 0, the history is stored as one array of this length,
+    sorted by backup id in ascending order. This is the case for nodes read
+    by metadataLoad() and allows binary searching the history. Must be reset
+    to 0 when modifying the history. */
+  size_t history_array_length;
+
   /** The subnodes of this node. A path can change its type from a regular
     file to a symlink or directory and vice versa during its lifetime. To
     simplify the implementation, the subnodes are stored independently of
@@ -171,6 +184,22 @@ struct PathNode
   PathNode *next;
 };
 
+/** A list of files stored inside the repository. */
+typedef struct RepoFileList RepoFileList;
+struct RepoFileList
+{
+  RegularFileInfo info;
+  RepoFileList *next;
+};
+
+/** A list of path nodes which need further processing. */
+typedef struct PathNodeList PathNodeList;
+struct PathNodeList
+{
+  PathNode *node;
+  PathNodeList *next;
+};
+
 /** Represents the metadata of a repository. */
 typedef struct
 {
@@ -199,11 +228,29 @@ typedef struct
     for reading/writing metadata and may not be accurate. */
   size_t total_path_count;
 
-  /** A StringTable associating a full, absolute filepath with its
-    PathNode. This table contains only paths that exist in the metadata
-    file. New files discovered during a backup will not be added to this
-    table. */
-  StringTable *path_table;
+  /** A PathTable for looking up nodes by their parent and name. This
+    table contains only paths that exist in the metadata file. New files
+    discovered during a backup will not be added to this table. */
+  PathTable *path_table;
+
+  /** Files in the repository which may have lost their last reference
+    during the current backup, e.g. through dropped history points. Only
+    these files need to be checked by collectDroppedFiles(). Can be NULL.
+    May contain duplicates. */
+  RepoFileList *dropped_files;
+
+  /** Nodes of regular files which were added or changed during the
+    current backup and must be stored in the repository by
+    finishBackup(). Gathered by initiateBackup() in the order in which the
+    files were found, so finishBackup() doesn't have to traverse the
+    entire tree again. Can be NULL. */
+  PathNodeList *files_to_store;
+
+  /** All files in the repository referenced by the path tree, gathered
+    while the tree gets written by metadataWrite(). Allows
+    collectDroppedFiles() to skip traversing the tree again. Will only be
+    gathered if `dropped_files` is not NULL. Can be NULL. */
+  FileSet *referenced_files;
 
   /** A list of backed up files in the filesystem. Can be NULL if this
     metadata doesn't contain any filepaths. */
@@ -215,5 +262,9 @@ extern Metadata *metadataLoad(CR_Region *r, StringView path);
 extern void metadataWrite(Metadata *metadata, StringView repo_path,
                           StringView repo_tmp_file_path,
                           StringView repo_metadata_path);
+extern size_t pathNodeGetPathLength(const PathNode *node);
+extern void pathNodeFormatPath(const PathNode *node, size_t length,
+                               char *buffer);
+extern StringView pathNodeGetPath(const PathNode *node, Allocator *a);
 
 #endif
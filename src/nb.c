@@ -1,3 +1,5 @@
+#include <inttypes.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,22 +11,34 @@
 #include "informations.h"
 #include "integrity.h"
 #include "metadata.h"
+#include "output.h"
 #include "restore.h"
 #include "safe-math.h"
 #include "safe-wrappers.h"
 #include "search-tree.h"
 #include "str.h"
+#include "trace.h"
 
 static void ensureUserConsent(const char *question,
                               Allocator *reusable_buffer)
 {
   while(true)
   {
-    printf("%s (y/n) ", question);
-    if(!sIsTTY(stdin))
+    if(outputGetFormat() == OF_ndjson)
     {
-      printf("\n");
+      outputJsonBegin("prompt");
+      outputJsonString("question", str(question));
+      outputJsonEnd();
+    }
+    else
+    {
+      printf("%s (y/n) ", question);
+      if(!sIsTTY(stdin))
+      {
+        printf("\n");
+      }
     }
+    outputFlush();
 
     StringView line = str("");
     if(!sReadLine(stdin, reusable_buffer, &line) ||
@@ -67,6 +81,13 @@ static void printStats(const char *summary, const TextColor color,
   printf(")");
 }
 
+/** Returns true if progress lines should be printed. In this case every
+  progress line will overwrite the previous one. */
+static bool showsProgress(void)
+{
+  return outputGetFormat() == OF_text && sIsTTY(stdout);
+}
+
 static void startOverprintingPreviousLine(void)
 {
   if(sIsTTY(stdout))
@@ -121,6 +142,8 @@ static void printProgress(const bool assume_is_finished,
   {
     printf("\n");
   }
+
+  outputFlush();
 }
 
 static void printGCProgress(const bool assume_is_finished,
@@ -153,25 +176,46 @@ static void gcProgressCallback(const uint64_t deleted_items_size,
   ctx->items_visited++;
 }
 
+/** Removes unreferenced files from the given repository.
+
+  @param after_backup True if only the files dropped by the backup which
+  was just completed should be checked. Otherwise the entire repository
+  will be checked.
+*/
 static void runGC(const Metadata *metadata, StringView repo_path,
-                  const bool prepend_newline)
+                  const bool after_backup)
 {
-  if(prepend_newline)
+  if(after_backup && outputGetFormat() == OF_text)
   {
     printf("\n");
   }
 
   GCProgressCallback *gc_progress_callback = NULL;
-  if(sIsTTY(stdout))
+  if(showsProgress())
   {
     gc_progress_callback = gcProgressCallback;
     printf("\n");
     printGCProgress(false, 0, 100, 0);
   }
 
-  const GCStatistics gc_stats = collectGarbageProgress(
-    metadata, repo_path, gc_progress_callback, &(GCProgressContext){ 0 });
-  printGCProgress(true, 0, 100, gc_stats.deleted_items_total_size);
+  tracePhaseBegin(TP_collect_garbage);
+  const GCStatistics gc_stats = after_backup
+    ? collectDroppedFiles(metadata, repo_path)
+    : collectGarbageProgress(metadata, repo_path, gc_progress_callback,
+                             &(GCProgressContext){ 0 });
+  tracePhaseEnd(TP_collect_garbage);
+
+  if(outputGetFormat() == OF_ndjson)
+  {
+    outputJsonBegin("gc");
+    outputJsonUint64("deleted_items", gc_stats.deleted_items_count);
+    outputJsonUint64("deleted_size", gc_stats.deleted_items_total_size);
+    outputJsonEnd();
+  }
+  else
+  {
+    printGCProgress(true, 0, 100, gc_stats.deleted_items_total_size);
+  }
 }
 
 static void printIntegrityProgress(const bool assume_is_finished,
@@ -198,7 +242,7 @@ integrityProgressCallback(const uint64_t processed_block_size,
 
   ctx->bytes_processed =
     sUint64Add(ctx->bytes_processed, processed_block_size);
-  if(sIsTTY(stdout) &&
+  if(showsProgress() &&
      shouldUpdateProgressLine(&ctx->last_print_timestamp))
   {
     printIntegrityProgress(false, ctx->bytes_processed,
@@ -206,51 +250,285 @@ integrityProgressCallback(const uint64_t processed_block_size,
   }
 }
 
+/** Prints the status of a repository and terminates the program if
+  corrupted nodes were found.
+
+  @param r Region used for building the paths of the broken nodes. Will
+  be released by this function.
+  @param broken_nodes List of nodes associated with corrupted files. NULL
+  if the repository is healthy.
+*/
+static void reportBrokenNodes(CR_Region *r,
+                              const ListOfBrokenPathNodes *broken_nodes)
+{
+  const bool print_text = outputGetFormat() == OF_text;
+  if(!print_text)
+  {
+    outputJsonBegin("status");
+    outputJsonBool("healthy", broken_nodes == NULL);
+    outputJsonEnd();
+  }
+  else
+  {
+    printf("Status of repository: ");
+    if(broken_nodes == NULL)
+    {
+      colorPrintf(stdout, TC_green_bold, "Healthy\n");
+    }
+    else
+    {
+      colorPrintf(stdout, TC_red_bold, "Incomplete\n\n");
+    }
+  }
+
+  size_t broken_node_count = 0;
+  for(const ListOfBrokenPathNodes *path_node = broken_nodes;
+      path_node != NULL; path_node = path_node->next)
+  {
+    StringView path =
+      pathNodeGetPath(path_node->node, allocatorWrapRegion(r));
+    if(print_text)
+    {
+      colorPrintf(stdout, TC_red_bold, "?? ");
+      colorPrintf(stdout, TC_red, "" PRI_STR " ", STR_FMT(path));
+      printf("(corrupted)\n");
+    }
+    else
+    {
+      outputJsonBegin("corrupted");
+      outputJsonString("path", path);
+      outputJsonEnd();
+    }
+    broken_node_count++;
+  }
+  CR_RegionRelease(r);
+
+  if(broken_node_count != 0)
+  {
+    if(print_text)
+    {
+      printf("\n");
+    }
+    die("found %li item%s with corrupted backup history",
+        broken_node_count, broken_node_count == 1 ? "" : "s");
+  }
+}
+
+/** Checks the integrity of the given repository.
+
+  @param quick True if files should only be checked for existence, type
+  and size without hashing their content.
+*/
 static void runIntegrityCheck(const Metadata *metadata,
-                              StringView repo_path)
+                              StringView repo_path, const bool quick)
 {
   CR_Region *r = CR_RegionNew();
-  if(sIsTTY(stdout))
+  if(showsProgress())
   {
     printf("\n");
     printIntegrityProgress(false, 0, 100);
   }
 
+  const IntegrityOptions options = {
+    .thread_count = 0,
+    .read_ahead = INTEGRITY_DEFAULT_READ_AHEAD,
+    .quick = quick,
+  };
   IntegrityProgressContext ctx = { 0 };
+  tracePhaseBegin(TP_check_integrity);
   const ListOfBrokenPathNodes *broken_nodes = checkIntegrity(
-    r, metadata, repo_path, integrityProgressCallback, &ctx);
-  printIntegrityProgress(true, ctx.bytes_processed, ctx.bytes_processed);
+    r, metadata, repo_path, &options, integrityProgressCallback, &ctx);
+  tracePhaseEnd(TP_check_integrity);
 
-  printf("Status of repository: ");
-  if(broken_nodes == NULL)
+  if(outputGetFormat() == OF_ndjson)
   {
-    colorPrintf(stdout, TC_green_bold, "Healthy\n");
+    outputJsonBegin("integrity");
+    outputJsonUint64("processed_size", ctx.bytes_processed);
+    outputJsonEnd();
   }
   else
   {
-    colorPrintf(stdout, TC_red_bold, "Incomplete\n\n");
+    printIntegrityProgress(true, ctx.bytes_processed,
+                           ctx.bytes_processed);
   }
 
-  size_t broken_node_count = 0;
-  for(const ListOfBrokenPathNodes *path_node = broken_nodes;
-      path_node != NULL; path_node = path_node->next)
+  reportBrokenNodes(r, broken_nodes);
+}
+
+/** Parses a single scrub limit like "30m" or "500G" and stores it in the
+  given budget. Durations accept the suffixes s, m, h and d. Volumes
+  accept the binary suffixes K, M, G and T. Terminates the program if the
+  budget already contains a limit of the same kind. */
+static void parseScrubBudget(CR_Region *r, ScrubBudget *budget,
+                             const char *arg)
+{
+  if(!sRegexIsMatching(sRegexCompile(r, str("^[0-9]+[smhdKMGT]$"),
+                                     str(__FILE__), __LINE__),
+                       str(arg)))
   {
-    colorPrintf(stdout, TC_red_bold, "?? ");
-    colorPrintf(stdout, TC_red, "" PRI_STR " ",
-                STR_FMT(path_node->node->path));
-    printf("(corrupted)\n");
-    broken_node_count++;
+    die("invalid scrub limit: \"%s\"", arg);
   }
-  CR_RegionRelease(r);
 
-  if(broken_node_count != 0)
+  const size_t length = strlen(arg);
+  const uint64_t value = sStringToSize(strUnterminated(arg, length - 1));
+  if(value == 0)
+  {
+    die("scrub limit must be greater than zero: \"%s\"", arg);
+  }
+
+  const char unit = arg[length - 1];
+  if(unit == 's' || unit == 'm' || unit == 'h' || unit == 'd')
+  {
+    const uint64_t seconds = sUint64Mul(value,
+                                        unit == 's' ? 1
+                                          : unit == 'm' ? 60
+                                          : unit == 'h' ? 60 * 60
+                                                        : 24 * 60 * 60);
+    if(seconds > INT32_MAX)
+    {
+      die("scrub duration too long: \"%s\"", arg);
+    }
+    else if(budget->max_seconds != 0)
+    {
+      die("scrub duration specified twice: \"%s\"", arg);
+    }
+    budget->max_seconds = (time_t)seconds;
+  }
+  else
+  {
+    const uint64_t shift = unit == 'K' ? 10
+      : unit == 'M'                    ? 20
+      : unit == 'G'                    ? 30
+                                       : 40;
+    if(budget->max_bytes != 0)
+    {
+      die("scrub volume specified twice: \"%s\"", arg);
+    }
+    budget->max_bytes = sUint64Mul(value, (uint64_t)1 << shift);
+  }
+}
+
+static void printScrubProgress(const bool assume_is_finished,
+                               const uint64_t bytes_processed,
+                               const uint64_t total_bytes_to_process)
+{
+  printProgress(assume_is_finished, bytes_processed,
+                total_bytes_to_process, bytes_processed, "Scrubbing",
+                "processed");
+}
+
+static void scrubProgressCallback(const uint64_t processed_block_size,
+                                  const uint64_t total_bytes_to_process,
+                                  void *user_data)
+{
+  IntegrityProgressContext *ctx = user_data;
+
+  ctx->bytes_processed =
+    sUint64Add(ctx->bytes_processed, processed_block_size);
+  if(showsProgress() &&
+     shouldUpdateProgressLine(&ctx->last_print_timestamp))
+  {
+    printScrubProgress(false, ctx->bytes_processed,
+                       total_bytes_to_process);
+  }
+}
+
+/** Prints how long ago the given point in time was. */
+static void printAge(const time_t timestamp)
+{
+  const time_t now = sTime();
+  const uint64_t age = now > timestamp ? (uint64_t)(now - timestamp) : 0;
+  const uint64_t days = age / (24 * 60 * 60);
+  const uint64_t hours = age / (60 * 60);
+
+  if(days > 0)
+  {
+    printf("%" PRIu64 " day%s ago", days, days == 1 ? "" : "s");
+  }
+  else if(hours > 0)
   {
+    printf("%" PRIu64 " hour%s ago", hours, hours == 1 ? "" : "s");
+  }
+  else
+  {
+    printf("less than an hour ago");
+  }
+}
+
+static void printScrubResult(const ScrubResult *result)
+{
+  printf("Checked files: ");
+  colorPrintf(stdout, TC_bold, "%zu", result->checked_count);
+  printf(" (");
+  printHumanReadableSize(result->checked_size);
+  printf(")\nChecked at least once: %zu of %zu files\n",
+         result->covered_count, result->total_count);
+  printf("Oldest check: ");
+  if(result->oldest_check == 0)
+  {
+    printf("never\n");
+  }
+  else
+  {
+    printAge(result->oldest_check);
     printf("\n");
-    die("found %li item%s with corrupted backup history",
-        broken_node_count, broken_node_count == 1 ? "" : "s");
   }
 }
 
+static void printScrubResultAsJson(const ScrubResult *result)
+{
+  outputJsonBegin("scrub");
+  outputJsonUint64("checked_items", result->checked_count);
+  outputJsonUint64("checked_size", result->checked_size);
+  outputJsonUint64("covered_items", result->covered_count);
+  outputJsonUint64("total_items", result->total_count);
+  if(result->oldest_check != 0)
+  {
+    outputJsonUint64("oldest_check", (uint64_t)result->oldest_check);
+  }
+  outputJsonEnd();
+}
+
+/** Checks the least recently checked files in the given repository. */
+static void runScrub(const Metadata *metadata, StringView repo_path,
+                     const ScrubBudget *budget)
+{
+  CR_Region *result_r = CR_RegionNew();
+  if(showsProgress())
+  {
+    printf("\n");
+    printScrubProgress(false, 0, 100);
+  }
+
+  IntegrityProgressContext ctx = { 0 };
+  tracePhaseBegin(TP_scrub);
+  const ScrubResult result =
+    scrubRepository(result_r, metadata, repo_path, budget, NULL,
+                    scrubProgressCallback, &ctx);
+  tracePhaseEnd(TP_scrub);
+
+  if(outputGetFormat() == OF_ndjson)
+  {
+    printScrubResultAsJson(&result);
+  }
+  else
+  {
+    printScrubProgress(true, ctx.bytes_processed, ctx.bytes_processed);
+    printScrubResult(&result);
+  }
+
+  reportBrokenNodes(result_r, result.broken_nodes);
+}
+
+/** Creates a region which holds a large data structure, so its memory
+  usage gets reported separately by NB_TRACE. */
+static CR_Region *newTaggedRegion(const char *tag)
+{
+  CR_Region *r = CR_RegionNew();
+  CR_RegionSetTag(r, tag);
+  return r;
+}
+
 static void backup(CR_Region *r, StringView repo_arg)
 {
   Allocator *a = allocatorWrapRegion(r);
@@ -266,18 +544,31 @@ static void backup(CR_Region *r, StringView repo_arg)
         STR_FMT(repo_arg));
   }
   repoLock(r, repo_path, RLH_readwrite);
-  SearchNode *root_node = searchTreeLoad(r, config_path);
+  SearchNode *root_node =
+    searchTreeLoad(newTaggedRegion("search tree"), config_path);
 
+  CR_Region *metadata_r = newTaggedRegion("metadata");
+  tracePhaseBegin(TP_load_metadata);
   Metadata *metadata = sPathExists(metadata_path)
-    ? metadataLoad(r, metadata_path)
-    : metadataNew(r);
+    ? metadataLoad(metadata_r, metadata_path)
+    : metadataNew(metadata_r);
+  tracePhaseEnd(TP_load_metadata);
 
+  tracePhaseBegin(TP_initiate_backup);
   initiateBackup(metadata, root_node);
+  tracePhaseEnd(TP_initiate_backup);
+
+  tracePhaseBegin(TP_print_changes);
   ChangeSummary changes =
     printMetadataChanges(metadata, *root_node->summarize_expressions);
+  tracePhaseEnd(TP_print_changes);
   printSearchTreeInfos(root_node);
 
-  if(containsChanges(&changes))
+  if(outputGetFormat() == OF_ndjson)
+  {
+    printChangeSummaryAsJson(&changes);
+  }
+  else if(containsChanges(&changes))
   {
     printf("\n");
 
@@ -299,10 +590,18 @@ static void backup(CR_Region *r, StringView repo_arg)
     {
       printf("\n\n");
     }
+  }
 
+  if(containsChanges(&changes))
+  {
     ensureUserConsent("proceed?", allocatorWrapOneSingleGrowableBuffer(r));
+    tracePhaseBegin(TP_finish_backup);
     finishBackup(metadata, repo_arg, tmp_file_path);
+    tracePhaseEnd(TP_finish_backup);
+
+    tracePhaseBegin(TP_write_metadata);
     metadataWrite(metadata, repo_arg, tmp_file_path, metadata_path);
+    tracePhaseEnd(TP_write_metadata);
 
     runGC(metadata, repo_arg, true);
   }
@@ -321,7 +620,12 @@ static Metadata *metadataLoadFromRepo(CR_Region *r, StringView repo_arg,
   }
 
   repoLock(r, repo_path, lock_hint);
-  return metadataLoad(r, metadata_path);
+  tracePhaseBegin(TP_load_metadata);
+  Metadata *metadata =
+    metadataLoad(newTaggedRegion("metadata"), metadata_path);
+  tracePhaseEnd(TP_load_metadata);
+
+  return metadata;
 }
 
 static StringView buildFullPath(Allocator *a, StringView path)
@@ -347,22 +651,52 @@ static void restore(CR_Region *r, StringView repo_arg, const size_t id,
   Metadata *metadata = metadataLoadFromRepo(r, repo_arg, RLH_readonly);
   StringView full_path =
     strStripTrailingSlashes(buildFullPath(allocatorWrapRegion(r), path));
+  tracePhaseBegin(TP_initiate_restore);
   initiateRestore(metadata, id, full_path);
+  tracePhaseEnd(TP_initiate_restore);
 
+  tracePhaseBegin(TP_print_changes);
   const ChangeSummary changes = printMetadataChanges(metadata, NULL);
-  if(containsChanges(&changes) && printf("\n") == 1)
+  tracePhaseEnd(TP_print_changes);
+
+  if(outputGetFormat() == OF_ndjson)
+  {
+    printChangeSummaryAsJson(&changes);
+  }
+  else if(containsChanges(&changes))
+  {
+    printf("\n");
+  }
+
+  if(containsChanges(&changes))
   {
     ensureUserConsent("restore?", allocatorWrapOneSingleGrowableBuffer(r));
+    tracePhaseBegin(TP_finish_restore);
     finishRestore(metadata, id, repo_arg);
+    tracePhaseEnd(TP_finish_restore);
   }
 }
 
-int main(const int arg_count, const char **arg_list)
+/** Parses the value of the --report option. */
+static OutputFormat parseReportFormat(const char *arg)
 {
-  CR_Region *r = CR_RegionNew();
-  setbuf(stdout, NULL);
-  setbuf(stderr, NULL);
+  if(strcmp(arg, "text") == 0)
+  {
+    return OF_text;
+  }
+  else if(strcmp(arg, "ndjson") == 0)
+  {
+    return OF_ndjson;
+  }
+
+  die("unsupported report format: \"%s\"", arg);
+}
 
+/** Runs the command specified by the given arguments, which have the same
+  layout as the arguments of main(). */
+static void runCommand(CR_Region *r, const int arg_count,
+                       const char **arg_list)
+{
   if(arg_count < 2)
   {
     die("no repository specified");
@@ -394,13 +728,39 @@ int main(const int arg_count, const char **arg_list)
   }
   else if(strcmp(arg_list[2], "integrity") == 0)
   {
-    if(arg_count > 3)
+    const bool quick =
+      arg_count > 3 && strcmp(arg_list[3], "--quick") == 0;
+    if(arg_count > 3 && !quick)
+    {
+      die("invalid argument for integrity command: \"%s\"", arg_list[3]);
+    }
+    else if(arg_count > 4)
     {
       die("too many arguments for integrity command");
     }
 
     runIntegrityCheck(metadataLoadFromRepo(r, path_to_repo, RLH_readonly),
-                      path_to_repo);
+                      path_to_repo, quick);
+  }
+  else if(strcmp(arg_list[2], "scrub") == 0)
+  {
+    if(arg_count < 4)
+    {
+      die("no limit specified for scrub command");
+    }
+    else if(arg_count > 5)
+    {
+      die("too many arguments for scrub command");
+    }
+
+    ScrubBudget budget = { .max_seconds = 0, .max_bytes = 0 };
+    for(int index = 3; index < arg_count; index++)
+    {
+      parseScrubBudget(r, &budget, arg_list[index]);
+    }
+
+    runScrub(metadataLoadFromRepo(r, path_to_repo, RLH_readwrite),
+             path_to_repo, &budget);
   }
   else if(sRegexIsMatching(
             sRegexCompile(r, str("^[0-9]+$"), str(__FILE__), __LINE__),
@@ -419,3 +779,27 @@ int main(const int arg_count, const char **arg_list)
     die("invalid arguments");
   }
 }
+
+int main(const int arg_count, const char **arg_list)
+{
+  const char *trace_report_path = getenv("NB_TRACE");
+  if(trace_report_path != NULL && trace_report_path[0] != '\0')
+  {
+    traceEnableWithReport(trace_report_path);
+  }
+
+  CR_Region *r = CR_RegionNew();
+  CR_RegionSetTag(r, "main");
+
+  const size_t option_length = strlen("--report=");
+  const bool has_report_option = arg_count > 1 &&
+    strncmp(arg_list[1], "--report=", option_length) == 0;
+  outputInit(has_report_option
+               ? parseReportFormat(&arg_list[1][option_length])
+               : OF_text);
+
+  /* Skip the report option, so all commands find their arguments at the
+     same index. */
+  runCommand(r, arg_count - has_report_option,
+             &arg_list[has_report_option]);
+}
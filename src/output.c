@@ -0,0 +1,231 @@
+#include "output.h"
+
+#include <inttypes.h>
+
+#include "error-handling.h"
+
+/** The size of the buffer in front of stdout. Large change lists get
+  written in chunks of this size, instead of one write per printed
+  fragment. */
+#define OUTPUT_BUFFER_SIZE ((size_t)64 << 10)
+
+static OutputFormat output_format = OF_text;
+
+/** Returns the length of the UTF-8 sequence starting at the given index.
+  Overlong encodings, surrogates and code points above U+10FFFF are not
+  valid.
+
+  @param string The string containing the sequence.
+  @param index The index of the first byte of the sequence. Must be
+  smaller than the length of the string.
+
+  @return The length of the sequence in bytes or 0 if it is not valid.
+*/
+static size_t utf8SequenceLength(StringView string, const size_t index)
+{
+  const unsigned char *bytes =
+    (const unsigned char *)&string.content[index];
+  unsigned char min_second_byte = 0x80;
+  unsigned char max_second_byte = 0xbf;
+  size_t length;
+
+  if(bytes[0] < 0x80)
+  {
+    return 1;
+  }
+  else if(bytes[0] >= 0xc2 && bytes[0] <= 0xdf)
+  {
+    length = 2;
+  }
+  else if(bytes[0] >= 0xe0 && bytes[0] <= 0xef)
+  {
+    length = 3;
+    min_second_byte = bytes[0] == 0xe0 ? 0xa0 : 0x80;
+    max_second_byte = bytes[0] == 0xed ? 0x9f : 0xbf;
+  }
+  else if(bytes[0] >= 0xf0 && bytes[0] <= 0xf4)
+  {
+    length = 4;
+    min_second_byte = bytes[0] == 0xf0 ? 0x90 : 0x80;
+    max_second_byte = bytes[0] == 0xf4 ? 0x8f : 0xbf;
+  }
+  else
+  {
+    return 0;
+  }
+
+  if(string.length - index < length || bytes[1] < min_second_byte ||
+     bytes[1] > max_second_byte)
+  {
+    return 0;
+  }
+  for(size_t byte = 2; byte < length; byte++)
+  {
+    if(bytes[byte] < 0x80 || bytes[byte] > 0xbf)
+    {
+      return 0;
+    }
+  }
+
+  return length;
+}
+
+static bool isValidUtf8(StringView string)
+{
+  for(size_t index = 0; index < string.length;)
+  {
+    const size_t length = utf8SequenceLength(string, index);
+    if(length == 0)
+    {
+      return false;
+    }
+    index += length;
+  }
+
+  return true;
+}
+
+/** Makes stdout fully buffered and sets the format of all reports. Text
+  which must be visible before nb blocks, like questions or progress
+  lines, must be followed by outputFlush(). stderr stays unbuffered.
+
+  @param format The format in which reports should be printed.
+*/
+void outputInit(const OutputFormat format)
+{
+  static char buffer[OUTPUT_BUFFER_SIZE];
+  if(setvbuf(stdout, buffer, _IOFBF, sizeof(buffer)) != 0 ||
+     setvbuf(stderr, NULL, _IONBF, 0) != 0)
+  {
+    die("failed to set up buffering of stdout");
+  }
+
+  output_format = format;
+}
+
+OutputFormat outputGetFormat(void)
+{
+  return output_format;
+}
+
+/** Writes everything buffered in stdout and terminates the program on
+  failure. */
+void outputFlush(void)
+{
+  if(fflush(stdout) != 0)
+  {
+    dieErrno("failed to write to stdout");
+  }
+}
+
+/** Starts a new JSON object on stdout. All objects printed by nb have a
+  "type" field, which must be followed by other fields or by
+  outputJsonEnd().
+
+  @param type The value of the "type" field. Will not be escaped.
+*/
+void outputJsonBegin(const char *type)
+{
+  printf("{\"type\":\"%s\"", type);
+}
+
+/** Appends a field to the object started by outputJsonBegin(). If the
+  value is not valid UTF-8, it will be followed by a second field with the
+  suffix "_hex", which contains the exact bytes of the value as lowercase
+  hex digits.
+
+  @param key The name of the field. Will not be escaped.
+  @param value The value of the field.
+*/
+void outputJsonString(const char *key, StringView value)
+{
+  printf(",\"%s\":", key);
+  outputWriteJsonString(stdout, value);
+
+  if(!isValidUtf8(value))
+  {
+    printf(",\"%s_hex\":\"", key);
+    for(size_t index = 0; index < value.length; index++)
+    {
+      printf("%02x", (unsigned char)value.content[index]);
+    }
+    putchar('"');
+  }
+}
+
+/** Like outputJsonString(), but for numbers. */
+void outputJsonUint64(const char *key, const uint64_t value)
+{
+  printf(",\"%s\":%" PRIu64, key, value);
+}
+
+/** Like outputJsonString(), but for booleans. */
+void outputJsonBool(const char *key, const bool value)
+{
+  printf(",\"%s\":%s", key, value ? "true" : "false");
+}
+
+/** Terminates the object started by outputJsonBegin() and its line. */
+void outputJsonEnd(void)
+{
+  printf("}\n");
+}
+
+/** Writes the given string as a quoted JSON string. Quotes, backslashes
+  and control characters get escaped. Each byte which is not part of a
+  valid UTF-8 sequence gets replaced by U+FFFD. All other bytes are
+  written unchanged.
+
+  @param stream The stream to which the string should be written.
+  @param string The string to write.
+*/
+void outputWriteJsonString(FILE *stream, StringView string)
+{
+  fputc('"', stream);
+
+  size_t unescaped_begin = 0;
+  for(size_t index = 0; index < string.length; index++)
+  {
+    const unsigned char c = (unsigned char)string.content[index];
+    const size_t sequence_length =
+      c >= 0x80 ? utf8SequenceLength(string, index) : 1;
+    if(sequence_length > 1)
+    {
+      index += sequence_length - 1;
+      continue;
+    }
+    else if(sequence_length == 1 && c >= 0x20 && c != '"' && c != '\\')
+    {
+      continue;
+    }
+
+    fwrite(&string.content[unescaped_begin], 1, index - unescaped_begin,
+           stream);
+    unescaped_begin = index + 1;
+
+    if(sequence_length == 0)
+    {
+      fputs("\\ufffd", stream);
+    }
+    else if(c == '"' || c == '\\')
+    {
+      fprintf(stream, "\\%c", c);
+    }
+    else if(c == '\n')
+    {
+      fputs("\\n", stream);
+    }
+    else if(c == '\t')
+    {
+      fputs("\\t", stream);
+    }
+    else
+    {
+      fprintf(stream, "\\u%04x", c);
+    }
+  }
+
+  fwrite(&string.content[unescaped_begin], 1,
+         string.length - unescaped_begin, stream);
+  fputc('"', stream);
+}
@@ -0,0 +1,31 @@
+#ifndef NANO_BACKUP_SRC_OUTPUT_H
+#define NANO_BACKUP_SRC_OUTPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "str.h"
+
+/** Formats in which nb can print its reports to stdout. */
+typedef enum
+{
+  /** Human readable text. Colorized if stdout is a TTY. */
+  OF_text,
+
+  /** One JSON object per line, without colors or progress lines. */
+  OF_ndjson,
+} OutputFormat;
+
+extern void outputInit(OutputFormat format);
+extern OutputFormat outputGetFormat(void);
+extern void outputFlush(void);
+
+extern void outputJsonBegin(const char *type);
+extern void outputJsonString(const char *key, StringView value);
+extern void outputJsonUint64(const char *key, uint64_t value);
+extern void outputJsonBool(const char *key, bool value);
+extern void outputJsonEnd(void);
+extern void outputWriteJsonString(FILE *stream, StringView string);
+
+#endif
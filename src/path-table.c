@@ -0,0 +1,103 @@
+#include "path-table.h"
+
+#include <stdint.h>
+
+#include "hash-table.h"
+#include "metadata.h"
+
+/** Slot in the flat array of a path table. */
+typedef struct
+{
+  /** Hash of the nodes parent and name. */
+  uint64_t hash;
+
+  PathNode *node;
+} Slot;
+
+/** The parent and name of a node to look up. */
+typedef struct
+{
+  const PathNode *parent;
+  StringView name;
+} Key;
+
+struct PathTable
+{
+  HashTable table;
+};
+
+/** Hashes the given name with a key derived from the tables secret key and
+  the given parent node. */
+static uint64_t hashKey(const PathTable *table, const PathNode *parent,
+                        StringView name)
+{
+  return hashTableHash(&table->table, (uint64_t)(uintptr_t)parent,
+                       name.content, name.length);
+}
+
+static bool slotMatches(const void *slot, const void *key)
+{
+  const PathNode *node = ((const Slot *)slot)->node;
+  const Key *path_key = key;
+
+  return node->parent == path_key->parent &&
+    strIsEqual(node->name, path_key->name);
+}
+
+/** Creates a dynamically growing table for looking up path nodes.
+
+  @param region Region to use for allocations.
+  @param expected_nodes The amount of nodes which the table is expected to
+  contain. Can be 0.
+
+  @return Table which lifetime will be bound to the given region.
+*/
+PathTable *pathTableNew(CR_Region *region, const size_t expected_nodes)
+{
+  PathTable *table = CR_RegionAlloc(region, sizeof(*table));
+  hashTableInit(&table->table, region, sizeof(Slot), expected_nodes);
+
+  return table;
+}
+
+/** Adds the given node to the table. This function does not check whether
+  a node with the same parent and name was already added.
+
+  @param table The table to which the node should be added.
+  @param node The node to add. The table will use its parent and name as
+  key, so the caller should not modify them, unless the given table is not
+  used anymore.
+*/
+void pathTableInsert(PathTable *table, PathNode *node)
+{
+  const Slot slot = {
+    .hash = hashKey(table, node->parent, node->name),
+    .node = node,
+  };
+  hashTableInsert(&table->table, &slot);
+}
+
+/** Finds the node with the given parent and name.
+
+  @param table Table containing the node.
+  @param parent The parent of the requested node. NULL for nodes at the
+  top of the tree.
+  @param name The name of the requested node, e.g. "foo.txt".
+
+  @return Found node or NULL.
+*/
+PathNode *pathTableGet(const PathTable *table, const PathNode *parent,
+                       StringView name)
+{
+  const Key key = { .parent = parent, .name = name };
+  const Slot *slot = hashTableFind(
+    &table->table, hashKey(table, parent, name), slotMatches, &key);
+
+  return slot == NULL ? NULL : slot->node;
+}
+
+/** @return Count of all nodes inside the given table. */
+size_t pathTableCountNodes(const PathTable *table)
+{
+  return table->table.count;
+}
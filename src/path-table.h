@@ -0,0 +1,22 @@
+#ifndef NANO_BACKUP_SRC_PATH_TABLE_H
+#define NANO_BACKUP_SRC_PATH_TABLE_H
+
+#include "CRegion/region.h"
+
+#include "str.h"
+
+struct PathNode;
+
+/** Index for looking up PathNodes by their parent node and name. The
+  nodes themselves serve as keys, so the table stores only one pointer and
+  a hash per node. */
+typedef struct PathTable PathTable;
+
+extern PathTable *pathTableNew(CR_Region *region, size_t expected_nodes);
+extern void pathTableInsert(PathTable *table, struct PathNode *node);
+extern struct PathNode *pathTableGet(const PathTable *table,
+                                     const struct PathNode *parent,
+                                     StringView name);
+extern size_t pathTableCountNodes(const PathTable *table);
+
+#endif
@@ -15,6 +15,11 @@
 #include "error-handling.h"
 #include "safe-math.h"
 #include "safe-wrappers.h"
+#include "thread-local.h"
+
+/** The size of the buffer in which a raw mode RepoWriter collects small
+  writes before passing them to its underlying stream. */
+#define WRITE_BUFFER_SIZE ((size_t)64 * 1024)
 
 /** A struct for safely writing files into backup repositories. */
 struct RepoWriter
@@ -47,6 +52,17 @@ struct RepoWriter
       will be generated from this file info. */
     const RegularFileInfo *info;
   } rename_to;
+
+  /** The size of the write buffer. 0 for writers storing regular files,
+    which are already written in large chunks. */
+  size_t buffer_capacity;
+
+  /** The amount of bytes stored in the write buffer. */
+  size_t buffer_used;
+
+  /** Collects small writes, like the fields of serialized metadata, and
+    passes them to the stream in large chunks. */
+  unsigned char buffer[];
 };
 
 /** A struct for reading files from backup repositories. */
@@ -92,28 +108,31 @@ static void buildFilePath(char *buffer, const RegularFileInfo *info)
   sprintf(suffix_buffer, "x%" PRIx64 "x%x", info->size, info->slot);
 }
 
-static char *path_buffer = NULL;
-
-/** Populates the path_buffer with the path required for accessing a file
-  inside the repository.
+/** Populates the thread-local path buffer with the path required for
+  accessing a file inside the repository.
 
   @param repo_path The full or relative path to a backup repository.
   @param info The informations describing the file, for which the path
   should be build.
+
+  @return The path buffer, which will be invalidated by the next call to
+  this function on the same thread.
 */
-static void fillPathBufferWithInfo(StringView repo_path,
-                                   const RegularFileInfo *info)
+static char *fillPathBufferWithInfo(StringView repo_path,
+                                    const RegularFileInfo *info)
 {
   /* The +1 is for the slash after the repo path. */
   size_t required_capacity = getFilePathRequiredCapacity(info) + 1;
   required_capacity = sSizeAdd(required_capacity, repo_path.length);
-  path_buffer = CR_EnsureCapacity(path_buffer, required_capacity);
+  char *path_buffer = threadLocalBuffer(TB_repo_path, required_capacity);
 
   memcpy(path_buffer, repo_path.content, repo_path.length);
   path_buffer[repo_path.length] = '/';
 
   char *hash_buffer = &path_buffer[repo_path.length + 1];
   buildFilePath(hash_buffer, info);
+
+  return path_buffer;
 }
 
 static RepoWriter *createRepoWriter(StringView repo_path,
@@ -122,13 +141,16 @@ static RepoWriter *createRepoWriter(StringView repo_path,
                                     const bool raw_mode)
 {
   FileStream *stream = sFopenWrite(repo_tmp_file_path);
-  RepoWriter *writer = sMalloc(sizeof *writer);
+  const size_t buffer_capacity = raw_mode ? WRITE_BUFFER_SIZE : 0;
+  RepoWriter *writer = sMalloc(sSizeAdd(sizeof *writer, buffer_capacity));
 
   strSet(&writer->repo_path, repo_path);
   strSet(&writer->repo_tmp_file_path, repo_tmp_file_path);
   strSet(&writer->source_file_path, source_file_path);
   writer->stream = stream;
   writer->raw_mode = raw_mode;
+  writer->buffer_capacity = buffer_capacity;
+  writer->buffer_used = 0;
 
   return writer;
 }
@@ -144,8 +166,7 @@ static RepoWriter *createRepoWriter(StringView repo_path,
 bool repoRegularFileExists(StringView repo_path,
                            const RegularFileInfo *info)
 {
-  fillPathBufferWithInfo(repo_path, info);
-  return sPathExists(str(path_buffer));
+  return sPathExists(str(fillPathBufferWithInfo(repo_path, info)));
 }
 
 /** Builds the unique path of the file represented by the given info.
@@ -164,6 +185,164 @@ void repoBuildRegularFilePath(char **buffer_ptr,
   buildFilePath(*buffer_ptr, info);
 }
 
+/** Writes the unique path of the given file info into the specified
+  buffer. Unlike repoBuildRegularFilePath() this function is thread-safe.
+
+  @param buffer The buffer to which the path will be written. Must have a
+  capacity of at least REPO_FILE_PATH_CAPACITY.
+  @param info The info from which the filepath will be built.
+*/
+void repoFormatRegularFilePath(char *buffer, const RegularFileInfo *info)
+{
+  buildFilePath(buffer, info);
+}
+
+/** Maps lowercase hex digits to their value plus one. All other
+  characters are mapped to zero. This allows parsing repository paths
+  without branching on every digit. */
+static const uint8_t hex_digit_values[256] = {
+  ['0'] = 1,  ['1'] = 2,  ['2'] = 3,  ['3'] = 4,  ['4'] = 5,  ['5'] = 6,
+  ['6'] = 7,  ['7'] = 8,  ['8'] = 9,  ['9'] = 10, ['a'] = 11, ['b'] = 12,
+  ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+};
+
+/** @return The value of the given lowercase hex digit plus one, or zero
+  if the character is not a lowercase hex digit. */
+static uint8_t parseHexDigit(const char c)
+{
+  return hex_digit_values[(unsigned char)c];
+}
+
+/** Parses a hex number in the format produced by buildFilePath(), without
+  leading zeros.
+
+  @param string The string to parse. Will be advanced behind the last
+  parsed digit.
+  @param end The end of the string.
+  @param max_digits The maximal amount of digits allowed.
+  @param value Will contain the parsed number.
+
+  @return False if the string contains no valid number.
+*/
+static bool parseHexNumber(const char **string, const char *end,
+                           const size_t max_digits, uint64_t *value)
+{
+  const char *start = *string;
+  if(start == end || (*start == '0' && start + 1 < end &&
+                      parseHexDigit(start[1]) != 0))
+  {
+    return false;
+  }
+
+  uint64_t number = 0;
+  const char *current = start;
+  for(uint8_t digit; current < end && (digit = parseHexDigit(*current)) != 0;
+      current++)
+  {
+    if((size_t)(current - start) == max_digits)
+    {
+      return false;
+    }
+    number = (number << 4) | (uint64_t)(digit - 1);
+  }
+
+  if(current == start)
+  {
+    return false;
+  }
+
+  *string = current;
+  *value = number;
+  return true;
+}
+
+/** Parses a path built by repoBuildRegularFilePath() back into the
+  informations identifying the file. Only paths which would be rebuilt
+  exactly the same will be accepted.
+
+  @param path The path to parse, relative to its repository.
+  @param info Its hash, size and slot will be overwritten. They are only
+  defined if this function returns true. All other values will be left
+  untouched.
+
+  @return True if the given path was a valid path to a regular file.
+*/
+bool repoParseRegularFilePath(StringView path, RegularFileInfo *info)
+{
+  /* 40 hex digits, 2 slashes, 2 x's and at least one digit per number. */
+  if(path.length < FILE_HASH_SIZE * 2 + 6 || path.content[1] != '/' ||
+     path.content[4] != '/')
+  {
+    return false;
+  }
+
+  /* Gather the hex digits split by slashes. */
+  char digits[FILE_HASH_SIZE * 2];
+  digits[0] = path.content[0];
+  digits[1] = path.content[2];
+  digits[2] = path.content[3];
+  memcpy(&digits[3], &path.content[5], sizeof(digits) - 3);
+
+  /* Invalid digits will wrap around and set bits above the lowest 4. */
+  unsigned int merged_digits = 0;
+  for(size_t index = 0; index < FILE_HASH_SIZE; index++)
+  {
+    const unsigned int high = parseHexDigit(digits[index * 2]) - 1u;
+    const unsigned int low = parseHexDigit(digits[index * 2 + 1]) - 1u;
+    merged_digits |= high | low;
+    info->hash[index] = (uint8_t)((high << 4) | (low & 0xf));
+  }
+  if(merged_digits > 0xf)
+  {
+    return false;
+  }
+
+  const char *current = &path.content[FILE_HASH_SIZE * 2 + 2];
+  const char *end = &path.content[path.length];
+  uint64_t size;
+  uint64_t slot;
+  if(*current != 'x')
+  {
+    return false;
+  }
+  current++;
+  if(!parseHexNumber(&current, end, 16, &size) || current == end ||
+     *current != 'x')
+  {
+    return false;
+  }
+  current++;
+  if(!parseHexNumber(&current, end, 2, &slot) || current != end)
+  {
+    return false;
+  }
+
+  info->size = size;
+  info->slot = (uint8_t)slot;
+  return true;
+}
+
+/** Orders files stored in a repository by hash, size and slot. Files for
+  which this function returns 0 share the same path in the repository.
+
+  @return A value less than, equal to or greater than zero, like
+  strcmp().
+*/
+int repoCompareRegularFiles(const RegularFileInfo *a,
+                            const RegularFileInfo *b)
+{
+  const int hash_order = memcmp(a->hash, b->hash, FILE_HASH_SIZE);
+  if(hash_order != 0)
+  {
+    return hash_order;
+  }
+  else if(a->size != b->size)
+  {
+    return a->size < b->size ? -1 : 1;
+  }
+  return (int)a->slot - (int)b->slot;
+}
+
 /** Opens a new RepoReader for reading a file from a repository.
 
   @param repo_path The path to the repository. The returned RepoReader will
@@ -182,8 +361,7 @@ RepoReader *repoReaderOpenFile(StringView repo_path,
                                StringView source_file_path,
                                const RegularFileInfo *info)
 {
-  fillPathBufferWithInfo(repo_path, info);
-  FILE *stream = fopen(path_buffer, "rb");
+  FILE *stream = fopen(fillPathBufferWithInfo(repo_path, info), "rb");
   if(stream == NULL)
   {
     dieErrno("failed to open \"" PRI_STR "\" in \"" PRI_STR "\"",
@@ -307,15 +485,10 @@ RepoWriter *repoWriterOpenRaw(StringView repo_path,
   return writer;
 }
 
-/** Writes data using the given RepoWriter and terminates the program on
-  failure.
-
-  @param data The data which should be written.
-  @param size The size of the data in bytes.
-  @param writer The writer which should be used.
-*/
-void repoWriterWrite(const void *data, const size_t size,
-                     RepoWriter *writer)
+/** Writes the given data directly to the stream of the specified writer.
+  On failure the writer will be destroyed and the program terminated. */
+static void writeToStream(const void *data, const size_t size,
+                          RepoWriter *writer)
 {
   if(!fWrite(data, size, writer->stream))
   {
@@ -330,6 +503,42 @@ void repoWriterWrite(const void *data, const size_t size,
   }
 }
 
+/** Passes all data collected in the writers buffer to its stream. */
+static void flushWriteBuffer(RepoWriter *writer)
+{
+  if(writer->buffer_used > 0)
+  {
+    writeToStream(writer->buffer, writer->buffer_used, writer);
+    writer->buffer_used = 0;
+  }
+}
+
+/** Writes data using the given RepoWriter and terminates the program on
+  failure. Small writes to raw mode writers will be buffered, so errors
+  may only be reported by later calls to this function or by
+  repoWriterClose().
+
+  @param data The data which should be written.
+  @param size The size of the data in bytes.
+  @param writer The writer which should be used.
+*/
+void repoWriterWrite(const void *data, const size_t size,
+                     RepoWriter *writer)
+{
+  if(size > writer->buffer_capacity - writer->buffer_used)
+  {
+    flushWriteBuffer(writer);
+    if(size >= writer->buffer_capacity)
+    {
+      writeToStream(data, size, writer);
+      return;
+    }
+  }
+
+  memcpy(&writer->buffer[writer->buffer_used], data, size);
+  writer->buffer_used += size;
+}
+
 /** Finalizes the write process represented by the given writer. All its
   data will be written to disk and the temporary file will be renamed to
   its final filename.
@@ -339,6 +548,8 @@ void repoWriterWrite(const void *data, const size_t size,
 */
 void repoWriterClose(RepoWriter *writer_to_close)
 {
+  flushWriteBuffer(writer_to_close);
+
   RepoWriter writer = *writer_to_close;
   free(writer_to_close);
 
@@ -358,7 +569,8 @@ void repoWriterClose(RepoWriter *writer_to_close)
   else
   {
     StringView repo_path = writer.repo_path;
-    fillPathBufferWithInfo(repo_path, writer.rename_to.info);
+    char *path_buffer =
+      fillPathBufferWithInfo(repo_path, writer.rename_to.info);
 
     /* Ensure that the final paths parent directories exists. */
     path_buffer[repo_path.length + 5] = '\0';
@@ -34,10 +34,22 @@ typedef struct
   uint8_t slot;
 } RegularFileInfo;
 
+/** The capacity required for storing any path built by
+  repoFormatRegularFilePath(), including the terminating null byte. Consists
+  of 40 hex digits, 2 slashes, 2 x's, 16 digits for the size and 2 digits
+  for the slot. */
+#define REPO_FILE_PATH_CAPACITY ((size_t)(FILE_HASH_SIZE * 2 + 23))
+
 extern bool repoRegularFileExists(StringView repo_path,
                                   const RegularFileInfo *info);
 extern void repoBuildRegularFilePath(char **buffer_ptr,
                                      const RegularFileInfo *info);
+extern void repoFormatRegularFilePath(char *buffer,
+                                      const RegularFileInfo *info);
+extern bool repoParseRegularFilePath(StringView path,
+                                     RegularFileInfo *info);
+extern int repoCompareRegularFiles(const RegularFileInfo *a,
+                                   const RegularFileInfo *b);
 
 extern RepoReader *repoReaderOpenFile(StringView repo_path,
                                       StringView source_file_path,
@@ -1,11 +1,100 @@
+/* Exposes copy_file_range() on Linux. */
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 #include "restore.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+#include "CRegion/alloc-growable.h"
 
 #include "backup-helpers.h"
 #include "error-handling.h"
+#include "safe-math.h"
 #include "safe-wrappers.h"
 #include "str.h"
+#include "thread-local.h"
+#include "trace.h"
+#include "worker-pool.h"
+
+/** The maximal amount of bytes copied per read() call when restoring
+  files in parallel. */
+#define COPY_BUFFER_SIZE ((size_t)64 * 1024)
+
+/** The maximal amount of bytes copied per copy_file_range() call. */
+#define COPY_RANGE_SIZE ((size_t)1024 * 1024 * 1024)
+
+/** A regular file whose content gets restored by a worker job. */
+typedef struct FileToRestore
+{
+  /** The node of the file. Its path gets built by the job restoring it,
+    to avoid keeping a copy of every path. */
+  const PathNode *node;
+  const PathState *state;
+
+  /** True if the file does not exist on the users system. Its owner and
+    permissions will only be applied if this is the case. */
+  bool is_new;
+
+  /** Another file with the same content, which gets restored before this
+    one. Its data can be shared with this file if the filesystem supports
+    it. NULL if this is the first file with its content. */
+  const struct FileToRestore *clone_source;
+
+  /** The inode of the file in the repository from which the content gets
+    copied. Used for reading the repository in physical order. 0 if
+    unknown. */
+  ino_t source_inode;
+
+  /** The physical location of the data of the file in the repository from
+    which the content gets copied. Only defined if
+    `has_source_physical_offset` is true. */
+  uint64_t source_physical_offset;
+
+  /** True if the physical location of the source is known. */
+  bool has_source_physical_offset;
+} FileToRestore;
+
+/** A directory whose timestamp must be restored after all files inside
+  it were written. */
+typedef struct
+{
+  StringView path;
+  time_t modification_time;
+} DirectoryToFinish;
+
+/** Collects the work done by finishRestore(), which gets deferred until
+  the entire tree was traversed. */
+typedef struct
+{
+  StringView repo_path;
+
+  /** Owns the paths of the directories in this context. */
+  Allocator *a;
+
+  /** Growable array of files to restore in parallel. */
+  FileToRestore *files;
+  size_t file_count;
+
+  /** The files restored by the current worker pool run. */
+  FileToRestore **queue;
+
+  /** Growable array of directories, ordered from the innermost to the
+    outermost directory. */
+  DirectoryToFinish *directories;
+  size_t directory_count;
+} RestoreContext;
 
 /** Searches the path state which the given node had during the given
   backup id. If not found, it returns NULL. If the nodes policy doesn't
@@ -18,6 +107,30 @@ static const PathState *searchPathState(const PathNode *node,
     return &node->history->state;
   }
 
+  if(node->history_array_length > 0)
+  {
+    /* Binary search for the first point with a backup id >= id. */
+    const PathHistory *points = node->history;
+    size_t start = 0;
+    size_t end = node->history_array_length;
+
+    while(start < end)
+    {
+      const size_t middle = start + (end - start) / 2;
+      if(points[middle].backup->id < id)
+      {
+        start = middle + 1;
+      }
+      else
+      {
+        end = middle;
+      }
+    }
+
+    return start < node->history_array_length ? &points[start].state
+                                              : NULL;
+  }
+
   for(PathHistory *point = node->history; point != NULL;
       point = point->next)
   {
@@ -46,8 +159,13 @@ static const PathState *searchExistingPathState(const PathNode *node,
 }
 
 /** Wrapper around searchExistingPathState(), which terminates the program
-  if the state doesn't exist. */
+  if the state doesn't exist.
+
+  @param path The full path of the given node. Only needed for printing
+  error messages.
+*/
 static const PathState *findExistingPathState(const PathNode *node,
+                                              StringView path,
                                               const size_t id)
 {
   const PathState *state = searchExistingPathState(node, id);
@@ -55,7 +173,7 @@ static const PathState *findExistingPathState(const PathNode *node,
   if(state == NULL)
   {
     die("path didn't exist at the specified time: \"" PRI_STR "\"",
-        STR_FMT(node->path));
+        STR_FMT(path));
   }
 
   return state;
@@ -124,21 +242,31 @@ static void handleFiletypeChanges(PathNode *node, const PathState *state,
   @param state The state against which the path should be compared.
   @param could_exist True if the path in the given node should be checked
   for existence. Otherwise it will be marked as BH_added.
+  @param path_buffer Reusable buffer for building the nodes path. Must be
+  distinct from the reusable buffer in the given allocator pair.
 */
 static void checkAndHandleChanges(AllocatorPair *allocator_pair,
                                   PathNode *node, const PathState *state,
-                                  const bool could_exist)
+                                  const bool could_exist,
+                                  Allocator *path_buffer)
 {
-  if(could_exist && sPathExists(node->path))
+  if(!could_exist)
+  {
+    backupHintSet(node->hint, BH_added);
+    return;
+  }
+
+  StringView path = pathNodeGetPath(node, path_buffer);
+  if(sPathExists(path))
   {
     const struct stat stats =
-      state->type == PST_symlink ? sLStat(node->path) : sStat(node->path);
+      state->type == PST_symlink ? sLStat(path) : sStat(path);
 
     handleFiletypeChanges(node, state, stats);
     if(backupHintNoPol(node->hint) == BH_none)
     {
       PathState dummy_state = *state;
-      applyNodeChanges(allocator_pair, node, &dummy_state, stats);
+      applyNodeChanges(allocator_pair, node, path, &dummy_state, stats);
     }
   }
   else
@@ -156,9 +284,11 @@ static void checkAndHandleChangesRecursively(AllocatorPair *allocator_pair,
                                              PathNode *node,
                                              const PathState *state,
                                              const size_t id,
-                                             bool could_exist)
+                                             bool could_exist,
+                                             Allocator *path_buffer)
 {
-  checkAndHandleChanges(allocator_pair, node, state, could_exist);
+  checkAndHandleChanges(allocator_pair, node, state, could_exist,
+                        path_buffer);
   if(state->type != PST_directory)
   {
     return;
@@ -176,64 +306,76 @@ static void checkAndHandleChangesRecursively(AllocatorPair *allocator_pair,
     if(subnode_state != NULL)
     {
       checkAndHandleChangesRecursively(allocator_pair, subnode,
-                                       subnode_state, id, could_exist);
+                                       subnode_state, id, could_exist,
+                                       path_buffer);
     }
   }
 }
 
-/** Initiates the restoring of a node in the given node list.
+/** Initiates the restoring of a subnode of the given parent node.
 
-  @param node_list The node list containing the given path.
+  @param path_table The table containing all nodes of the restored tree.
+  @param parent The node containing the element of the given path which
+  follows the parent path. NULL for the top of the tree.
   @param id The backup id to which should be restored.
-  @param path The path to restore.
+  @param path The full path to restore.
+  @param parent_length The length of the part of the given path, which
+  leads to the given parent node. E.g. 4 for "/etc" if the parent node
+  represents "/etc".
   @param could_exist True if the path to restore could exist. See
   checkAndHandleChanges() for more informations.
+  @param path_buffer Reusable buffer for building paths.
 */
 static void initiateRestoreRecursively(AllocatorPair *allocator_pair,
-                                       PathNode *node_list,
+                                       const PathTable *path_table,
+                                       const PathNode *parent,
                                        const size_t id, StringView path,
-                                       const bool could_exist)
+                                       const size_t parent_length,
+                                       const bool could_exist,
+                                       Allocator *path_buffer)
 {
-  bool found_node = false;
+  /* Extract the element following the parent path, without its leading
+     slash. */
+  const char *name_start = &path.content[parent_length + 1];
+  const char *name_end =
+    memchr(name_start, '/', path.length - parent_length - 1);
+  const size_t node_path_length =
+    name_end == NULL ? path.length : (size_t)(name_end - path.content);
+  StringView name = strUnterminated(
+    name_start, node_path_length - parent_length - 1);
+  StringView node_path = strUnterminated(path.content, node_path_length);
 
-  for(PathNode *node = node_list; node != NULL && found_node == false;
-      node = node->next)
+  PathNode *node = pathTableGet(path_table, parent, name);
+  if(node == NULL)
   {
-    if(strIsEqual(node->path, path))
-    {
-      found_node = true;
-      const PathState *state = findExistingPathState(node, id);
-      checkAndHandleChangesRecursively(allocator_pair, node, state, id,
-                                       could_exist);
-    }
-    else if(strIsParentPath(node->path, path))
-    {
-      found_node = true;
-
-      const PathState *state = findExistingPathState(node, id);
-      if(state->type != PST_directory)
-      {
-        die("path was not a directory at the specified time: \"" PRI_STR
-            "\"",
-            STR_FMT(node->path));
-      }
-
-      checkAndHandleChanges(allocator_pair, node, state, could_exist);
-
-      const bool subnode_could_exist = could_exist &&
-        !(backupHintNoPol(node->hint) >= BH_added &&
-          backupHintNoPol(node->hint) <= BH_other_to_directory);
+    die("path doesn't exist in repository: \"" PRI_STR "\"",
+        STR_FMT(path));
+  }
 
-      initiateRestoreRecursively(allocator_pair, node->subnodes, id, path,
-                                 subnode_could_exist);
-    }
+  const PathState *state = findExistingPathState(node, node_path, id);
+  if(name_end == NULL)
+  {
+    checkAndHandleChangesRecursively(allocator_pair, node, state, id,
+                                     could_exist, path_buffer);
+    return;
   }
 
-  if(!found_node)
+  if(state->type != PST_directory)
   {
-    die("path doesn't exist in repository: \"" PRI_STR "\"",
-        STR_FMT(path));
+    die("path was not a directory at the specified time: \"" PRI_STR "\"",
+        STR_FMT(node_path));
   }
+
+  checkAndHandleChanges(allocator_pair, node, state, could_exist,
+                        path_buffer);
+
+  const bool subnode_could_exist = could_exist &&
+    !(backupHintNoPol(node->hint) >= BH_added &&
+      backupHintNoPol(node->hint) <= BH_other_to_directory);
+
+  initiateRestoreRecursively(allocator_pair, path_table, node, id, path,
+                             node_path_length, subnode_could_exist,
+                             path_buffer);
 }
 
 /** Initiates the restoring of the given path.
@@ -250,6 +392,7 @@ void initiateRestore(Metadata *metadata, const size_t id, StringView path)
     .a = allocatorWrapRegion(metadata->r),
     .reusable_buffer = allocatorWrapOneSingleGrowableBuffer(metadata->r),
   };
+  Allocator *path_buffer = allocatorWrapOneSingleGrowableBuffer(metadata->r);
 
   if(strIsEmpty(path))
   {
@@ -259,14 +402,14 @@ void initiateRestore(Metadata *metadata, const size_t id, StringView path)
       if(state != NULL)
       {
         checkAndHandleChangesRecursively(&allocator_pair, node, state, id,
-                                         true);
+                                         true, path_buffer);
       }
     }
   }
   else
   {
-    initiateRestoreRecursively(&allocator_pair, metadata->paths, id, path,
-                               true);
+    initiateRestoreRecursively(&allocator_pair, metadata->path_table,
+                               NULL, id, path, 0, true, path_buffer);
   }
 }
 
@@ -310,58 +453,81 @@ void restoreFile(StringView path, const RegularFileInfo *info,
   }
 }
 
-/** Restores a path depending on the given state.
+/** Schedules the restoring of the given regular file. */
+static void deferFile(RestoreContext *ctx, const PathNode *node,
+                      const PathState *state, const bool is_new)
+{
+  ctx->files = CR_EnsureCapacity(
+    ctx->files,
+    sSizeMul(sSizeAdd(ctx->file_count, 1), sizeof(*ctx->files)));
+  ctx->files[ctx->file_count].node = node;
+  ctx->files[ctx->file_count].state = state;
+  ctx->files[ctx->file_count].is_new = is_new;
+  ctx->files[ctx->file_count].clone_source = NULL;
+  ctx->files[ctx->file_count].source_inode = 0;
+  ctx->files[ctx->file_count].source_physical_offset = 0;
+  ctx->files[ctx->file_count].has_source_physical_offset = false;
+  ctx->file_count++;
+}
+
+/** Schedules the restoring of the given directories timestamp. */
+static void deferDirectoryTimestamp(RestoreContext *ctx, StringView path,
+                                    const time_t modification_time)
+{
+  ctx->directories = CR_EnsureCapacity(
+    ctx->directories, sSizeMul(sSizeAdd(ctx->directory_count, 1),
+                               sizeof(*ctx->directories)));
+  strSet(&ctx->directories[ctx->directory_count].path,
+         strCopy(path, ctx->a));
+  ctx->directories[ctx->directory_count].modification_time =
+    modification_time;
+  ctx->directory_count++;
+}
+
+/** Restores a path depending on the given state. Regular files will only
+  be scheduled for restoring.
 
-  @param node The node representing the path to restore.
+  @param node The node of the path to restore.
+  @param path The path to restore.
   @param state The state to which the path should be restored.
-  @param repo_path The path to the repository.
 */
-static void restorePath(const PathNode *node, const PathState *state,
-                        StringView repo_path)
+static void restorePath(RestoreContext *ctx, const PathNode *node,
+                        StringView path, const PathState *state)
 {
   if(state->type == PST_regular_file)
   {
-    restoreFile(node->path, &state->metadata.file_info, repo_path);
-    sChown(node->path, state->uid, state->gid);
-    sChmod(node->path, state->metadata.file_info.permission_bits);
-    sUtime(node->path, state->metadata.file_info.modification_time);
+    deferFile(ctx, node, state, true);
   }
   else if(state->type == PST_symlink)
   {
-    sSymlink(state->metadata.symlink_target, node->path);
-    sLChown(node->path, state->uid, state->gid);
+    sSymlink(state->metadata.symlink_target, path);
+    sLChown(path, state->uid, state->gid);
   }
   else if(state->type == PST_directory)
   {
-    sMkdir(node->path);
-    sChown(node->path, state->uid, state->gid);
-    sChmod(node->path, state->metadata.directory_info.permission_bits);
-    sUtime(node->path, state->metadata.directory_info.modification_time);
+    sMkdir(path);
+    sChown(path, state->uid, state->gid);
+    sChmod(path, state->metadata.directory_info.permission_bits);
+    sUtime(path, state->metadata.directory_info.modification_time);
   }
 }
 
-/** Recursive counterpart to finishRestore().
+/** Applies the changes described by the given nodes backup hint.
 
   @param node The node to restore.
-  @param id See finishRestore().
-  @param repo_path See finishRestore().
+  @param path The full path of the given node.
+  @param state The state to which the node should be restored.
 
   @return True if the restoring affected the parent directories timestamp.
 */
-static bool finishRestoreRecursively(const PathNode *node, const size_t id,
-                                     StringView repo_path)
+static bool restoreNode(RestoreContext *ctx, const PathNode *node,
+                        StringView path, const PathState *state)
 {
   bool affects_parent_timestamp = false;
 
-  const PathState *state = searchExistingPathState(node, id);
-  if(state == NULL)
-  {
-    return affects_parent_timestamp;
-  }
-
   if(backupHintNoPol(node->hint) == BH_added)
   {
-    restorePath(node, state, repo_path);
+    restorePath(ctx, node, path, state);
     affects_parent_timestamp = true;
   }
   else if(backupHintNoPol(node->hint) >= BH_regular_to_symlink &&
@@ -370,14 +536,14 @@ static bool finishRestoreRecursively(const PathNode *node, const size_t id,
     if(backupHintNoPol(node->hint) == BH_directory_to_regular ||
        backupHintNoPol(node->hint) == BH_directory_to_symlink)
     {
-      sRemoveRecursively(node->path);
+      sRemoveRecursively(path);
     }
     else
     {
-      sRemove(node->path);
+      sRemove(path);
     }
 
-    restorePath(node, state, repo_path);
+    restorePath(ctx, node, path, state);
     affects_parent_timestamp = true;
   }
   else if(node->policy != BPOL_none)
@@ -386,22 +552,22 @@ static bool finishRestoreRecursively(const PathNode *node, const size_t id,
     {
       if(state->type == PST_symlink)
       {
-        sLChown(node->path, state->uid, state->gid);
+        sLChown(path, state->uid, state->gid);
       }
       else
       {
-        sChown(node->path, state->uid, state->gid);
+        sChown(path, state->uid, state->gid);
       }
     }
     if(node->hint & BH_permissions_changed)
     {
       if(state->type == PST_regular_file)
       {
-        sChmod(node->path, state->metadata.file_info.permission_bits);
+        sChmod(path, state->metadata.file_info.permission_bits);
       }
       else if(state->type == PST_directory)
       {
-        sChmod(node->path, state->metadata.directory_info.permission_bits);
+        sChmod(path, state->metadata.directory_info.permission_bits);
       }
     }
 
@@ -409,13 +575,12 @@ static bool finishRestoreRecursively(const PathNode *node, const size_t id,
     {
       if(state->type == PST_regular_file)
       {
-        restoreFile(node->path, &state->metadata.file_info, repo_path);
-        sUtime(node->path, state->metadata.file_info.modification_time);
+        deferFile(ctx, node, state, false);
       }
       else if(state->type == PST_symlink)
       {
-        sRemove(node->path);
-        restorePath(node, state, repo_path);
+        sRemove(path);
+        restorePath(ctx, node, path, state);
         affects_parent_timestamp = true;
       }
     }
@@ -423,16 +588,43 @@ static bool finishRestoreRecursively(const PathNode *node, const size_t id,
     {
       if(state->type == PST_regular_file)
       {
-        sUtime(node->path, state->metadata.file_info.modification_time);
+        sUtime(path, state->metadata.file_info.modification_time);
       }
       else if(state->type == PST_directory)
       {
-        sUtime(node->path,
-               state->metadata.directory_info.modification_time);
+        sUtime(path, state->metadata.directory_info.modification_time);
       }
     }
   }
 
+  return affects_parent_timestamp;
+}
+
+/** Recursive counterpart to finishRestore().
+
+  @param node The node to restore.
+  @param id See finishRestore().
+  @param path_buffer Reusable buffer for building paths.
+
+  @return True if the restoring affected the parent directories timestamp.
+*/
+static bool finishRestoreRecursively(RestoreContext *ctx,
+                                     const PathNode *node, const size_t id,
+                                     Allocator *path_buffer)
+{
+  const PathState *state = searchExistingPathState(node, id);
+  if(state == NULL)
+  {
+    return false;
+  }
+
+  bool affects_parent_timestamp = false;
+  if(node->hint != BH_none)
+  {
+    affects_parent_timestamp = restoreNode(
+      ctx, node, pathNodeGetPath(node, path_buffer), state);
+  }
+
   if(state->type == PST_directory)
   {
     bool subnode_changes_timestamp = false;
@@ -441,19 +633,454 @@ static bool finishRestoreRecursively(const PathNode *node, const size_t id,
         subnode = subnode->next)
     {
       subnode_changes_timestamp |=
-        finishRestoreRecursively(subnode, id, repo_path);
+        finishRestoreRecursively(ctx, subnode, id, path_buffer);
     }
 
     if(subnode_changes_timestamp && node->policy != BPOL_none)
     {
-      sUtime(node->path, state->metadata.directory_info.modification_time);
+      deferDirectoryTimestamp(
+        ctx, pathNodeGetPath(node, path_buffer),
+        state->metadata.directory_info.modification_time);
     }
   }
 
   return affects_parent_timestamp;
 }
 
-/** Completes the restoring of a path.
+/** Writes the path of the given file inside the repository into the
+  given buffer, which must have a capacity of at least `repo_path.length +
+  1 + REPO_FILE_PATH_CAPACITY`. */
+static void buildSourcePath(char *buffer, const RestoreContext *ctx,
+                            const RegularFileInfo *info)
+{
+  memcpy(buffer, ctx->repo_path.content, ctx->repo_path.length);
+  buffer[ctx->repo_path.length] = '/';
+  repoFormatRegularFilePath(&buffer[ctx->repo_path.length + 1], info);
+}
+
+/** Builds the path of the given node into the given thread-local buffer.
+
+  @return A path which stays valid until the buffer gets reused by the
+  calling thread.
+*/
+static const char *buildNodePath(const PathNode *node,
+                                 const ThreadBuffer buffer_id)
+{
+  const size_t length = pathNodeGetPathLength(node);
+  char *buffer = threadLocalBuffer(buffer_id, sSizeAdd(length, 1));
+  pathNodeFormatPath(node, length, buffer);
+
+  return buffer;
+}
+
+/** Copies the content of the given file from the repository into the
+  given file descriptor.
+
+  @param path The path of the file to which the content gets written. Only
+  used for error messages.
+
+  @return False if an error was reported to the given pool.
+*/
+static bool copyFileContent(const RestoreContext *ctx, WorkerPool *pool,
+                            const FileToRestore *file, const char *path,
+                            const int fd)
+{
+  const RegularFileInfo *info = &file->state->metadata.file_info;
+  if(info->size <= FILE_HASH_SIZE)
+  {
+    if(write(fd, info->hash, info->size) != (ssize_t)info->size)
+    {
+      workerPoolFail(pool, errno, "failed to write to \"%s\"",
+                     path);
+      return false;
+    }
+    return true;
+  }
+
+  char source_path[ctx->repo_path.length + 1 + REPO_FILE_PATH_CAPACITY];
+  buildSourcePath(source_path, ctx, info);
+
+  const int source_fd = open(source_path, O_RDONLY | O_NOCTTY);
+  if(source_fd == -1)
+  {
+    workerPoolFail(pool, errno, "failed to open \"%s\" in \"%s\"",
+                   path, ctx->repo_path.content);
+    return false;
+  }
+  (void)posix_fadvise(source_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  const size_t buffer_size =
+    info->size < COPY_BUFFER_SIZE ? info->size : COPY_BUFFER_SIZE;
+  char *buffer = threadLocalBuffer(TB_copy, buffer_size);
+
+  bool success = true;
+  uint64_t bytes_left = info->size;
+  while(success && bytes_left > 0)
+  {
+    const size_t bytes_to_read =
+      bytes_left > buffer_size ? buffer_size : bytes_left;
+    const ssize_t bytes_read = read(source_fd, buffer, bytes_to_read);
+    if(bytes_read == -1 && errno == EINTR)
+    {
+      continue;
+    }
+    else if(bytes_read == -1)
+    {
+      workerPoolFail(pool, errno,
+                     "IO error while reading \"%s\" from \"%s\"",
+                     path, ctx->repo_path.content);
+      success = false;
+    }
+    else if(bytes_read == 0)
+    {
+      workerPoolFail(pool, 0,
+                     "reading \"%s\" from \"%s\": reached end of file "
+                     "unexpectedly",
+                     path, ctx->repo_path.content);
+      success = false;
+    }
+
+    for(ssize_t bytes_written = 0; success && bytes_written < bytes_read;)
+    {
+      const ssize_t result =
+        write(fd, &buffer[bytes_written], bytes_read - bytes_written);
+      if(result == -1 && errno != EINTR)
+      {
+        workerPoolFail(pool, errno, "failed to write to \"%s\"",
+                       path);
+        success = false;
+      }
+      else if(result > 0)
+      {
+        bytes_written += result;
+      }
+    }
+    if(success)
+    {
+      traceCount(TR_bytes_copied, bytes_read);
+      bytes_left -= bytes_read;
+    }
+  }
+
+  if(close(source_fd) != 0 && success)
+  {
+    workerPoolFail(pool, errno, "failed to close \"%s\"", source_path);
+    success = false;
+  }
+  return success;
+}
+
+#ifdef __linux__
+/** Copies the data of the given file inside the kernel, without passing
+  it through userspace. Some filesystems, like NFS, can share the data or
+  copy it on the server side.
+
+  @param source_fd The file to copy.
+  @param fd The empty file to which the data should be copied. Its file
+  offset will not be changed.
+  @param size The size of the source file.
+
+  @return False if the data could not be copied completely. Partially
+  copied data will be overwritten by copyFileContent().
+*/
+static bool copyFileRange(const int source_fd, const int fd,
+                          const uint64_t size)
+{
+  off_t source_offset = 0;
+  off_t offset = 0;
+
+  for(uint64_t bytes_left = size; bytes_left > 0;)
+  {
+    const size_t bytes_to_copy =
+      bytes_left > COPY_RANGE_SIZE ? COPY_RANGE_SIZE : bytes_left;
+    const ssize_t bytes_copied = copy_file_range(
+      source_fd, &source_offset, fd, &offset, bytes_to_copy, 0);
+    if(bytes_copied == -1 && errno == EINTR)
+    {
+      continue;
+    }
+    else if(bytes_copied <= 0)
+    {
+      return false;
+    }
+
+    traceCount(TR_bytes_copied, bytes_copied);
+    bytes_left -= bytes_copied;
+  }
+
+  return true;
+}
+#endif
+
+/** Tries to restore the content of the given file without reading it
+  into userspace. Reflinks are tried first, which are supported on Linux
+  filesystems like Btrfs or XFS. Otherwise the data gets copied with
+  copy_file_range().
+
+  @param source_path The file to clone.
+  @param fd The empty file which should receive the data of the source.
+  @param size The size of the source file.
+
+  @return False if the data could not be restored this way for any
+  reason.
+*/
+static bool cloneFileContent(const char *source_path, const int fd,
+                             const uint64_t size)
+{
+#ifdef __linux__
+  const int source_fd = open(source_path, O_RDONLY | O_NOCTTY);
+  if(source_fd == -1)
+  {
+    return false;
+  }
+
+  bool success = false;
+#ifdef FICLONE
+  success = ioctl(fd, FICLONE, source_fd) == 0;
+#endif
+  success = success || copyFileRange(source_fd, fd, size);
+
+  (void)close(source_fd);
+  return success;
+#else
+  (void)source_path;
+  (void)fd;
+  (void)size;
+  return false;
+#endif
+}
+
+/** Restores the content of a single file. New files also get their owner
+  and permissions applied through their file descriptor. */
+static void restoreFileJob(const size_t index, WorkerPool *pool,
+                           void *user_data)
+{
+  const RestoreContext *ctx = user_data;
+  const FileToRestore *file = ctx->queue[index];
+  const PathState *state = file->state;
+  const char *path = buildNodePath(file->node, TB_restore_path);
+
+  const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY,
+                      file->is_new ? 0600 : 0666);
+  if(fd == -1)
+  {
+    workerPoolFail(pool, errno, "failed to open \"%s\" for writing", path);
+    return;
+  }
+
+  const FileToRestore *source = file->clone_source;
+  bool success =
+    (source != NULL &&
+     cloneFileContent(buildNodePath(source->node, TB_clone_source_path),
+                      fd, state->metadata.file_info.size)) ||
+    copyFileContent(ctx, pool, file, path, fd);
+  if(success && file->is_new && fchown(fd, state->uid, state->gid) != 0)
+  {
+    workerPoolFail(pool, errno, "failed to change owner of \"%s\"", path);
+    success = false;
+  }
+  if(success && file->is_new &&
+     fchmod(fd, state->metadata.file_info.permission_bits) != 0)
+  {
+    workerPoolFail(pool, errno, "failed to change permissions of \"%s\"",
+                   path);
+    success = false;
+  }
+
+  const struct timespec times[2] = {
+    { .tv_sec = state->metadata.file_info.modification_time },
+    { .tv_sec = state->metadata.file_info.modification_time },
+  };
+  if(success && futimens(fd, times) != 0)
+  {
+    workerPoolFail(pool, errno, "failed to set timestamp of \"%s\"",
+                   path);
+    success = false;
+  }
+  if(close(fd) != 0 && success)
+  {
+    workerPoolFail(pool, errno, "failed to close \"%s\"", path);
+  }
+}
+
+static int compareFileContents(const void *a, const void *b)
+{
+  const FileToRestore *file_a = *(const FileToRestore *const *)a;
+  const FileToRestore *file_b = *(const FileToRestore *const *)b;
+
+  const int content_order =
+    repoCompareRegularFiles(&file_a->state->metadata.file_info,
+                            &file_b->state->metadata.file_info);
+  if(content_order != 0)
+  {
+    return content_order;
+  }
+
+  /* Keep the traversal order of files with the same content. */
+  return file_a < file_b ? -1 : file_a > file_b;
+}
+
+/** Assigns each file a clone source if another file with the same
+  content gets restored before it.
+
+  @param r Used for allocating the returned queue.
+  @param duplicate_count Will be set to the amount of files, which have a
+  clone source.
+
+  @return A queue containing the files of the given context. Files without
+  a clone source come first, followed by all files with a clone source.
+*/
+static FileToRestore **planClones(CR_Region *r, RestoreContext *ctx,
+                                  size_t *duplicate_count)
+{
+  FileToRestore **files = CR_RegionAlloc(
+    r, sSizeMul(sSizeAdd(ctx->file_count, 1), sizeof(*files)));
+  for(size_t index = 0; index < ctx->file_count; index++)
+  {
+    files[index] = &ctx->files[index];
+  }
+  qsort(files, ctx->file_count, sizeof(*files), compareFileContents);
+
+  for(size_t index = 1; index < ctx->file_count; index++)
+  {
+    const RegularFileInfo *info = &files[index]->state->metadata.file_info;
+    FileToRestore *previous = files[index - 1];
+    if(info->size > FILE_HASH_SIZE &&
+       repoCompareRegularFiles(info,
+                               &previous->state->metadata.file_info) == 0)
+    {
+      files[index]->clone_source = previous->clone_source != NULL
+        ? previous->clone_source
+        : previous;
+    }
+  }
+
+  FileToRestore **queue = CR_RegionAlloc(
+    r, sSizeMul(sSizeAdd(ctx->file_count, 1), sizeof(*queue)));
+  size_t original_count = 0;
+  *duplicate_count = 0;
+  for(size_t index = 0; index < ctx->file_count; index++)
+  {
+    if(ctx->files[index].clone_source == NULL)
+    {
+      queue[original_count] = &ctx->files[index];
+      original_count++;
+    }
+  }
+  for(size_t index = 0; index < ctx->file_count; index++)
+  {
+    if(ctx->files[index].clone_source != NULL)
+    {
+      queue[original_count + *duplicate_count] = &ctx->files[index];
+      (*duplicate_count)++;
+    }
+  }
+
+  return queue;
+}
+
+/** Looks up the location of the repository file from which the queued
+  file gets restored. Errors will be ignored, since they will be reported
+  when copying the file. */
+static void locateSourceJob(const size_t index, WorkerPool *pool,
+                            void *user_data)
+{
+  (void)pool;
+  const RestoreContext *ctx = user_data;
+  FileToRestore *file = ctx->queue[index];
+  const RegularFileInfo *info = &file->state->metadata.file_info;
+  if(info->size <= FILE_HASH_SIZE)
+  {
+    return;
+  }
+
+  char source_path[ctx->repo_path.length + 1 + REPO_FILE_PATH_CAPACITY];
+  buildSourcePath(source_path, ctx, info);
+  const int fd = open(source_path, O_RDONLY | O_NONBLOCK | O_NOCTTY);
+  if(fd == -1)
+  {
+    return;
+  }
+  traceCount(TR_files_stated, 1);
+
+  struct stat stats;
+  if(fstat(fd, &stats) == 0)
+  {
+    file->source_inode = stats.st_ino;
+  }
+  file->has_source_physical_offset =
+    fPhysicalOffset(fd, &file->source_physical_offset);
+  (void)close(fd);
+}
+
+/** Orders files by the physical location of their source inside the
+  repository. Sources with an unknown location are ordered by their
+  inode, which approximates their physical order on most filesystems.
+  Files without a source come first. */
+static int compareSourceLocation(const void *a, const void *b)
+{
+  const FileToRestore *file_a = *(const FileToRestore *const *)a;
+  const FileToRestore *file_b = *(const FileToRestore *const *)b;
+
+  const uint64_t offset_a = file_a->source_physical_offset;
+  const uint64_t offset_b = file_b->source_physical_offset;
+
+  if(file_a->has_source_physical_offset !=
+     file_b->has_source_physical_offset)
+  {
+    return file_a->has_source_physical_offset ? 1 : -1;
+  }
+  else if(file_a->has_source_physical_offset && offset_a != offset_b)
+  {
+    return offset_a < offset_b ? -1 : 1;
+  }
+  else if(file_a->source_inode != file_b->source_inode)
+  {
+    return file_a->source_inode < file_b->source_inode ? -1 : 1;
+  }
+
+  /* Keep the traversal order of files with the same source. */
+  return file_a < file_b ? -1 : file_a > file_b;
+}
+
+/** Sorts the given queue by the location of each files source inside the
+  repository.
+
+  @param queue The queue returned by planClones().
+  @param thread_count The amount of threads used for looking up files.
+  @param duplicate_count The amount of files at the end of the queue,
+  which have a clone source.
+*/
+static void sortBySourceLocation(RestoreContext *ctx,
+                                 FileToRestore **queue,
+                                 const size_t thread_count,
+                                 const size_t duplicate_count)
+{
+  const size_t original_count = ctx->file_count - duplicate_count;
+  ctx->queue = queue;
+  workerPoolRunUnordered(thread_count, original_count, locateSourceJob,
+                         ctx);
+
+  for(size_t index = original_count; index < ctx->file_count; index++)
+  {
+    const FileToRestore *source = queue[index]->clone_source;
+    queue[index]->source_inode = source->source_inode;
+    queue[index]->source_physical_offset = source->source_physical_offset;
+    queue[index]->has_source_physical_offset =
+      source->has_source_physical_offset;
+  }
+
+  qsort(queue, original_count, sizeof(*queue), compareSourceLocation);
+  qsort(&queue[original_count], duplicate_count, sizeof(*queue),
+        compareSourceLocation);
+}
+
+/** Completes the restoring of a path. The tree gets traversed first,
+  which creates directories and symlinks and removes replaced paths. The
+  content of regular files gets restored afterwards in parallel, followed
+  by the timestamps of their parent directories. Files with the same
+  content share their data if the filesystem supports it. The repository
+  gets read in the physical order of its files.
 
   @param metadata Metadata initiated via initiateRestore().
   @param id The same id which was passed to initiateRestore().
@@ -462,9 +1089,44 @@ static bool finishRestoreRecursively(const PathNode *node, const size_t id,
 void finishRestore(const Metadata *metadata, const size_t id,
                    StringView repo_path)
 {
+  Allocator *path_buffer = allocatorWrapOneSingleGrowableBuffer(metadata->r);
+  CR_Region *disposable_r = CR_RegionNew();
+  CR_RegionSetTag(disposable_r, "restore");
+  Allocator *disposable_a = allocatorWrapRegion(disposable_r);
+  RestoreContext ctx = {
+    .repo_path = strCopy(repo_path, disposable_a),
+    .a = disposable_a,
+    .files = CR_RegionAllocGrowable(disposable_r, sizeof(*ctx.files)),
+    .file_count = 0,
+    .directories =
+      CR_RegionAllocGrowable(disposable_r, sizeof(*ctx.directories)),
+    .directory_count = 0,
+  };
+
   for(const PathNode *node = metadata->paths; node != NULL;
       node = node->next)
   {
-    finishRestoreRecursively(node, id, repo_path);
+    finishRestoreRecursively(&ctx, node, id, path_buffer);
+  }
+
+  /* Files sharing their content with another file are restored after
+     all other files, to ensure that their clone source is complete. */
+  size_t duplicate_count;
+  FileToRestore **queue = planClones(disposable_r, &ctx, &duplicate_count);
+  const size_t thread_count = workerPoolDefaultSize();
+  sortBySourceLocation(&ctx, queue, thread_count, duplicate_count);
+
+  ctx.queue = queue;
+  workerPoolRun(thread_count, ctx.file_count - duplicate_count,
+                restoreFileJob, &ctx);
+  ctx.queue = &queue[ctx.file_count - duplicate_count];
+  workerPoolRun(thread_count, duplicate_count, restoreFileJob, &ctx);
+
+  for(size_t index = 0; index < ctx.directory_count; index++)
+  {
+    sUtime(ctx.directories[index].path,
+           ctx.directories[index].modification_time);
   }
+
+  CR_RegionRelease(disposable_r);
 }
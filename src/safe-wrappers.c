@@ -10,26 +10,31 @@
 #include <unistd.h>
 #include <utime.h>
 
-#include "CRegion/global-region.h"
+#ifdef __linux__
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+#include "CRegion/alloc-growable.h"
+
 #include "allocator.h"
 #include "error-handling.h"
 #include "safe-math.h"
+#include "thread-local.h"
+#include "trace.h"
 
-/** Returns a single reusable buffer allocator. Each allocation trough this
-  allocator will invalidate all previously allocated memory from it.
+/** Returns a single reusable buffer allocator, which belongs to the
+  calling thread. Each allocation trough this allocator will invalidate all
+  previously allocated memory from it.
 
   @param secondary True if the second slot should be used. Needed for
   allocating two temporary helper buffers.
 */
 static Allocator *getTemporaryBuffer(const bool secondary)
 {
-  static Allocator *buffer[2] = { NULL, NULL };
-  if(buffer[secondary] == NULL)
-  {
-    buffer[secondary] =
-      allocatorWrapOneSingleGrowableBuffer(CR_GetGlobalRegion());
-  }
-  return buffer[secondary];
+  return threadLocalAllocator(secondary ? TA_temporary_secondary
+                                        : TA_temporary);
 }
 
 /** Return a _temporary_ null-terminated version of the given string.
@@ -61,6 +66,7 @@ static struct stat safeStat(StringView path,
                             int (*stat_fun)(const char *, struct stat *))
 {
   struct stat buffer;
+  traceCount(TR_files_stated, 1);
   if(stat_fun(nullTerminate(path), &buffer) == -1)
   {
     dieErrno("failed to access \"" PRI_STR "\"", STR_FMT(path));
@@ -91,22 +97,28 @@ void sAtexit(void (*function)(void))
   }
 }
 
+/** The size of the buffer used by each FileStream. */
+#define FILE_STREAM_BUFFER_SIZE ((size_t)BUFSIZ)
+
+/** FileStreams and DirIterators are never released. Closed ones get
+  reused by the thread which closed them, together with their buffers.
+  They belong to the calling threads region, which closes them on program
+  exit or when the thread exits. */
 struct FileStream
 {
-  CR_Region *r;
   StringView path; /**< Used for error printing. */
   FILE *handle;
-};
 
-static FileStream *newFileStream(StringView path)
-{
-  CR_Region *r = CR_RegionNew();
+  /** Holds the content of `path`. */
+  char *path_buffer;
+
+  /** The buffer of `handle`. */
+  char *io_buffer;
+
+  /** The next closed stream of the owning thread. */
+  FileStream *next_unused;
+};
 
-  FileStream *stream = CR_RegionAlloc(r, sizeof *stream);
-  stream->r = r;
-  strSet(&stream->path, strCopy(path, allocatorWrapRegion(r)));
-  return stream;
-}
 static void closeFileHandle(void *data)
 {
   FileStream *stream = data;
@@ -117,6 +129,74 @@ static void closeFileHandle(void *data)
   errno = old_errno;
 }
 
+/** Copies the given path into the given growable buffer.
+
+  @return A null-terminated string which uses the given buffer.
+*/
+static StringView copyPath(StringView path, char **buffer)
+{
+  *buffer = CR_EnsureCapacity(*buffer, sSizeAdd(path.length, 1));
+  memcpy(*buffer, path.content, path.length);
+  (*buffer)[path.length] = '\0';
+
+  return strUnterminated(*buffer, path.length);
+}
+
+/** Returns a closed stream, which will be reused if possible. */
+static FileStream *newFileStream(StringView path)
+{
+  void **unused_streams = threadLocalList(TL_file_streams);
+  FileStream *stream = *unused_streams;
+  if(stream != NULL)
+  {
+    *unused_streams = stream->next_unused;
+  }
+  else
+  {
+    CR_Region *r = threadLocalRegion();
+    stream = CR_RegionAlloc(r, sizeof *stream);
+    stream->handle = NULL;
+    stream->path_buffer = CR_RegionAllocGrowable(r, 1);
+    stream->io_buffer = CR_RegionAlloc(r, FILE_STREAM_BUFFER_SIZE);
+    CR_RegionAttach(r, closeFileHandle, stream);
+  }
+
+  strSet(&stream->path, copyPath(path, &stream->path_buffer));
+  return stream;
+}
+
+/** Closes the given stream without checking for errors and makes it
+  available for reuse. Does not modify errno. */
+static void recycleFileStream(FileStream *stream)
+{
+  closeFileHandle(stream);
+  stream->handle = NULL;
+
+  void **unused_streams = threadLocalList(TL_file_streams);
+  stream->next_unused = *unused_streams;
+  *unused_streams = stream;
+}
+
+/** Opens the given stream with the given mode.
+
+  @return False if fopen() failed.
+*/
+static bool openFileStream(FileStream *stream, const char *mode)
+{
+  stream->handle = fopen(stream->path.content, mode);
+  if(stream->handle == NULL)
+  {
+    recycleFileStream(stream);
+    return false;
+  }
+
+  /* Failing to set the buffer is harmless and leaves stdio's own buffer
+     in place. */
+  (void)setvbuf(stream->handle, stream->io_buffer, _IOFBF,
+                FILE_STREAM_BUFFER_SIZE);
+  return true;
+}
+
 /** Safe wrapper around fopen().
 
   @param path The path to the file which should be opened for reading.
@@ -127,13 +207,10 @@ static void closeFileHandle(void *data)
 FileStream *sFopenRead(StringView path)
 {
   FileStream *result = newFileStream(path);
-  result->handle = fopen(nullTerminate(path), "rb");
-  if(result->handle == NULL)
+  if(!openFileStream(result, "rb"))
   {
-    CR_RegionRelease(result->r);
     dieErrno("failed to open \"" PRI_STR "\" for reading", STR_FMT(path));
   }
-  CR_RegionAttach(result->r, closeFileHandle, result);
 
   return result;
 }
@@ -143,13 +220,10 @@ FileStream *sFopenRead(StringView path)
 FileStream *sFopenWrite(StringView path)
 {
   FileStream *result = newFileStream(path);
-  result->handle = fopen(nullTerminate(path), "wb");
-  if(result->handle == NULL)
+  if(!openFileStream(result, "wb"))
   {
-    CR_RegionRelease(result->r);
     dieErrno("failed to open \"" PRI_STR "\" for writing", STR_FMT(path));
   }
-  CR_RegionAttach(result->r, closeFileHandle, result);
 
   return result;
 }
@@ -158,7 +232,7 @@ FileStream *sFopenWrite(StringView path)
 static const char *internalFDestroy(FileStream *stream)
 {
   char *result = strCopyRaw(stream->path, getTemporaryBuffer(false));
-  CR_RegionRelease(stream->r);
+  recycleFileStream(stream);
   return result;
 }
 
@@ -216,6 +290,7 @@ bool fWrite(const void *ptr, const size_t size, FileStream *stream)
 bool fTodisk(FileStream *stream)
 {
   const int descriptor = fileno(stream->handle);
+  traceCount(TR_fsync_calls, 1);
 
   return descriptor != -1 && fflush(stream->handle) == 0 &&
     fdatasync(descriptor) == 0;
@@ -224,6 +299,7 @@ bool fTodisk(FileStream *stream)
 void fDatasync(StringView path)
 {
   const int dir_descriptor = open(nullTerminate(path), O_RDONLY, 0);
+  traceCount(TR_fsync_calls, 1);
   if(dir_descriptor == -1 || fdatasync(dir_descriptor) != 0 ||
      close(dir_descriptor) != 0)
   {
@@ -257,10 +333,16 @@ void fDestroy(FileStream *stream)
 
 struct DirIterator
 {
-  CR_Region *r;
   StringView directory_path;
+
+  /** Holds the content of `directory_path`. */
+  char *path_buffer;
+
   Allocator *returned_result_buffer;
   DIR *handle;
+
+  /** The next closed iterator of the owning thread. */
+  DirIterator *next_unused;
 };
 void closeDirHandle(void *data)
 {
@@ -272,23 +354,42 @@ void closeDirHandle(void *data)
   errno = old_errno;
 }
 
+/** Makes the given closed iterator available for reuse. */
+static void recycleDirIterator(DirIterator *dir)
+{
+  void **unused_iterators = threadLocalList(TL_dir_iterators);
+  dir->next_unused = *unused_iterators;
+  *unused_iterators = dir;
+}
+
 /** @return Must be freed with sDirClose(). */
 DirIterator *sDirOpen(StringView path)
 {
-  CR_Region *r = CR_RegionNew();
-  DirIterator *dir = CR_RegionAlloc(r, sizeof *dir);
+  void **unused_iterators = threadLocalList(TL_dir_iterators);
+  DirIterator *dir = *unused_iterators;
+  if(dir != NULL)
+  {
+    *unused_iterators = dir->next_unused;
+  }
+  else
+  {
+    CR_Region *r = threadLocalRegion();
+    dir = CR_RegionAlloc(r, sizeof *dir);
+    dir->path_buffer = CR_RegionAllocGrowable(r, 1);
+    dir->returned_result_buffer = allocatorWrapOneSingleGrowableBuffer(r);
+    dir->handle = NULL;
+    CR_RegionAttach(r, closeDirHandle, dir);
+  }
 
-  dir->r = r;
-  strSet(&dir->directory_path, strCopy(path, allocatorWrapRegion(r)));
-  dir->returned_result_buffer = allocatorWrapOneSingleGrowableBuffer(r);
-  dir->handle = opendir(nullTerminate(path));
+  strSet(&dir->directory_path, copyPath(path, &dir->path_buffer));
+  dir->handle = opendir(dir->directory_path.content);
+  traceCount(TR_directories_read, 1);
 
   if(dir->handle == NULL)
   {
-    CR_RegionRelease(r);
+    recycleDirIterator(dir);
     dieErrno("failed to open directory \"" PRI_STR "\"", STR_FMT(path));
   }
-  CR_RegionAttach(r, closeDirHandle, dir);
 
   return dir;
 }
@@ -335,7 +436,7 @@ void sDirClose(DirIterator *dir)
     dieErrno("failed to close directory \"" PRI_STR "\"",
              STR_FMT(dir->directory_path));
   }
-  CR_RegionRelease(dir->r);
+  recycleDirIterator(dir);
 }
 
 /** Checks if there are unread bytes left in the given stream.
@@ -367,6 +468,139 @@ bool sFbytesLeft(FileStream *stream)
   return character != EOF;
 }
 
+/** Opens the given file for reading without creating a FileStream.
+
+  @param path The path to the file.
+
+  @return A file descriptor which must be closed by the caller.
+*/
+int sOpenRead(StringView path)
+{
+  const int descriptor = open(nullTerminate(path), O_RDONLY);
+  if(descriptor == -1)
+  {
+    dieErrno("failed to open \"" PRI_STR "\" for reading", STR_FMT(path));
+  }
+
+  return descriptor;
+}
+
+/** Looks up the physical location of the first byte of the given file,
+  using FIEMAP on Linux. Sorting files by this value allows reading them
+  sequentially from rotational disks. Inode numbers are only an
+  approximation of this order.
+
+  @param descriptor The file to look up.
+  @param offset_out Will contain the offset of the files first byte on
+  its device. Only defined if this function returns true.
+
+  @return False if the offset is unknown, e.g. because the file is empty,
+  its data was not written yet or the system doesn't support looking it
+  up. Does not modify errno.
+*/
+bool fPhysicalOffset(const int descriptor, uint64_t *offset_out)
+{
+#ifdef FS_IOC_FIEMAP
+  union
+  {
+    struct fiemap map;
+    char buffer[sizeof(struct fiemap) + sizeof(struct fiemap_extent)];
+  } request;
+  memset(&request, 0, sizeof(request));
+  request.map.fm_start = 0;
+  request.map.fm_length = FIEMAP_MAX_OFFSET;
+  request.map.fm_extent_count = 1;
+
+  const int old_errno = errno;
+  const bool success = ioctl(descriptor, FS_IOC_FIEMAP, &request) == 0;
+  errno = old_errno;
+
+  const struct fiemap_extent *extent = &request.map.fm_extents[0];
+  if(success && request.map.fm_mapped_extents > 0 &&
+     (extent->fe_flags & (FIEMAP_EXTENT_UNKNOWN |
+                          FIEMAP_EXTENT_DATA_INLINE)) == 0)
+  {
+    *offset_out = extent->fe_physical;
+    return true;
+  }
+#else
+  (void)descriptor;
+  (void)offset_out;
+#endif
+
+  return false;
+}
+
+/** Closes the given file descriptor without checking for errors. Does
+  not modify errno. */
+static void closeDescriptor(const int descriptor)
+{
+  const int old_errno = errno;
+  (void)close(descriptor);
+  errno = old_errno;
+}
+
+/** Reads a file of known size into the given buffer using only its file
+  descriptor. This avoids the overhead of creating a FileStream, which
+  dominates when reading small files, and reads files of any size with as
+  few calls as possible. Terminates the program on errors or if the file
+  contains less than the given amount of bytes.
+
+  @param path The path to the file.
+  @param buffer The location to which the content will be written.
+  @param size The expected size of the file.
+
+  @return False if the file contains more than the given amount of bytes.
+*/
+bool sReadFileExactly(StringView path, void *buffer, const size_t size)
+{
+  const int descriptor = sOpenRead(path);
+
+  unsigned char *data = buffer;
+  size_t bytes_read = 0;
+  while(bytes_read < size)
+  {
+    const ssize_t result =
+      read(descriptor, &data[bytes_read], size - bytes_read);
+    if(result > 0)
+    {
+      bytes_read += (size_t)result;
+    }
+    else if(result == 0)
+    {
+      closeDescriptor(descriptor);
+      die("reading \"" PRI_STR "\": reached end of file unexpectedly",
+          STR_FMT(path));
+    }
+    else if(errno != EINTR)
+    {
+      closeDescriptor(descriptor);
+      dieErrno("IO error while reading \"" PRI_STR "\"", STR_FMT(path));
+    }
+  }
+
+  /* The end of the file is reached if another read returns nothing. */
+  unsigned char extra_byte;
+  ssize_t result;
+  do
+  {
+    result = read(descriptor, &extra_byte, 1);
+  } while(result == -1 && errno == EINTR);
+
+  if(result == -1)
+  {
+    closeDescriptor(descriptor);
+    dieErrno("failed to check for remaining bytes in \"" PRI_STR "\"",
+             STR_FMT(path));
+  }
+  else if(close(descriptor) != 0)
+  {
+    dieErrno("failed to close \"" PRI_STR "\"", STR_FMT(path));
+  }
+
+  return result == 0;
+}
+
 /** Returns true if the given filepath exists and terminates the program
   on any unexpected errors.
 
@@ -380,6 +614,7 @@ bool sPathExists(StringView path)
   bool exists = true;
   struct stat stats;
   errno = 0;
+  traceCount(TR_files_stated, 1);
 
   if(lstat(nullTerminate(path), &stats) != 0)
   {
@@ -528,6 +763,31 @@ void sRemove(StringView path)
   errno = old_errno;
 }
 
+/** Removes the given directory if it is empty.
+
+  @param path The path to an existing directory.
+
+  @return True if the directory was removed, false if it was not empty.
+*/
+bool sRemoveIfEmpty(StringView path)
+{
+  const int old_errno = errno;
+  if(rmdir(nullTerminate(path)) != 0)
+  {
+    if(errno != ENOTEMPTY && errno != EEXIST)
+    {
+      dieErrno("failed to remove directory \"" PRI_STR "\"",
+               STR_FMT(path));
+    }
+
+    errno = old_errno;
+    return false;
+  }
+
+  errno = old_errno;
+  return true;
+}
+
 bool alwaysReturnTrue(StringView path, const struct stat *stats,
                       void *user_data)
 {
@@ -779,13 +1039,8 @@ FileContent sGetFilesContent(CR_Region *region, StringView path)
 
   if(file_stats.st_size > 0)
   {
-    FileStream *stream = sFopenRead(path);
     char *content = CR_RegionAllocUnaligned(region, file_stats.st_size);
-    sFread(content, file_stats.st_size, stream);
-    const bool stream_not_at_end = sFbytesLeft(stream);
-    sFclose(stream);
-
-    if(stream_not_at_end)
+    if(!sReadFileExactly(path, content, file_stats.st_size))
     {
       die("file changed while reading: \"" PRI_STR "\"", STR_FMT(path));
     }
@@ -834,5 +1089,6 @@ const regex_t *sRegexCompile(CR_Region *r, StringView expression,
 
 bool sRegexIsMatching(const regex_t *regex, StringView string)
 {
+  traceCount(TR_regex_evaluations, 1);
   return regexec(regex, nullTerminate(string), 0, NULL, 0) == 0;
 }
@@ -20,7 +20,8 @@ extern void *sMalloc(size_t size);
 extern void sAtexit(void (*function)(void));
 
 /** An opaque wrapper around FILE, which stores additional informations for
-  printing better error messages. */
+  printing better error messages. Must be closed by the thread which
+  opened it. */
 typedef struct FileStream FileStream;
 
 extern FileStream *sFopenRead(StringView path);
@@ -31,9 +32,14 @@ extern bool fWrite(const void *ptr, size_t size, FileStream *stream);
 extern bool fTodisk(FileStream *stream);
 extern void fDatasync(StringView path);
 extern bool sFbytesLeft(FileStream *stream);
+extern int sOpenRead(StringView path);
+extern bool fPhysicalOffset(int descriptor, uint64_t *offset_out);
+extern bool sReadFileExactly(StringView path, void *buffer, size_t size);
 extern void sFclose(FileStream *stream);
 extern void fDestroy(FileStream *stream);
 
+/** An opaque wrapper around DIR. Must be closed by the thread which
+  opened it. */
 typedef struct DirIterator DirIterator;
 extern DirIterator *sDirOpen(StringView path);
 extern StringView sDirGetNext(DirIterator *dir);
@@ -51,6 +57,7 @@ extern void sChown(StringView path, uid_t user, gid_t group);
 extern void sLChown(StringView path, uid_t user, gid_t group);
 extern void sUtime(StringView path, time_t time);
 extern void sRemove(StringView path);
+extern bool sRemoveIfEmpty(StringView path);
 extern void sRemoveRecursively(StringView path);
 
 typedef bool ShouldRemoveCallback(StringView path,
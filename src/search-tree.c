@@ -157,6 +157,7 @@ SearchNode *searchTreeParse(CR_Region *r, StringView config)
 
   /* This table maps paths to existing nodes, without a trailing slash. */
   CR_Region *existing_nodes_region = CR_RegionNew();
+  CR_RegionSetTag(existing_nodes_region, "config parsing");
   StringTable *existing_nodes = strTableNew(existing_nodes_region);
 
   /* Associate an empty string with the root node. */
@@ -291,6 +292,7 @@ SearchNode *searchTreeParse(CR_Region *r, StringView config)
 SearchNode *searchTreeLoad(CR_Region *r, StringView path_to_config)
 {
   CR_Region *disposable_r = CR_RegionNew();
+  CR_RegionSetTag(disposable_r, "config parsing");
   const FileContent content =
     sGetFilesContent(disposable_r, path_to_config);
   StringView config = strUnterminated(content.content, content.size);
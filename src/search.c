@@ -352,6 +352,7 @@ static SearchResult finishCurrentNode(SearchIterator *iterator)
 SearchIterator *searchNew(SearchNode *root_node)
 {
   CR_Region *r = CR_RegionNew();
+  CR_RegionSetTag(r, "SearchIterator");
 
   SearchIterator *iterator = CR_RegionAlloc(r, sizeof *iterator);
   iterator->r = r;
@@ -0,0 +1,174 @@
+#include "shared-region.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "error-handling.h"
+#include "safe-math.h"
+#include "thread-local.h"
+#include "worker-pool.h"
+
+/** The amount of independently locked shards. Threads get distributed
+  over them by their thread-local id. */
+#define SHARD_COUNT 16
+
+/** The size of the chunks from which small allocations are served. */
+#define CHUNK_SIZE ((size_t)64 * 1024)
+
+/** Allocations larger than this get their own chunk. */
+#define MAX_SMALL_ALLOCATION_SIZE (CHUNK_SIZE / 8)
+
+/** The header of each chunk allocated with malloc(). Its size keeps the
+  memory behind it aligned like CR_RegionAlloc(). */
+typedef union Chunk Chunk;
+union Chunk
+{
+  Chunk *next;
+  uint64_t alignment;
+};
+
+typedef struct
+{
+  /** Protects all other members of this shard. */
+  pthread_mutex_t mutex;
+
+  /** All chunks of this shard. The first one is the current chunk. */
+  Chunk *chunks;
+
+  /** Unused bytes at the end of the current chunk. */
+  unsigned char *free_bytes;
+  size_t free_byte_count;
+} Shard;
+
+struct SharedRegion
+{
+  Shard shards[SHARD_COUNT];
+
+  /** Allocation statistics are recorded in this region. */
+  CR_Region *r;
+};
+
+/** Frees all chunks of the given shared region and destroys its locks. */
+static void releaseSharedRegion(void *data)
+{
+  SharedRegion *shared = data;
+  for(size_t index = 0; index < SHARD_COUNT; index++)
+  {
+    Shard *shard = &shared->shards[index];
+    for(Chunk *chunk = shard->chunks; chunk != NULL;)
+    {
+      Chunk *next = chunk->next;
+      free(chunk);
+      chunk = next;
+    }
+    pthread_mutex_destroy(&shard->mutex);
+  }
+}
+
+/** Creates a new shared region.
+
+  @param r The region to which the lifetime of the shared region and all
+  its allocations will be bound.
+
+  @return A shared region which can be used by any amount of threads at
+  the same time, until the given region gets released.
+*/
+SharedRegion *sharedRegionNew(CR_Region *r)
+{
+  SharedRegion *shared = CR_RegionAlloc(r, sizeof(*shared));
+  shared->r = r;
+
+  for(size_t index = 0; index < SHARD_COUNT; index++)
+  {
+    Shard *shard = &shared->shards[index];
+    const int error = pthread_mutex_init(&shard->mutex, NULL);
+    if(error != 0)
+    {
+      while(index > 0)
+      {
+        index--;
+        pthread_mutex_destroy(&shared->shards[index].mutex);
+      }
+      errno = error;
+      dieErrno("failed to initialize mutex");
+    }
+
+    shard->chunks = NULL;
+    shard->free_bytes = NULL;
+    shard->free_byte_count = 0;
+  }
+
+  CR_RegionAttach(r, releaseSharedRegion, shared);
+  return shared;
+}
+
+/** Allocates a chunk which can hold the given amount of bytes. Terminates
+  the program on failure, so it must not be called while holding the lock
+  of a shard. */
+static Chunk *newChunk(SharedRegion *shared, const size_t size)
+{
+  const size_t chunk_size = sSizeAdd(sizeof(Chunk), size);
+  Chunk *chunk = malloc(chunk_size);
+  if(chunk == NULL)
+  {
+    dieErrno("failed to allocate %zu bytes", chunk_size);
+  }
+  CR_RegionAccount(shared->r, 0, chunk_size);
+
+  return chunk;
+}
+
+/** Allocates memory from the given shared region. Can be called by
+  multiple threads at the same time. The returned memory is aligned like
+  memory returned by CR_RegionAlloc().
+
+  @param shared The shared region to allocate from.
+  @param size The amount of bytes to allocate. Must be greater than 0.
+
+  @return Uninitialized memory which will be released together with the
+  region of the given shared region. Will never be NULL.
+*/
+void *sharedRegionAlloc(SharedRegion *shared, const size_t size)
+{
+  if(size == 0)
+  {
+    die("unable to allocate 0 bytes");
+  }
+  CR_RegionAccount(shared->r, size, 0);
+
+  Shard *shard = &shared->shards[threadLocalId() % SHARD_COUNT];
+  if(size > MAX_SMALL_ALLOCATION_SIZE)
+  {
+    Chunk *chunk = newChunk(shared, size);
+    workerPoolLockMutex(&shard->mutex);
+    chunk->next = shard->chunks;
+    shard->chunks = chunk;
+    workerPoolUnlockMutex(&shard->mutex);
+
+    return chunk + 1;
+  }
+
+  const size_t padded_size = size + (8 - size % 8) % 8;
+  workerPoolLockMutex(&shard->mutex);
+  if(padded_size > shard->free_byte_count)
+  {
+    workerPoolUnlockMutex(&shard->mutex);
+    Chunk *chunk = newChunk(shared, CHUNK_SIZE);
+    workerPoolLockMutex(&shard->mutex);
+
+    /* The rest of the current chunk gets abandoned. */
+    chunk->next = shard->chunks;
+    shard->chunks = chunk;
+    shard->free_bytes = (unsigned char *)(chunk + 1);
+    shard->free_byte_count = CHUNK_SIZE;
+  }
+
+  void *data = shard->free_bytes;
+  shard->free_bytes += padded_size;
+  shard->free_byte_count -= padded_size;
+  workerPoolUnlockMutex(&shard->mutex);
+
+  return data;
+}
@@ -0,0 +1,15 @@
+#ifndef NANO_BACKUP_SRC_SHARED_REGION_H
+#define NANO_BACKUP_SRC_SHARED_REGION_H
+
+#include <stddef.h>
+
+#include "CRegion/region.h"
+
+/** An opaque struct for allocating memory from multiple threads at the
+  same time. The lifetime of all memory is bound to a region. */
+typedef struct SharedRegion SharedRegion;
+
+extern SharedRegion *sharedRegionNew(CR_Region *r);
+extern void *sharedRegionAlloc(SharedRegion *shared, size_t size);
+
+#endif
@@ -1,71 +1,38 @@
 #include "string-table.h"
 
-#include <stdint.h>
-#include <stdlib.h>
 #include <string.h>
 
-#include "SipHash/siphash.h"
+#include "hash-table.h"
 
-#include "safe-math.h"
-#include "safe-wrappers.h"
-
-/** Bucket for storing colliding keys. */
-typedef struct Bucket Bucket;
-struct Bucket
+/** Slot in the flat array of a string table. */
+typedef struct
 {
-  /** Hash of the key. Required to resize the string table. */
+  /** Hash of the key. Lookups compare this value before comparing the
+    keys. */
   uint64_t hash;
 
-  StringView key;
+  const char *key;
+  size_t key_length;
   void *data;
-
-  Bucket *next;
-};
+} Slot;
 
 struct StringTable
 {
-  CR_Region *region;
-  Bucket **buckets;
-  size_t capacity;     /**< The amount of buckets in the String table. */
-  size_t associations; /**< The amount of associations in the table. */
-  uint8_t secret_key[16]; /**< Secret key for SipHash. */
+  HashTable table;
 };
 
-/** Double the capacity of the given table and move all buckets to their
-  new destination. */
-static void doubleTableCapacity(StringTable *table)
+static uint64_t hashKey(const StringTable *table, StringView key)
 {
-  const size_t new_capacity = sSizeMul(table->capacity, 2);
-  const size_t new_array_size =
-    sSizeMul(new_capacity, sizeof(*table->buckets));
-
-  Bucket **new_buckets = sMalloc(new_array_size);
-  memset(new_buckets, 0, new_array_size);
-
-  /* Copy all associations into their new location. */
-  for(size_t index = 0; index < table->capacity; index++)
-  {
-    Bucket *bucket = table->buckets[index];
-    while(bucket)
-    {
-      Bucket *bucket_to_move = bucket;
-      bucket = bucket->next;
-
-      const size_t new_bucket_id = bucket_to_move->hash % new_capacity;
-      bucket_to_move->next = new_buckets[new_bucket_id];
-      new_buckets[new_bucket_id] = bucket_to_move;
-    }
-  }
-
-  free(table->buckets);
-  table->buckets = new_buckets;
-  table->capacity = new_capacity;
+  return hashTableHash(&table->table, 0, key.content, key.length);
 }
 
-static void releaseStringTable(void *data)
+static bool slotMatches(const void *slot, const void *key)
 {
-  StringTable *table = data;
-  free(table->buckets);
+  const Slot *string_slot = slot;
+  const StringView *string = key;
+
+  return string_slot->key_length == string->length &&
+    memcmp(string_slot->key, string->content, string->length) == 0;
 }
 
 /** Creates a dynamically growing table for mapping strings to arbitrary
@@ -76,23 +43,22 @@ static void releaseStringTable(void *data)
   @return Table which lifetime will be bound to the given region.
 */
 StringTable *strTableNew(CR_Region *region)
+{
+  return strTableNewWithCapacity(region, 0);
+}
+
+/** Like strTableNew(), but preallocates enough slots to store the given
+  amount of associations without having to grow.
+
+  @param expected_associations The amount of associations which the table
+  is expected to contain. Can be 0.
+*/
+StringTable *strTableNewWithCapacity(CR_Region *region,
+                                     const size_t expected_associations)
 {
   StringTable *table = CR_RegionAlloc(region, sizeof(*table));
-  table->region = region;
-  table->associations = 0;
-  table->capacity = 32; /* A small initial value allows the test suite to
-                           cover table resizing. */
-
-  for(size_t index = 0; index < sizeof(table->secret_key); index++)
-  {
-    table->secret_key[index] = sRand() % UINT8_MAX;
-  }
-
-  const size_t array_size =
-    sSizeMul(table->capacity, sizeof(*table->buckets));
-  table->buckets = sMalloc(array_size);
-  CR_RegionAttach(table->region, releaseStringTable, table);
-  memset(table->buckets, 0, array_size);
+  hashTableInit(&table->table, region, sizeof(Slot),
+                expected_associations);
 
   return table;
 }
@@ -111,23 +77,13 @@ StringTable *strTableNew(CR_Region *region)
 */
 void strTableMap(StringTable *table, StringView key, void *data)
 {
-  if(table->associations == table->capacity)
-  {
-    doubleTableCapacity(table);
-  }
-
-  Bucket *bucket = CR_RegionAlloc(table->region, sizeof(*bucket));
-  bucket->hash =
-    siphash((const uint8_t *)key.content, key.length, table->secret_key);
-  strSet(&bucket->key, key);
-  bucket->data = data;
-
-  /* Prepend the bucket to the bucket slot in the bucket array. */
-  const size_t bucket_id = bucket->hash % table->capacity;
-  bucket->next = table->buckets[bucket_id];
-  table->buckets[bucket_id] = bucket;
-
-  table->associations++;
+  const Slot slot = {
+    .hash = hashKey(table, key),
+    .key = key.content,
+    .key_length = key.length,
+    .data = data,
+  };
+  hashTableInsert(&table->table, &slot);
 }
 
 /** Returns the value associated with the given key.
@@ -139,24 +95,14 @@ void strTableMap(StringTable *table, StringView key, void *data)
 */
 void *strTableGet(const StringTable *table, StringView key)
 {
-  const size_t hash =
-    siphash((const uint8_t *)key.content, key.length, table->secret_key);
-  const size_t bucket_id = hash % table->capacity;
-
-  for(const Bucket *bucket = table->buckets[bucket_id]; bucket != NULL;
-      bucket = bucket->next)
-  {
-    if(strIsEqual(key, bucket->key))
-    {
-      return bucket->data;
-    }
-  }
-
-  return NULL;
+  const Slot *slot = hashTableFind(&table->table, hashKey(table, key),
+                                   slotMatches, &key);
+
+  return slot == NULL ? NULL : slot->data;
 }
 
 /** @return Count of all associations inside the given table. */
 size_t strTableCountMappings(const StringTable *table)
 {
-  return table->associations;
+  return table->table.count;
 }
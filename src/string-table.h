@@ -9,6 +9,8 @@
 typedef struct StringTable StringTable;
 
 extern StringTable *strTableNew(CR_Region *region);
+extern StringTable *strTableNewWithCapacity(CR_Region *region,
+                                            size_t expected_associations);
 extern void strTableMap(StringTable *table, StringView key, void *data);
 extern void *strTableGet(const StringTable *table, StringView key);
 extern size_t strTableCountMappings(const StringTable *table);
@@ -0,0 +1,173 @@
+#include "thread-local.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "CRegion/alloc-growable.h"
+
+#include "error-handling.h"
+#include "worker-pool.h"
+
+/** Memory owned by a single thread. */
+typedef struct
+{
+  /** The region owning this struct and all buffers. Gets released when
+    the thread exits. */
+  CR_Region *r;
+
+  size_t id;
+  void *buffers[TB_count];
+  Allocator *allocators[TA_count];
+  void *lists[TL_count];
+} ThreadMemory;
+
+static pthread_key_t memory_key;
+static pthread_once_t memory_key_once = PTHREAD_ONCE_INIT;
+static int memory_key_error = 0;
+
+/** The id of the next thread which accesses its memory. */
+static size_t next_id = 0;
+static pthread_mutex_t id_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Called when a thread exits. */
+static void releaseMemory(void *data)
+{
+  ThreadMemory *memory = data;
+  CR_RegionRelease(memory->r);
+}
+
+static void createKey(void)
+{
+  memory_key_error = pthread_key_create(&memory_key, releaseMemory);
+}
+
+/** Detaches the memory from the calling thread. Gets attached to the
+  memory's region, which will be released by CRegion's atexit() handler
+  on the main thread. Ensures that the released memory will not be reused
+  by the remaining handlers. */
+static void forgetMemory(void *data)
+{
+  (void)data;
+  (void)pthread_setspecific(memory_key, NULL);
+}
+
+static size_t claimId(void)
+{
+  workerPoolLockMutex(&id_mutex);
+  const size_t id = next_id;
+  next_id++;
+  workerPoolUnlockMutex(&id_mutex);
+
+  return id;
+}
+
+/** Returns the memory of the calling thread, which will be created if it
+  doesn't exist. */
+static ThreadMemory *getMemory(void)
+{
+  if(pthread_once(&memory_key_once, createKey) != 0 ||
+     memory_key_error != 0)
+  {
+    errno = memory_key_error;
+    dieErrno("failed to create key for thread-local memory");
+  }
+
+  ThreadMemory *memory = pthread_getspecific(memory_key);
+  if(memory != NULL)
+  {
+    return memory;
+  }
+
+  CR_Region *r = CR_RegionNew();
+  CR_RegionSetTag(r, "thread-local");
+  CR_RegionAttach(r, forgetMemory, NULL);
+
+  memory = CR_RegionAlloc(r, sizeof(*memory));
+  memory->r = r;
+  memory->id = claimId();
+  for(size_t index = 0; index < TB_count; index++)
+  {
+    memory->buffers[index] = NULL;
+  }
+  for(size_t index = 0; index < TA_count; index++)
+  {
+    memory->allocators[index] = NULL;
+  }
+  for(size_t index = 0; index < TL_count; index++)
+  {
+    memory->lists[index] = NULL;
+  }
+
+  const int error = pthread_setspecific(memory_key, memory);
+  if(error != 0)
+  {
+    CR_RegionRelease(r);
+    errno = error;
+    dieErrno("failed to store thread-local memory");
+  }
+
+  return memory;
+}
+
+/** Returns a region which belongs to the calling thread. It will be
+  released when the thread exits, or at program exit for the main
+  thread. */
+CR_Region *threadLocalRegion(void)
+{
+  return getMemory()->r;
+}
+
+/** Returns the given buffer of the calling thread. Its content will be
+  preserved if it has to grow.
+
+  @param buffer The buffer to return.
+  @param capacity The minimal capacity of the returned buffer. Must be
+  greater than 0.
+
+  @return A buffer which is only valid until the next call to this
+  function with the same buffer, or until the thread exits.
+*/
+void *threadLocalBuffer(const ThreadBuffer buffer, const size_t capacity)
+{
+  ThreadMemory *memory = getMemory();
+  memory->buffers[buffer] = memory->buffers[buffer] == NULL
+    ? CR_RegionAllocGrowable(memory->r, capacity)
+    : CR_EnsureCapacity(memory->buffers[buffer], capacity);
+
+  return memory->buffers[buffer];
+}
+
+/** Returns the given allocator of the calling thread.
+
+  @see allocatorWrapOneSingleGrowableBuffer()
+*/
+Allocator *threadLocalAllocator(const ThreadAllocator allocator)
+{
+  ThreadMemory *memory = getMemory();
+  if(memory->allocators[allocator] == NULL)
+  {
+    memory->allocators[allocator] =
+      allocatorWrapOneSingleGrowableBuffer(memory->r);
+  }
+
+  return memory->allocators[allocator];
+}
+
+/** Returns the head of the given list of the calling thread.
+
+  @return A pointer to the first element of the list, which is NULL if
+  the list is empty. Can be modified by the caller.
+*/
+void **threadLocalList(const ThreadList list)
+{
+  return &getMemory()->lists[list];
+}
+
+/** Returns a small number which is unique to the calling thread. Ids get
+  assigned in the order in which threads call this function for the first
+  time and will not be reused. */
+size_t threadLocalId(void)
+{
+  return getMemory()->id;
+}
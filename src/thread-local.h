@@ -0,0 +1,68 @@
+#ifndef NANO_BACKUP_SRC_THREAD_LOCAL_H
+#define NANO_BACKUP_SRC_THREAD_LOCAL_H
+
+#include <stddef.h>
+
+#include "CRegion/region.h"
+#include "allocator.h"
+
+/** Reusable buffers of which each thread has its own copy. Each buffer
+  must only be used by one function at a time. */
+typedef enum
+{
+  /** Used for copying and comparing files during backups. */
+  TB_io,
+
+  /** Used for reading files which get hashed. */
+  TB_hash,
+
+  /** Used for copying files out of the repository. */
+  TB_copy,
+
+  /** Used for building paths to files inside the repository. */
+  TB_repo_path,
+
+  /** Used for building the paths of restored files and the paths of the
+    files they get cloned from. */
+  TB_restore_path,
+  TB_clone_source_path,
+
+  /** The amount of buffers. Not a valid buffer. */
+  TB_count,
+} ThreadBuffer;
+
+/** Reusable allocators of which each thread has its own copy. Each
+  allocation invalidates all memory previously allocated from the same
+  allocator. */
+typedef enum
+{
+  /** Used by safe wrappers for terminating strings. */
+  TA_temporary,
+  TA_temporary_secondary,
+
+  /** The amount of allocators. Not a valid allocator. */
+  TA_count,
+} ThreadAllocator;
+
+/** Lists of unused objects of which each thread has its own copy. The
+  objects are linked by their users and allocated from the region returned
+  by threadLocalRegion(). */
+typedef enum
+{
+  /** Closed FileStreams ready for reuse. */
+  TL_file_streams,
+
+  /** Closed DirIterators ready for reuse. */
+  TL_dir_iterators,
+
+  /** The amount of lists. Not a valid list. */
+  TL_count,
+} ThreadList;
+
+extern CR_Region *threadLocalRegion(void);
+extern void *threadLocalBuffer(ThreadBuffer buffer, size_t capacity);
+extern Allocator *threadLocalAllocator(ThreadAllocator allocator);
+extern void **threadLocalList(ThreadList list);
+extern size_t threadLocalId(void);
+
+#endif
@@ -0,0 +1,284 @@
+#include "trace.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "CRegion/region.h"
+
+#include "error-handling.h"
+#include "safe-math.h"
+#include "safe-wrappers.h"
+
+static const char *phase_names[TP_count] = {
+  [TP_load_metadata] = "load_metadata",
+  [TP_initiate_backup] = "initiate_backup",
+  [TP_print_changes] = "print_changes",
+  [TP_finish_backup] = "finish_backup",
+  [TP_write_metadata] = "write_metadata",
+  [TP_collect_garbage] = "collect_garbage",
+  [TP_check_integrity] = "check_integrity",
+  [TP_scrub] = "scrub",
+  [TP_initiate_restore] = "initiate_restore",
+  [TP_finish_restore] = "finish_restore",
+};
+
+static const char *counter_names[TR_count] = {
+  [TR_files_stated] = "files_stated",
+  [TR_directories_read] = "directories_read",
+  [TR_regex_evaluations] = "regex_evaluations",
+  [TR_bytes_hashed] = "bytes_hashed",
+  [TR_bytes_copied] = "bytes_copied",
+  [TR_fsync_calls] = "fsync_calls",
+  [TR_metadata_bytes_written] = "metadata_bytes_written",
+  [TR_gc_objects_scanned] = "gc_objects_scanned",
+  [TR_metadata_paths_loaded] = "metadata_paths_loaded",
+};
+
+typedef struct
+{
+  size_t calls;
+  bool is_running;
+
+  /** Timestamps in microseconds at which the current call started. */
+  uint64_t wall_start;
+  uint64_t cpu_start;
+
+  /** Accumulated durations of all finished calls in microseconds. */
+  uint64_t wall_total;
+  uint64_t cpu_total;
+} PhaseRecord;
+
+/** True if tracing was enabled. Will only be set before any worker
+  threads are started, so it can be read without locking. */
+static bool tracing_enabled = false;
+
+/** The file to which the report gets written on exit. "-" stands for
+  stderr. */
+static const char *report_path = NULL;
+
+/** Phases are only entered and left by the main thread. */
+static PhaseRecord phases[TP_count];
+
+/** Counters can be updated by worker threads. */
+static pthread_mutex_t counter_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t counters[TR_count];
+
+static uint64_t getWallMicroseconds(void)
+{
+  struct timespec timespec;
+  if(clock_gettime(CLOCK_MONOTONIC, &timespec) == -1)
+  {
+    dieErrno("failed to determine elapsed time");
+  }
+
+  return sUint64Add(sUint64Mul(timespec.tv_sec, 1000000),
+                    timespec.tv_nsec / 1000);
+}
+
+static uint64_t timevalToMicroseconds(const struct timeval time)
+{
+  return sUint64Add(sUint64Mul(time.tv_sec, 1000000), time.tv_usec);
+}
+
+/** @return The CPU time used by all threads of the process. */
+static uint64_t getCpuMicroseconds(void)
+{
+  struct rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) != 0)
+  {
+    dieErrno("failed to determine consumed CPU time");
+  }
+
+  return sUint64Add(timevalToMicroseconds(usage.ru_utime),
+                    timevalToMicroseconds(usage.ru_stime));
+}
+
+static void writeReportOnExit(void)
+{
+  if(strcmp(report_path, "-") == 0)
+  {
+    traceWriteReport(stderr);
+    return;
+  }
+
+  /* Calling die() from an exit handler is undefined behaviour. */
+  FILE *stream = fopen(report_path, "w");
+  if(stream == NULL)
+  {
+    fprintf(stderr,
+            "nb: error: failed to open trace report \"%s\": %s\n",
+            report_path, strerror(errno));
+    return;
+  }
+
+  traceWriteReport(stream);
+  if(fclose(stream) != 0)
+  {
+    fprintf(stderr,
+            "nb: error: failed to write trace report \"%s\": %s\n",
+            report_path, strerror(errno));
+  }
+}
+
+/** Starts recording phases, counters and the memory usage of regions.
+  Must be called before any worker threads are started. Regions created
+  before calling this function are not tracked. */
+void traceEnable(void)
+{
+  tracing_enabled = true;
+  CR_EnableStatistics();
+}
+
+/** Like traceEnable(), but also writes the report to the given path when
+  the program exits.
+
+  @param path The path to the report file or "-" for stderr. Must remain
+  valid until the program exits.
+*/
+void traceEnableWithReport(const char *path)
+{
+  traceEnable();
+  if(report_path == NULL)
+  {
+    sAtexit(writeReportOnExit);
+  }
+  report_path = path;
+}
+
+/** Marks the start of the given phase. Must be called by the main thread.
+  Does nothing if tracing is disabled. */
+void tracePhaseBegin(const TracePhase phase)
+{
+  if(!tracing_enabled)
+  {
+    return;
+  }
+
+  PhaseRecord *record = &phases[phase];
+  if(record->is_running)
+  {
+    die("trace phase was entered twice: %s", phase_names[phase]);
+  }
+
+  record->calls = sSizeAdd(record->calls, 1);
+  record->is_running = true;
+  record->wall_start = getWallMicroseconds();
+  record->cpu_start = getCpuMicroseconds();
+}
+
+static void stopPhase(PhaseRecord *record)
+{
+  const uint64_t wall_now = getWallMicroseconds();
+  const uint64_t cpu_now = getCpuMicroseconds();
+
+  record->wall_total =
+    sUint64Add(record->wall_total,
+               sUint64GetDifference(record->wall_start, wall_now));
+  record->cpu_total = sUint64Add(
+    record->cpu_total, sUint64GetDifference(record->cpu_start, cpu_now));
+  record->is_running = false;
+}
+
+/** Marks the end of the given phase. Must be called by the main thread.
+  Does nothing if tracing is disabled. */
+void tracePhaseEnd(const TracePhase phase)
+{
+  if(!tracing_enabled)
+  {
+    return;
+  }
+
+  PhaseRecord *record = &phases[phase];
+  if(!record->is_running)
+  {
+    die("trace phase was left without being entered: %s",
+        phase_names[phase]);
+  }
+  stopPhase(record);
+}
+
+/** Adds the given amount to a counter. Can be called from any thread.
+  Does nothing if tracing is disabled. */
+void traceCount(const TraceCounter counter, const uint64_t amount)
+{
+  if(!tracing_enabled)
+  {
+    return;
+  }
+
+  /* Counters are only used for reporting and may be updated from inside
+     worker jobs, so they saturate instead of terminating the program. */
+  (void)pthread_mutex_lock(&counter_mutex);
+  counters[counter] = counters[counter] > UINT64_MAX - amount
+    ? UINT64_MAX
+    : counters[counter] + amount;
+  (void)pthread_mutex_unlock(&counter_mutex);
+}
+
+uint64_t traceGetCount(const TraceCounter counter)
+{
+  (void)pthread_mutex_lock(&counter_mutex);
+  const uint64_t value = counters[counter];
+  (void)pthread_mutex_unlock(&counter_mutex);
+
+  return value;
+}
+
+size_t traceGetPhaseCalls(const TracePhase phase)
+{
+  return phases[phase].calls;
+}
+
+/** Writes all recorded phases, counters and the memory usage of regions
+  grouped by their tag as a single JSON object to the given stream. Phases
+  which are still running get stopped. Phases which were never entered are
+  included with zero values, so the set of keys stays the same for all
+  commands. */
+void traceWriteReport(FILE *stream)
+{
+  fprintf(stream, "{\"phases\":{");
+  for(size_t phase = 0; phase < TP_count; phase++)
+  {
+    PhaseRecord *record = &phases[phase];
+    if(record->is_running)
+    {
+      stopPhase(record);
+    }
+
+    fprintf(stream,
+            "%s\"%s\":{\"calls\":%zu,\"wall_ms\":%.3f,\"cpu_ms\":%.3f}",
+            phase == 0 ? "" : ",", phase_names[phase], record->calls,
+            (double)record->wall_total / 1000.0,
+            (double)record->cpu_total / 1000.0);
+  }
+
+  fprintf(stream, "},\"counters\":{");
+  for(size_t counter = 0; counter < TR_count; counter++)
+  {
+    fprintf(stream, "%s\"%s\":%" PRIu64, counter == 0 ? "" : ",",
+            counter_names[counter], traceGetCount(counter));
+  }
+
+  const CR_RegionStatistics *statistics;
+  const size_t tag_count = CR_GetStatistics(&statistics);
+  fprintf(stream, "},\"memory\":{\"high_water\":%" PRIu64 ",\"regions\":{",
+          CR_GetHighWater());
+  for(size_t index = 0; index < tag_count; index++)
+  {
+    const CR_RegionStatistics *tag = &statistics[index];
+    fprintf(stream,
+            "%s\"%s\":{\"count\":%zu,\"bytes_requested\":%" PRIu64
+            ",\"bytes_allocated\":%" PRIu64 ",\"bytes_in_use\":%" PRIu64
+            ",\"high_water\":%" PRIu64 "}",
+            index == 0 ? "" : ",", tag->tag, tag->region_count,
+            tag->bytes_requested, tag->bytes_allocated, tag->bytes_in_use,
+            tag->high_water);
+  }
+  fprintf(stream, "}}}\n");
+}
@@ -0,0 +1,52 @@
+#ifndef NANO_BACKUP_SRC_TRACE_H
+#define NANO_BACKUP_SRC_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/** Distinct steps of a nb command for which the elapsed time gets
+  recorded. */
+typedef enum
+{
+  TP_load_metadata,
+  TP_initiate_backup,
+  TP_print_changes,
+  TP_finish_backup,
+  TP_write_metadata,
+  TP_collect_garbage,
+  TP_check_integrity,
+  TP_scrub,
+  TP_initiate_restore,
+  TP_finish_restore,
+
+  /** The amount of phases. Not a valid phase. */
+  TP_count,
+} TracePhase;
+
+/** Amounts of work which get accumulated over the entire program run. */
+typedef enum
+{
+  TR_files_stated,
+  TR_directories_read,
+  TR_regex_evaluations,
+  TR_bytes_hashed,
+  TR_bytes_copied,
+  TR_fsync_calls,
+  TR_metadata_bytes_written,
+  TR_gc_objects_scanned,
+  TR_metadata_paths_loaded,
+
+  /** The amount of counters. Not a valid counter. */
+  TR_count,
+} TraceCounter;
+
+extern void traceEnable(void);
+extern void traceEnableWithReport(const char *report_path);
+extern void tracePhaseBegin(TracePhase phase);
+extern void tracePhaseEnd(TracePhase phase);
+extern void traceCount(TraceCounter counter, uint64_t amount);
+extern uint64_t traceGetCount(TraceCounter counter);
+extern size_t traceGetPhaseCalls(TracePhase phase);
+extern void traceWriteReport(FILE *stream);
+
+#endif
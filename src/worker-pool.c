@@ -0,0 +1,681 @@
+#include "worker-pool.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "error-handling.h"
+#include "safe-math.h"
+#include "safe-wrappers.h"
+
+/** A range of jobs owned by a single thread. The owner takes jobs from
+  its beginning and other threads steal jobs from its end. */
+typedef struct
+{
+  /** Protects all members below. */
+  pthread_mutex_t mutex;
+
+  /** The next job to process. */
+  size_t begin;
+
+  /** The index after the last job in this range. */
+  size_t end;
+
+  /** Prevents ranges of different threads from sharing a cache line. */
+  char padding[64];
+} JobRange;
+
+/** Describes a thread while it processes the jobs of a pool. */
+typedef struct
+{
+  WorkerPool *pool;
+
+  /** The jobs owned by this thread or NULL if jobs get processed in
+    order. */
+  JobRange *range;
+
+  /** True if the thread holds the lock of workerPoolLock(). */
+  bool holds_user_lock;
+} WorkerThread;
+
+struct WorkerPool
+{
+  WorkerJob *job;
+  void *user_data;
+  size_t job_count;
+
+  /** One entry for each thread, starting with the owner. */
+  WorkerThread *workers;
+
+  /** Contains one range for each entry in `workers` or is NULL if jobs
+    get processed in order. */
+  JobRange *ranges;
+  size_t range_count;
+
+  /** Protects all members below. */
+  pthread_mutex_t state_mutex;
+
+  /** The index of the next job to be processed in order. */
+  size_t next_job;
+
+  /** True if a job has called workerPoolFail(). No new jobs will be
+    started once this is set. */
+  bool failed;
+
+  /** The errno value passed to workerPoolFail() or 0. */
+  int error_number;
+
+  /** The message of the first reported error. Can be NULL if allocating
+    the message failed. */
+  char *error_message;
+
+  /** Lock which can be used by jobs trough workerPoolLock(). */
+  pthread_mutex_t user_mutex;
+
+  /** The thread which called workerPoolRun(). */
+  pthread_t owner;
+
+  /** Threads started in addition to the owner. */
+  pthread_t *threads;
+  size_t thread_count;
+};
+
+/** Associates each thread with its WorkerThread while it processes
+  jobs. */
+static pthread_key_t worker_key;
+static pthread_once_t worker_key_once = PTHREAD_ONCE_INIT;
+static int worker_key_error = 0;
+
+static void createWorkerKey(void)
+{
+  worker_key_error = pthread_key_create(&worker_key, NULL);
+}
+
+/** @return The state of the calling thread or NULL if it is not
+  processing a job. */
+static WorkerThread *getWorkerThread(void)
+{
+  if(pthread_once(&worker_key_once, createWorkerKey) != 0 ||
+     worker_key_error != 0)
+  {
+    return NULL;
+  }
+  return pthread_getspecific(worker_key);
+}
+
+/** Locks the given mutex and aborts the program on failure. Locking can
+  only fail on programming errors, which can't be reported safely from
+  inside a worker thread or while holding another lock. */
+void workerPoolLockMutex(pthread_mutex_t *mutex)
+{
+  if(pthread_mutex_lock(mutex) != 0)
+  {
+    abort();
+  }
+}
+
+/** Counterpart to workerPoolLockMutex(). */
+void workerPoolUnlockMutex(pthread_mutex_t *mutex)
+{
+  if(pthread_mutex_unlock(mutex) != 0)
+  {
+    abort();
+  }
+}
+
+/** Claims the next job in order.
+
+  @return False if no jobs are left or the pool has failed.
+*/
+static bool claimNextJob(WorkerPool *pool, size_t *index_out)
+{
+  workerPoolLockMutex(&pool->state_mutex);
+  const bool has_job = !pool->failed && pool->next_job < pool->job_count;
+  if(has_job)
+  {
+    *index_out = pool->next_job;
+    pool->next_job++;
+  }
+  workerPoolUnlockMutex(&pool->state_mutex);
+
+  return has_job;
+}
+
+/** Takes the first job from the given range.
+
+  @return False if the range is empty.
+*/
+static bool takeFromRange(JobRange *range, size_t *index_out)
+{
+  workerPoolLockMutex(&range->mutex);
+  const bool has_job = range->begin < range->end;
+  if(has_job)
+  {
+    *index_out = range->begin;
+    range->begin++;
+  }
+  workerPoolUnlockMutex(&range->mutex);
+
+  return has_job;
+}
+
+/** Moves the second half of the largest range of another thread into the
+  empty range of the calling thread and takes the first job from it.
+
+  @return False if no jobs are left or the pool has failed.
+*/
+static bool stealJobs(WorkerPool *pool, JobRange *own_range,
+                      size_t *index_out)
+{
+  while(true)
+  {
+    JobRange *victim = NULL;
+    size_t victim_size = 0;
+    for(size_t index = 0; index < pool->range_count; index++)
+    {
+      JobRange *range = &pool->ranges[index];
+      if(range == own_range)
+      {
+        continue;
+      }
+
+      workerPoolLockMutex(&range->mutex);
+      const size_t size = range->end - range->begin;
+      workerPoolUnlockMutex(&range->mutex);
+
+      if(size > victim_size)
+      {
+        victim = range;
+        victim_size = size;
+      }
+    }
+    if(victim == NULL)
+    {
+      return false;
+    }
+
+    workerPoolLockMutex(&victim->mutex);
+    const size_t remaining = victim->end - victim->begin;
+    const size_t stolen_begin = victim->end - (remaining - remaining / 2);
+    const size_t stolen_end = victim->end;
+    victim->end = stolen_begin;
+    workerPoolUnlockMutex(&victim->mutex);
+
+    /* The victim may have processed its jobs in the meantime. */
+    if(stolen_begin == stolen_end)
+    {
+      continue;
+    }
+
+    /* Jobs which were stolen while the pool failed get dropped. */
+    workerPoolLockMutex(&own_range->mutex);
+    const bool has_failed = own_range->begin == SIZE_MAX;
+    if(!has_failed)
+    {
+      *index_out = stolen_begin;
+      own_range->begin = stolen_begin + 1;
+      own_range->end = stolen_end;
+    }
+    workerPoolUnlockMutex(&own_range->mutex);
+
+    return !has_failed;
+  }
+}
+
+/** Claims the next job to process.
+
+  @return False if no jobs are left or the pool has failed.
+*/
+static bool claimJob(WorkerThread *self, size_t *index_out)
+{
+  if(self->range == NULL)
+  {
+    return claimNextJob(self->pool, index_out);
+  }
+  return takeFromRange(self->range, index_out) ||
+    stealJobs(self->pool, self->range, index_out);
+}
+
+static void *processJobs(void *data)
+{
+  WorkerThread *self = data;
+  WorkerPool *pool = self->pool;
+
+  const int error = pthread_setspecific(worker_key, self);
+  if(error != 0)
+  {
+    workerPoolFail(pool, error, "failed to initialize worker thread");
+    return NULL;
+  }
+
+  size_t index;
+  while(claimJob(self, &index))
+  {
+    pool->job(index, pool, pool->user_data);
+  }
+
+  (void)pthread_setspecific(worker_key, NULL);
+  return NULL;
+}
+
+/** Waits for all threads started in addition to the owner. */
+static void joinThreads(WorkerPool *pool)
+{
+  for(size_t index = 0; index < pool->thread_count; index++)
+  {
+    /* Joining valid threads can only fail on programming errors. */
+    if(pthread_join(pool->threads[index], NULL) != 0)
+    {
+      abort();
+    }
+  }
+  pool->thread_count = 0;
+}
+
+/** Releases all resources of the given pool, except its error message.
+  All threads must have been joined. */
+static void destroyPool(WorkerPool *pool)
+{
+  free(pool->threads);
+  pool->threads = NULL;
+
+  for(size_t index = 0; index < pool->range_count; index++)
+  {
+    pthread_mutex_destroy(&pool->ranges[index].mutex);
+  }
+  free(pool->ranges);
+  pool->ranges = NULL;
+  pool->range_count = 0;
+
+  free(pool->workers);
+  pool->workers = NULL;
+
+  pthread_mutex_destroy(&pool->user_mutex);
+  pthread_mutex_destroy(&pool->state_mutex);
+}
+
+/** Reads a single line from the given file into the given buffer.
+
+  @return False if the file could not be read.
+*/
+static bool readLine(const char *path, char *buffer, const size_t size)
+{
+  FILE *stream = fopen(path, "r");
+  if(stream == NULL)
+  {
+    return false;
+  }
+
+  const bool success = fgets(buffer, (int)size, stream) != NULL;
+  fclose(stream);
+
+  return success;
+}
+
+/** Converts the given CPU quota into an amount of threads.
+
+  @return The quota rounded up to whole CPUs or 0 if it is unlimited or
+  invalid.
+*/
+static size_t quotaToThreads(const long long quota, const long long period)
+{
+  if(quota <= 0 || period <= 0)
+  {
+    return 0;
+  }
+  return (size_t)(quota / period + (quota % period > 0));
+}
+
+/** Returns the amount of CPUs which the given cgroup allows to use. Both
+  the unified hierarchy (cgroup v2) and the cpu controller of cgroup v1
+  are supported. Errors are ignored, since the limit is only a hint.
+
+  @param cgroup_path The path to the mount point of the cgroup
+  filesystem, e.g. "/sys/fs/cgroup".
+
+  @return The limit rounded up to whole CPUs or 0 if no limit was found.
+*/
+size_t workerPoolCgroupCpuLimit(const char *cgroup_path)
+{
+  char path[256];
+  char line[64];
+  long long quota;
+  long long period;
+
+  snprintf(path, sizeof(path), "%s/cpu.max", cgroup_path);
+  if(readLine(path, line, sizeof(line)))
+  {
+    return sscanf(line, "%lld %lld", &quota, &period) == 2
+      ? quotaToThreads(quota, period)
+      : 0;
+  }
+
+  snprintf(path, sizeof(path), "%s/cpu/cpu.cfs_quota_us", cgroup_path);
+  if(!readLine(path, line, sizeof(line)) ||
+     sscanf(line, "%lld", &quota) != 1)
+  {
+    return 0;
+  }
+
+  snprintf(path, sizeof(path), "%s/cpu/cpu.cfs_period_us", cgroup_path);
+  if(!readLine(path, line, sizeof(line)) ||
+     sscanf(line, "%lld", &period) != 1)
+  {
+    return 0;
+  }
+
+  return quotaToThreads(quota, period);
+}
+
+/** Returns the amount of threads which should be used for processing
+  jobs in parallel. This is the amount of online CPUs, limited by the CPU
+  quota of the cgroup in which the program runs. */
+size_t workerPoolDefaultSize(void)
+{
+  size_t thread_count = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+  const long processor_count = sysconf(_SC_NPROCESSORS_ONLN);
+  if(processor_count > 0)
+  {
+    thread_count = (size_t)processor_count;
+  }
+#endif
+
+  const size_t cpu_limit = workerPoolCgroupCpuLimit("/sys/fs/cgroup");
+  if(cpu_limit > 0 && cpu_limit < thread_count)
+  {
+    thread_count = cpu_limit;
+  }
+
+  return thread_count;
+}
+
+/** Splits the given amount of jobs into one range per worker. */
+static void initRanges(WorkerPool *pool, const size_t worker_count)
+{
+  pool->ranges = sMalloc(sSizeMul(sizeof *pool->ranges, worker_count));
+
+  const size_t jobs_per_range = pool->job_count / worker_count;
+  const size_t remainder = pool->job_count % worker_count;
+  size_t begin = 0;
+
+  for(; pool->range_count < worker_count; pool->range_count++)
+  {
+    JobRange *range = &pool->ranges[pool->range_count];
+    const int error = pthread_mutex_init(&range->mutex, NULL);
+    if(error != 0)
+    {
+      joinThreads(pool);
+      destroyPool(pool);
+      errno = error;
+      dieErrno("failed to initialize mutex");
+    }
+
+    range->begin = begin;
+    begin += jobs_per_range + (pool->range_count < remainder);
+    range->end = begin;
+  }
+}
+
+static void runPool(const size_t thread_count, const size_t job_count,
+                    WorkerJob *job, void *user_data, const bool unordered)
+{
+  if(pthread_once(&worker_key_once, createWorkerKey) != 0 ||
+     worker_key_error != 0)
+  {
+    errno = worker_key_error;
+    dieErrno("failed to create key for worker threads");
+  }
+  else if(pthread_getspecific(worker_key) != NULL)
+  {
+    die("worker pools can not be nested");
+  }
+
+  WorkerPool pool = {
+    .job = job,
+    .user_data = user_data,
+    .job_count = job_count,
+    .workers = NULL,
+    .ranges = NULL,
+    .range_count = 0,
+    .next_job = 0,
+    .failed = false,
+    .error_number = 0,
+    .error_message = NULL,
+    .owner = pthread_self(),
+    .threads = NULL,
+    .thread_count = 0,
+  };
+
+  int error = pthread_mutex_init(&pool.state_mutex, NULL);
+  if(error == 0)
+  {
+    error = pthread_mutex_init(&pool.user_mutex, NULL);
+    if(error != 0)
+    {
+      pthread_mutex_destroy(&pool.state_mutex);
+    }
+  }
+  if(error != 0)
+  {
+    errno = error;
+    dieErrno("failed to initialize mutex");
+  }
+
+  size_t extra_thread_count =
+    (thread_count < job_count ? thread_count : job_count);
+  extra_thread_count -= extra_thread_count > 0;
+  const size_t worker_count = extra_thread_count + 1;
+
+  pool.workers = sMalloc(sSizeMul(sizeof *pool.workers, worker_count));
+  if(unordered)
+  {
+    initRanges(&pool, worker_count);
+  }
+  for(size_t index = 0; index < worker_count; index++)
+  {
+    pool.workers[index].pool = &pool;
+    pool.workers[index].range = unordered ? &pool.ranges[index] : NULL;
+    pool.workers[index].holds_user_lock = false;
+  }
+
+  pool.threads = extra_thread_count == 0
+    ? NULL
+    : sMalloc(sSizeMul(sizeof *pool.threads, extra_thread_count));
+
+  for(; pool.thread_count < extra_thread_count; pool.thread_count++)
+  {
+    error = pthread_create(&pool.threads[pool.thread_count], NULL,
+                           processJobs,
+                           &pool.workers[pool.thread_count + 1]);
+    if(error != 0)
+    {
+      workerPoolFail(&pool, error, "failed to start worker thread");
+      break;
+    }
+  }
+
+  processJobs(&pool.workers[0]);
+  joinThreads(&pool);
+  destroyPool(&pool);
+
+  if(pool.failed)
+  {
+    const char *message = pool.error_message != NULL
+      ? pool.error_message
+      : "failed to allocate error message of worker thread";
+    char message_copy[strlen(message) + 1];
+    memcpy(message_copy, message, sizeof(message_copy));
+    free(pool.error_message);
+
+    if(pool.error_number != 0)
+    {
+      errno = pool.error_number;
+      dieErrno("%s", message_copy);
+    }
+    die("%s", message_copy);
+  }
+}
+
+/** Processes the given jobs on multiple threads and returns once all of
+  them have finished. Jobs get started in the order of their indices. If
+  a job calls workerPoolFail(), no further jobs will be started and this
+  function will terminate the program with the reported error once all
+  running jobs have returned.
+
+  @param thread_count The maximal amount of threads to use, including the
+  calling thread. Will be clamped to the amount of jobs.
+  @param job_count The amount of jobs to process.
+  @param job The function which processes a single job.
+  @param user_data Will be passed to each call of `job`.
+*/
+void workerPoolRun(const size_t thread_count, const size_t job_count,
+                   WorkerJob *job, void *user_data)
+{
+  runPool(thread_count, job_count, job, user_data, false);
+}
+
+/** Like workerPoolRun(), but jobs can be started in any order. Each
+  thread gets its own range of jobs and threads which run out of jobs
+  steal half of the remaining jobs from the busiest thread. This avoids
+  contention when processing many small jobs. */
+void workerPoolRunUnordered(const size_t thread_count,
+                            const size_t job_count, WorkerJob *job,
+                            void *user_data)
+{
+  runPool(thread_count, job_count, job, user_data, true);
+}
+
+/** Locks the given pools user lock. Can be used by jobs to synchronize
+  access to shared data. Must be released with workerPoolUnlock(). */
+void workerPoolLock(WorkerPool *pool)
+{
+  workerPoolLockMutex(&pool->user_mutex);
+
+  WorkerThread *self = getWorkerThread();
+  if(self != NULL)
+  {
+    self->holds_user_lock = true;
+  }
+}
+
+/** Releases a lock acquired by workerPoolLock(). */
+void workerPoolUnlock(WorkerPool *pool)
+{
+  WorkerThread *self = getWorkerThread();
+  if(self != NULL)
+  {
+    self->holds_user_lock = false;
+  }
+
+  workerPoolUnlockMutex(&pool->user_mutex);
+}
+
+/** Reports an error from inside a job. It takes the same arguments as
+  printf(). Only the first reported error will be kept. The program will be
+  terminated by workerPoolRun() once all running jobs have returned.
+
+  @param pool The pool processing the failed job.
+  @param error_number The errno value describing the error or 0.
+  @param format A valid formatting string.
+  @param ... Additional arguments.
+*/
+void workerPoolFail(WorkerPool *pool, const int error_number,
+                    const char *format, ...)
+{
+  workerPoolLockMutex(&pool->state_mutex);
+  if(pool->failed)
+  {
+    workerPoolUnlockMutex(&pool->state_mutex);
+    return;
+  }
+  pool->failed = true;
+  pool->error_number = error_number;
+
+  /* Empty all ranges and mark them, so stolen jobs get dropped too. */
+  for(size_t index = 0; index < pool->range_count; index++)
+  {
+    workerPoolLockMutex(&pool->ranges[index].mutex);
+    pool->ranges[index].begin = SIZE_MAX;
+    pool->ranges[index].end = SIZE_MAX;
+    workerPoolUnlockMutex(&pool->ranges[index].mutex);
+  }
+
+  va_list arguments;
+  va_start(arguments, format);
+  va_list arguments_copy;
+  va_copy(arguments_copy, arguments);
+
+  const int length = vsnprintf(NULL, 0, format, arguments);
+  if(length >= 0)
+  {
+    pool->error_message = malloc((size_t)length + 1);
+    if(pool->error_message != NULL)
+    {
+      vsnprintf(pool->error_message, (size_t)length + 1, format,
+                arguments_copy);
+    }
+  }
+
+  va_end(arguments_copy);
+  va_end(arguments);
+  workerPoolUnlockMutex(&pool->state_mutex);
+}
+
+/** @return True if a job of the given pool has called workerPoolFail().
+  Can be used by long running jobs to stop early. */
+bool workerPoolHasFailed(WorkerPool *pool)
+{
+  workerPoolLockMutex(&pool->state_mutex);
+  const bool failed = pool->failed;
+  workerPoolUnlockMutex(&pool->state_mutex);
+
+  return failed;
+}
+
+/** Stops the pool of the calling thread. This function gets called by
+  die() before terminating the program and does nothing if the calling
+  thread is not processing a job. Releases the lock of workerPoolLock() if
+  it is held by the calling thread.
+
+  On threads started by workerPoolRun(), the error gets reported trough
+  workerPoolFail() and the thread exits without returning. On the thread
+  which called workerPoolRun(), this function waits until all other
+  threads have exited and releases the pool, so the caller can terminate
+  the program safely.
+
+  @param error_number The errno value describing the error or 0.
+  @param message The error message passed to die().
+*/
+void workerPoolStopOnDie(const int error_number, const char *message)
+{
+  WorkerThread *self = getWorkerThread();
+  if(self == NULL)
+  {
+    return;
+  }
+
+  WorkerPool *pool = self->pool;
+  if(self->holds_user_lock)
+  {
+    self->holds_user_lock = false;
+    workerPoolUnlockMutex(&pool->user_mutex);
+  }
+  (void)pthread_setspecific(worker_key, NULL);
+  workerPoolFail(pool, error_number, "%s", message);
+
+  if(!pthread_equal(pool->owner, pthread_self()))
+  {
+    pthread_exit(NULL);
+  }
+
+  joinThreads(pool);
+  destroyPool(pool);
+  free(pool->error_message);
+  pool->error_message = NULL;
+}
@@ -0,0 +1,48 @@
+#ifndef NANO_BACKUP_SRC_WORKER_POOL_H
+#define NANO_BACKUP_SRC_WORKER_POOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __GNUC__
+#define FAIL_FUNCTION_ATTRIBUTES __attribute__((format(printf, 3, 4)))
+#else
+#define FAIL_FUNCTION_ATTRIBUTES
+#endif
+
+/** An opaque struct representing a group of threads, which process jobs
+  started by workerPoolRun(). */
+typedef struct WorkerPool WorkerPool;
+
+/** Processes a single job. Jobs can report errors trough workerPoolFail()
+  and return, which allows them to release their resources. They may also
+  call die(), which stops all other jobs before the program terminates.
+  Regions and other memory used by jobs must not be shared with other
+  threads, unless access to them is synchronized.
+
+  @param index The index of the job, ranging from 0 to `job_count - 1`.
+  @param pool The pool processing the job.
+  @param user_data The value passed to workerPoolRun().
+*/
+typedef void WorkerJob(size_t index, WorkerPool *pool, void *user_data);
+
+extern size_t workerPoolCgroupCpuLimit(const char *cgroup_path);
+extern size_t workerPoolDefaultSize(void);
+extern void workerPoolRun(size_t thread_count, size_t job_count,
+                          WorkerJob *job, void *user_data);
+extern void workerPoolRunUnordered(size_t thread_count, size_t job_count,
+                                   WorkerJob *job, void *user_data);
+extern void workerPoolLock(WorkerPool *pool);
+extern void workerPoolUnlock(WorkerPool *pool);
+extern void workerPoolFail(WorkerPool *pool, int error_number,
+                           const char *format,
+                           ...) FAIL_FUNCTION_ATTRIBUTES;
+extern bool workerPoolHasFailed(WorkerPool *pool);
+extern void workerPoolStopOnDie(int error_number, const char *message);
+extern void workerPoolLockMutex(pthread_mutex_t *mutex);
+extern void workerPoolUnlockMutex(pthread_mutex_t *mutex);
+
+#undef FAIL_FUNCTION_ATTRIBUTES
+
+#endif
@@ -0,0 +1,305 @@
+#include "worker-queue.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "error-handling.h"
+#include "safe-math.h"
+#include "worker-pool.h"
+
+/** The interval in nanoseconds in which threads waiting inside a pool
+  check whether the pool has failed. */
+#define FAILURE_CHECK_INTERVAL 10000000L
+
+struct WorkerQueue
+{
+  /** Protects all members below. */
+  pthread_mutex_t mutex;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+
+  /** A ring buffer containing `count` items, starting at `first`. */
+  void **items;
+  size_t capacity;
+  size_t first;
+  size_t count;
+
+  /** True if workerQueueClose() was called. */
+  bool closed;
+};
+
+struct WorkerLatch
+{
+  /** Protects all members below. */
+  pthread_mutex_t mutex;
+  pthread_cond_t reached_zero;
+
+  /** The amount of remaining calls to workerLatchCountDown(). */
+  size_t count;
+};
+
+/** Initializes the given mutex and condition variables. Terminates the
+  program on failure. */
+static void initSync(pthread_mutex_t *mutex, pthread_cond_t **conditions,
+                     const size_t condition_count)
+{
+  int error = pthread_mutex_init(mutex, NULL);
+  if(error != 0)
+  {
+    errno = error;
+    dieErrno("failed to initialize mutex");
+  }
+
+  for(size_t index = 0; index < condition_count; index++)
+  {
+    error = pthread_cond_init(conditions[index], NULL);
+    if(error != 0)
+    {
+      while(index > 0)
+      {
+        index--;
+        pthread_cond_destroy(conditions[index]);
+      }
+      pthread_mutex_destroy(mutex);
+      errno = error;
+      dieErrno("failed to initialize condition variable");
+    }
+  }
+}
+
+static void broadcast(pthread_cond_t *condition)
+{
+  if(pthread_cond_broadcast(condition) != 0)
+  {
+    abort();
+  }
+}
+
+/** Waits until the given condition gets signaled. Since failing jobs
+  don't signal conditions, waits inside a pool get interrupted
+  periodically. Like all condition waits, this can return spuriously.
+
+  @param pool The pool processing the calling job or NULL.
+
+  @return False if the given pool has failed.
+*/
+static bool waitFor(pthread_cond_t *condition, pthread_mutex_t *mutex,
+                    WorkerPool *pool)
+{
+  if(pool == NULL)
+  {
+    if(pthread_cond_wait(condition, mutex) != 0)
+    {
+      abort();
+    }
+    return true;
+  }
+  else if(workerPoolHasFailed(pool))
+  {
+    return false;
+  }
+
+  struct timespec deadline;
+  if(clock_gettime(CLOCK_REALTIME, &deadline) != 0)
+  {
+    abort();
+  }
+  deadline.tv_nsec += FAILURE_CHECK_INTERVAL;
+  if(deadline.tv_nsec >= 1000000000L)
+  {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  const int error = pthread_cond_timedwait(condition, mutex, &deadline);
+  if(error != 0 && error != ETIMEDOUT)
+  {
+    abort();
+  }
+  return true;
+}
+
+static void releaseQueue(void *data)
+{
+  WorkerQueue *queue = data;
+  pthread_cond_destroy(&queue->not_full);
+  pthread_cond_destroy(&queue->not_empty);
+  pthread_mutex_destroy(&queue->mutex);
+}
+
+/** Creates a new queue.
+
+  @param r The region to which the lifetime of the queue will be bound.
+  @param capacity The maximal amount of items in the queue. Must be
+  greater than 0.
+
+  @return A queue which can be used by any amount of threads at the same
+  time, until the given region gets released.
+*/
+WorkerQueue *workerQueueNew(CR_Region *r, const size_t capacity)
+{
+  if(capacity == 0)
+  {
+    die("unable to create queue with a capacity of 0");
+  }
+
+  WorkerQueue *queue = CR_RegionAlloc(r, sizeof(*queue));
+  queue->items = CR_RegionAlloc(r, sSizeMul(sizeof(void *), capacity));
+  queue->capacity = capacity;
+  queue->first = 0;
+  queue->count = 0;
+  queue->closed = false;
+
+  initSync(&queue->mutex,
+           (pthread_cond_t *[]){ &queue->not_empty, &queue->not_full }, 2);
+  CR_RegionAttach(r, releaseQueue, queue);
+
+  return queue;
+}
+
+/** Appends an item to the given queue. Blocks while the queue is full.
+
+  @param queue The queue to append to.
+  @param pool The pool processing the calling job. If it fails, waiting
+  will be aborted. Can be NULL.
+  @param item The item to append.
+
+  @return False if the item was not added, because the queue was closed
+  or the given pool has failed.
+*/
+bool workerQueuePush(WorkerQueue *queue, WorkerPool *pool, void *item)
+{
+  workerPoolLockMutex(&queue->mutex);
+
+  bool can_push = true;
+  while(can_push && !queue->closed && queue->count == queue->capacity)
+  {
+    can_push = waitFor(&queue->not_full, &queue->mutex, pool);
+  }
+  can_push = can_push && !queue->closed;
+
+  if(can_push)
+  {
+    queue->items[(queue->first + queue->count) % queue->capacity] = item;
+    queue->count++;
+    broadcast(&queue->not_empty);
+  }
+
+  workerPoolUnlockMutex(&queue->mutex);
+  return can_push;
+}
+
+/** Removes the oldest item from the given queue. Blocks while the queue
+  is empty and not closed.
+
+  @param queue The queue to take the item from.
+  @param pool The pool processing the calling job. If it fails, waiting
+  will be aborted. Can be NULL.
+  @param item_out Will be set to the removed item.
+
+  @return False if no item was removed, because the queue was closed and
+  is empty, or because the given pool has failed.
+*/
+bool workerQueuePop(WorkerQueue *queue, WorkerPool *pool, void **item_out)
+{
+  workerPoolLockMutex(&queue->mutex);
+
+  bool can_pop = true;
+  while(can_pop && !queue->closed && queue->count == 0)
+  {
+    can_pop = waitFor(&queue->not_empty, &queue->mutex, pool);
+  }
+  can_pop = can_pop && queue->count > 0;
+
+  if(can_pop)
+  {
+    *item_out = queue->items[queue->first];
+    queue->first = (queue->first + 1) % queue->capacity;
+    queue->count--;
+    broadcast(&queue->not_full);
+  }
+
+  workerPoolUnlockMutex(&queue->mutex);
+  return can_pop;
+}
+
+/** Closes the given queue. No more items can be added, but remaining
+  items can still be removed. Wakes up all blocked threads. */
+void workerQueueClose(WorkerQueue *queue)
+{
+  workerPoolLockMutex(&queue->mutex);
+  queue->closed = true;
+  broadcast(&queue->not_empty);
+  broadcast(&queue->not_full);
+  workerPoolUnlockMutex(&queue->mutex);
+}
+
+static void releaseLatch(void *data)
+{
+  WorkerLatch *latch = data;
+  pthread_cond_destroy(&latch->reached_zero);
+  pthread_mutex_destroy(&latch->mutex);
+}
+
+/** Creates a new latch.
+
+  @param r The region to which the lifetime of the latch will be bound.
+  @param count The amount of calls to workerLatchCountDown() required to
+  release waiting threads.
+
+  @return A latch which can be used by any amount of threads at the same
+  time, until the given region gets released.
+*/
+WorkerLatch *workerLatchNew(CR_Region *r, const size_t count)
+{
+  WorkerLatch *latch = CR_RegionAlloc(r, sizeof(*latch));
+  latch->count = count;
+
+  initSync(&latch->mutex, (pthread_cond_t *[]){ &latch->reached_zero },
+           1);
+  CR_RegionAttach(r, releaseLatch, latch);
+
+  return latch;
+}
+
+/** Decrements the counter of the given latch and wakes up all waiting
+  threads once it reaches zero. Calls on a latch which has already reached
+  zero are ignored. */
+void workerLatchCountDown(WorkerLatch *latch)
+{
+  workerPoolLockMutex(&latch->mutex);
+  if(latch->count > 0)
+  {
+    latch->count--;
+    if(latch->count == 0)
+    {
+      broadcast(&latch->reached_zero);
+    }
+  }
+  workerPoolUnlockMutex(&latch->mutex);
+}
+
+/** Blocks until the counter of the given latch reaches zero.
+
+  @param latch The latch to wait for.
+  @param pool The pool processing the calling job. If it fails, waiting
+  will be aborted. Can be NULL.
+
+  @return False if the given pool has failed before the counter reached
+  zero.
+*/
+bool workerLatchWait(WorkerLatch *latch, WorkerPool *pool)
+{
+  workerPoolLockMutex(&latch->mutex);
+
+  bool reached_zero = true;
+  while(reached_zero && latch->count > 0)
+  {
+    reached_zero = waitFor(&latch->reached_zero, &latch->mutex, pool);
+  }
+
+  workerPoolUnlockMutex(&latch->mutex);
+  return reached_zero;
+}
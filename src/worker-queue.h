@@ -0,0 +1,30 @@
+#ifndef NANO_BACKUP_SRC_WORKER_QUEUE_H
+#define NANO_BACKUP_SRC_WORKER_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "CRegion/region.h"
+
+#include "worker-pool.h"
+
+/** An opaque struct representing a queue with a fixed capacity, which
+  can be used by multiple producers and consumers at the same time. */
+typedef struct WorkerQueue WorkerQueue;
+
+/** An opaque struct which allows threads to wait until a fixed amount of
+  work has been completed. */
+typedef struct WorkerLatch WorkerLatch;
+
+extern WorkerQueue *workerQueueNew(CR_Region *r, size_t capacity);
+extern bool workerQueuePush(WorkerQueue *queue, WorkerPool *pool,
+                            void *item);
+extern bool workerQueuePop(WorkerQueue *queue, WorkerPool *pool,
+                           void **item_out);
+extern void workerQueueClose(WorkerQueue *queue);
+
+extern WorkerLatch *workerLatchNew(CR_Region *r, size_t count);
+extern void workerLatchCountDown(WorkerLatch *latch);
+extern bool workerLatchWait(WorkerLatch *latch, WorkerPool *pool);
+
+#endif
@@ -7,6 +7,7 @@
 #include "error-handling.h"
 #include "restore.h"
 #include "safe-wrappers.h"
+#include "string-table.h"
 #include "test-common.h"
 #include "test.h"
 
@@ -28,25 +29,25 @@ PathNode *findCwdNode(Metadata *metadata, StringView cwd, const BackupHint hint)
   {
     if((node->hint & ~BH_timestamp_changed) != hint)
     {
-      die("path has wrong backup hint: \"" PRI_STR "\"", STR_FMT(node->path));
+      die("path has wrong backup hint: \"" PRI_STR "\"", STR_FMT(nodePath(node)));
     }
     else if(node->policy != BPOL_none)
     {
-      die("path shouldn't have a policy: \"" PRI_STR "\"", STR_FMT(node->path));
+      die("path shouldn't have a policy: \"" PRI_STR "\"", STR_FMT(nodePath(node)));
     }
     else if(node->history->next != NULL)
     {
-      die("path has too many history points: \"" PRI_STR "\"", STR_FMT(node->path));
+      die("path has too many history points: \"" PRI_STR "\"", STR_FMT(nodePath(node)));
     }
     else if(node->next != NULL)
     {
-      die("item is not the last in list: \"" PRI_STR "\"", STR_FMT(node->path));
+      die("item is not the last in list: \"" PRI_STR "\"", STR_FMT(nodePath(node)));
     }
     else if(node->history->state.type != PST_directory)
     {
-      die("not a directory: \"" PRI_STR "\"", STR_FMT(node->path));
+      die("not a directory: \"" PRI_STR "\"", STR_FMT(nodePath(node)));
     }
-    else if(strIsEqual(node->path, cwd))
+    else if(strIsEqual(nodePath(node), cwd))
     {
       return node;
     }
@@ -75,7 +76,7 @@ PathNode *findSubnode(PathNode *node, const char *subnode_name, const BackupHint
                       const size_t requested_history_length, const size_t requested_subnode_count)
 {
   CR_Region *r = CR_RegionNew();
-  StringView subnode_path = strAppendPath(node->path, str(subnode_name), allocatorWrapRegion(r));
+  StringView subnode_path = strAppendPath(nodePath(node), str(subnode_name), allocatorWrapRegion(r));
   PathNode *result = findPathNode(node->subnodes, nullTerminate(subnode_path), hint, policy,
                                   requested_history_length, requested_subnode_count);
   CR_RegionRelease(r);
@@ -207,9 +208,9 @@ void regenerateFile(PathNode *node, const char *content, const size_t repetition
 {
   assert_true(node->history->state.type == PST_regular_file);
 
-  removePath(nullTerminate(node->path));
-  generateFile(nullTerminate(node->path), content, repetitions);
-  sUtime(node->path, node->history->state.metadata.file_info.modification_time);
+  removePath(nullTerminate(nodePath(node)));
+  generateFile(nullTerminate(nodePath(node)), content, repetitions);
+  sUtime(nodePath(node), node->history->state.metadata.file_info.modification_time);
 }
 
 /** Changes the path to which a symlink points.
@@ -243,7 +244,7 @@ PathHistory *findExistingHistPoint(PathNode *node)
     }
   }
 
-  die("failed to find existing path state type for \"" PRI_STR "\"", STR_FMT(node->path));
+  die("failed to find existing path state type for \"" PRI_STR "\"", STR_FMT(nodePath(node)));
   return NULL;
 }
 
@@ -273,26 +274,26 @@ void restoreWithTimeRecursively(PathNode *node)
   CR_Region *r = CR_RegionNew();
   Allocator *a = allocatorWrapOneSingleGrowableBuffer(r);
 
-  if(!sPathExists(node->path))
+  if(!sPathExists(nodePath(node)))
   {
     PathHistory *point = findExistingHistPoint(node);
     switch(point->state.type)
     {
       case PST_regular_file:
-        restoreRegularFile(nullTerminate(node->path), &point->state.metadata.file_info);
+        restoreRegularFile(nullTerminate(nodePath(node)), &point->state.metadata.file_info);
         break;
       case PST_symlink:
-        makeSymlink(strGetContent(point->state.metadata.symlink_target, a), nullTerminate(node->path));
+        makeSymlink(strGetContent(point->state.metadata.symlink_target, a), nullTerminate(nodePath(node)));
         break;
       case PST_directory:
-        makeDir(nullTerminate(node->path));
-        sUtime(node->path, point->state.metadata.directory_info.modification_time);
+        makeDir(nullTerminate(nodePath(node)));
+        sUtime(nodePath(node), point->state.metadata.directory_info.modification_time);
         break;
-      default: die("unable to restore \"" PRI_STR "\"", STR_FMT(node->path));
+      default: die("unable to restore \"" PRI_STR "\"", STR_FMT(nodePath(node)));
     }
   }
 
-  if(S_ISDIR(sLStat(node->path).st_mode))
+  if(S_ISDIR(sLStat(nodePath(node)).st_mode))
   {
     for(PathNode *subnode = node->subnodes; subnode != NULL; subnode = subnode->next)
     {
@@ -390,14 +391,14 @@ void mustHaveRegularStats(const PathNode *node, const Backup *backup, const stru
 void mustHaveRegularStat(const PathNode *node, const Backup *backup, const uint64_t size, const uint8_t *hash,
                          const uint8_t slot)
 {
-  mustHaveRegularStats(node, backup, sStat(node->path), size, hash, slot);
+  mustHaveRegularStats(node, backup, sStat(nodePath(node)), size, hash, slot);
 }
 
 /** Cached version of mustHaveRegularStat(). */
 void mustHaveRegularCached(const PathNode *node, const Backup *backup, const uint64_t size, const uint8_t *hash,
                            const uint8_t slot)
 {
-  mustHaveRegularStats(node, backup, cachedStat(node->path, sStat), size, hash, slot);
+  mustHaveRegularStats(node, backup, cachedStat(nodePath(node), sStat), size, hash, slot);
 }
 
 /** Like mustHaveSymlinkLStat(), but takes a stat struct instead. */
@@ -410,13 +411,13 @@ void mustHaveSymlinkStats(const PathNode *node, const Backup *backup, const stru
 /** Like mustHaveRegularStat(), but for mustHaveSymlink(). */
 void mustHaveSymlinkLStat(const PathNode *node, const Backup *backup, const char *symlink_target)
 {
-  mustHaveSymlinkStats(node, backup, sLStat(node->path), symlink_target);
+  mustHaveSymlinkStats(node, backup, sLStat(nodePath(node)), symlink_target);
 }
 
 /** Cached version of mustHaveSymlinkLStat(). */
 void mustHaveSymlinkLCached(const PathNode *node, const Backup *backup, const char *symlink_target)
 {
-  mustHaveSymlinkStats(node, backup, cachedStat(node->path, sLStat), symlink_target);
+  mustHaveSymlinkStats(node, backup, cachedStat(nodePath(node), sLStat), symlink_target);
 }
 
 /** Like mustHaveDirectory, but takes a stat struct instead. */
@@ -428,13 +429,13 @@ void mustHaveDirectoryStats(const PathNode *node, const Backup *backup, const st
 /** Like mustHaveRegularStat(), but for mustHaveDirectory(). */
 void mustHaveDirectoryStat(const PathNode *node, const Backup *backup)
 {
-  mustHaveDirectoryStats(node, backup, sStat(node->path));
+  mustHaveDirectoryStats(node, backup, sStat(nodePath(node)));
 }
 
 /** Cached version of mustHaveDirectoryStat(). */
 void mustHaveDirectoryCached(const PathNode *node, const Backup *backup)
 {
-  mustHaveDirectoryStats(node, backup, cachedStat(node->path, sStat));
+  mustHaveDirectoryStats(node, backup, cachedStat(nodePath(node), sStat));
 }
 
 /** Finds the node "$PWD/tmp/files".
@@ -197,7 +197,7 @@ static void change2NoneFiletypeChange(CR_Region *r, SearchNode *none_filetype_no
   mustHaveRegularCached(d_1, &metadata->backup_history[1], 12, (uint8_t *)"BARBARBARBAR", 0);
 
   PathNode *e = findSubnode(files, "e", BH_directory_to_regular, BPOL_none, 1, 1);
-  struct stat e_stats = cachedStat(e->path, sStat);
+  struct stat e_stats = cachedStat(nodePath(e), sStat);
   e_stats.st_uid++;
   e_stats.st_mtime++;
   mustHaveDirectoryStats(e, &metadata->current_backup, e_stats);
@@ -256,7 +256,7 @@ static void postNoneFiletypeChange(CR_Region *r, SearchNode *none_filetype_node)
   mustHaveRegularCached(d_1, &metadata->backup_history[2], 12, (uint8_t *)"BARBARBARBAR", 0);
 
   PathNode *e = findSubnode(files, "e", BH_directory_to_regular, BPOL_none, 1, 1);
-  struct stat e_stats = cachedStat(e->path, sStat);
+  struct stat e_stats = cachedStat(nodePath(e), sStat);
   e_stats.st_uid++;
   e_stats.st_mtime++;
   mustHaveDirectoryStats(e, &metadata->current_backup, e_stats);
@@ -886,7 +886,7 @@ static void trackFiletypeChange(CR_Region *r, SearchNode *filetype_node)
 
   PathNode *node_3 = findSubnode(files, "3", BH_regular_to_directory, BPOL_track, 2, 1);
   mustHaveDirectoryStat(node_3, &metadata->current_backup);
-  struct stat node_3_stats = cachedStat(node_3->path, sStat);
+  struct stat node_3_stats = cachedStat(nodePath(node_3), sStat);
   node_3_stats.st_gid++;
   mustHaveRegularStats(node_3, &metadata->backup_history[1], node_3_stats, 42, test_c_hash, 0);
   PathNode *node_3_a = findSubnode(node_3, "a", BH_added, BPOL_track, 1, 2);
@@ -916,7 +916,7 @@ static void trackFiletypeChange(CR_Region *r, SearchNode *filetype_node)
 
   PathNode *node_5 = findSubnode(files, "5", BH_directory_to_regular, BPOL_track, 2, 0);
   mustHaveRegularStat(node_5, &metadata->current_backup, 13, NULL, 0);
-  struct stat node_5_stats = cachedStat(node_5->path, sStat);
+  struct stat node_5_stats = cachedStat(nodePath(node_5), sStat);
   node_5_stats.st_mode++;
   mustHaveDirectoryStats(node_5, &metadata->backup_history[1], node_5_stats);
 
@@ -969,7 +969,7 @@ static void trackFiletypeChange(CR_Region *r, SearchNode *filetype_node)
 
   PathNode *node_8 = findSubnode(files, "8", BH_directory_to_regular, BPOL_track, 2, 3);
   mustHaveRegularStat(node_8, &metadata->current_backup, 518, NULL, 0);
-  struct stat node_8_stats = cachedStat(node_8->path, sStat);
+  struct stat node_8_stats = cachedStat(nodePath(node_8), sStat);
   node_8_stats.st_mode++;
   mustHaveDirectoryStats(node_8, &metadata->backup_history[1], node_8_stats);
   PathNode *node_8_a = findSubnode(node_8, "a", BH_removed, BPOL_track, 2, 1);
@@ -1070,7 +1070,7 @@ static void trackFiletypeChangePost(CR_Region *r, SearchNode *filetype_node, con
 
   PathNode *node_3 = findSubnode(files, "3", BH_unchanged, BPOL_track, 2, 1);
   mustHaveDirectoryStat(node_3, &metadata->backup_history[0 + off]);
-  struct stat node_3_stats = cachedStat(node_3->path, sStat);
+  struct stat node_3_stats = cachedStat(nodePath(node_3), sStat);
   node_3_stats.st_gid++;
   mustHaveRegularStats(node_3, &metadata->backup_history[2 + off], node_3_stats, 42, test_c_hash, 0);
   PathNode *node_3_a = findSubnode(node_3, "a", BH_unchanged, BPOL_track, 1, 2);
@@ -1100,7 +1100,7 @@ static void trackFiletypeChangePost(CR_Region *r, SearchNode *filetype_node, con
 
   PathNode *node_5 = findSubnode(files, "5", BH_unchanged, BPOL_track, 2, 0);
   mustHaveRegularStat(node_5, &metadata->backup_history[0 + off], 13, (uint8_t *)"?????????????", 0);
-  struct stat node_5_stats = cachedStat(node_5->path, sStat);
+  struct stat node_5_stats = cachedStat(nodePath(node_5), sStat);
   node_5_stats.st_mode++;
   mustHaveDirectoryStats(node_5, &metadata->backup_history[2 + off], node_5_stats);
 
@@ -1153,7 +1153,7 @@ static void trackFiletypeChangePost(CR_Region *r, SearchNode *filetype_node, con
 
   PathNode *node_8 = findSubnode(files, "8", BH_unchanged, BPOL_track, 2, 3);
   mustHaveRegularStat(node_8, &metadata->backup_history[0 + off], 518, node_42_hash, 0);
-  struct stat node_8_stats = cachedStat(node_8->path, sStat);
+  struct stat node_8_stats = cachedStat(nodePath(node_8), sStat);
   node_8_stats.st_mode++;
   mustHaveDirectoryStats(node_8, &metadata->backup_history[2 + off], node_8_stats);
   PathNode *node_8_a = findSubnode(node_8, "a", BH_unchanged, BPOL_track, 2, 1);
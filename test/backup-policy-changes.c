@@ -46,29 +46,29 @@ static void policyChangeFromNoneInit(CR_Region *r, SearchNode *change_from_none_
   PathNode *files = findFilesNode(metadata, BH_added, 8);
 
   PathNode *b = findSubnode(files, "b", BH_added, BPOL_none, 1, 1);
-  cachedStat(b->path, sStat);
-  cachedStat(findSubnode(b, "1", BH_added, BPOL_mirror, 1, 0)->path, sStat);
+  cachedStat(nodePath(b), sStat);
+  cachedStat(nodePath(findSubnode(b, "1", BH_added, BPOL_mirror, 1, 0)), sStat);
 
   PathNode *d = findSubnode(files, "d", BH_added, BPOL_none, 1, 1);
-  cachedStat(d->path, sStat);
-  cachedStat(findSubnode(d, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(d), sStat);
+  cachedStat(nodePath(findSubnode(d, "1", BH_added, BPOL_track, 1, 0)), sStat);
 
   PathNode *f = findSubnode(files, "f", BH_added, BPOL_none, 1, 1);
-  cachedStat(f->path, sStat);
-  cachedStat(findSubnode(f, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(f), sStat);
+  cachedStat(nodePath(findSubnode(f, "1", BH_added, BPOL_track, 1, 0)), sStat);
 
   PathNode *g = findSubnode(files, "g", BH_added, BPOL_none, 1, 1);
-  cachedStat(g->path, sStat);
-  cachedStat(findSubnode(g, "1", BH_added, BPOL_mirror, 1, 0)->path, sStat);
+  cachedStat(nodePath(g), sStat);
+  cachedStat(nodePath(findSubnode(g, "1", BH_added, BPOL_mirror, 1, 0)), sStat);
 
   PathNode *h = findSubnode(files, "h", BH_added, BPOL_none, 1, 2);
-  cachedStat(h->path, sStat);
+  cachedStat(nodePath(h), sStat);
   PathNode *h_1 = findSubnode(h, "1", BH_added, BPOL_copy, 1, 1);
-  cachedStat(h_1->path, sStat);
-  cachedStat(findSubnode(h_1, "2", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(h_1), sStat);
+  cachedStat(nodePath(findSubnode(h_1, "2", BH_added, BPOL_track, 1, 0)), sStat);
   PathNode *h_3 = findSubnode(h, "3", BH_added, BPOL_mirror, 1, 1);
-  cachedStat(h_3->path, sStat);
-  cachedStat(findSubnode(h_3, "4", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(h_3), sStat);
+  cachedStat(nodePath(findSubnode(h_3, "4", BH_added, BPOL_track, 1, 0)), sStat);
 
   /* Finish the backup and perform additional checks. */
   completeBackup(metadata);
@@ -314,45 +314,45 @@ static void policyChangeFromCopyInit(CR_Region *r, SearchNode *change_from_copy_
   PathNode *files = findFilesNode(metadata, BH_added, 19);
 
   PathNode *c = findSubnode(files, "c", BH_added, BPOL_copy, 1, 1);
-  cachedStat(c->path, sStat);
-  cachedStat(findSubnode(c, "1", BH_added, BPOL_copy, 1, 0)->path, sStat);
+  cachedStat(nodePath(c), sStat);
+  cachedStat(nodePath(findSubnode(c, "1", BH_added, BPOL_copy, 1, 0)), sStat);
 
-  cachedStat(findSubnode(files, "d", BH_added, BPOL_copy, 1, 0)->path, sStat);
+  cachedStat(nodePath(findSubnode(files, "d", BH_added, BPOL_copy, 1, 0)), sStat);
 
   PathNode *f = findSubnode(files, "f", BH_added, BPOL_copy, 1, 2);
-  cachedStat(f->path, sStat);
-  cachedStat(findSubnode(f, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
-  cachedStat(findSubnode(f, "2", BH_added, BPOL_mirror, 1, 0)->path, sStat);
+  cachedStat(nodePath(f), sStat);
+  cachedStat(nodePath(findSubnode(f, "1", BH_added, BPOL_track, 1, 0)), sStat);
+  cachedStat(nodePath(findSubnode(f, "2", BH_added, BPOL_mirror, 1, 0)), sStat);
 
   PathNode *j = findSubnode(files, "j", BH_added, BPOL_copy, 1, 1);
-  cachedStat(j->path, sStat);
-  cachedStat(findSubnode(j, "1", BH_added, BPOL_copy, 1, 0)->path, sStat);
+  cachedStat(nodePath(j), sStat);
+  cachedStat(nodePath(findSubnode(j, "1", BH_added, BPOL_copy, 1, 0)), sStat);
 
-  cachedStat(findSubnode(files, "k", BH_added, BPOL_copy, 1, 0)->path, sStat);
+  cachedStat(nodePath(findSubnode(files, "k", BH_added, BPOL_copy, 1, 0)), sStat);
 
   PathNode *l = findSubnode(files, "l", BH_added, BPOL_copy, 1, 3);
-  cachedStat(l->path, sStat);
-  cachedStat(findSubnode(l, "1", BH_added, BPOL_mirror, 1, 0)->path, sStat);
-  cachedStat(findSubnode(l, "2", BH_added, BPOL_track, 1, 0)->path, sStat);
-  cachedStat(findSubnode(l, "3", BH_added, BPOL_copy, 1, 0)->path, sStat);
+  cachedStat(nodePath(l), sStat);
+  cachedStat(nodePath(findSubnode(l, "1", BH_added, BPOL_mirror, 1, 0)), sStat);
+  cachedStat(nodePath(findSubnode(l, "2", BH_added, BPOL_track, 1, 0)), sStat);
+  cachedStat(nodePath(findSubnode(l, "3", BH_added, BPOL_copy, 1, 0)), sStat);
 
   PathNode *o = findSubnode(files, "o", BH_added, BPOL_copy, 1, 1);
-  cachedStat(o->path, sStat);
-  cachedStat(findSubnode(o, "1", BH_added, BPOL_copy, 1, 0)->path, sStat);
+  cachedStat(nodePath(o), sStat);
+  cachedStat(nodePath(findSubnode(o, "1", BH_added, BPOL_copy, 1, 0)), sStat);
 
-  cachedStat(findSubnode(files, "p", BH_added, BPOL_copy, 1, 0)->path, sStat);
+  cachedStat(nodePath(findSubnode(files, "p", BH_added, BPOL_copy, 1, 0)), sStat);
 
   PathNode *r_node = findSubnode(files, "r", BH_added, BPOL_copy, 1, 2);
-  cachedStat(r_node->path, sStat);
-  cachedStat(findSubnode(r_node, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
-  cachedStat(findSubnode(r_node, "2", BH_added, BPOL_mirror, 1, 0)->path, sStat);
+  cachedStat(nodePath(r_node), sStat);
+  cachedStat(nodePath(findSubnode(r_node, "1", BH_added, BPOL_track, 1, 0)), sStat);
+  cachedStat(nodePath(findSubnode(r_node, "2", BH_added, BPOL_mirror, 1, 0)), sStat);
 
   PathNode *s = findSubnode(files, "s", BH_added, BPOL_copy, 1, 2);
-  cachedStat(s->path, sStat);
-  cachedStat(findSubnode(s, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(s), sStat);
+  cachedStat(nodePath(findSubnode(s, "1", BH_added, BPOL_track, 1, 0)), sStat);
   PathNode *s_2 = findSubnode(s, "2", BH_added, BPOL_copy, 1, 1);
-  cachedStat(s_2->path, sStat);
-  cachedStat(findSubnode(s_2, "3", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(s_2), sStat);
+  cachedStat(nodePath(findSubnode(s_2, "3", BH_added, BPOL_track, 1, 0)), sStat);
 
   /* Finish the backup and perform additional checks. */
   completeBackup(metadata);
@@ -684,31 +684,31 @@ static void policyChangeFromMirrorInit(CR_Region *r, SearchNode *change_from_mir
   PathNode *files = findFilesNode(metadata, BH_added, 10);
 
   PathNode *b = findSubnode(files, "b", BH_added, BPOL_mirror, 1, 2);
-  cachedStat(b->path, sStat);
-  cachedStat(findSubnode(b, "1", BH_added, BPOL_mirror, 1, 0)->path, sStat);
-  cachedStat(findSubnode(b, "2", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(b), sStat);
+  cachedStat(nodePath(findSubnode(b, "1", BH_added, BPOL_mirror, 1, 0)), sStat);
+  cachedStat(nodePath(findSubnode(b, "2", BH_added, BPOL_track, 1, 0)), sStat);
 
-  cachedStat(findSubnode(files, "d", BH_added, BPOL_mirror, 1, 0)->path, sStat);
+  cachedStat(nodePath(findSubnode(files, "d", BH_added, BPOL_mirror, 1, 0)), sStat);
 
   PathNode *e = findSubnode(files, "e", BH_added, BPOL_mirror, 1, 1);
-  cachedStat(e->path, sStat);
-  cachedStat(findSubnode(e, "1", BH_added, BPOL_mirror, 1, 0)->path, sStat);
+  cachedStat(nodePath(e), sStat);
+  cachedStat(nodePath(findSubnode(e, "1", BH_added, BPOL_mirror, 1, 0)), sStat);
 
-  cachedStat(findSubnode(files, "g", BH_added, BPOL_mirror, 1, 0)->path, sStat);
+  cachedStat(nodePath(findSubnode(files, "g", BH_added, BPOL_mirror, 1, 0)), sStat);
 
   PathNode *i = findSubnode(files, "i", BH_added, BPOL_mirror, 1, 3);
-  cachedStat(i->path, sStat);
+  cachedStat(nodePath(i), sStat);
   PathNode *i_1 = findSubnode(i, "1", BH_added, BPOL_copy, 1, 1);
-  cachedStat(i_1->path, sStat);
-  cachedStat(findSubnode(i_1, "2", BH_added, BPOL_track, 1, 0)->path, sStat);
-  cachedStat(findSubnode(i, "2", BH_added, BPOL_mirror, 1, 0)->path, sStat);
+  cachedStat(nodePath(i_1), sStat);
+  cachedStat(nodePath(findSubnode(i_1, "2", BH_added, BPOL_track, 1, 0)), sStat);
+  cachedStat(nodePath(findSubnode(i, "2", BH_added, BPOL_mirror, 1, 0)), sStat);
   PathNode *i_3 = findSubnode(i, "3", BH_added, BPOL_track, 1, 1);
-  cachedStat(i_3->path, sStat);
-  cachedStat(findSubnode(i_3, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(i_3), sStat);
+  cachedStat(nodePath(findSubnode(i_3, "1", BH_added, BPOL_track, 1, 0)), sStat);
 
   PathNode *j = findSubnode(files, "j", BH_added, BPOL_mirror, 1, 1);
-  cachedStat(j->path, sStat);
-  cachedStat(findSubnode(j, "1", BH_added, BPOL_mirror, 1, 0)->path, sStat);
+  cachedStat(nodePath(j), sStat);
+  cachedStat(nodePath(findSubnode(j, "1", BH_added, BPOL_mirror, 1, 0)), sStat);
 
   /* Finish the backup and perform additional checks. */
   completeBackup(metadata);
@@ -965,69 +965,69 @@ static void policyChangeFromTrackInit0(CR_Region *r, SearchNode *change_from_tra
   PathNode *files = findFilesNode(metadata, BH_added, 16);
 
   PathNode *a = findSubnode(files, "a", BH_added, BPOL_track, 1, 1);
-  cachedStat(findSubnode(a, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(findSubnode(a, "1", BH_added, BPOL_track, 1, 0)), sStat);
 
   PathNode *b = findSubnode(files, "b", BH_added, BPOL_track, 1, 1);
-  cachedStat(b->path, sStat);
-  cachedStat(findSubnode(b, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(b), sStat);
+  cachedStat(nodePath(findSubnode(b, "1", BH_added, BPOL_track, 1, 0)), sStat);
 
   PathNode *c = findSubnode(files, "c", BH_added, BPOL_track, 1, 2);
-  cachedStat(c->path, sStat);
-  cachedStat(findSubnode(c, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
-  cachedStat(findSubnode(c, "2", BH_added, BPOL_track, 1, 0)->path, sLStat);
+  cachedStat(nodePath(c), sStat);
+  cachedStat(nodePath(findSubnode(c, "1", BH_added, BPOL_track, 1, 0)), sStat);
+  cachedStat(nodePath(findSubnode(c, "2", BH_added, BPOL_track, 1, 0)), sLStat);
 
   PathNode *d = findSubnode(files, "d", BH_added, BPOL_track, 1, 1);
-  cachedStat(d->path, sStat);
+  cachedStat(nodePath(d), sStat);
   PathNode *d_1 = findSubnode(d, "1", BH_added, BPOL_track, 1, 1);
-  cachedStat(d_1->path, sStat);
-  cachedStat(findSubnode(d_1, "2", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(d_1), sStat);
+  cachedStat(nodePath(findSubnode(d_1, "2", BH_added, BPOL_track, 1, 0)), sStat);
 
-  cachedStat(findSubnode(files, "e", BH_added, BPOL_track, 1, 0)->path, sStat);
-  cachedStat(findSubnode(files, "f", BH_added, BPOL_track, 1, 1)->path, sStat);
+  cachedStat(nodePath(findSubnode(files, "e", BH_added, BPOL_track, 1, 0)), sStat);
+  cachedStat(nodePath(findSubnode(files, "f", BH_added, BPOL_track, 1, 1)), sStat);
 
   PathNode *g = findSubnode(files, "g", BH_added, BPOL_track, 1, 1);
-  cachedStat(findSubnode(g, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(findSubnode(g, "1", BH_added, BPOL_track, 1, 0)), sStat);
 
   PathNode *h = findSubnode(files, "h", BH_added, BPOL_track, 1, 2);
-  cachedStat(h->path, sStat);
+  cachedStat(nodePath(h), sStat);
   PathNode *h_1 = findSubnode(h, "1", BH_added, BPOL_track, 1, 2);
-  cachedStat(h_1->path, sStat);
-  cachedStat(findSubnode(h_1, "2", BH_added, BPOL_track, 1, 0)->path, sStat);
-  cachedStat(findSubnode(h_1, "4", BH_added, BPOL_mirror, 1, 0)->path, sLStat);
-  cachedStat(findSubnode(h, "5", BH_added, BPOL_copy, 1, 0)->path, sStat);
+  cachedStat(nodePath(h_1), sStat);
+  cachedStat(nodePath(findSubnode(h_1, "2", BH_added, BPOL_track, 1, 0)), sStat);
+  cachedStat(nodePath(findSubnode(h_1, "4", BH_added, BPOL_mirror, 1, 0)), sLStat);
+  cachedStat(nodePath(findSubnode(h, "5", BH_added, BPOL_copy, 1, 0)), sStat);
 
   PathNode *i = findSubnode(files, "i", BH_added, BPOL_track, 1, 1);
-  cachedStat(i->path, sStat);
-  cachedStat(findSubnode(i, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(i), sStat);
+  cachedStat(nodePath(findSubnode(i, "1", BH_added, BPOL_track, 1, 0)), sStat);
 
   PathNode *j = findSubnode(files, "j", BH_added, BPOL_track, 1, 2);
-  cachedStat(j->path, sStat);
-  cachedStat(findSubnode(j, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(j), sStat);
+  cachedStat(nodePath(findSubnode(j, "1", BH_added, BPOL_track, 1, 0)), sStat);
   PathNode *j_2 = findSubnode(j, "2", BH_added, BPOL_track, 1, 1);
-  cachedStat(j_2->path, sStat);
-  cachedStat(findSubnode(j_2, "3", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(j_2), sStat);
+  cachedStat(nodePath(findSubnode(j_2, "3", BH_added, BPOL_track, 1, 0)), sStat);
 
-  cachedStat(findSubnode(files, "k", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(findSubnode(files, "k", BH_added, BPOL_track, 1, 0)), sStat);
 
   PathNode *l = findSubnode(files, "l", BH_added, BPOL_track, 1, 2);
-  cachedStat(l->path, sStat);
-  cachedStat(findSubnode(l, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
-  cachedStat(findSubnode(l, "2", BH_added, BPOL_mirror, 1, 0)->path, sStat);
+  cachedStat(nodePath(l), sStat);
+  cachedStat(nodePath(findSubnode(l, "1", BH_added, BPOL_track, 1, 0)), sStat);
+  cachedStat(nodePath(findSubnode(l, "2", BH_added, BPOL_mirror, 1, 0)), sStat);
 
   PathNode *m = findSubnode(files, "m", BH_added, BPOL_track, 1, 1);
-  cachedStat(m->path, sStat);
+  cachedStat(nodePath(m), sStat);
   PathNode *m_1 = findSubnode(m, "1", BH_added, BPOL_track, 1, 1);
-  cachedStat(m_1->path, sStat);
-  cachedStat(findSubnode(m_1, "2", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(m_1), sStat);
+  cachedStat(nodePath(findSubnode(m_1, "2", BH_added, BPOL_track, 1, 0)), sStat);
 
-  cachedStat(findSubnode(files, "n", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(findSubnode(files, "n", BH_added, BPOL_track, 1, 0)), sStat);
 
   PathNode *o = findSubnode(files, "o", BH_added, BPOL_track, 1, 2);
-  cachedStat(o->path, sStat);
-  cachedStat(findSubnode(o, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
-  cachedStat(findSubnode(o, "2", BH_added, BPOL_copy, 1, 0)->path, sStat);
+  cachedStat(nodePath(o), sStat);
+  cachedStat(nodePath(findSubnode(o, "1", BH_added, BPOL_track, 1, 0)), sStat);
+  cachedStat(nodePath(findSubnode(o, "2", BH_added, BPOL_copy, 1, 0)), sStat);
 
-  cachedStat(findSubnode(files, "p", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(findSubnode(files, "p", BH_added, BPOL_track, 1, 0)), sStat);
 
   /* Finish the backup and perform additional checks. */
   completeBackup(metadata);
@@ -1093,32 +1093,32 @@ static void policyChangeFromTrackInit1(CR_Region *r, SearchNode *change_from_tra
   setStatCache(1);
   PathNode *files = findFilesNode(metadata, BH_unchanged, 16);
 
-  cachedStat(findSubnode(files, "d", BH_directory_to_regular, BPOL_track, 2, 1)->path, sStat);
+  cachedStat(nodePath(findSubnode(files, "d", BH_directory_to_regular, BPOL_track, 2, 1)), sStat);
 
   PathNode *e = findSubnode(files, "e", BH_regular_to_directory, BPOL_track, 2, 2);
-  cachedStat(e->path, sStat);
-  cachedStat(findSubnode(e, "1", BH_added, BPOL_track, 1, 0)->path, sStat);
-  cachedStat(findSubnode(e, "2", BH_added, BPOL_mirror, 1, 0)->path, sStat);
+  cachedStat(nodePath(e), sStat);
+  cachedStat(nodePath(findSubnode(e, "1", BH_added, BPOL_track, 1, 0)), sStat);
+  cachedStat(nodePath(findSubnode(e, "2", BH_added, BPOL_mirror, 1, 0)), sStat);
 
-  cachedStat(findSubnode(files, "f", BH_timestamp_changed, BPOL_track, 2, 1)->path, sStat);
+  cachedStat(nodePath(findSubnode(files, "f", BH_timestamp_changed, BPOL_track, 2, 1)), sStat);
 
   PathNode *h = findSubnode(files, "h", BH_timestamp_changed, BPOL_track, 2, 2);
-  cachedStat(h->path, sStat);
+  cachedStat(nodePath(h), sStat);
   PathNode *h_1 = findSubnode(h, "1", BH_unchanged, BPOL_track, 1, 2);
   PathNode *h_2 = findSubnode(h_1, "2", BH_regular_to_directory, BPOL_track, 2, 1);
-  cachedStat(h_2->path, sStat);
-  cachedStat(findSubnode(h_2, "3", BH_added, BPOL_track, 1, 0)->path, sStat);
+  cachedStat(nodePath(h_2), sStat);
+  cachedStat(nodePath(findSubnode(h_2, "3", BH_added, BPOL_track, 1, 0)), sStat);
 
   PathNode *l = findSubnode(files, "l", BH_unchanged, BPOL_track, 1, 2);
-  cachedStat(findSubnode(l, "1", BH_regular_to_directory, BPOL_track, 2, 0)->path, sStat);
+  cachedStat(nodePath(findSubnode(l, "1", BH_regular_to_directory, BPOL_track, 2, 0)), sStat);
 
-  cachedStat(findSubnode(files, "o", BH_directory_to_regular, BPOL_track, 2, 2)->path, sStat);
+  cachedStat(nodePath(findSubnode(files, "o", BH_directory_to_regular, BPOL_track, 2, 2)), sStat);
 
   PathNode *p = findSubnode(files, "p", BH_regular_to_directory, BPOL_track, 2, 1);
-  cachedStat(p->path, sStat);
+  cachedStat(nodePath(p), sStat);
   PathNode *p_1 = findSubnode(p, "1", BH_added, BPOL_track, 1, 1);
-  cachedStat(p_1->path, sStat);
-  cachedStat(findSubnode(p_1, "2", BH_added, BPOL_track, 1, 0)->path, sLStat);
+  cachedStat(nodePath(p_1), sStat);
+  cachedStat(nodePath(findSubnode(p_1, "2", BH_added, BPOL_track, 1, 0)), sLStat);
 
   /* Finish backup. */
   completeBackup(metadata);
@@ -1171,7 +1171,7 @@ static void policyChangeFromTrackInit2(CR_Region *r, SearchNode *change_from_tra
   /* Populate stat cache. */
   setStatCache(2);
   PathNode *files = findFilesNode(metadata, BH_unchanged, 16);
-  cachedStat(findSubnode(files, "h", BH_directory_to_regular, BPOL_track, 3, 2)->path, sStat);
+  cachedStat(nodePath(findSubnode(files, "h", BH_directory_to_regular, BPOL_track, 3, 2)), sStat);
 
   /* Finish backup. */
   completeBackup(metadata);
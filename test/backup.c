@@ -61,8 +61,19 @@ static void runPhase1(CR_Region *r, SearchNode *phase_1_node)
   PathNode *some_file = findSubnode(foo, "some file", BH_added, BPOL_copy, 1, 0);
   mustHaveRegularStat(some_file, &metadata->current_backup, 84, NULL, 0);
 
+  /* Only non-empty regular files must be stored in the repository. */
+  size_t files_to_store_count = 0;
+  for(const PathNodeList *element = metadata->files_to_store; element != NULL; element = element->next)
+  {
+    assert_true(element->node == one_txt || element->node == three_txt || element->node == dir_three_txt ||
+                element->node == some_file);
+    files_to_store_count++;
+  }
+  assert_true(files_to_store_count == 4);
+
   /* Finish backup and perform additional checks. */
   completeBackup(metadata);
+  assert_true(metadata->files_to_store == NULL);
   mustHaveRegularStat(one_txt, &metadata->current_backup, 12, (uint8_t *)"A small file", 0);
   mustHaveRegularStat(two_txt, &metadata->current_backup, 0, (uint8_t *)"", 0);
   mustHaveRegularStat(three_txt, &metadata->current_backup, 400, three_hash, 0);
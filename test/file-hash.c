@@ -1,5 +1,8 @@
 #include "file-hash.h"
 
+#include <errno.h>
+#include <unistd.h>
+
 #include "safe-wrappers.h"
 #include "test.h"
 
@@ -89,6 +92,43 @@ int main(void)
 
   testGroupEnd();
 
+  testGroupStart("fileHash(): files smaller and bigger than a block");
+  {
+    char content[10000];
+    for(size_t index = 0; index < sizeof(content); index++)
+    {
+      content[index] = (char)(index * 7 + index / 256);
+    }
+
+    /* Sizes around the block sizes used below. */
+    static const size_t sizes[] = { 1, 21, 4095, 4096, 4097, 8192, 10000 };
+    for(size_t index = 0; index < sizeof(sizes) / sizeof(sizes[0]); index++)
+    {
+      StringView path = str("tmp/hashed-file");
+      FileStream *stream = sFopenWrite(path);
+      sFwrite(content, sizes[index], stream);
+      sFclose(stream);
+
+      stats = sStat(path);
+      stats.st_blksize = 8192;
+      uint8_t large_block_hash[FILE_HASH_SIZE];
+      fileHash(path, stats, large_block_hash, NULL, NULL);
+
+      stats.st_blksize = 1000;
+      fileHash(path, stats, hash, NULL, NULL);
+      assert_true(memcmp(hash, large_block_hash, FILE_HASH_SIZE) == 0);
+
+      uint64_t total_filesize = 0;
+      stats.st_blksize = 8192;
+      fileHash(path, stats, hash, appendBlockSize, &total_filesize);
+      assert_true(total_filesize == sizes[index]);
+      assert_true(memcmp(hash, large_block_hash, FILE_HASH_SIZE) == 0);
+
+      sRemove(path);
+    }
+  }
+  testGroupEnd();
+
   testGroupStart("fileHash(): progress callback on empty files");
   {
     StringView path = str("empty.txt");
@@ -105,4 +145,24 @@ int main(void)
     assert_true(total_filesize == 179);
   }
   testGroupEnd();
+
+  testGroupStart("fileHashDescriptor()");
+  {
+    const uint64_t size = sStat(str("example.txt")).st_size;
+    const int descriptor = sOpenRead(str("example.txt"));
+    assert_true(fileHashDescriptor(descriptor, size, 3, hash, NULL, NULL) == FHR_success);
+    assert_true(memcmp(hash, example_hash, FILE_HASH_SIZE) == 0);
+
+    assert_true(lseek(descriptor, 0, SEEK_SET) == 0);
+    assert_true(fileHashDescriptor(descriptor, size + 1, 4096, hash, NULL, NULL) == FHR_end_of_file);
+    assert_true(lseek(descriptor, 0, SEEK_SET) == 0);
+    assert_true(fileHashDescriptor(descriptor, size - 1, 4096, hash, NULL, NULL) == FHR_file_changed);
+    assert_true(close(descriptor) == 0);
+
+    assert_true(fileHashDescriptor(-1, 0, 4096, hash, NULL, NULL) == FHR_probe_error);
+    assert_true(errno == EBADF);
+    assert_true(fileHashDescriptor(-1, 1, 4096, hash, NULL, NULL) == FHR_read_error);
+    assert_true(errno == EBADF);
+  }
+  testGroupEnd();
 }
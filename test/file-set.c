@@ -0,0 +1,99 @@
+#include "file-set.h"
+
+#include <string.h>
+
+#include "test.h"
+
+/** Returns a file info with a hash derived from the given number. */
+static RegularFileInfo fileInfo(const size_t number, const uint64_t size, const uint8_t slot)
+{
+  RegularFileInfo info = { .size = size, .slot = slot };
+  for(size_t index = 0; index < FILE_HASH_SIZE; index++)
+  {
+    info.hash[index] = (uint8_t)(number >> ((index % sizeof(number)) * 8));
+  }
+  return info;
+}
+
+static bool setContains(const FileSet *set, const size_t number, const uint64_t size, const uint8_t slot)
+{
+  const RegularFileInfo info = fileInfo(number, size, slot);
+  return fileSetContains(set, &info);
+}
+
+/** Populates the given set with the given amount of files and checks all
+  of them afterwards. Every file is added with two different sizes and
+  slots. */
+static void testFileSet(FileSet *set, const size_t file_count)
+{
+  for(size_t index = 0; index < file_count; index++)
+  {
+    const RegularFileInfo info = fileInfo(index, 21, 0);
+    assert_true(!fileSetContains(set, &info));
+    assert_true(fileSetInsert(set, &info));
+    assert_true(fileSetContains(set, &info));
+    assert_true(!fileSetInsert(set, &info));
+
+    const RegularFileInfo other_size = fileInfo(index, 1024, 0);
+    const RegularFileInfo other_slot = fileInfo(index, 21, 7);
+    assert_true(fileSetInsert(set, &other_size));
+    assert_true(fileSetInsert(set, &other_slot));
+  }
+
+  assert_true(fileSetCount(set) == file_count * 3);
+
+  for(size_t index = 0; index < file_count; index++)
+  {
+    RegularFileInfo info = fileInfo(index, 21, 0);
+    assert_true(fileSetContains(set, &info));
+
+    /* Values other than hash, size and slot are ignored. */
+    info.permission_bits = 0777;
+    info.modification_time = 12345;
+    assert_true(fileSetContains(set, &info));
+
+    assert_true(setContains(set, index, 1024, 0));
+    assert_true(setContains(set, index, 21, 7));
+    assert_true(!setContains(set, index, 22, 0));
+    assert_true(!setContains(set, index, 21, 1));
+    assert_true(!setContains(set, index + file_count, 21, 0));
+  }
+}
+
+int main(void)
+{
+  testGroupStart("growing file set");
+  {
+    CR_Region *r = CR_RegionNew();
+    FileSet *set = fileSetNew(r, 0);
+    assert_true(fileSetCount(set) == 0);
+    testFileSet(set, 2000);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("file set with capacity hint");
+  {
+    CR_Region *r = CR_RegionNew();
+    testFileSet(fileSetNew(r, 1), 20);
+    testFileSet(fileSetNew(r, 60), 20);
+    testFileSet(fileSetNew(r, 50000), 20);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("files stored inside the hash");
+  {
+    CR_Region *r = CR_RegionNew();
+    FileSet *set = fileSetNew(r, 0);
+    const RegularFileInfo info = fileInfo(0, 0, 0);
+    assert_true(!fileSetContains(set, &info));
+    assert_error(fileSetInsert(set, &info), "unable to add file with size 0 to file set");
+    const RegularFileInfo small_info = fileInfo(9, 20, 0);
+    assert_true(!fileSetContains(set, &small_info));
+    assert_error(fileSetInsert(set, &small_info), "unable to add file with size 20 to file set");
+    assert_true(fileSetCount(set) == 0);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+}
@@ -0,0 +1,5 @@
+mkdir -p generated/files/dir
+printf 'hello' > generated/files/a.txt
+printf 'remove me' > generated/files/b.txt
+printf 'content' > generated/files/dir/c.txt
+ln -s a.txt generated/files/link
@@ -0,0 +1,7 @@
+printf 'hello world' > generated/files/a.txt
+rm generated/files/b.txt
+rm generated/files/link
+mkdir generated/files/link
+chmod 600 generated/files/dir/c.txt
+printf 'quoted' > 'generated/files/say "hi".txt'
+touch -t 03120812 generated/files/a.txt
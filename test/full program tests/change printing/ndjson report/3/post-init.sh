@@ -0,0 +1 @@
+printf 'latin-1' > "$(printf 'generated/files/caf\351.txt')"
@@ -0,0 +1 @@
+sh -e run-nb.sh
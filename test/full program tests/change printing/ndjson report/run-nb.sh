@@ -0,0 +1,25 @@
+# Runs a backup with --report=ndjson and compares the output to
+# "$PHASE_PATH/expected-ndjson". Paths in the expected output get
+# prefixed with the current directory.
+pwd_hex=$(printf '%s' "$PWD" | od -A n -v -t x1 | tr -d ' \n')
+sed -e "s,\"path\":\"/,\"path\":\"$PWD/,g" \
+  -e "s,\"path_hex\":\"2f,\"path_hex\":\"${pwd_hex}2f,g" \
+  "$PHASE_PATH/expected-ndjson" > generated/expected-ndjson
+
+printf 'yes' | "$NB" --report=ndjson generated/repo > generated/ndjson 2>&1
+
+# Changes are listed in the order of the filesystem, so only they get
+# sorted. All other lines must follow them in the expected order.
+#
+# $1 The file containing the output to normalize.
+normalize()
+{
+  awk '/^\{"type":"change"/ { if(other) exit 1; next } { other = 1 }' "$1"
+  grep '^{"type":"change"' "$1" | sort
+  grep -v '^{"type":"change"' "$1"
+}
+
+normalize generated/ndjson > generated/output
+normalize generated/expected-ndjson > generated/expected-output
+
+diff -q generated/output generated/expected-output
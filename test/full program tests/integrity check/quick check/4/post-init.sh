@@ -0,0 +1,5 @@
+# Restore after previous phase.
+yes 'Content 1' | head -n 250 > generated/repo/f/7b/0050e802a029f67ec2227eb93d1eb71c173d9x9c4x0
+
+# Remove a file.
+rm generated/repo/f/8c/351d51d65d79fa008d2f227e780d4bd798551x12c0x0
@@ -0,0 +1,2 @@
+# Break two deduplicated files.
+yes 'Content 2' | head -n 250 > generated/repo/f/7b/0050e802a029f67ec2227eb93d1eb71c173d9x9c4x0
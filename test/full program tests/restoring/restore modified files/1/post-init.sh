@@ -0,0 +1,17 @@
+mkdir -p generated/files/a/b generated/files/c
+yes 'Content 1' | head -n 250 > generated/files/file1.txt
+yes 'Content 1' | head -n 250 > generated/files/a/duplicate.txt
+yes 'Content 2' | head -n 500 > generated/files/a/b/file2.txt
+printf 'small' > generated/files/a/b/small.txt
+printf 'another small file' > generated/files/c/small.txt
+yes 'Content 3' | head -n 10 > generated/files/c/file3.txt
+ln -s ../file1.txt generated/files/c/link
+chmod 640 generated/files/a/duplicate.txt
+chmod 600 generated/files/c/file3.txt
+chmod 750 generated/files/c
+
+touch -t 200001011200 generated/files/file1.txt generated/files/a/b/file2.txt
+touch -t 200502031415 generated/files/a/duplicate.txt generated/files/a/b/small.txt
+touch -t 201012241830 generated/files/c/small.txt generated/files/c/file3.txt
+touch -t 201506070809 generated/files/a/b generated/files/c
+touch -t 201607080910 generated/files/a
@@ -0,0 +1,7 @@
+rm -r generated/files/a/b
+rm generated/files/c/small.txt
+yes 'Modified' | head -n 250 > generated/files/file1.txt
+chmod 644 generated/files/a/duplicate.txt
+rm generated/files/c/link
+mkdir generated/files/c/link
+printf 'replaced' > generated/files/c/file3.txt
@@ -0,0 +1,6 @@
+# Record the state of the backed up files before modifying them.
+ls -lnR generated/files | sed '/^total /d' |
+  awk '/^l/ { print $1, $3, $4, $9, $10, $11; next }
+       { print $1, $3, $4, $6, $7, $8, $9 }' > generated/expected-listing
+rm -rf generated/original
+cp -R generated/files generated/original
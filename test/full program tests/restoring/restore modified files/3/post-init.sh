@@ -0,0 +1,2 @@
+# Restore multiple files with the same content.
+rm generated/files/file1.txt generated/files/a/duplicate.txt
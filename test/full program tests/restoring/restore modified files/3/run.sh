@@ -0,0 +1,7 @@
+sh -e "../../fallback targets/run.sh"
+
+ls -lnR generated/files | sed '/^total /d' |
+  awk '/^l/ { print $1, $3, $4, $9, $10, $11; next }
+       { print $1, $3, $4, $6, $7, $8, $9 }' > generated/listing
+diff -q generated/listing generated/expected-listing
+diff -qr generated/files generated/original
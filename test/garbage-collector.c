@@ -222,6 +222,80 @@ static void testWithComplexMetadata(CR_Region *r)
   testGroupEnd();
 }
 
+static void addDroppedFile(CR_Region *r, Metadata *metadata, const PathNode *node)
+{
+  RepoFileList *element = CR_RegionAlloc(r, sizeof *element);
+  element->info = node->history->state.metadata.file_info;
+  element->next = metadata->dropped_files;
+  metadata->dropped_files = element;
+}
+
+static void testCollectDroppedFiles(CR_Region *r)
+{
+  testGroupStart("collect only dropped files");
+  Metadata *metadata = genTestMetadata(r);
+  StringView some_file_hash_path = str("tmp/repo/7/f1/1e53c1ddfc806aa108f531847debf26ac9f5ex90x0");
+  StringView three_hash_path = str("tmp/repo/c/cf/44e30207cdd286c592fb4384aa9585598caabxbfx0");
+  StringView super_hash_path = str("tmp/repo/c/17/4c9dca0c3e380e14cbece6616f2c65f157b56x78x0");
+
+  sMkdir(str("tmp/repo"));
+  sMkdir(str("tmp/repo/7"));
+  sMkdir(str("tmp/repo/7/f1"));
+  sFclose(sFopenWrite(some_file_hash_path));
+  sMkdir(str("tmp/repo/c"));
+  sMkdir(str("tmp/repo/c/cf"));
+  sFclose(sFopenWrite(three_hash_path));
+  sMkdir(str("tmp/repo/c/17"));
+  FileStream *writer = sFopenWrite(super_hash_path);
+  sFwrite("Test Data", 9, writer);
+  sFclose(writer);
+  sFclose(sFopenWrite(str("tmp/repo/stray-file.txt")));
+
+  GCStatistics stats = collectDroppedFiles(metadata, str("tmp/repo"));
+  assert_true(stats.deleted_items_count == 0);
+  assert_true(stats.deleted_items_total_size == 0);
+  assert_true(sPathExists(super_hash_path));
+
+  PathNode *tmpdir = metadata->paths;
+  PathNode *foo = findPathNode(tmpdir->subnodes, "/tmp/foo.txt", BH_none, BPOL_mirror, 1, 0);
+  PathNode *unneeded = findPathNode(tmpdir->subnodes, "/tmp/unneeded.txt", BH_not_part_of_repository, BPOL_mirror, 1, 0);
+  addDroppedFile(r, metadata, unneeded);
+  addDroppedFile(r, metadata, foo);
+  addDroppedFile(r, metadata, unneeded);
+
+  stats = collectDroppedFiles(metadata, str("tmp/repo"));
+  assert_true(stats.deleted_items_count == 2);
+  assert_true(stats.deleted_items_total_size == 9);
+  assert_true(!sPathExists(super_hash_path));
+  assert_true(!sPathExists(str("tmp/repo/c/17")));
+  assert_true(sPathExists(three_hash_path));
+  assert_true(sPathExists(some_file_hash_path));
+  assert_true(sPathExists(str("tmp/repo/stray-file.txt")));
+
+  /* Files which don't exist anymore are skipped. */
+  stats = collectDroppedFiles(metadata, str("tmp/repo"));
+  assert_true(stats.deleted_items_count == 0);
+  assert_true(stats.deleted_items_total_size == 0);
+
+  /* Reuse the files referenced by the written metadata. */
+  sMkdir(str("tmp/repo/c/17"));
+  writer = sFopenWrite(super_hash_path);
+  sFwrite("Test Data", 9, writer);
+  sFclose(writer);
+  metadataWrite(metadata, str("tmp/repo"), str("tmp/repo/tmp-file"), str("tmp/repo/metadata"));
+  assert_true(metadata->referenced_files != NULL);
+
+  stats = collectDroppedFiles(metadata, str("tmp/repo"));
+  assert_true(stats.deleted_items_count == 2);
+  assert_true(stats.deleted_items_total_size == 9);
+  assert_true(!sPathExists(super_hash_path));
+  assert_true(sPathExists(three_hash_path));
+  assert_true(sPathExists(str("tmp/repo/metadata")));
+
+  sRemoveRecursively(str("tmp/repo"));
+  testGroupEnd();
+}
+
 static void testGatheringTotalDeletedSize(CR_Region *r)
 {
   testGroupStart("calculate total size of deleted files");
@@ -253,7 +327,7 @@ static void increment(const uint64_t deleted_items_size, const size_t max_call_l
 {
   size_t *value = user_data;
   (*value)++;
-  assert_true(max_call_limit == 5);
+  assert_true(max_call_limit == 6);
   assert_true(deleted_items_size == 0);
 }
 
@@ -291,6 +365,7 @@ int main(void)
   testInvalidRepositoryPath(r);
   testGatheringTotalDeletedSize(r);
   testProgressCallback(r);
+  testCollectDroppedFiles(r);
 
   CR_RegionRelease(r);
 }
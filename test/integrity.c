@@ -61,6 +61,58 @@ static void progressCallback(const uint64_t processed_block_size, const uint64_t
   assert_true(total_bytes_to_process == ctx->expected_total_bytes_to_process);
 }
 
+/** Asserts that the given list contains exactly the nodes broken by the
+  test "prepare corrupted repository". */
+static void checkBrokenNodes(const ListOfBrokenPathNodes *broken_node_list, StringView cwd)
+{
+  CR_Region *r = CR_RegionNew();
+  size_t broken_path_node_count = 0;
+  StringTable *broken_path_nodes = strTableNew(r);
+  for(const ListOfBrokenPathNodes *path_node = broken_node_list; path_node != NULL; path_node = path_node->next)
+  {
+    StringView node_path = nodePath(path_node->node);
+    assert_true(strIsParentPath(cwd, node_path));
+    StringView unique_subpath =
+      strUnterminated(&node_path.content[cwd.length + 1], node_path.length - cwd.length - 1);
+    assert_true(strTableGet(broken_path_nodes, unique_subpath) == NULL);
+    strTableMap(broken_path_nodes, unique_subpath, (void *)0x1);
+    broken_path_node_count++;
+  }
+  assert_true(strTableGet(broken_path_nodes, str("tmp/files/empty-file.txt")) != NULL);
+  assert_true(strTableGet(broken_path_nodes, str("tmp/files/Another File.txt")) != NULL);
+  assert_true(strTableGet(broken_path_nodes, str("tmp/files/smaller file")) != NULL);
+  assert_true(strTableGet(broken_path_nodes, str("tmp/files/unchanged extra file")) != NULL);
+  assert_true(strTableGet(broken_path_nodes, str("tmp/files/21-bytes.txt")) != NULL);
+  assert_true(strTableGet(broken_path_nodes, str("tmp/files/additional-file-03")) != NULL);
+  assert_true(strTableGet(broken_path_nodes, str("tmp/files/breaks-via-deduplication.txt")) != NULL);
+  assert_true(broken_path_node_count == 7);
+  CR_RegionRelease(r);
+}
+
+/** Prepends all nodes in `list` to `merged_list`, which are not already
+  contained in it. */
+static ListOfBrokenPathNodes *mergeBrokenNodes(CR_Region *r, ListOfBrokenPathNodes *merged_list,
+                                               const ListOfBrokenPathNodes *list)
+{
+  for(; list != NULL; list = list->next)
+  {
+    bool already_merged = false;
+    for(const ListOfBrokenPathNodes *element = merged_list; element != NULL; element = element->next)
+    {
+      already_merged |= element->node == list->node;
+    }
+
+    if(!already_merged)
+    {
+      ListOfBrokenPathNodes *element = CR_RegionAlloc(r, sizeof(*element));
+      element->node = list->node;
+      element->next = merged_list;
+      merged_list = element;
+    }
+  }
+  return merged_list;
+}
+
 int main(void)
 {
   CR_Region *r = CR_RegionNew();
@@ -106,7 +158,7 @@ int main(void)
   testGroupEnd();
 
   testGroupStart("checkIntegrity(): healthy repository");
-  assert_true(checkIntegrity(r, metadata, repo_path, NULL, NULL) == NULL);
+  assert_true(checkIntegrity(r, metadata, repo_path, NULL, NULL, NULL) == NULL);
   testGroupEnd();
 
   testGroupStart("checkIntegrity(): healthy repository: progress callback");
@@ -115,7 +167,7 @@ int main(void)
       .total_bytes_processed = 0,
       .expected_total_bytes_to_process = getSizeOfAllValidConfigFiles() + total_size_of_large_generated_files,
     };
-    checkIntegrity(r, metadata, repo_path, progressCallback, &ctx);
+    checkIntegrity(r, metadata, repo_path, NULL, progressCallback, &ctx);
     assert_true(ctx.total_bytes_processed == ctx.expected_total_bytes_to_process);
   }
   testGroupEnd();
@@ -138,26 +190,75 @@ int main(void)
   testGroupEnd();
 
   testGroupStart("checkIntegrity(): corrupted repository");
-  size_t broken_path_node_count = 0;
-  StringTable *broken_path_nodes = strTableNew(r);
-  const ListOfBrokenPathNodes *broken_node_list = checkIntegrity(r, metadata, repo_path, NULL, NULL);
-  for(const ListOfBrokenPathNodes *path_node = broken_node_list; path_node != NULL; path_node = path_node->next)
+  const ListOfBrokenPathNodes *broken_node_list = checkIntegrity(r, metadata, repo_path, NULL, NULL, NULL);
+  checkBrokenNodes(broken_node_list, cwd);
+  testGroupEnd();
+
+  testGroupStart("checkIntegrity(): thread count and read-ahead");
   {
-    assert_true(strIsParentPath(cwd, path_node->node->path));
-    StringView unique_subpath = strUnterminated(&path_node->node->path.content[cwd.length + 1],
-                                                path_node->node->path.length - cwd.length - 1);
-    assert_true(strTableGet(broken_path_nodes, unique_subpath) == NULL);
-    strTableMap(broken_path_nodes, unique_subpath, (void *)0x1);
-    broken_path_node_count++;
+    const IntegrityOptions options[] = {
+      { .thread_count = 1, .read_ahead = 0 },
+      { .thread_count = 1, .read_ahead = 1 },
+      { .thread_count = 2, .read_ahead = 3 },
+      { .thread_count = 8, .read_ahead = 100 },
+    };
+    for(size_t index = 0; index < sizeof(options) / sizeof(options[0]); index++)
+    {
+      const ListOfBrokenPathNodes *list = checkIntegrity(r, metadata, repo_path, &options[index], NULL, NULL);
+      checkBrokenNodes(list, cwd);
+
+      /* The order of broken nodes must not depend on the order in which
+         files were checked. */
+      const ListOfBrokenPathNodes *expected = broken_node_list;
+      for(; list != NULL && expected != NULL; list = list->next, expected = expected->next)
+      {
+        assert_true(list->node == expected->node);
+      }
+      assert_true(list == NULL && expected == NULL);
+    }
+  }
+  testGroupEnd();
+
+  testGroupStart("checkIntegrity(): quick check");
+  {
+    const IntegrityOptions options = { .thread_count = 2, .read_ahead = 0, .quick = true };
+    ProgressContext ctx = {
+      .total_bytes_processed = 0,
+      .expected_total_bytes_to_process = getSizeOfAllValidConfigFiles() + total_size_of_large_generated_files,
+    };
+    const ListOfBrokenPathNodes *list = checkIntegrity(r, metadata, repo_path, &options, progressCallback, &ctx);
+    assert_true(ctx.total_bytes_processed == ctx.expected_total_bytes_to_process);
+
+    /* Files with modified content of the same size can't be detected. */
+    size_t broken_path_node_count = 0;
+    StringTable *broken_path_nodes = strTableNew(r);
+    for(; list != NULL; list = list->next)
+    {
+      StringView node_path = nodePath(list->node);
+      StringView unique_subpath =
+        strUnterminated(&node_path.content[cwd.length + 1], node_path.length - cwd.length - 1);
+      strTableMap(broken_path_nodes, unique_subpath, (void *)0x1);
+      broken_path_node_count++;
+    }
+    assert_true(strTableGet(broken_path_nodes, str("tmp/files/empty-file.txt")) != NULL);
+    assert_true(strTableGet(broken_path_nodes, str("tmp/files/Another File.txt")) != NULL);
+    assert_true(strTableGet(broken_path_nodes, str("tmp/files/unchanged extra file")) != NULL);
+    assert_true(strTableGet(broken_path_nodes, str("tmp/files/additional-file-03")) != NULL);
+    assert_true(strTableGet(broken_path_nodes, str("tmp/files/breaks-via-deduplication.txt")) != NULL);
+    assert_true(broken_path_node_count == 5);
+  }
+  testGroupEnd();
+
+  testGroupStart("checkIntegrity(): parallel progress callback");
+  {
+    const IntegrityOptions options = { .thread_count = 4, .read_ahead = 2 };
+    ProgressContext ctx = {
+      .total_bytes_processed = 0,
+      .expected_total_bytes_to_process = getSizeOfAllValidConfigFiles() + total_size_of_large_generated_files,
+    };
+    checkIntegrity(r, metadata, repo_path, &options, progressCallback, &ctx);
+    assert_true(ctx.total_bytes_processed == ctx.expected_total_bytes_to_process);
   }
-  assert_true(strTableGet(broken_path_nodes, str("tmp/files/empty-file.txt")) != NULL);
-  assert_true(strTableGet(broken_path_nodes, str("tmp/files/Another File.txt")) != NULL);
-  assert_true(strTableGet(broken_path_nodes, str("tmp/files/smaller file")) != NULL);
-  assert_true(strTableGet(broken_path_nodes, str("tmp/files/unchanged extra file")) != NULL);
-  assert_true(strTableGet(broken_path_nodes, str("tmp/files/21-bytes.txt")) != NULL);
-  assert_true(strTableGet(broken_path_nodes, str("tmp/files/additional-file-03")) != NULL);
-  assert_true(strTableGet(broken_path_nodes, str("tmp/files/breaks-via-deduplication.txt")) != NULL);
-  assert_true(broken_path_node_count == 7);
   testGroupEnd();
 
   testGroupStart("checkIntegrity(): corrupted repository: progress callback");
@@ -166,8 +267,98 @@ int main(void)
       .total_bytes_processed = 0,
       .expected_total_bytes_to_process = getSizeOfAllValidConfigFiles() + total_size_of_large_generated_files,
     };
-    checkIntegrity(r, metadata, repo_path, progressCallback, &ctx);
+    checkIntegrity(r, metadata, repo_path, NULL, progressCallback, &ctx);
+    assert_true(ctx.total_bytes_processed == ctx.expected_total_bytes_to_process);
+  }
+  testGroupEnd();
+
+  testGroupStart("checkIntegrity(): forward errors from worker threads");
+  {
+    sRename(str("tmp/repo/9"), str("tmp/repo/9-moved"));
+    writeToFile("tmp/repo/9", "");
+    const IntegrityOptions options = { .thread_count = 1, .read_ahead = 2 };
+    assert_error_errno(checkIntegrity(r, metadata, repo_path, &options, NULL, NULL),
+                       "failed to check existence of \"tmp/repo/9/14/63ea1831fa59be6f547140553e6134f3ec0bbx15x0\"",
+                       ENOTDIR);
+    sRemove(str("tmp/repo/9"));
+    sRename(str("tmp/repo/9-moved"), str("tmp/repo/9"));
+  }
+  testGroupEnd();
+
+  testGroupStart("scrubRepository(): resume with byte budget");
+  {
+    const ScrubBudget budget = { .max_seconds = 0, .max_bytes = 1 };
+    ScrubResult result = scrubRepository(r, metadata, repo_path, &budget, NULL, NULL, NULL);
+    const size_t total_count = result.total_count;
+    assert_true(total_count > 2);
+    assert_true(result.total_size == getSizeOfAllValidConfigFiles() + total_size_of_large_generated_files);
+
+    ListOfBrokenPathNodes *merged_broken_nodes = mergeBrokenNodes(r, NULL, result.broken_nodes);
+    for(size_t run = 1; run <= total_count; run++)
+    {
+      assert_true(result.checked_count == 1);
+      assert_true(result.checked_size > FILE_HASH_SIZE);
+      assert_true(result.total_count == total_count);
+      assert_true(result.covered_count == run);
+      assert_true(sStat(str("tmp/repo/scrub-state")).st_size == (off_t)run * 37);
+      if(run < total_count)
+      {
+        assert_true(result.oldest_check == 0);
+        result = scrubRepository(r, metadata, repo_path, &budget, NULL, NULL, NULL);
+        merged_broken_nodes = mergeBrokenNodes(r, merged_broken_nodes, result.broken_nodes);
+      }
+    }
+    assert_true(result.oldest_check > 0);
+    checkBrokenNodes(merged_broken_nodes, cwd);
+  }
+  testGroupEnd();
+
+  testGroupStart("scrubRepository(): unlimited budget");
+  {
+    const ScrubBudget budget = { .max_seconds = 0, .max_bytes = 0 };
+    const IntegrityOptions options = { .thread_count = 3, .read_ahead = 1 };
+    ProgressContext ctx = {
+      .total_bytes_processed = 0,
+      .expected_total_bytes_to_process = getSizeOfAllValidConfigFiles() + total_size_of_large_generated_files,
+    };
+    const ScrubResult result = scrubRepository(r, metadata, repo_path, &budget, &options, progressCallback, &ctx);
     assert_true(ctx.total_bytes_processed == ctx.expected_total_bytes_to_process);
+    assert_true(result.checked_count == result.total_count);
+    assert_true(result.checked_size == result.total_size);
+    assert_true(result.covered_count == result.total_count);
+    assert_true(result.oldest_check > 0);
+    checkBrokenNodes(result.broken_nodes, cwd);
+  }
+  testGroupEnd();
+
+  testGroupStart("scrubRepository(): time budget");
+  {
+    const ScrubBudget budget = { .max_seconds = 60, .max_bytes = 0 };
+    const ScrubResult result = scrubRepository(r, metadata, repo_path, &budget, NULL, NULL, NULL);
+    assert_true(result.checked_count == result.total_count);
+    checkBrokenNodes(result.broken_nodes, cwd);
+  }
+  testGroupEnd();
+
+  testGroupStart("scrubRepository(): drop unreferenced files from state");
+  {
+    Metadata *empty_metadata = metadataNew(r);
+    const ScrubBudget budget = { .max_seconds = 0, .max_bytes = 1 };
+    const ScrubResult result = scrubRepository(r, empty_metadata, repo_path, &budget, NULL, NULL, NULL);
+    assert_true(result.broken_nodes == NULL);
+    assert_true(result.checked_count == 0);
+    assert_true(result.total_count == 0);
+    assert_true(result.covered_count == 0);
+    assert_true(sStat(str("tmp/repo/scrub-state")).st_size == 0);
+  }
+  testGroupEnd();
+
+  testGroupStart("scrubRepository(): corrupted state");
+  {
+    writeToFile("tmp/repo/scrub-state", "broken");
+    const ScrubBudget budget = { .max_seconds = 0, .max_bytes = 1 };
+    assert_error(scrubRepository(r, metadata, repo_path, &budget, NULL, NULL, NULL),
+                 "corrupted scrub state: \"tmp/repo/scrub-state\"");
   }
   testGroupEnd();
 
@@ -31,7 +31,10 @@ Metadata *createEmptyMetadata(CR_Region *r, const size_t backup_history_length)
 
   metadata->config_history = NULL;
   metadata->total_path_count = 0;
-  metadata->path_table = strTableNew(r);
+  metadata->path_table = pathTableNew(r, 0);
+  metadata->dropped_files = NULL;
+  metadata->files_to_store = NULL;
+  metadata->referenced_files = NULL;
   metadata->paths = NULL;
 
   return metadata;
@@ -46,8 +49,7 @@ void initHistPoint(Metadata *metadata, const size_t index, const size_t id, cons
 
 /** Creates a new path node.
 
-  @param path_str The node name, which will be appended to the parent nodes
-  path.
+  @param path_str The name of the new node.
   @param parent_node The parent node, in which the new node should be
   stored. Can be NULL, if the new node shouldn't have a parent node.
   @param metadata The metadata to which the current node belongs to. It
@@ -64,25 +66,23 @@ PathNode *createPathNode(const char *path_str, const BackupPolicy policy, PathNo
   node->hint = BH_none;
   node->policy = policy;
   node->history = NULL;
+  node->history_array_length = 0;
   node->subnodes = NULL;
 
+  node->parent = parent_node;
+  strSet(&node->name, strCopy(str(path_str), a));
+
   if(parent_node == NULL)
   {
-    StringView path = strAppendPath(str(""), str(path_str), a);
-    strSet(&node->path, path);
-
     node->next = NULL;
   }
   else
   {
-    StringView path = strAppendPath(parent_node->path, str(path_str), a);
-    strSet(&node->path, path);
-
     node->next = parent_node->subnodes;
     parent_node->subnodes = node;
   }
 
-  strTableMap(metadata->path_table, node->path, node);
+  pathTableInsert(metadata->path_table, node);
   metadata->total_path_count = sSizeAdd(metadata->total_path_count, 1);
 
   return node;
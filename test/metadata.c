@@ -628,6 +628,37 @@ static void copyStringRaw(char *data, const char *string)
   memcpy(data, string, strlen(string));
 }
 
+/** Looks up the node with the given path in the metadatas path table.
+
+  @param metadata The metadata containing the path table.
+  @param path_str A full path like "/etc/conf.d".
+
+  @return The node, or NULL if any element of the path isn't mapped.
+*/
+static PathNode *lookupPath(const Metadata *metadata, const char *path_str)
+{
+  StringView path = str(path_str);
+  PathNode *node = NULL;
+
+  for(size_t start = 1; start < path.length;)
+  {
+    size_t end = start;
+    while(end < path.length && path.content[end] != '/')
+    {
+      end++;
+    }
+
+    node = pathTableGet(metadata->path_table, node, strUnterminated(&path.content[start], end - start));
+    if(node == NULL)
+    {
+      return NULL;
+    }
+    start = end + 1;
+  }
+
+  return node;
+}
+
 /** Generates various broken metadata files. */
 static void generateBrokenMetadata(void)
 {
@@ -637,8 +668,9 @@ static void generateBrokenMetadata(void)
 
   Metadata *metadata = metadataLoad(r, str("tmp/test-data-1"));
   checkMetadata(metadata, 2, true);
-  PathNode *portage = strTableGet(metadata->path_table, str("/etc/portage"));
+  PathNode *portage = lookupPath(metadata, "/etc/portage");
   assert_true(portage != NULL);
+  assert_true(portage->history_array_length == 2);
 
   /* Truncate metadata file to provoke errors. */
   writeBytesToFile(643, test_data, "tmp/missing-byte");
@@ -689,13 +721,13 @@ static void generateBrokenMetadata(void)
   test_data[172] = 1;
 
   /* Generate metadata containing zero-length filenames. */
-  PathNode *etc = strTableGet(metadata->path_table, str("/etc"));
+  PathNode *etc = lookupPath(metadata, "/etc");
   assert_true(etc != NULL);
-  PathNode *conf_d = strTableGet(metadata->path_table, str("/etc/conf.d"));
+  PathNode *conf_d = lookupPath(metadata, "/etc/conf.d");
   assert_true(conf_d != NULL);
-  PathNode *foo = strTableGet(metadata->path_table, str("/etc/conf.d/foo"));
+  PathNode *foo = lookupPath(metadata, "/etc/conf.d/foo");
   assert_true(foo != NULL);
-  PathNode *bar = strTableGet(metadata->path_table, str("/etc/conf.d/bar"));
+  PathNode *bar = lookupPath(metadata, "/etc/conf.d/bar");
   assert_true(bar != NULL);
 
   /* To generate broken metadata at runtime it is required to overwrite
@@ -705,34 +737,34 @@ static void generateBrokenMetadata(void)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wcast-qual"
 #endif
-  *((size_t *)&etc->path.length) -= 3;
+  *((size_t *)&etc->name.length) -= 3;
   metadataWrite(metadata, str("tmp"), str("tmp/tmp-file"), str("tmp/filename-with-length-zero-1"));
-  *((size_t *)&etc->path.length) += 3;
+  *((size_t *)&etc->name.length) += 3;
 
-  *((size_t *)&foo->path.length) -= 3;
+  *((size_t *)&foo->name.length) -= 3;
   metadataWrite(metadata, str("tmp"), str("tmp/tmp-file"), str("tmp/filename-with-length-zero-2"));
-  *((size_t *)&foo->path.length) += 3;
+  *((size_t *)&foo->name.length) += 3;
 
   /* Generate metadata containing dot filenames. */
-  *((char *)&conf_d->path.content[conf_d->path.length - 6]) = '.';
-  *((char *)&conf_d->path.content[conf_d->path.length - 5]) = '.';
-  *((size_t *)&conf_d->path.length) -= 4;
+  *((char *)&conf_d->name.content[conf_d->name.length - 6]) = '.';
+  *((char *)&conf_d->name.content[conf_d->name.length - 5]) = '.';
+  *((size_t *)&conf_d->name.length) -= 4;
   metadataWrite(metadata, str("tmp"), str("tmp/tmp-file"), str("tmp/dot-filename-2"));
-  *((size_t *)&conf_d->path.length) += 4;
-  *((char *)&conf_d->path.content[conf_d->path.length - 5]) = 'o';
-  *((char *)&conf_d->path.content[conf_d->path.length - 6]) = 'c';
+  *((size_t *)&conf_d->name.length) += 4;
+  *((char *)&conf_d->name.content[conf_d->name.length - 5]) = 'o';
+  *((char *)&conf_d->name.content[conf_d->name.length - 6]) = 'c';
 #ifdef __GNUC__
 #pragma GCC diagnostic pop
 #endif
 
-  writeWithBrokenChar3(metadata, &etc->path, '.', "tmp/dot-filename-1");
-  writeWithBrokenChar3(metadata, &bar->path, '.', "tmp/dot-filename-3");
+  writeWithBrokenChar3(metadata, &etc->name, '.', "tmp/dot-filename-1");
+  writeWithBrokenChar3(metadata, &bar->name, '.', "tmp/dot-filename-3");
 
   /* Generate metadata containing slashes in filenames. */
   char *conf_d_bytes = findString(test_data, "conf.d", 700);
   char *portage_bytes = findString(test_data, "portage", 700);
   char *make_conf_bytes = findString(test_data, "make.conf", 700);
-  writeWithBrokenChar3(metadata, &bar->path, '/', "tmp/slash-filename-1");
+  writeWithBrokenChar3(metadata, &bar->name, '/', "tmp/slash-filename-1");
 
   conf_d_bytes[0] = '/';
   writeBytesToFile(700, test_data, "tmp/slash-filename-2");
@@ -753,8 +785,8 @@ static void generateBrokenMetadata(void)
   copyStringRaw(make_conf_bytes, "make.conf");
 
   /* Generate metadata containing null-bytes in filenames. */
-  writeWithBrokenChar3(metadata, &foo->path, '\0', "tmp/null-byte-filename-1");
-  writeWithBrokenChar3(metadata, &conf_d->path, '\0', "tmp/null-byte-filename-2");
+  writeWithBrokenChar3(metadata, &foo->name, '\0', "tmp/null-byte-filename-1");
+  writeWithBrokenChar3(metadata, &conf_d->name, '\0', "tmp/null-byte-filename-2");
 
   portage_bytes[2] = '\0';
   writeBytesToFile(700, test_data, "tmp/null-byte-filename-3");
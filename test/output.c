@@ -0,0 +1,50 @@
+#include "output.h"
+
+#include <string.h>
+
+#include "CRegion/region.h"
+
+#include "safe-wrappers.h"
+#include "test.h"
+
+/** Writes the given string as JSON to a temporary file and checks that
+  the result matches the expected string. */
+static void checkJsonString(CR_Region *r, StringView string, const char *expected)
+{
+  FILE *file = fopen("tmp/json-string", "wb");
+  assert_true(file != NULL);
+  outputWriteJsonString(file, string);
+  assert_true(fclose(file) == 0);
+
+  const FileContent content = sGetFilesContent(r, str("tmp/json-string"));
+  assert_true(content.size == strlen(expected));
+  assert_true(memcmp(content.content, expected, content.size) == 0);
+}
+
+int main(void)
+{
+  testGroupStart("outputWriteJsonString()");
+  CR_Region *r = CR_RegionNew();
+
+  checkJsonString(r, str(""), "\"\"");
+  checkJsonString(r, str("/home/user/file.txt"), "\"/home/user/file.txt\"");
+  checkJsonString(r, str("/test directory/♞.☂"), "\"/test directory/♞.☂\"");
+  checkJsonString(r, str("say \"hello\""), "\"say \\\"hello\\\"\"");
+  checkJsonString(r, str("C:\\files\\"), "\"C:\\\\files\\\\\"");
+  checkJsonString(r, str("line 1\nline 2\tend"), "\"line 1\\nline 2\\tend\"");
+  checkJsonString(r, str("\r\033[0m\x7f"), "\"\\u000d\\u001b[0m\x7f\"");
+  checkJsonString(r, str("\xff\xfe"), "\"\\ufffd\\ufffd\"");
+  checkJsonString(r, str("file-\xe4.txt"), "\"file-\\ufffd.txt\"");
+  checkJsonString(r, str("\xf0\x9f\x98\x80 \xc3\xa4"), "\"\xf0\x9f\x98\x80 \xc3\xa4\"");
+  checkJsonString(r, str("\xc0\xaf"), "\"\\ufffd\\ufffd\"");
+  checkJsonString(r, str("\xe0\x80\xaf"), "\"\\ufffd\\ufffd\\ufffd\"");
+  checkJsonString(r, str("\xed\xa0\x80"), "\"\\ufffd\\ufffd\\ufffd\"");
+  checkJsonString(r, str("\xf4\x90\x80\x80"), "\"\\ufffd\\ufffd\\ufffd\\ufffd\"");
+  checkJsonString(r, str("a\xe2\x98"), "\"a\\ufffd\\ufffd\"");
+  checkJsonString(r, str("\xe2\x98\"\x82"), "\"\\ufffd\\ufffd\\\"\\ufffd\"");
+  checkJsonString(r, (StringView){ .content = "a\0b", .length = 3, .is_terminated = true }, "\"a\\u0000b\"");
+  checkJsonString(r, strUnterminated("abc\"def", 4), "\"abc\\\"\"");
+
+  CR_RegionRelease(r);
+  testGroupEnd();
+}
@@ -0,0 +1,116 @@
+#include "path-table.h"
+
+#include <stdio.h>
+
+#include "error-handling.h"
+#include "metadata.h"
+#include "test.h"
+
+/* clang-format off */
+static const char *names[] =
+{
+  "etc", "usr", "home", "var", "bin", "lib", "share", "local", "conf.d",
+  "portage", "make.conf", "foo", "bar", "", ".hidden", "a", "b", "c",
+};
+static const size_t name_count = sizeof(names)/sizeof(void*);
+/* clang-format on */
+
+static PathNode *newNode(CR_Region *r, PathNode *parent, const char *name)
+{
+  PathNode *node = CR_RegionAlloc(r, sizeof *node);
+  node->parent = parent;
+  strSet(&node->name, str(name));
+  return node;
+}
+
+/** Populates the given table with a tree consisting of the given amount
+  of directories, each containing every name in `names`. Checks all
+  associations afterwards. */
+static void testPathTable(CR_Region *r, PathTable *table, const size_t directory_count)
+{
+  PathNode **directories = CR_RegionAlloc(r, sizeof *directories * directory_count);
+  PathNode **nodes = CR_RegionAlloc(r, sizeof *nodes * directory_count * name_count);
+
+  for(size_t index = 0; index < directory_count; index++)
+  {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%zu", index);
+    StringView name = strCopy(str(buffer), allocatorWrapRegion(r));
+
+    assert_true(pathTableGet(table, NULL, name) == NULL);
+    directories[index] = newNode(r, NULL, name.content);
+    pathTableInsert(table, directories[index]);
+    assert_true(pathTableGet(table, NULL, name) == directories[index]);
+  }
+
+  for(size_t index = 0; index < directory_count; index++)
+  {
+    for(size_t name_index = 0; name_index < name_count; name_index++)
+    {
+      StringView name = str(names[name_index]);
+      if(pathTableGet(table, directories[index], name) != NULL)
+      {
+        die("name \"%s\" already exists in path table", names[name_index]);
+      }
+
+      PathNode *node = newNode(r, directories[index], names[name_index]);
+      nodes[index * name_count + name_index] = node;
+      pathTableInsert(table, node);
+
+      if(pathTableGet(table, directories[index], name) != node)
+      {
+        die("failed to map name \"%s\"", names[name_index]);
+      }
+    }
+  }
+
+  assert_true(pathTableCountNodes(table) == directory_count * (name_count + 1));
+
+  /* Check that all names are mapped to the node with the correct
+     parent. */
+  for(size_t index = 0; index < directory_count; index++)
+  {
+    for(size_t name_index = 0; name_index < name_count; name_index++)
+    {
+      StringView name = str(names[name_index]);
+      assert_true(pathTableGet(table, directories[index], name) == nodes[index * name_count + name_index]);
+      assert_true(pathTableGet(table, NULL, name) == NULL);
+      assert_true(pathTableGet(table, nodes[index * name_count], name) == NULL);
+    }
+
+    assert_true(pathTableGet(table, directories[index], str("etc/")) == NULL);
+    assert_true(pathTableGet(table, directories[index], str("conf")) == NULL);
+  }
+}
+
+int main(void)
+{
+  testGroupStart("growing path table");
+  {
+    CR_Region *r = CR_RegionNew();
+    PathTable *table = pathTableNew(r, 0);
+    assert_true(pathTableCountNodes(table) == 0);
+    assert_true(pathTableGet(table, NULL, str("")) == NULL);
+    testPathTable(r, table, 1);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("same names in different directories");
+  {
+    CR_Region *r = CR_RegionNew();
+    testPathTable(r, pathTableNew(r, 0), 500);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("path table with capacity hint");
+  {
+    CR_Region *r = CR_RegionNew();
+    testPathTable(r, pathTableNew(r, 1), 20);
+    testPathTable(r, pathTableNew(r, 20 * (name_count + 1)), 20);
+    testPathTable(r, pathTableNew(r, 50000), 20);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+}
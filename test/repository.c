@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "error-handling.h"
@@ -122,6 +123,42 @@ static void testWithExistingTmpFile(RepoWriter *writer, StringView final_path)
   checkFilesContent(final_path, "Nano Backup");
 }
 
+/** Writes a pattern of small and large chunks trough the given writer,
+  which crosses the boundaries of its internal buffer multiple times. */
+static void writeMixedChunks(RepoWriter *writer, char *large_chunk, const size_t large_chunk_size)
+{
+  for(size_t index = 0; index < 30000; index++)
+  {
+    repoWriterWrite("abc", 3, writer);
+  }
+  repoWriterWrite(large_chunk, large_chunk_size, writer);
+  repoWriterWrite("x", 1, writer);
+  repoWriterWrite(large_chunk, large_chunk_size, writer);
+  repoWriterWrite("", 0, writer);
+  repoWriterWrite("yz", 2, writer);
+}
+
+/** Checks a file written by writeMixedChunks(). */
+static void checkMixedChunks(StringView path, const char *large_chunk, const size_t large_chunk_size)
+{
+  CR_Region *r = CR_RegionNew();
+  const FileContent content = sGetFilesContent(r, path);
+  assert_true(content.size == 30000 * 3 + large_chunk_size * 2 + 3);
+
+  for(size_t index = 0; index < 30000; index++)
+  {
+    assert_true(memcmp(&content.content[index * 3], "abc", 3) == 0);
+  }
+
+  const char *rest = &content.content[30000 * 3];
+  assert_true(memcmp(rest, large_chunk, large_chunk_size) == 0);
+  assert_true(rest[large_chunk_size] == 'x');
+  assert_true(memcmp(&rest[large_chunk_size + 1], large_chunk, large_chunk_size) == 0);
+  assert_true(memcmp(&rest[large_chunk_size * 2 + 1], "yz", 2) == 0);
+
+  CR_RegionRelease(r);
+}
+
 /** Tests repoBuildRegularFilePath().
 
   @param path The path of the final file relative to the current directory.
@@ -135,6 +172,30 @@ static void testRegularFilePathBuilding(StringView path, const RegularFileInfo *
   assert_true(strcmp(buffer, &nullTerminate(path)[4]) == 0);
 }
 
+/** Tests repoParseRegularFilePath().
+
+  @param path The path of the final file relative to the current directory.
+  @param info The file info which should be parsed from the given path.
+*/
+static void testRegularFilePathParsing(StringView path, const RegularFileInfo *info)
+{
+  RegularFileInfo parsed_info = { .permission_bits = 0640, .modification_time = 98765 };
+  assert_true(repoParseRegularFilePath(strUnterminated(&path.content[4], path.length - 4), &parsed_info));
+  assert_true(parsed_info.size == info->size);
+  assert_true(parsed_info.slot == info->slot);
+  assert_true(memcmp(parsed_info.hash, info->hash, FILE_HASH_SIZE) == 0);
+  assert_true(parsed_info.permission_bits == 0640);
+  assert_true(parsed_info.modification_time == 98765);
+}
+
+/** Asserts that the given path can't be parsed by
+  repoParseRegularFilePath(). */
+static void testInvalidRegularFilePath(const char *path)
+{
+  RegularFileInfo info;
+  assert_true(!repoParseRegularFilePath(str(path), &info));
+}
+
 int main(void)
 {
   StringView info_1_path = str("tmp/0/70/a0d101316191c1f2225282b2e3134373a3d40x8bx18");
@@ -220,6 +281,64 @@ int main(void)
   testRegularFilePathBuilding(info_6_path, &info_6);
   testGroupEnd();
 
+  testGroupStart("repoParseRegularFilePath()");
+  testRegularFilePathParsing(info_1_path, &info_1);
+  testRegularFilePathParsing(info_2_path, &info_2);
+  testRegularFilePathParsing(info_3_path, &info_3);
+  testRegularFilePathParsing(info_4_path, &info_4);
+  testRegularFilePathParsing(info_5_path, &info_5);
+  testRegularFilePathParsing(info_6_path, &info_6);
+
+  testInvalidRegularFilePath("");
+  testInvalidRegularFilePath("config");
+  testInvalidRegularFilePath("metadata");
+  testInvalidRegularFilePath("0");
+  testInvalidRegularFilePath("0/70");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40x8b");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40x8bx");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40xx18");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40x8bx18x");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40x8bx18/");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d4x8bx18");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d400x8bx18");
+  testInvalidRegularFilePath("07/0/a0d101316191c1f2225282b2e3134373a3d40x8bx18");
+  testInvalidRegularFilePath("0/70a/0d101316191c1f2225282b2e3134373a3d40x8bx18");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282B2e3134373a3d40x8bx18");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40x8Bx18");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40x08bx18");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40x8bx018");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40x8bx118");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40x8bx-1");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40x-8bx18");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40x1ffffffffffffffffx18");
+  testInvalidRegularFilePath("0/70/a0d10131619 c1f2225282b2e3134373a3d40x8bx18");
+  testInvalidRegularFilePath("0/70/a0d101316191c1f2225282b2e3134373a3d40x8bx18.tmp");
+  testGroupEnd();
+
+  testGroupStart("repoCompareRegularFiles()");
+  {
+    assert_true(repoCompareRegularFiles(&info_1, &info_1) == 0);
+    assert_true(repoCompareRegularFiles(&info_4, &info_1) < 0);
+    assert_true(repoCompareRegularFiles(&info_1, &info_4) > 0);
+    assert_true(repoCompareRegularFiles(&info_5, &info_6) < 0);
+
+    RegularFileInfo info = info_1;
+    info.permission_bits = 0755;
+    info.modification_time = 1234;
+    assert_true(repoCompareRegularFiles(&info, &info_1) == 0);
+
+    info.size++;
+    assert_true(repoCompareRegularFiles(&info, &info_1) > 0);
+    assert_true(repoCompareRegularFiles(&info_1, &info) < 0);
+
+    info.size = info_1.size;
+    info.slot--;
+    assert_true(repoCompareRegularFiles(&info, &info_1) < 0);
+    assert_true(repoCompareRegularFiles(&info_1, &info) > 0);
+  }
+  testGroupEnd();
+
   testGroupStart("write regular files to repository");
   assert_error_errno(
     repoWriterOpenFile(str("non-existing-directory"), str("non-existing-directory/tmp-file"), str("foo"), &info_1),
@@ -382,6 +501,29 @@ int main(void)
   assert_true(sStat(str("tmp/another-file")).st_size == 0);
   testGroupEnd();
 
+  testGroupStart("buffering of small and large writes");
+  {
+    const size_t large_chunk_size = 150001;
+    char *large_chunk = sMalloc(large_chunk_size);
+    for(size_t index = 0; index < large_chunk_size; index++)
+    {
+      large_chunk[index] = (char)(index % 251);
+    }
+
+    writer = repoWriterOpenRaw(str("tmp"), TMP_FILE_PATH, str("mixed-chunks"), str("tmp/mixed-chunks"));
+    writeMixedChunks(writer, large_chunk, large_chunk_size);
+    repoWriterClose(writer);
+    checkMixedChunks(str("tmp/mixed-chunks"), large_chunk, large_chunk_size);
+
+    writer = repoWriterOpenFile(str("tmp"), TMP_FILE_PATH, str("info_5"), &info_5);
+    writeMixedChunks(writer, large_chunk, large_chunk_size);
+    repoWriterClose(writer);
+    checkMixedChunks(info_5_path, large_chunk, large_chunk_size);
+
+    free(large_chunk);
+  }
+  testGroupEnd();
+
   testGroupStart("reading from repository");
   assert_error_errno(repoReaderOpenFile(str("tmp"), str("info_1"), &info_1),
                      "failed to open \"info_1\" in \"tmp\"", ENOENT);
@@ -3,9 +3,9 @@
 export LANG=C
 
 # Names of tests specified in the order to run.
-tests="safe-math allocator safe-wrappers file-hash colors str string-table search-tree
+tests="safe-math allocator safe-wrappers file-hash colors output str worker-pool worker-queue string-table path-table file-set search-tree
 search repository metadata backup backup-changes backup-filetype-changes
-backup-policy-changes garbage-collector integrity"
+backup-policy-changes garbage-collector integrity trace thread-local shared-region"
 
 cd test/data/
 
@@ -447,6 +447,51 @@ int main(void)
   sFclose(example_read);
   testGroupEnd();
 
+  testGroupStart("sReadFileExactly()");
+  {
+    char content[50] = { 0 };
+    assert_true(sReadFileExactly(wrap("example.txt"), content, 25));
+    assert_true(strcmp(content, "This is an example file.\n") == 0);
+
+    memset(content, 0, sizeof(content));
+    assert_true(!sReadFileExactly(wrap("example.txt"), content, 24));
+    assert_true(strcmp(content, "This is an example file.") == 0);
+
+    assert_true(sReadFileExactly(wrap("empty.txt"), content, 0));
+    assert_true(!sReadFileExactly(wrap("example.txt"), content, 0));
+
+    assert_error(sReadFileExactly(wrap("example.txt"), content, 26),
+                 "reading \"example.txt\": reached end of file unexpectedly");
+    assert_error_errno(sReadFileExactly(wrap("non-existing-file.txt"), content, 10),
+                       "failed to open \"non-existing-file.txt\" for reading", ENOENT);
+    assert_error_errno(sReadFileExactly(wrap("test directory"), content, 10),
+                       "IO error while reading \"test directory\"", EISDIR);
+    assert_error_errno(sReadFileExactly(wrap("test directory"), content, 0),
+                       "failed to check for remaining bytes in \"test directory\"", EISDIR);
+  }
+  testGroupEnd();
+
+  testGroupStart("fPhysicalOffset()");
+  {
+    uint64_t offset = 0;
+    errno = 0;
+    assert_true(!fPhysicalOffset(-1, &offset));
+    assert_true(errno == 0);
+
+    int descriptor = sOpenRead(wrap("empty.txt"));
+    assert_true(!fPhysicalOffset(descriptor, &offset));
+    assert_true(close(descriptor) == 0);
+
+    /* Depends on the filesystem and only needs to succeed. */
+    descriptor = sOpenRead(wrap("example.txt"));
+    (void)fPhysicalOffset(descriptor, &offset);
+    assert_true(close(descriptor) == 0);
+
+    assert_error_errno(sOpenRead(wrap("non-existing-file.txt")),
+                       "failed to open \"non-existing-file.txt\" for reading", ENOENT);
+  }
+  testGroupEnd();
+
   testGroupStart("sGetFilesContent()");
   CR_Region *r = CR_RegionNew();
   assert_error_errno(sGetFilesContent(r, wrap("non-existing-file.txt")),
@@ -893,5 +938,45 @@ int main(void)
   sDirClose(test_foo_1);
   testGroupEnd();
 
+  testGroupStart("reuse closed handles");
+  {
+    FileStream *stream = sFopenRead(wrap("example.txt"));
+    sFclose(stream);
+
+    /* Paths and buffers get replaced when reusing a stream. */
+    FileStream *reused_stream = sFopenRead(wrap("test directory/foo 1/test-file-a.txt"));
+    assert_true(reused_stream == stream);
+    FileStream *second_stream = sFopenRead(wrap("example.txt"));
+    assert_true(second_stream != stream);
+    assert_error(sFread(buffer, 1, reused_stream),
+                 "reading \"test directory/foo 1/test-file-a.txt\": reached end of file unexpectedly");
+
+    sFread(buffer, 25, second_stream);
+    assert_true(memcmp(buffer, "This is an example file.\n", 25) == 0);
+    sFclose(second_stream);
+
+    /* Streams get reused after failing to open a file. */
+    assert_error_errno(sFopenRead(wrap("non-existing-file.txt")),
+                       "failed to open \"non-existing-file.txt\" for reading", ENOENT);
+    FileStream *write_stream = sFopenWrite(wrap("tmp/reused-stream"));
+    sFwrite("data", 4, write_stream);
+    sFclose(write_stream);
+    CR_Region *content_r = CR_RegionNew();
+    assert_true(sGetFilesContent(content_r, wrap("tmp/reused-stream")).size == 4);
+    CR_RegionRelease(content_r);
+    sRemove(wrap("tmp/reused-stream"));
+
+    DirIterator *dir = sDirOpen(wrap("test directory/foo 1"));
+    sDirClose(dir);
+    assert_error_errno(sDirOpen(wrap("non-existing-directory")),
+                       "failed to open directory \"non-existing-directory\"", ENOENT);
+    DirIterator *reused_dir = sDirOpen(wrap("test directory/foo 1/bar"));
+    assert_true(reused_dir == dir);
+    StringView path = sDirGetNext(reused_dir);
+    assert_true(strIsParentPath(wrap("test directory/foo 1/bar"), path));
+    sDirClose(reused_dir);
+  }
+  testGroupEnd();
+
   testRegexWrapper();
 }
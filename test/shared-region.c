@@ -0,0 +1,83 @@
+#include "shared-region.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "test.h"
+#include "worker-pool.h"
+
+#define JOB_COUNT 4000
+
+typedef struct
+{
+  SharedRegion *shared;
+  unsigned char *allocations[JOB_COUNT];
+} AllocationContext;
+
+static size_t getAllocationSize(const size_t index)
+{
+  return index % 100 == 0 ? 20000 + index : 1 + index % 300;
+}
+
+static void allocate(const size_t index, WorkerPool *pool, void *user_data)
+{
+  (void)pool;
+  AllocationContext *ctx = user_data;
+  const size_t size = getAllocationSize(index);
+
+  unsigned char *data = sharedRegionAlloc(ctx->shared, size);
+  memset(data, (int)(index % 251), size);
+  ctx->allocations[index] = data;
+}
+
+/** Asserts that all allocations of the given context are aligned and that
+  none of them were overwritten. */
+static void checkAllocations(const AllocationContext *ctx, const size_t count)
+{
+  for(size_t index = 0; index < count; index++)
+  {
+    const unsigned char *data = ctx->allocations[index];
+    assert_true((uintptr_t)data % 8 == 0);
+
+    for(size_t byte = 0; byte < getAllocationSize(index); byte++)
+    {
+      assert_true(data[byte] == index % 251);
+    }
+  }
+}
+
+int main(void)
+{
+  testGroupStart("allocate memory");
+  {
+    static AllocationContext ctx;
+    CR_Region *r = CR_RegionNew();
+    ctx.shared = sharedRegionNew(r);
+
+    for(size_t index = 0; index < 500; index++)
+    {
+      allocate(index, NULL, &ctx);
+    }
+    checkAllocations(&ctx, 500);
+
+    assert_error(sharedRegionAlloc(ctx.shared, 0), "unable to allocate 0 bytes");
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("allocate from multiple threads");
+  {
+    static AllocationContext ctx;
+    for(size_t run = 0; run < 10; run++)
+    {
+      CR_Region *r = CR_RegionNew();
+      ctx.shared = sharedRegionNew(r);
+
+      workerPoolRun(8, JOB_COUNT, allocate, &ctx);
+      checkAllocations(&ctx, JOB_COUNT);
+
+      CR_RegionRelease(r);
+    }
+  }
+  testGroupEnd();
+}
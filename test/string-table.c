@@ -1,5 +1,7 @@
 #include "string-table.h"
 
+#include <stdio.h>
+
 #include "error-handling.h"
 #include "test.h"
 
@@ -76,6 +78,39 @@ static void testStringTable(StringTable *table)
   assert_true(strTableGet(table, str("originall")) == NULL);
 }
 
+/** Maps a large amount of generated keys to their index and checks the
+  result. */
+static void testManyMappings(StringTable *table, const size_t count)
+{
+  CR_Region *r = CR_RegionNew();
+  StringView *keys = CR_RegionAlloc(r, sizeof(*keys) * count);
+
+  for(size_t index = 0; index < count; index++)
+  {
+    char *buffer = CR_RegionAlloc(r, 32);
+    sprintf(buffer, "/home/user/file-%zu", index);
+    strSet(&keys[index], str(buffer));
+
+    strTableMap(table, keys[index], &keys[index]);
+  }
+  assert_true(strTableCountMappings(table) == count);
+
+  for(size_t index = 0; index < count; index++)
+  {
+    if(strTableGet(table, keys[index]) != &keys[index])
+    {
+      die("\"" PRI_STR "\" was not mapped to its index", STR_FMT(keys[index]));
+    }
+  }
+
+  assert_true(strTableGet(table, str("/home/user/file-")) == NULL);
+  assert_true(strTableGet(table, str("/home/user/file-0 ")) == NULL);
+  assert_true(strTableGet(table, str("/home/user/file-99999999")) == NULL);
+  assert_true(strTableGet(table, str("")) == NULL);
+
+  CR_RegionRelease(r);
+}
+
 int main(void)
 {
   testGroupStart("growing string table");
@@ -98,6 +133,46 @@ int main(void)
   }
   testGroupEnd();
 
+  testGroupStart("string table with capacity hint");
+  {
+    CR_Region *r = CR_RegionNew();
+    testStringTable(strTableNewWithCapacity(r, 0));
+    testStringTable(strTableNewWithCapacity(r, 1));
+    testStringTable(strTableNewWithCapacity(r, zlib_count));
+    testStringTable(strTableNewWithCapacity(r, 5000));
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("many mappings");
+  {
+    CR_Region *r = CR_RegionNew();
+    testManyMappings(strTableNew(r), 50000);
+    testManyMappings(strTableNewWithCapacity(r, 50000), 50000);
+    testManyMappings(strTableNewWithCapacity(r, 100), 20000);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("mapping the same key multiple times");
+  {
+    CR_Region *r = CR_RegionNew();
+    StringTable *table = strTableNew(r);
+    int values[3];
+
+    strTableMap(table, str("foo"), &values[0]);
+    strTableMap(table, str("foo"), &values[1]);
+    strTableMap(table, str("bar"), &values[2]);
+    assert_true(strTableCountMappings(table) == 3);
+
+    const void *data = strTableGet(table, str("foo"));
+    assert_true(data == &values[0] || data == &values[1]);
+    assert_true(strTableGet(table, str("bar")) == &values[2]);
+    assert_true(strTableGet(table, str("fo")) == NULL);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
   testGroupStart("strTableCountMappings()");
   {
     CR_Region *r = CR_RegionNew();
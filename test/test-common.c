@@ -104,46 +104,60 @@ static size_t getHistoryLength(const PathNode *node)
 
 /** Checks a path tree recursively and terminates the program on errors.
 
-  @param parent_node The first node in the list, which should be checked
+  @param node_list The first node in the list, which should be checked
   recursively.
+  @param parent The node containing the given list. Can be NULL.
   @param metadata The metadata to which the tree belongs.
   @param check_path_table True, if the associations in the metadatas path
   table should be checked.
 
   @return The amount of path nodes in the entire tree.
 */
-static size_t checkPathTree(const PathNode *parent_node, const Metadata *metadata, const bool check_path_table)
+static size_t checkPathTree(const PathNode *node_list, const PathNode *parent, const Metadata *metadata,
+                            const bool check_path_table)
 {
   size_t count = 0;
 
-  for(const PathNode *node = parent_node; node != NULL; node = node->next)
+  for(const PathNode *node = node_list; node != NULL; node = node->next)
   {
     if(backupHintNoPol(node->hint) == BH_not_part_of_repository)
     {
       continue;
     }
-    if(check_path_table && strTableGet(metadata->path_table, node->path) == NULL)
+    if(node->parent != parent)
     {
-      die("path was not mapped in metadata: \"" PRI_STR "\"", STR_FMT(node->path));
+      die("path has an invalid parent: \"" PRI_STR "\"", STR_FMT(nodePath(node)));
+    }
+    else if(check_path_table && pathTableGet(metadata->path_table, node->parent, node->name) != node)
+    {
+      die("path was not mapped in metadata: \"" PRI_STR "\"", STR_FMT(nodePath(node)));
     }
     else if(node->history == NULL)
     {
-      die("path has no history: \"" PRI_STR "\"", STR_FMT(node->path));
+      die("path has no history: \"" PRI_STR "\"", STR_FMT(nodePath(node)));
+    }
+    else if(node->history_array_length > 0 && node->history_array_length != getHistoryLength(node))
+    {
+      die("path has an invalid history array length: \"" PRI_STR "\"", STR_FMT(nodePath(node)));
     }
     else
       for(PathHistory *point = node->history; point != NULL; point = point->next)
       {
         if(!nextNodeGreater(metadata, point))
         {
-          die("path node history has an invalid order: \"" PRI_STR "\"", STR_FMT(node->path));
+          die("path node history has an invalid order: \"" PRI_STR "\"", STR_FMT(nodePath(node)));
         }
         else if(point->state.type > PST_directory)
         {
-          die("node history point has an invalid state type: \"" PRI_STR "\"", STR_FMT(node->path));
+          die("node history point has an invalid state type: \"" PRI_STR "\"", STR_FMT(nodePath(node)));
+        }
+        else if(node->history_array_length > 0 && point->next != NULL && point->next != &point[1])
+        {
+          die("node history is not stored as an array: \"" PRI_STR "\"", STR_FMT(nodePath(node)));
         }
       }
 
-    count += checkPathTree(node->subnodes, metadata, check_path_table);
+    count += checkPathTree(node->subnodes, node, metadata, check_path_table);
     count++;
   }
 
@@ -184,7 +198,7 @@ static const PathHistory *findHistoryPoint(const PathNode *node, const Backup *b
 
   if(point == NULL)
   {
-    die("node \"" PRI_STR "\" doesn't have a backup with id %zu in its history", STR_FMT(node->path), backup->id);
+    die("node \"" PRI_STR "\" doesn't have a backup with id %zu in its history", STR_FMT(nodePath(node)), backup->id);
   }
 
   return point;
@@ -196,11 +210,11 @@ static void checkPathState(const PathNode *node, const PathHistory *point, const
 {
   if(point->state.uid != uid)
   {
-    die("backup point %zu in node \"" PRI_STR "\" contains invalid uid", point->backup->id, STR_FMT(node->path));
+    die("backup point %zu in node \"" PRI_STR "\" contains invalid uid", point->backup->id, STR_FMT(nodePath(node)));
   }
   else if(point->state.gid != gid)
   {
-    die("backup point %zu in node \"" PRI_STR "\" contains invalid gid", point->backup->id, STR_FMT(node->path));
+    die("backup point %zu in node \"" PRI_STR "\" contains invalid gid", point->backup->id, STR_FMT(nodePath(node)));
   }
 }
 
@@ -259,7 +273,7 @@ void checkMetadata(const Metadata *metadata, const size_t config_history_length,
 
   assert_true(checkConfHist(metadata) == config_history_length);
   assert_true(metadata->path_table != NULL);
-  assert_true(metadata->total_path_count == checkPathTree(metadata->paths, metadata, check_path_table));
+  assert_true(metadata->total_path_count == checkPathTree(metadata->paths, NULL, metadata, check_path_table));
 }
 
 /** Performs some checks on the metadatas backup history.
@@ -314,7 +328,7 @@ PathNode *findPathNode(PathNode *start_node, const char *path_str, BackupHint hi
 
   for(PathNode *node = start_node; node != NULL && requested_node == NULL; node = node->next)
   {
-    if(strIsEqual(node->path, str(path_str)))
+    if(strIsEqual(nodePath(node), str(path_str)))
     {
       requested_node = node;
     }
@@ -352,7 +366,7 @@ void mustHaveNonExisting(const PathNode *node, const Backup *backup)
   if(point->state.type != PST_non_existing)
   {
     die("backup point %zu in node \"" PRI_STR "\" doesn't have the state PST_non_existing", backup->id,
-        STR_FMT(node->path));
+        STR_FMT(nodePath(node)));
   }
 }
 
@@ -366,21 +380,21 @@ void mustHaveRegular(const PathNode *node, const Backup *backup, const uid_t uid
   if(point->state.type != PST_regular_file)
   {
     die("backup point %zu in node \"" PRI_STR "\" doesn't have the state PST_regular", backup->id,
-        STR_FMT(node->path));
+        STR_FMT(nodePath(node)));
   }
   else if(point->state.metadata.file_info.permission_bits != permission_bits)
   {
     die("backup point %zu in node \"" PRI_STR "\" contains invalid permission bits", backup->id,
-        STR_FMT(node->path));
+        STR_FMT(nodePath(node)));
   }
   else if(point->state.metadata.file_info.modification_time != modification_time)
   {
     die("backup point %zu in node \"" PRI_STR "\" contains invalid modification_time", backup->id,
-        STR_FMT(node->path));
+        STR_FMT(nodePath(node)));
   }
   else if(!checkRegularValues(&point->state, size, hash, slot))
   {
-    die("backup point %zu in node \"" PRI_STR "\" contains invalid values", backup->id, STR_FMT(node->path));
+    die("backup point %zu in node \"" PRI_STR "\" contains invalid values", backup->id, STR_FMT(nodePath(node)));
   }
 
   checkPathState(node, point, uid, gid);
@@ -395,12 +409,12 @@ void mustHaveSymlink(const PathNode *node, const Backup *backup, const uid_t uid
   if(point->state.type != PST_symlink)
   {
     die("backup point %zu in node \"" PRI_STR "\" doesn't have the state PST_symlink", backup->id,
-        STR_FMT(node->path));
+        STR_FMT(nodePath(node)));
   }
   else if(!strIsEqual(point->state.metadata.symlink_target, str(symlink_target)))
   {
     die("backup point %zu in node \"" PRI_STR "\" doesn't contain the symlink target \"%s\"", backup->id,
-        STR_FMT(node->path), symlink_target);
+        STR_FMT(nodePath(node)), symlink_target);
   }
 
   checkPathState(node, point, uid, gid);
@@ -415,17 +429,17 @@ void mustHaveDirectory(const PathNode *node, const Backup *backup, const uid_t u
   if(point->state.type != PST_directory)
   {
     die("backup point %zu in node \"" PRI_STR "\" doesn't have the state PST_directory", backup->id,
-        STR_FMT(node->path));
+        STR_FMT(nodePath(node)));
   }
   else if(point->state.metadata.directory_info.permission_bits != permission_bits)
   {
     die("backup point %zu in node \"" PRI_STR "\" contains invalid permission bits", backup->id,
-        STR_FMT(node->path));
+        STR_FMT(nodePath(node)));
   }
   else if(point->state.metadata.directory_info.modification_time != modification_time)
   {
     die("backup point %zu in node \"" PRI_STR "\" contains invalid modification_time", backup->id,
-        STR_FMT(node->path));
+        STR_FMT(nodePath(node)));
   }
 
   checkPathState(node, point, uid, gid);
@@ -441,3 +455,10 @@ const char *nullTerminate(StringView string)
   }
   return strGetContent(string, buffer);
 }
+
+/** Returns the full path of the given node, allocated inside the global
+  region. */
+StringView nodePath(const PathNode *node)
+{
+  return pathNodeGetPath(node, allocatorWrapRegion(CR_GetGlobalRegion()));
+}
@@ -16,6 +16,7 @@
 
 #include "colors.h"
 #include "error-handling.h"
+#include "worker-pool.h"
 
 /** A global jump buffer. It should not be used directly. */
 jmp_buf test_jump_buffer;
@@ -88,6 +89,43 @@ static void populateTestErrorMessage(const char *format, va_list arguments)
   }
 }
 
+/** Stops the worker pool of the calling thread, like the real die() does.
+  Worker threads will exit inside this function, so only the thread which
+  started the pool stores the error message and jumps back into the assert
+  statement.
+*/
+#ifdef __GNUC__
+static void stopWorkerPool(int error_number, const char *format, va_list arguments) __attribute__((nonnull(2)));
+#endif
+static void stopWorkerPool(const int error_number, const char *format, va_list arguments)
+{
+  const int saved_errno = errno;
+  va_list arguments_copy;
+  va_copy(arguments_copy, arguments);
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#endif
+  const int length = vsnprintf(NULL, 0, format, arguments_copy);
+  va_end(arguments_copy);
+
+  char message[length > 0 ? length + 1 : 1];
+  message[0] = '\0';
+  if(length > 0)
+  {
+    va_copy(arguments_copy, arguments);
+    vsnprintf(message, sizeof(message), format, arguments_copy);
+    va_end(arguments_copy);
+  }
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+  workerPoolStopOnDie(error_number, message);
+  errno = saved_errno;
+}
+
 /* The next two functions are alternative implementations of the die() and
    dieErrno() functions. If test_catch_die is true, they will store the
    error message in test_error_message and jump back into the last assert
@@ -98,6 +136,7 @@ void die(const char *format, ...)
 {
   va_list arguments;
   va_start(arguments, format);
+  stopWorkerPool(0, format, arguments);
   populateTestErrorMessage(format, arguments);
   va_end(arguments);
 
@@ -115,6 +154,7 @@ void dieErrno(const char *format, ...)
 {
   va_list arguments;
   va_start(arguments, format);
+  stopWorkerPool(errno, format, arguments);
   populateTestErrorMessage(format, arguments);
   va_end(arguments);
 
@@ -0,0 +1,149 @@
+#include "thread-local.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "CRegion/region.h"
+
+#include "test.h"
+#include "worker-pool.h"
+
+#define JOB_COUNT 800
+
+typedef struct
+{
+  size_t ids[JOB_COUNT];
+} IdContext;
+
+/** Fills thread-local buffers with the id of the current thread and
+  checks that no other thread has modified them. */
+static void fillBuffers(const size_t index, WorkerPool *pool, void *user_data)
+{
+  IdContext *ctx = user_data;
+  const size_t id = threadLocalId();
+  const size_t size = 1 + (index * 97) % 8192;
+
+  unsigned char *buffer = threadLocalBuffer(TB_io, size);
+  memset(buffer, (int)(id % 256), size);
+
+  char *data = CR_RegionAlloc(threadLocalRegion(), 64);
+  memset(data, 'x', 64);
+
+  for(size_t byte = 0; byte < size; byte++)
+  {
+    if(buffer[byte] != (unsigned char)(id % 256))
+    {
+      workerPoolFail(pool, 0, "buffer of thread %zu was modified", id);
+      return;
+    }
+  }
+  ctx->ids[index] = id;
+}
+
+static void *useMemory(void *data)
+{
+  (void)data;
+  (void)threadLocalBuffer(TB_io, 1 << 16);
+  (void)threadLocalAllocator(TA_temporary);
+  (void)CR_RegionAlloc(threadLocalRegion(), 4096);
+
+  return NULL;
+}
+
+static const CR_RegionStatistics *getThreadLocalStatistics(void)
+{
+  const CR_RegionStatistics *statistics;
+  const size_t tag_count = CR_GetStatistics(&statistics);
+  for(size_t index = 0; index < tag_count; index++)
+  {
+    if(strcmp(statistics[index].tag, "thread-local") == 0)
+    {
+      return &statistics[index];
+    }
+  }
+  return NULL;
+}
+
+int main(void)
+{
+  CR_EnableStatistics();
+
+  testGroupStart("reuse buffers");
+  {
+    char *buffer = threadLocalBuffer(TB_io, 16);
+    memcpy(buffer, "0123456789abcdef", 16);
+    assert_true(threadLocalBuffer(TB_io, 8) == buffer);
+
+    /* Content gets preserved when growing. */
+    buffer = threadLocalBuffer(TB_io, 1 << 20);
+    assert_true(memcmp(buffer, "0123456789abcdef", 16) == 0);
+    assert_true(threadLocalBuffer(TB_io, 1 << 20) == buffer);
+
+    assert_true(threadLocalBuffer(TB_hash, 16) != buffer);
+    assert_true(threadLocalBuffer(TB_repo_path, 16) != buffer);
+
+    Allocator *a = threadLocalAllocator(TA_temporary);
+    assert_true(a != NULL);
+    assert_true(threadLocalAllocator(TA_temporary) == a);
+    assert_true(threadLocalAllocator(TA_temporary_secondary) != a);
+
+    assert_true(threadLocalRegion() == threadLocalRegion());
+    assert_true(threadLocalId() == threadLocalId());
+  }
+  testGroupEnd();
+
+  testGroupStart("separate memory per thread");
+  {
+    static IdContext ctx;
+    const size_t main_id = threadLocalId();
+
+    workerPoolRun(8, JOB_COUNT, fillBuffers, &ctx);
+
+    size_t distinct_ids[8];
+    size_t distinct_id_count = 0;
+    for(size_t index = 0; index < JOB_COUNT; index++)
+    {
+      bool is_known = false;
+      for(size_t id = 0; id < distinct_id_count; id++)
+      {
+        is_known |= distinct_ids[id] == ctx.ids[index];
+      }
+      if(!is_known)
+      {
+        assert_true(distinct_id_count < 8);
+        distinct_ids[distinct_id_count] = ctx.ids[index];
+        distinct_id_count++;
+      }
+    }
+    assert_true(distinct_id_count >= 1);
+
+    /* The main thread keeps its id while processing jobs. */
+    assert_true(threadLocalId() == main_id);
+  }
+  testGroupEnd();
+
+  testGroupStart("release memory when threads exit");
+  {
+    const CR_RegionStatistics *statistics = getThreadLocalStatistics();
+    assert_true(statistics != NULL);
+    const size_t region_count = statistics->region_count;
+    const uint64_t bytes_in_use = statistics->bytes_in_use;
+
+    pthread_t threads[4];
+    for(size_t index = 0; index < 4; index++)
+    {
+      assert_true(pthread_create(&threads[index], NULL, useMemory, NULL) == 0);
+    }
+    for(size_t index = 0; index < 4; index++)
+    {
+      assert_true(pthread_join(threads[index], NULL) == 0);
+    }
+
+    statistics = getThreadLocalStatistics();
+    assert_true(statistics->region_count == region_count + 4);
+    assert_true(statistics->bytes_in_use == bytes_in_use);
+    assert_true(statistics->high_water >= bytes_in_use + (1 << 16));
+  }
+  testGroupEnd();
+}
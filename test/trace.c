@@ -0,0 +1,169 @@
+#include "trace.h"
+
+#include "CRegion/alloc-growable.h"
+
+#include "safe-wrappers.h"
+#include "test.h"
+#include "worker-pool.h"
+
+static void countBytes(const size_t index, WorkerPool *pool, void *user_data)
+{
+  (void)pool;
+  (void)user_data;
+  traceCount(TR_bytes_hashed, index);
+}
+
+/** Asserts that the given content contains the specified string. */
+static bool containsString(const FileContent content, const char *string)
+{
+  const size_t length = strlen(string);
+  for(size_t index = 0; index + length <= content.size; index++)
+  {
+    if(memcmp(&content.content[index], string, length) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static const CR_RegionStatistics *getRegionStatistics(const char *tag)
+{
+  const CR_RegionStatistics *statistics;
+  const size_t tag_count = CR_GetStatistics(&statistics);
+  for(size_t index = 0; index < tag_count; index++)
+  {
+    if(strcmp(statistics[index].tag, tag) == 0)
+    {
+      return &statistics[index];
+    }
+  }
+  return NULL;
+}
+
+int main(void)
+{
+  testGroupStart("do nothing if disabled");
+  traceCount(TR_files_stated, 5);
+  tracePhaseBegin(TP_scrub);
+  tracePhaseEnd(TP_scrub);
+  tracePhaseEnd(TP_scrub);
+  assert_true(traceGetCount(TR_files_stated) == 0);
+  assert_true(traceGetPhaseCalls(TP_scrub) == 0);
+  testGroupEnd();
+
+  testGroupStart("count from multiple threads");
+  traceEnable();
+  traceCount(TR_files_stated, 5);
+  traceCount(TR_files_stated, 0);
+  traceCount(TR_files_stated, 2);
+  assert_true(traceGetCount(TR_files_stated) == 7);
+  assert_true(traceGetCount(TR_bytes_copied) == 0);
+
+  workerPoolRun(8, 1000, countBytes, NULL);
+  assert_true(traceGetCount(TR_bytes_hashed) == 999 * 1000 / 2);
+  testGroupEnd();
+
+  testGroupStart("saturate counters");
+  traceCount(TR_bytes_copied, UINT64_MAX - 3);
+  traceCount(TR_bytes_copied, 3);
+  assert_true(traceGetCount(TR_bytes_copied) == UINT64_MAX);
+  traceCount(TR_bytes_copied, 10);
+  assert_true(traceGetCount(TR_bytes_copied) == UINT64_MAX);
+  testGroupEnd();
+
+  testGroupStart("record phases");
+  tracePhaseBegin(TP_load_metadata);
+  tracePhaseEnd(TP_load_metadata);
+  tracePhaseBegin(TP_load_metadata);
+  tracePhaseBegin(TP_initiate_backup);
+  tracePhaseEnd(TP_initiate_backup);
+  tracePhaseEnd(TP_load_metadata);
+  assert_true(traceGetPhaseCalls(TP_load_metadata) == 2);
+  assert_true(traceGetPhaseCalls(TP_initiate_backup) == 1);
+  assert_true(traceGetPhaseCalls(TP_scrub) == 0);
+
+  tracePhaseBegin(TP_scrub);
+  assert_error(tracePhaseBegin(TP_scrub), "trace phase was entered twice: scrub");
+  tracePhaseEnd(TP_scrub);
+  assert_error(tracePhaseEnd(TP_scrub), "trace phase was left without being entered: scrub");
+  assert_error(tracePhaseEnd(TP_finish_restore),
+               "trace phase was left without being entered: finish_restore");
+  assert_true(traceGetPhaseCalls(TP_scrub) == 1);
+  assert_true(traceGetPhaseCalls(TP_finish_restore) == 0);
+  testGroupEnd();
+
+  testGroupStart("track memory of regions");
+  {
+    assert_true(getRegionStatistics("trace test") == NULL);
+
+    CR_Region *r = CR_RegionNew();
+    CR_RegionSetTag(r, "trace test");
+    (void)CR_RegionAlloc(r, 100);
+    (void)CR_RegionAllocUnaligned(r, 3);
+    char *buffer = CR_RegionAllocGrowable(r, 10);
+    buffer = CR_EnsureCapacity(buffer, 5000);
+    buffer = CR_EnsureCapacity(buffer, 20);
+
+    const CR_RegionStatistics *statistics = getRegionStatistics("trace test");
+    assert_true(statistics != NULL);
+    assert_true(statistics->region_count == 1);
+    assert_true(statistics->bytes_requested >= 100 + 3 + 5000);
+    assert_true(statistics->bytes_requested < 100 + 3 + 5000 + 64);
+    assert_true(statistics->bytes_allocated >= 1024 + 5000);
+    assert_true(statistics->bytes_in_use == statistics->bytes_allocated);
+    assert_true(statistics->high_water == statistics->bytes_in_use);
+
+    const uint64_t high_water = statistics->high_water;
+    CR_RegionRelease(r);
+    statistics = getRegionStatistics("trace test");
+    assert_true(statistics->bytes_in_use == 0);
+    assert_true(statistics->high_water == high_water);
+    assert_true(CR_GetHighWater() >= high_water);
+
+    /* Tags are compared by content. */
+    static char tag_copy[] = "trace test";
+    r = CR_RegionNew();
+    CR_RegionSetTag(r, tag_copy);
+    (void)CR_RegionAlloc(r, 8);
+    assert_true(getRegionStatistics("trace test")->region_count == 2);
+    assert_true(getRegionStatistics("trace test")->bytes_in_use == 1024);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("write report");
+  {
+    tracePhaseBegin(TP_collect_garbage);
+
+    FILE *stream = fopen("tmp/report.json", "w");
+    assert_true(stream != NULL);
+    traceWriteReport(stream);
+    assert_true(fclose(stream) == 0);
+
+    CR_Region *r = CR_RegionNew();
+    const FileContent content = sGetFilesContent(r, str("tmp/report.json"));
+    assert_true(content.size > 0);
+    const char *expected_start = "{\"phases\":{\"load_metadata\":{\"calls\":2,";
+    assert_true(memcmp(content.content, expected_start, strlen(expected_start)) == 0);
+    assert_true(content.content[content.size - 1] == '\n');
+    assert_true(content.content[content.size - 2] == '}');
+    assert_true(containsString(content, "\"initiate_backup\":{\"calls\":1,\"wall_ms\":"));
+    assert_true(containsString(content, "\"collect_garbage\":{\"calls\":1,"));
+    assert_true(containsString(content, "\"finish_restore\":{\"calls\":0,\"wall_ms\":0.000,\"cpu_ms\":0.000}"));
+    assert_true(containsString(content, "},\"counters\":{\"files_stated\":7,"));
+    assert_true(containsString(content, "\"bytes_hashed\":499500,"));
+    assert_true(containsString(content, "\"bytes_copied\":18446744073709551615,"));
+    assert_true(containsString(content, "\"metadata_paths_loaded\":0},\"memory\":{\"high_water\":"));
+    assert_true(containsString(content, "\"trace test\":{\"count\":2,\"bytes_requested\":"));
+    assert_true(containsString(content, ",\"bytes_in_use\":0,\"high_water\":"));
+    assert_true(containsString(content, "}}}\n"));
+    CR_RegionRelease(r);
+
+    /* Running phases got stopped by the report. */
+    tracePhaseBegin(TP_collect_garbage);
+    tracePhaseEnd(TP_collect_garbage);
+    assert_true(traceGetPhaseCalls(TP_collect_garbage) == 2);
+  }
+  testGroupEnd();
+}
@@ -0,0 +1,349 @@
+#include "worker-pool.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "CRegion/region.h"
+
+#include "error-handling.h"
+#include "safe-wrappers.h"
+#include "test.h"
+#include "thread-local.h"
+#include "worker-queue.h"
+
+typedef struct
+{
+  size_t *calls_per_job;
+  size_t total_calls;
+  size_t fail_at_job;
+  bool has_failed;
+} TestContext;
+
+static void countCalls(const size_t index, WorkerPool *pool, void *user_data)
+{
+  TestContext *ctx = user_data;
+  ctx->calls_per_job[index]++;
+
+  workerPoolLock(pool);
+  ctx->total_calls++;
+  workerPoolUnlock(pool);
+
+  if(index == ctx->fail_at_job)
+  {
+    workerPoolFail(pool, 0, "job %zu failed", index);
+    ctx->has_failed = workerPoolHasFailed(pool);
+
+    /* Only the first error will be reported. */
+    workerPoolFail(pool, EIO, "second error");
+  }
+}
+
+static void failWithErrno(const size_t index, WorkerPool *pool, void *user_data)
+{
+  (void)user_data;
+  workerPoolFail(pool, ENOENT, "failed to process \"%s\" in job %zu", "foo", index);
+}
+
+typedef struct
+{
+  size_t die_at_job;
+  size_t started_jobs;
+  pthread_t main_thread;
+} DieContext;
+
+static void dieInJob(const size_t index, WorkerPool *pool, void *user_data)
+{
+  DieContext *ctx = user_data;
+
+  workerPoolLock(pool);
+  ctx->started_jobs++;
+  if(index == ctx->die_at_job)
+  {
+    /* Must not block other jobs waiting for the lock. */
+    die("job %zu died", index);
+  }
+  workerPoolUnlock(pool);
+}
+
+/** Dies only on threads started by the worker pool. */
+static void dieOnWorkerThread(const size_t index, WorkerPool *pool, void *user_data)
+{
+  const DieContext *ctx = user_data;
+  if(pthread_equal(pthread_self(), ctx->main_thread))
+  {
+    while(!workerPoolHasFailed(pool))
+    {
+      sched_yield();
+    }
+    return;
+  }
+
+  (void)index;
+  errno = EACCES;
+  dieErrno("worker job failed");
+}
+
+static void startNestedPool(const size_t index, WorkerPool *pool, void *user_data)
+{
+  (void)index;
+  (void)pool;
+  workerPoolRun(2, 2, dieInJob, user_data);
+}
+
+/** Uses functions which allocate from regions and thread-local buffers,
+  and dies in some jobs. */
+static void useSafeWrappers(const size_t index, WorkerPool *pool, void *user_data)
+{
+  (void)pool;
+  const size_t die_every_nth_job = *(const size_t *)user_data;
+
+  char path[64];
+  sprintf(path, "tmp/file-%zu", index);
+  FileStream *stream = sFopenWrite(str(path));
+  sFwrite(path, strlen(path), stream);
+  sFclose(stream);
+
+  CR_Region *r = CR_RegionNew();
+  const FileContent content = sGetFilesContent(r, str(path));
+  if(content.size != strlen(path) || memcmp(content.content, path, content.size) != 0)
+  {
+    die("wrong content in \"%s\"", path);
+  }
+  CR_RegionRelease(r);
+  sRemove(str(path));
+
+  (void)threadLocalBuffer(TB_io, 1 + index % 4096);
+  if(die_every_nth_job > 0 && index % die_every_nth_job == die_every_nth_job - 1)
+  {
+    die("job %zu died", index);
+  }
+}
+
+typedef struct
+{
+  WorkerLatch *latch;
+  size_t last_job;
+  bool waited;
+} StealContext;
+
+/** The first job waits until the last job has finished. This can only
+  happen if another thread steals the last job. */
+static void waitForLastJob(const size_t index, WorkerPool *pool, void *user_data)
+{
+  StealContext *ctx = user_data;
+  if(index == 0)
+  {
+    ctx->waited = workerLatchWait(ctx->latch, pool);
+  }
+  else if(index == ctx->last_job)
+  {
+    workerLatchCountDown(ctx->latch);
+  }
+}
+
+typedef void RunFunction(size_t thread_count, size_t job_count, WorkerJob *job, void *user_data);
+
+/** Runs the given amount of jobs and asserts that each of them was
+  processed exactly once. */
+static void testRunWith(RunFunction *run, const size_t thread_count, const size_t job_count)
+{
+  size_t calls_per_job[job_count + 1];
+  memset(calls_per_job, 0, sizeof(calls_per_job));
+  TestContext ctx = { .calls_per_job = calls_per_job, .total_calls = 0, .fail_at_job = job_count };
+
+  run(thread_count, job_count, countCalls, &ctx);
+
+  assert_true(ctx.total_calls == job_count);
+  for(size_t index = 0; index < job_count; index++)
+  {
+    assert_true(calls_per_job[index] == 1);
+  }
+  assert_true(calls_per_job[job_count] == 0);
+}
+
+static void testRun(const size_t thread_count, const size_t job_count)
+{
+  testRunWith(workerPoolRun, thread_count, job_count);
+}
+
+static void testRunUnordered(const size_t thread_count, const size_t job_count)
+{
+  testRunWith(workerPoolRunUnordered, thread_count, job_count);
+}
+
+static void writeFile(const char *path, const char *content)
+{
+  FileStream *stream = sFopenWrite(str(path));
+  sFwrite(content, strlen(content), stream);
+  sFclose(stream);
+}
+
+int main(void)
+{
+  testGroupStart("workerPoolDefaultSize()");
+  assert_true(workerPoolDefaultSize() >= 1);
+  testGroupEnd();
+
+  testGroupStart("read cpu limit of cgroups");
+  {
+    assert_true(workerPoolCgroupCpuLimit("tmp/non-existing") == 0);
+
+    sMkdir(str("tmp/cgroup"));
+    writeFile("tmp/cgroup/cpu.max", "max 100000\n");
+    assert_true(workerPoolCgroupCpuLimit("tmp/cgroup") == 0);
+    writeFile("tmp/cgroup/cpu.max", "200000 100000\n");
+    assert_true(workerPoolCgroupCpuLimit("tmp/cgroup") == 2);
+    writeFile("tmp/cgroup/cpu.max", "150000 100000\n");
+    assert_true(workerPoolCgroupCpuLimit("tmp/cgroup") == 2);
+    writeFile("tmp/cgroup/cpu.max", "5000 100000\n");
+    assert_true(workerPoolCgroupCpuLimit("tmp/cgroup") == 1);
+    writeFile("tmp/cgroup/cpu.max", "");
+    assert_true(workerPoolCgroupCpuLimit("tmp/cgroup") == 0);
+    sRemove(str("tmp/cgroup/cpu.max"));
+
+    sMkdir(str("tmp/cgroup/cpu"));
+    writeFile("tmp/cgroup/cpu/cpu.cfs_quota_us", "-1\n");
+    writeFile("tmp/cgroup/cpu/cpu.cfs_period_us", "100000\n");
+    assert_true(workerPoolCgroupCpuLimit("tmp/cgroup") == 0);
+    writeFile("tmp/cgroup/cpu/cpu.cfs_quota_us", "300000\n");
+    assert_true(workerPoolCgroupCpuLimit("tmp/cgroup") == 3);
+    sRemove(str("tmp/cgroup/cpu/cpu.cfs_period_us"));
+    assert_true(workerPoolCgroupCpuLimit("tmp/cgroup") == 0);
+
+    sRemoveRecursively(str("tmp/cgroup"));
+  }
+  testGroupEnd();
+
+  testGroupStart("process all jobs");
+  testRun(0, 0);
+  testRun(1, 0);
+  testRun(8, 0);
+  testRun(0, 1);
+  testRun(1, 1);
+  testRun(1, 50);
+  testRun(4, 1);
+  testRun(4, 3);
+  testRun(4, 1000);
+  testRun(64, 20);
+  testRun(workerPoolDefaultSize(), 10000);
+  testGroupEnd();
+
+  testGroupStart("process all jobs unordered");
+  testRunUnordered(0, 0);
+  testRunUnordered(1, 0);
+  testRunUnordered(8, 0);
+  testRunUnordered(0, 1);
+  testRunUnordered(1, 1);
+  testRunUnordered(1, 50);
+  testRunUnordered(4, 1);
+  testRunUnordered(4, 3);
+  testRunUnordered(4, 1000);
+  testRunUnordered(64, 20);
+  testRunUnordered(7, 100003);
+  testRunUnordered(workerPoolDefaultSize(), 10000);
+  testGroupEnd();
+
+  testGroupStart("steal jobs from other threads");
+  for(size_t job_count = 4; job_count <= 200; job_count += 11)
+  {
+    CR_Region *r = CR_RegionNew();
+    StealContext ctx = { .latch = workerLatchNew(r, 1), .last_job = job_count / 2 - 1, .waited = false };
+    workerPoolRunUnordered(2, job_count, waitForLastJob, &ctx);
+    assert_true(ctx.waited);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("forward errors to die()");
+  {
+    size_t calls_per_job[1000] = { 0 };
+    TestContext ctx = { .calls_per_job = calls_per_job, .total_calls = 0, .fail_at_job = 0 };
+    assert_error(workerPoolRun(1, 1000, countCalls, &ctx), "job 0 failed");
+
+    /* No jobs get started after a failure. */
+    assert_true(ctx.has_failed);
+    assert_true(ctx.total_calls == 1);
+    assert_true(calls_per_job[0] == 1);
+    assert_true(calls_per_job[1] == 0);
+
+    memset(calls_per_job, 0, sizeof(calls_per_job));
+    ctx.total_calls = 0;
+    ctx.fail_at_job = 10;
+    ctx.has_failed = false;
+    assert_error(workerPoolRun(4, 1000, countCalls, &ctx), "job 10 failed");
+    assert_true(ctx.has_failed);
+    assert_true(calls_per_job[10] == 1);
+    assert_true(ctx.total_calls < 1000);
+
+    assert_error_errno(workerPoolRun(1, 5, failWithErrno, NULL), "failed to process \"foo\" in job 0", ENOENT);
+
+    memset(calls_per_job, 0, sizeof(calls_per_job));
+    ctx.total_calls = 0;
+    ctx.fail_at_job = 0;
+    ctx.has_failed = false;
+    assert_error(workerPoolRunUnordered(1, 1000, countCalls, &ctx), "job 0 failed");
+    assert_true(ctx.has_failed);
+    assert_true(ctx.total_calls == 1);
+
+    memset(calls_per_job, 0, sizeof(calls_per_job));
+    ctx.total_calls = 0;
+    ctx.fail_at_job = 700;
+    ctx.has_failed = false;
+    assert_error(workerPoolRunUnordered(4, 1000, countCalls, &ctx), "job 700 failed");
+    assert_true(ctx.has_failed);
+    assert_true(calls_per_job[700] == 1);
+    assert_true(ctx.total_calls < 1000);
+    for(size_t index = 0; index < 1000; index++)
+    {
+      assert_true(calls_per_job[index] <= 1);
+    }
+  }
+  testGroupEnd();
+
+  testGroupStart("stop jobs on die()");
+  {
+    DieContext ctx = { .die_at_job = 0, .started_jobs = 0 };
+    assert_error(workerPoolRun(1, 1000, dieInJob, &ctx), "job 0 died");
+    assert_true(ctx.started_jobs == 1);
+
+    ctx.die_at_job = 500;
+    ctx.started_jobs = 0;
+    assert_error(workerPoolRun(8, 1000, dieInJob, &ctx), "job 500 died");
+    assert_true(ctx.started_jobs > 500);
+    assert_true(ctx.started_jobs < 1000);
+
+    ctx.main_thread = pthread_self();
+    assert_error_errno(workerPoolRun(2, 2, dieOnWorkerThread, &ctx), "worker job failed", EACCES);
+
+    ctx.die_at_job = 1000;
+    assert_error(workerPoolRun(1, 1, startNestedPool, &ctx), "worker pools can not be nested");
+
+    ctx.die_at_job = 900;
+    ctx.started_jobs = 0;
+    assert_error(workerPoolRunUnordered(8, 1000, dieInJob, &ctx), "job 900 died");
+
+    /* Pools still work after being stopped. */
+    testRun(4, 100);
+    testRunUnordered(4, 100);
+  }
+  testGroupEnd();
+
+  testGroupStart("use safe wrappers in jobs");
+  {
+    size_t die_every_nth_job = 0;
+    workerPoolRun(8, 1000, useSafeWrappers, &die_every_nth_job);
+    assert_true(!sPathExists(str("tmp/file-0")));
+
+    for(size_t run = 0; run < 100; run++)
+    {
+      die_every_nth_job = 1 + run % 13;
+      assert_error_any(workerPoolRun(8, 64, useSafeWrappers, &die_every_nth_job));
+      assert_error_any(workerPoolRunUnordered(8, 64, useSafeWrappers, &die_every_nth_job));
+    }
+    testRun(8, 100);
+  }
+  testGroupEnd();
+}
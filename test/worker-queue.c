@@ -0,0 +1,226 @@
+#include "worker-queue.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "error-handling.h"
+#include "test.h"
+
+#define PRODUCER_COUNT 4
+#define CONSUMER_COUNT 3
+#define ITEMS_PER_PRODUCER 5000
+
+static void *toItem(const size_t value)
+{
+  return (void *)(uintptr_t)value;
+}
+
+static size_t fromItem(void *item)
+{
+  return (size_t)(uintptr_t)item;
+}
+
+typedef struct
+{
+  WorkerQueue *queue;
+  WorkerLatch *producers_done;
+  size_t pops_per_item[PRODUCER_COUNT * ITEMS_PER_PRODUCER + 1];
+  size_t items_per_consumer[CONSUMER_COUNT];
+  size_t failed_calls;
+} PipelineContext;
+
+/** The first jobs produce items, followed by a job which closes the queue
+  once all producers are done. All other jobs consume items. */
+static void runPipeline(const size_t index, WorkerPool *pool, void *user_data)
+{
+  PipelineContext *ctx = user_data;
+  if(index < PRODUCER_COUNT)
+  {
+    size_t failed_pushes = 0;
+    for(size_t item = 0; item < ITEMS_PER_PRODUCER; item++)
+    {
+      failed_pushes += !workerQueuePush(ctx->queue, pool, toItem(1 + index * ITEMS_PER_PRODUCER + item));
+    }
+    workerLatchCountDown(ctx->producers_done);
+
+    workerPoolLock(pool);
+    ctx->failed_calls += failed_pushes;
+    workerPoolUnlock(pool);
+  }
+  else if(index == PRODUCER_COUNT)
+  {
+    const bool success = workerLatchWait(ctx->producers_done, pool);
+    workerQueueClose(ctx->queue);
+
+    workerPoolLock(pool);
+    ctx->failed_calls += !success;
+    workerPoolUnlock(pool);
+  }
+  else
+  {
+    const size_t consumer = index - PRODUCER_COUNT - 1;
+    void *item;
+    while(workerQueuePop(ctx->queue, pool, &item))
+    {
+      workerPoolLock(pool);
+      ctx->pops_per_item[fromItem(item)]++;
+      workerPoolUnlock(pool);
+      ctx->items_per_consumer[consumer]++;
+    }
+  }
+}
+
+typedef struct
+{
+  WorkerQueue *full_queue;
+  WorkerQueue *empty_queue;
+  WorkerLatch *latch;
+  bool use_die;
+  bool push_returned;
+  bool pop_returned;
+  bool wait_returned;
+} FailureContext;
+
+/** The first jobs block on a full queue, an empty queue and a latch,
+  until the last job fails. */
+static void failWhileBlocked(const size_t index, WorkerPool *pool, void *user_data)
+{
+  FailureContext *ctx = user_data;
+  if(index == 0)
+  {
+    ctx->push_returned = workerQueuePush(ctx->full_queue, pool, toItem(1));
+  }
+  else if(index == 1)
+  {
+    void *item;
+    ctx->pop_returned = workerQueuePop(ctx->empty_queue, pool, &item);
+  }
+  else if(index == 2)
+  {
+    ctx->wait_returned = workerLatchWait(ctx->latch, pool);
+  }
+  else if(ctx->use_die)
+  {
+    die("job %zu died", index);
+  }
+  else
+  {
+    workerPoolFail(pool, 0, "job %zu failed", index);
+  }
+}
+
+int main(void)
+{
+  testGroupStart("push and pop items");
+  {
+    CR_Region *r = CR_RegionNew();
+    WorkerQueue *queue = workerQueueNew(r, 3);
+
+    void *item = NULL;
+    for(size_t round = 0; round < 10; round++)
+    {
+      assert_true(workerQueuePush(queue, NULL, toItem(round * 3 + 1)));
+      assert_true(workerQueuePush(queue, NULL, toItem(round * 3 + 2)));
+      assert_true(workerQueuePop(queue, NULL, &item));
+      assert_true(fromItem(item) == round * 3 + 1);
+      assert_true(workerQueuePush(queue, NULL, toItem(round * 3 + 3)));
+      assert_true(workerQueuePop(queue, NULL, &item));
+      assert_true(fromItem(item) == round * 3 + 2);
+      assert_true(workerQueuePop(queue, NULL, &item));
+      assert_true(fromItem(item) == round * 3 + 3);
+    }
+
+    assert_true(workerQueuePush(queue, NULL, toItem(7)));
+    assert_true(workerQueuePush(queue, NULL, NULL));
+    workerQueueClose(queue);
+    assert_true(!workerQueuePush(queue, NULL, toItem(8)));
+
+    /* Remaining items can be removed after closing. */
+    assert_true(workerQueuePop(queue, NULL, &item));
+    assert_true(fromItem(item) == 7);
+    assert_true(workerQueuePop(queue, NULL, &item));
+    assert_true(item == NULL);
+    item = toItem(9);
+    assert_true(!workerQueuePop(queue, NULL, &item));
+    assert_true(fromItem(item) == 9);
+
+    assert_error(workerQueueNew(r, 0), "unable to create queue with a capacity of 0");
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("count down latches");
+  {
+    CR_Region *r = CR_RegionNew();
+    assert_true(workerLatchWait(workerLatchNew(r, 0), NULL));
+
+    WorkerLatch *latch = workerLatchNew(r, 3);
+    workerLatchCountDown(latch);
+    workerLatchCountDown(latch);
+    workerLatchCountDown(latch);
+    assert_true(workerLatchWait(latch, NULL));
+    workerLatchCountDown(latch);
+    assert_true(workerLatchWait(latch, NULL));
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("pass items between threads");
+  for(size_t capacity = 1; capacity <= 1000; capacity *= 10)
+  {
+    CR_Region *r = CR_RegionNew();
+    PipelineContext *ctx = CR_RegionAlloc(r, sizeof(*ctx));
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->queue = workerQueueNew(r, capacity);
+    ctx->producers_done = workerLatchNew(r, PRODUCER_COUNT);
+
+    const size_t job_count = PRODUCER_COUNT + 1 + CONSUMER_COUNT;
+    workerPoolRun(job_count, job_count, runPipeline, ctx);
+    assert_true(ctx->failed_calls == 0);
+
+    assert_true(ctx->pops_per_item[0] == 0);
+    for(size_t index = 1; index <= PRODUCER_COUNT * ITEMS_PER_PRODUCER; index++)
+    {
+      assert_true(ctx->pops_per_item[index] == 1);
+    }
+
+    size_t total_items = 0;
+    for(size_t consumer = 0; consumer < CONSUMER_COUNT; consumer++)
+    {
+      total_items += ctx->items_per_consumer[consumer];
+    }
+    assert_true(total_items == PRODUCER_COUNT * ITEMS_PER_PRODUCER);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+
+  testGroupStart("stop waiting when the pool fails");
+  for(size_t run = 0; run < 2; run++)
+  {
+    CR_Region *r = CR_RegionNew();
+    FailureContext ctx = {
+      .full_queue = workerQueueNew(r, 1),
+      .empty_queue = workerQueueNew(r, 1),
+      .latch = workerLatchNew(r, 1),
+      .use_die = run == 1,
+      .push_returned = true,
+      .pop_returned = true,
+      .wait_returned = true,
+    };
+    assert_true(workerQueuePush(ctx.full_queue, NULL, toItem(1)));
+
+    if(ctx.use_die)
+    {
+      assert_error(workerPoolRun(4, 4, failWhileBlocked, &ctx), "job 3 died");
+    }
+    else
+    {
+      assert_error(workerPoolRun(4, 4, failWhileBlocked, &ctx), "job 3 failed");
+    }
+    assert_true(!ctx.push_returned);
+    assert_true(!ctx.pop_returned);
+    assert_true(!ctx.wait_returned);
+    CR_RegionRelease(r);
+  }
+  testGroupEnd();
+}
@@ -18,6 +18,9 @@ typedef struct
   /** A pointer for updating the pointer attached to the region. */
   void **attached_pointer;
 
+  /** The region which owns the memory. Required for statistics. */
+  CR_Region *r;
+
   /** The capacity of the allocated memory. */
   size_t capacity;
 }Header;
@@ -54,7 +57,9 @@ void *CR_RegionAllocGrowable(CR_Region *r, size_t size)
 
   *attached_pointer = header;
   header->attached_pointer = attached_pointer;
+  header->r = r;
   header->capacity = size;
+  CR_RegionAccount(r, size, chunk_size);
 
   CR_RegionAttach(r, freeAttachedPointer, attached_pointer);
 
@@ -98,6 +103,9 @@ void *CR_EnsureCapacity(void *ptr, size_t size)
   }
 
   *reallocated_header->attached_pointer = reallocated_header;
+  CR_RegionAccount(reallocated_header->r,
+                   size - reallocated_header->capacity,
+                   size - reallocated_header->capacity);
   reallocated_header->capacity = size;
 
   ASAN_POISON_MEMORY_REGION(reallocated_header, sizeof(Header));
@@ -5,14 +5,58 @@
 
 #include "global-region.h"
 
-/** Returns a global region bound to the lifetime of the program. */
+#include <pthread.h>
+#include <stdlib.h>
+
+static void lockMutex(pthread_mutex_t *mutex)
+{
+  if(pthread_mutex_lock(mutex) != 0)
+  {
+    abort();
+  }
+}
+
+static void unlockMutex(pthread_mutex_t *mutex)
+{
+  if(pthread_mutex_unlock(mutex) != 0)
+  {
+    abort();
+  }
+}
+
+/** Returns a global region bound to the lifetime of the program. It can
+  be obtained from any thread, but like every other region it must only
+  be used by one thread at a time. */
 CR_Region *CR_GetGlobalRegion(void)
 {
+  static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
   static CR_Region *r = NULL;
+
+  lockMutex(&mutex);
+  CR_Region *global_region = r;
+  unlockMutex(&mutex);
+  if(global_region != NULL)
+  {
+    return global_region;
+  }
+
+  /* Creating regions may terminate the program, which must not happen
+     while holding the lock. */
+  CR_Region *new_region = CR_RegionNew();
+  CR_RegionSetTag(new_region, "global");
+
+  lockMutex(&mutex);
   if(r == NULL)
   {
-    r = CR_RegionNew();
+    r = new_region;
+    new_region = NULL;
   }
+  global_region = r;
+  unlockMutex(&mutex);
 
-  return r;
+  if(new_region != NULL)
+  {
+    CR_RegionRelease(new_region);
+  }
+  return global_region;
 }
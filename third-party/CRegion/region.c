@@ -4,9 +4,11 @@
 
 #include "region.h"
 
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "error-handling.h"
 #include "safe-math.h"
@@ -14,6 +16,7 @@
 
 #define alignment sizeof(uint64_t)
 #define first_chunk_size 1024
+#define max_statistics_tags 32
 
 /** A list of callbacks. */
 typedef struct CallbackList CallbackList;
@@ -62,19 +65,65 @@ struct CR_Region
   CR_ReleaseCallback *pending_callback;
   void *pending_callback_data;
 
+  /** The statistics to which all allocations of this region get added.
+    NULL if statistics were disabled when the region was created. */
+  CR_RegionStatistics *statistics;
+
+  /** The amount of bytes requested and allocated by this region. */
+  uint64_t bytes_requested;
+  uint64_t bytes_allocated;
+
   /** The previous and next regions. */
   CR_Region *prev, *next;
 };
 
+/** Protects the region list and all statistics. Regions themselves are
+  not protected and must only be used by one thread at a time. */
+static pthread_mutex_t region_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /** A list of all allocated regions. */
 static CR_Region *region_list = NULL;
 
+/** Statistics, which get only collected after CR_EnableStatistics() was
+  called. */
+static bool statistics_enabled = false;
+static CR_RegionStatistics statistics_list[max_statistics_tags];
+static size_t statistics_count = 0;
+static uint64_t total_bytes_in_use = 0;
+static uint64_t total_high_water = 0;
+
+/** Locking can only fail on programming errors, which can't be reported
+  safely while other threads may hold the lock. */
+static void lockRegions(void)
+{
+  if(pthread_mutex_lock(&region_mutex) != 0)
+  {
+    abort();
+  }
+}
+
+static void unlockRegions(void)
+{
+  if(pthread_mutex_unlock(&region_mutex) != 0)
+  {
+    abort();
+  }
+}
+
 /** Releases all known regions. */
 static void releaseAllRegions(void)
 {
-  while(region_list != NULL)
+  while(true)
   {
-    CR_RegionRelease(region_list);
+    lockRegions();
+    CR_Region *r = region_list;
+    unlockRegions();
+
+    if(r == NULL)
+    {
+      break;
+    }
+    CR_RegionRelease(r);
   }
 }
 
@@ -83,17 +132,16 @@ static void releaseAllRegions(void)
 static void ensureRegionsAreInitialized(void)
 {
   static bool initialized = false;
-  if(initialized == true)
-  {
-    return;
-  }
 
-  if(atexit(releaseAllRegions) != 0)
+  lockRegions();
+  const bool success = initialized || atexit(releaseAllRegions) == 0;
+  initialized = success;
+  unlockRegions();
+
+  if(!success)
   {
     CR_ExitFailure("failed to register function with atexit");
   }
-
-  initialized = true;
 }
 
 /** Wrapper around malloc which handles returned NULL pointers. */
@@ -108,8 +156,165 @@ static void *checkedMalloc(size_t size)
   return data;
 }
 
+/** Returns the statistics associated with the given tag. Must be called
+  with the region mutex held.
+
+  @return NULL if the maximal amount of tags was reached.
+*/
+static CR_RegionStatistics *getStatistics(const char *tag)
+{
+  for(size_t index = 0; index < statistics_count; index++)
+  {
+    if(statistics_list[index].tag == tag ||
+       strcmp(statistics_list[index].tag, tag) == 0)
+    {
+      return &statistics_list[index];
+    }
+  }
+
+  if(statistics_count == max_statistics_tags)
+  {
+    return NULL;
+  }
+
+  CR_RegionStatistics *statistics = &statistics_list[statistics_count];
+  statistics_count++;
+
+  statistics->tag = tag;
+  statistics->region_count = 0;
+  statistics->bytes_requested = 0;
+  statistics->bytes_allocated = 0;
+  statistics->bytes_in_use = 0;
+  statistics->high_water = 0;
+
+  return statistics;
+}
+
+/** Implements CR_RegionAccount(). Must be called with the region mutex
+  held. */
+static void account(CR_Region *r, size_t bytes_requested,
+                    size_t bytes_allocated)
+{
+  CR_RegionStatistics *statistics = r->statistics;
+  r->bytes_requested += bytes_requested;
+  r->bytes_allocated += bytes_allocated;
+
+  statistics->bytes_requested += bytes_requested;
+  statistics->bytes_allocated += bytes_allocated;
+  statistics->bytes_in_use += bytes_allocated;
+  if(statistics->bytes_in_use > statistics->high_water)
+  {
+    statistics->high_water = statistics->bytes_in_use;
+  }
+
+  total_bytes_in_use += bytes_allocated;
+  if(total_bytes_in_use > total_high_water)
+  {
+    total_high_water = total_bytes_in_use;
+  }
+}
+
+/** Adds the given amounts of bytes to the statistics of the specified
+  region. Does nothing if the region is not tracked. This function is used
+  by other parts of CRegion, which allocate memory bound to a region.
+
+  @param r The region which owns the memory.
+  @param bytes_requested The amount of bytes requested by the user.
+  @param bytes_allocated The amount of bytes allocated with malloc() or
+  by growing memory with realloc().
+*/
+void CR_RegionAccount(CR_Region *r, size_t bytes_requested,
+                      size_t bytes_allocated)
+{
+  if(r->statistics == NULL)
+  {
+    return;
+  }
+
+  lockRegions();
+  account(r, bytes_requested, bytes_allocated);
+  unlockRegions();
+}
+
+/** Starts tracking the memory usage of all regions created from now on.
+  The overhead is a few additions and a mutex per allocation. */
+void CR_EnableStatistics(void)
+{
+  lockRegions();
+  statistics_enabled = true;
+  unlockRegions();
+}
+
+/** Moves the statistics of the given region to the specified tag. All
+  regions start with the tag "untagged".
+
+  @param r The region to tag. If it was created before statistics were
+  enabled, this function does nothing.
+  @param tag A string describing the owner of the region. Must remain
+  valid until the program exits.
+*/
+void CR_RegionSetTag(CR_Region *r, const char *tag)
+{
+  CR_RegionStatistics *old_statistics = r->statistics;
+  if(old_statistics == NULL)
+  {
+    return;
+  }
+
+  lockRegions();
+  CR_RegionStatistics *new_statistics = getStatistics(tag);
+  if(new_statistics == NULL)
+  {
+    unlockRegions();
+    CR_ExitFailure("too many region tags: \"%s\"", tag);
+  }
+
+  old_statistics->region_count--;
+  old_statistics->bytes_requested -= r->bytes_requested;
+  old_statistics->bytes_allocated -= r->bytes_allocated;
+  old_statistics->bytes_in_use -= r->bytes_allocated;
+  total_bytes_in_use -= r->bytes_allocated;
+
+  const uint64_t bytes_requested = r->bytes_requested;
+  const uint64_t bytes_allocated = r->bytes_allocated;
+  r->bytes_requested = 0;
+  r->bytes_allocated = 0;
+
+  r->statistics = new_statistics;
+  r->statistics->region_count++;
+  account(r, bytes_requested, bytes_allocated);
+  unlockRegions();
+}
+
+/** Returns the statistics of all tags. Must not be called while other
+  threads are using regions.
+
+  @param statistics_out Will be set to an array of statistics, which gets
+  invalidated by the next allocation from any region.
+
+  @return The amount of elements in the array.
+*/
+size_t CR_GetStatistics(const CR_RegionStatistics **statistics_out)
+{
+  *statistics_out = statistics_list;
+  return statistics_count;
+}
+
+/** Returns the maximum amount of bytes held by all tracked regions at the
+  same time. */
+uint64_t CR_GetHighWater(void)
+{
+  lockRegions();
+  const uint64_t high_water = total_high_water;
+  unlockRegions();
+
+  return high_water;
+}
+
 /** Creates a new CR_Region that gets freed automatically on exit, or
-  manually via CR_RegionRelease(). */
+  manually via CR_RegionRelease(). Regions can be created and released by
+  any thread, but each region must only be used by one thread at a
+  time. */
 CR_Region *CR_RegionNew(void)
 {
   ensureRegionsAreInitialized();
@@ -140,6 +345,24 @@ CR_Region *CR_RegionNew(void)
   r->pending_callback = NULL;
   r->pending_callback_data = NULL;
 
+  r->statistics = NULL;
+  r->bytes_requested = 0;
+  r->bytes_allocated = 0;
+
+  lockRegions();
+  if(statistics_enabled)
+  {
+    r->statistics = getStatistics("untagged");
+    if(r->statistics == NULL)
+    {
+      unlockRegions();
+      free(element);
+      CR_ExitFailure("too many region tags: \"untagged\"");
+    }
+    r->statistics->region_count++;
+    account(r, 0, first_chunk_size);
+  }
+
   /* Prepend region to region list. */
   r->prev = NULL;
   r->next = region_list;
@@ -149,6 +372,7 @@ CR_Region *CR_RegionNew(void)
     region_list->prev = r;
   }
   region_list = r;
+  unlockRegions();
 
   return r;
 }
@@ -183,6 +407,7 @@ static void *allocFromChunk(CR_Region *r, Chunk *chunk, size_t size)
   else if(size < chunk->next_chunk_size - sizeof(ChunkList))
   {
     ChunkList *element = checkedMalloc(chunk->next_chunk_size);
+    CR_RegionAccount(r, 0, chunk->next_chunk_size);
 
     chunk->chunk = (unsigned char *)element;
     chunk->bytes_used = sizeof *element;
@@ -197,7 +422,9 @@ static void *allocFromChunk(CR_Region *r, Chunk *chunk, size_t size)
   }
   else
   {
-    ChunkList *element = checkedMalloc(CR_SafeAdd(sizeof(ChunkList), size));
+    const size_t element_size = CR_SafeAdd(sizeof(ChunkList), size);
+    ChunkList *element = checkedMalloc(element_size);
+    CR_RegionAccount(r, 0, element_size);
 
     element->next = r->chunk_list;
     r->chunk_list = element;
@@ -244,6 +471,7 @@ static void *rawMallocWithRegion(CR_Region *r, size_t size)
 
   void *data = checkedMalloc(size);
   CR_RegionAttach(r, free, data);
+  CR_RegionAccount(r, 0, size);
 
   return data;
 }
@@ -263,6 +491,7 @@ static void *rawMallocWithRegion(CR_Region *r, size_t size)
 */
 void *CR_RegionAlloc(CR_Region *r, size_t size)
 {
+  CR_RegionAccount(r, size, 0);
 #ifdef CREGION_ALWAYS_FRESH_MALLOC
   return rawMallocWithRegion(r, size);
 #else
@@ -273,6 +502,7 @@ void *CR_RegionAlloc(CR_Region *r, size_t size)
 /** Like CR_RegionAlloc() but without aligning memory. */
 void *CR_RegionAllocUnaligned(CR_Region *r, size_t size)
 {
+  CR_RegionAccount(r, size, 0);
 #ifdef CREGION_ALWAYS_FRESH_MALLOC
   return rawMallocWithRegion(r, size);
 #else
@@ -325,6 +555,7 @@ void CR_RegionRelease(CR_Region *r)
   }
 
   /* Detach the region from the region-list. */
+  lockRegions();
   if(r->prev != NULL)
   {
     r->prev->next = r->next;
@@ -338,6 +569,13 @@ void CR_RegionRelease(CR_Region *r)
     region_list = region_list->next;
   }
 
+  if(r->statistics != NULL)
+  {
+    r->statistics->bytes_in_use -= r->bytes_allocated;
+    total_bytes_in_use -= r->bytes_allocated;
+  }
+  unlockRegions();
+
   /* Free all chunks associated with the region. */
   ChunkList *element = r->chunk_list;
   while(element != NULL)
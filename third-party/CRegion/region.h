@@ -6,6 +6,7 @@
 #define CREGION_SRC_REGION_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 typedef struct CR_Region CR_Region;
 
@@ -19,4 +20,33 @@ extern void *CR_RegionAllocUnaligned(CR_Region *r, size_t size);
 extern void CR_RegionAttach(CR_Region *r, CR_ReleaseCallback *callback, void *data);
 extern void CR_RegionRelease(CR_Region *r);
 
+/** Memory usage of all regions sharing the same tag. */
+typedef struct
+{
+  const char *tag;
+
+  /** The amount of regions created with this tag. */
+  size_t region_count;
+
+  /** The sum of all sizes passed to allocation functions. */
+  uint64_t bytes_requested;
+
+  /** The sum of all chunks allocated with malloc(). The difference to
+    bytes_requested is the overhead of chunks, padding and bookkeeping. */
+  uint64_t bytes_allocated;
+
+  /** The amount of bytes held by regions which were not released yet. */
+  uint64_t bytes_in_use;
+
+  /** The maximum value bytes_in_use ever reached. */
+  uint64_t high_water;
+}CR_RegionStatistics;
+
+extern void CR_EnableStatistics(void);
+extern void CR_RegionSetTag(CR_Region *r, const char *tag);
+extern size_t CR_GetStatistics(const CR_RegionStatistics **statistics_out);
+extern uint64_t CR_GetHighWater(void);
+extern void CR_RegionAccount(CR_Region *r, size_t bytes_requested,
+                             size_t bytes_allocated);
+
 #endif